@@ -11,9 +11,12 @@
 #ifndef BSPTree_H
 #define BSPTree_H
 
+#include <typeinfo>
+
 #include "eckit/container/bsptree/BSPNode.h"
 #include "eckit/container/sptree/SPTree.h"
 
+#include "KDArena.h"
 #include "KDMapped.h"
 #include "KDMemory.h"
 
@@ -48,16 +51,38 @@ class BSPTreeMemory : public BSPTreeX<TT<Traits, KDMemory>, Partition> {
 public:
     BSPTreeMemory() :
         BSPTreeX<TT<Traits, KDMemory>, Partition>(alloc_) {}
+
+    /// Nodes are released while the allocator is alive
+    ~BSPTreeMemory() {
+        alloc_.deleteNode(this->root_, (BSPNode<TT<Traits, KDMemory>, Partition>*)0);
+        this->root_ = 0;
+    }
 };
 
+/// BSPTree with its nodes in an arena, which can outlive it and be reused by the next trees
+template <class Traits, class Partition>
+using BSPTreeArena = BSPTreeX<TT<Traits, KDArena>, Partition>;
+
 template <class Traits, class Partition>
 class BSPTreeMapped : public BSPTreeX<TT<Traits, KDMapped>, Partition> {
+    using Node = BSPNode<TT<Traits, KDMapped>, Partition>;
+
     KDMapped alloc_;
 
 public:
     BSPTreeMapped(const eckit::PathName& path, size_t itemCount, size_t metadataSize) :
         BSPTreeX<TT<Traits, KDMapped>, Partition>(alloc_),
-        alloc_(path, itemCount, sizeof(BSPNode<TT<Traits, KDMapped>, Partition>), metadataSize) {}
+        alloc_(path, itemCount, sizeof(Node), metadataSize, KDMapped::signature(typeid(Node).name(), sizeof(Node))) {}
+
+    /// Build the tree, then finalise the file
+    template <class Container>
+    void build(Container& nodes) {
+        BSPTreeX<TT<Traits, KDMapped>, Partition>::build(nodes);
+        finalise();
+    }
+
+    /// Record the checksum and mark the file complete, so it can be opened by readers
+    void finalise() { alloc_.finalise(); }
 };
 
 
@@ -10,6 +10,7 @@
 
 #include <sys/file.h>
 #include <ostream>
+#include <sstream>
 #ifdef __linux__
 #include <linux/errno.h>
 #ifndef ENOTSUPP
@@ -17,8 +18,13 @@
 #endif
 #endif
 
+#include <sys/mman.h>
+#include <algorithm>
+
+#include "eckit/config/Resource.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/io/FDataSync.h"
+#include "eckit/memory/MMap.h"
 #include "eckit/memory/Zero.h"
 
 namespace eckit {
@@ -62,7 +68,38 @@ void BTree<K, V, S, L>::_NodePage::print(std::ostream& s) const {
 
 template <class K, class V, int S, class L>
 BTree<K, V, S, L>::BTree(const PathName& path, bool readOnly, off_t offset) :
-    path_(path), file_(path, readOnly), cacheReads_(true), cacheWrites_(true), readOnly_(readOnly), offset_(offset) {
+    path_(path),
+    file_(path, readOnly),
+    cacheReads_(true),
+    cacheWrites_(true),
+    readOnly_(readOnly),
+    offset_(offset),
+    cacheSize_(0),
+    readAhead_(0),
+    map_(nullptr),
+    mapSize_(0),
+    writerThread_(std::thread::id()),
+    writerActive_(false),
+    writerDepth_(0),
+    writerNested_(0),
+    readers_(0),
+    readersEnter_(false),
+    waitingFor_(noReaders_),
+    fallbacks_(0),
+    fileLock_(F_UNLCK),
+    changing_(false),
+    mappedReads_(0) {
+    for (auto& v : versions_) {
+        v = 0;
+    }
+
+
+    static const size_t cacheBytes = Resource<size_t>("btreeCacheSize;$ECKIT_BTREE_CACHE_SIZE", 64 * 1024 * 1024);
+    static const size_t readAhead  = Resource<size_t>("btreeReadAhead;$ECKIT_BTREE_READ_AHEAD", 32);
+
+    cacheSize(std::max<size_t>(4, cacheBytes / sizeof(Page)));
+    readAhead_ = readAhead;
+
     file_.open();
 
     AutoLock<BTree<K, V, S, L> > lock(this);
@@ -109,18 +146,67 @@ BTree<K, V, S, L>::~BTree() {
         file_.close();
     }
 
-    for (typename Cache::iterator j = cache_.begin(); j != cache_.end(); ++j)
-        delete (*j).second.page_;
+    if (map_) {
+        MMap::munmap(map_, mapSize_);
+    }
+}
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::cacheSize(size_t pages) {
+    ASSERT(pages > 0);
+    cacheSize_ = pages;
+
+    // every shard holds at least one page: a shard of size 0 would never cache the pages mapped to it
+    for (size_t i = 0; i < shards_; ++i) {
+        Shard& s = cache_[i];
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        s.size_ = std::max<size_t>(1, pages / shards_ + (i < pages % shards_ ? 1 : 0));
+        while (s.cache_.size() > s.size_) {
+            evict(s);
+        }
+    }
+}
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::mmap() {
+    ASSERT(readOnly_);
+    ASSERT(!map_);
+
+    off_t size = file_.seekEnd();
+    if (size <= offset_) {
+        return;
+    }
+
+    void* map = MMap::mmap(nullptr, size_t(size), PROT_READ, MAP_SHARED, file_.fileno(), 0);
+    if (map == MAP_FAILED) {
+        Log::error() << "BTree: mmap(" << path_ << ')' << Log::syserr << std::endl;
+        throw FailedSystemCall("mmap", Here());
+    }
+
+    map_     = map;
+    mapSize_ = size_t(size);
+
+    // pages are now read from the mapping
+    flush();
+
+    for (Shard& s : cache_) {
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        s.cache_.clear();
+        s.lru_.clear();
+    }
 }
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::flush() {
-    for (typename Cache::iterator j = cache_.begin(); j != cache_.end(); ++j) {
-        // Log::info() << "BTree<K,V,S,L>::flush() " << path_ << " " << (*j).first << ", " <<
-        // (*j).second.dirty_ << std::endl;
-        if ((*j).second.dirty_) {
-            _savePage(*(*j).second.page_);
-            (*j).second.dirty_ = false;
+    for (Shard& s : cache_) {
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        for (typename Cache::iterator j = s.cache_.begin(); j != s.cache_.end(); ++j) {
+            // Log::info() << "BTree<K,V,S,L>::flush() " << path_ << " " << (*j).first << ", " <<
+            // (*j).second.dirty_ << std::endl;
+            if ((*j).second.dirty_) {
+                _savePage(*(*j).second.page_);
+                (*j).second.dirty_ = false;
+            }
         }
     }
 }
@@ -149,7 +235,13 @@ template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::dump(std::ostream& s) const {
     AutoSharedLock<BTree<K, V, S, L> > lock(const_cast<BTree*>(this));
     s << "::BTree : maxLeafEntries_=" << maxLeafEntries_ << ", maxNodeEntries_=" << maxNodeEntries_ << std::endl;
-    dump(s, 1, 0);
+
+    std::ostringstream out;
+    optimistic([&] {
+        out.str("");
+        dump(out, 1, 0);
+    });
+    s << out.str();
 }
 
 
@@ -188,6 +280,255 @@ unsigned long BTree<K, V, S, L>::next(const K& key, const Page& p) const {
 }
 
 
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::leaf(const K& key, Page& p, K& limit, bool& bounded) const {
+    bounded = false;
+
+    unsigned long page = 1;
+    for (;;) {
+        loadPage(page, p);
+        if (!p.node_) {
+            return;
+        }
+
+        const NodeEntry* begin = p.nodePage().nentries_;
+        const NodeEntry* end   = begin + p.count_;
+        ASSERT(begin != end);
+
+        const NodeEntry* e = std::upper_bound(begin, end, key, [](const K& k, const NodeEntry& n) { return k < n.key_; });
+        if (e != end) {
+            limit   = (*e).key_;
+            bounded = true;
+        }
+
+        page = (e == begin) ? p.left_ : (*(e - 1)).page_;
+    }
+}
+
+
+template <class K, class V, int S, class L>
+size_t BTree<K, V, S, L>::get(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found) {
+    AutoSharedLock<BTree<K, V, S, L> > lock(this);
+
+    values.resize(keys.size());
+
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    size_t count = 0;
+    optimistic([&] {
+        found.assign(keys.size(), false);
+        count = 0;
+
+        Page p;
+        K limit;
+        bool bounded;
+
+        for (size_t i = 0; i < order.size();) {
+            leaf(keys[order[i]], p, limit, bounded);
+
+            const LeafEntry* e   = p.leafPage().lentries_;
+            const LeafEntry* end = e + p.count_;
+
+            // keys of this leaf, in increasing order
+            for (; i < order.size() && (!bounded || keys[order[i]] < limit); ++i) {
+                const K& key = keys[order[i]];
+                e            = std::lower_bound(e, end, key);
+                if (e != end && (*e).key_ == key) {
+                    values[order[i]] = (*e).value_;
+                    found[order[i]]  = true;
+                    count++;
+                }
+            }
+        }
+    });
+
+    return count;
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::set(const std::vector<result_type>& entries) {
+    AutoLock<BTree<K, V, S, L> > lock(this);
+
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&entries](size_t a, size_t b) { return entries[a].first < entries[b].first; });
+
+    Page p;
+    K limit;
+    bool bounded;
+
+    for (size_t i = 0; i < order.size();) {
+        leaf(entries[order[i]].first, p, limit, bounded);
+
+        LeafEntry* begin = p.leafPage().lentries_;
+        bool modified    = false;
+
+        // entries of this leaf, while it does not need splitting
+        for (; i < order.size() && (!bounded || entries[order[i]].first < limit); ++i) {
+            const K& key   = entries[order[i]].first;
+            const V& value = entries[order[i]].second;
+
+            LeafEntry* end = begin + p.count_;
+            LeafEntry* e   = std::lower_bound(begin, end, key);
+
+            if (e != end && (*e).key_ == key) {
+                (*e).value_ = value;
+                modified    = true;
+                continue;
+            }
+
+            if (p.count_ + 1 == maxLeafEntries_) {
+                break;
+            }
+
+            memmove(e + 1, e, (end - e) * sizeof(LeafEntry));
+            (*e).key_   = key;
+            (*e).value_ = value;
+            p.count_++;
+            modified = true;
+        }
+
+        if (modified) {
+            savePage(p);
+        }
+
+        // the leaf is full, split it on the way
+        if (i < order.size() && (!bounded || entries[order[i]].first < limit)) {
+            std::vector<unsigned long> path;
+            insert(1, entries[order[i]].first, entries[order[i]].second, path);
+            ++i;
+        }
+    }
+}
+
+
+template <class K, class V, int S, class L>
+template <class Iterator>
+void BTree<K, V, S, L>::build(Iterator begin, Iterator end, double fill) {
+    AutoLock<BTree<K, V, S, L> > lock(this);
+
+    ASSERT(!readOnly_);
+    ASSERT(0. < fill && fill <= 1.);
+
+    Page root;
+    loadPage(1, root);
+    ASSERT_MSG(!root.node_ && root.count_ == 0, "BTree::build: tree is not empty");
+
+    // split happens at full pages, and nodes need at least two children
+    const size_t leafFill = std::max<size_t>(1, std::min<size_t>(maxLeafEntries_ - 1, size_t(fill * maxLeafEntries_)));
+    const size_t nodeFill = std::max<size_t>(3, std::min<size_t>(maxNodeEntries_ - 1, size_t(fill * maxNodeEntries_)));
+
+    // Pages are appended to the file in batches, they are not reachable before the root is saved
+    off_t here = file_.seekEnd();
+
+    const unsigned long first = (here - offset_) / sizeof(Page) + 1;
+    ASSERT(pageOffset(first) == here);
+
+    std::vector<Page> pending;
+    unsigned long nextPage = first;
+
+    auto write = [this, &pending, &here]() {
+        ASSERT(file_.seek(here) == here);
+        ASSERT(file_.write(pending.data(), pending.size() * sizeof(Page)) == ssize_t(pending.size() * sizeof(Page)));
+        here += pending.size() * sizeof(Page);
+        pending.clear();
+    };
+
+    auto append = [&pending, &nextPage, &write](Page& p) {
+        p.id_ = nextPage++;
+        pending.push_back(p);
+        if (pending.size() == 64) {
+            write();
+        }
+    };
+
+    // Leaves
+    std::vector<NodeEntry> level;  // first key and page of each page of the level
+
+    Page p;
+    zero(p);
+
+    bool started = false;
+    K last;
+
+    for (; begin != end; ++begin) {
+        const K& key = (*begin).first;
+        ASSERT_MSG(!started || last < key, "BTree::build: keys are not strictly increasing");
+        last    = key;
+        started = true;
+
+        if (p.count_ == leafFill) {
+            p.right_ = nextPage + 1;
+            level.push_back(NodeEntry{p.leafPage().lentries_[0].key_, nextPage});
+            append(p);
+
+            zero(p);
+            p.left_ = nextPage - 1;
+        }
+
+        p.leafPage().lentries_[p.count_].key_   = key;
+        p.leafPage().lentries_[p.count_].value_ = (*begin).second;
+        p.count_++;
+    }
+
+    if (level.empty()) {
+        // a single leaf is the root
+        p.id_   = 1;
+        p.left_ = 0;
+        savePage(p);
+        return;
+    }
+
+    level.push_back(NodeEntry{p.leafPage().lentries_[0].key_, nextPage});
+    append(p);
+
+    // Nodes, one level at a time, until the root can hold all children
+    while (level.size() > maxNodeEntries_) {
+        const size_t groups = (level.size() + nodeFill) / (nodeFill + 1);
+
+        std::vector<NodeEntry> up;
+        for (size_t g = 0, i = 0; g < groups; ++g) {
+            // children spread evenly, so that each node has at least two
+            const size_t n = level.size() / groups + (g < level.size() % groups ? 1 : 0);
+
+            zero(p);
+            p.node_ = true;
+            p.left_ = level[i].page_;
+            for (size_t j = 1; j < n; ++j) {
+                p.nodePage().nentries_[p.count_++] = level[i + j];
+            }
+
+            up.push_back(NodeEntry{level[i].key_, nextPage});
+            append(p);
+            i += n;
+        }
+
+        level.swap(up);
+    }
+
+    if (!pending.empty()) {
+        write();
+    }
+
+    zero(root);
+    root.id_   = 1;
+    root.node_ = true;
+    root.left_ = level[0].page_;
+    for (size_t j = 1; j < level.size(); ++j) {
+        root.nodePage().nentries_[root.count_++] = level[j];
+    }
+    savePage(root);
+}
+
+
 template <class K, class V, int S, class L>
 bool BTree<K, V, S, L>::insert(unsigned long page, const K& key, const V& value, std::vector<unsigned long>& path) {
     Page p;
@@ -411,8 +752,11 @@ bool BTree<K, V, S, L>::get(const K& key, V& value) {
     AutoSharedLock<BTree<K, V, S, L> > lock(this);
 
     V result;
+    bool found = false;
 
-    if (search(1, key, result)) {
+    optimistic([&] { found = search(1, key, result); });
+
+    if (found) {
         // std::cout << "Found " << result << std::endl;
         value = result;
         return true;
@@ -451,8 +795,10 @@ template <class K, class V, int S, class L>
 template <class T>
 void BTree<K, V, S, L>::range(const K& key1, const K& key2, T& result) {
     AutoSharedLock<BTree<K, V, S, L> > lock(this);
-    result.clear();
-    search(1, key1, key2, result);
+    optimistic([&] {
+        result.clear();
+        search(1, key1, key2, result);
+    });
 }
 
 template <class K, class V, int S, class L>
@@ -466,49 +812,99 @@ void BTree<K, V, S, L>::search(unsigned long page, const K& key1, const K& key2,
     Page p;
     loadPage(page, p);
 
-    // std::cout << "Search " << key << ", Visit " << p << std::endl;
+    if (!p.node_) {
+        const LeafEntry* begin = p.leafPage().lentries_;
+        const LeafEntry* end   = begin + p.count_;
 
-    if (p.node_) {
-        return search(next(key1, p), key1, key2, result);
+        for (const LeafEntry* e = std::lower_bound(begin, end, key1); e != end && !(key2 < (*e).key_); ++e) {
+            result.push_back(result_type((*e).key_, (*e).value_));
+        }
+        return;
     }
 
-    const LeafEntry* begin = p.leafPage().lentries_;
-    const LeafEntry* end   = begin + p.count_;
+    // Children whose key interval intersects [key1, key2], in key order
+    // (left_ holds the keys below the first entry, each entry the keys up to the next entry)
 
-    const LeafEntry* e = std::lower_bound(begin, end, key1);
+    const NodeEntry* begin = p.nodePage().nentries_;
+    const NodeEntry* end   = begin + p.count_;
 
-    if (e == end)
-        return;
+    std::vector<unsigned long> children;
+    if (begin == end || key1 < (*begin).key_) {
+        children.push_back(p.left_);
+    }
 
-    // while((*e).key_ < key1) { e++; if (e == end) return; }
+    for (const NodeEntry* e = begin; e != end && !(key2 < (*e).key_); ++e) {
+        const NodeEntry* n = e + 1;
+        if (n == end || key1 < (*n).key_) {
+            children.push_back((*e).page_);
+        }
+    }
 
-    // std::cout << "range " << (*e).key_ << " .... " << p.count_ << " " << (e - begin) <<
-    // std::endl;  std::cout << " key1 " << key1 << std::endl;  std::cout << " key2 " << key2 <<
-    // std::endl;
+    // Visit the children in batches, read ahead with coalesced reads
+    const size_t batch = std::max<size_t>(1, std::min(readAhead_, cacheSize_ / 2));
 
-    // std::cout << " begin " << (*begin).key_ << std::endl;
-    if (p.count_) {
-        // unused		const LeafEntry *last   = begin + p.count_ -1;
-        // std::cout << " last "   << (*last).key_ << std::endl;
+    for (size_t i = 0; i < children.size(); i += batch) {
+        std::vector<unsigned long> pages(children.begin() + i, children.begin() + std::min(i + batch, children.size()));
+        if (pages.size() > 1) {
+            std::vector<unsigned long> ahead(pages);
+            readAhead(ahead);
+        }
+
+        for (unsigned long child : pages) {
+            search(child, key1, key2, result);
+        }
     }
+}
 
-    while (!(key2 < (*e).key_)) {
-        // std::cout << "match " << p.id_ << " pos " << (e - begin) << " " << (*e).key_ <<
-        // std::endl;
-        result.push_back(result_type((*e).key_, (*e).value_));
-
-        ++e;
-        if (e == end) {
-            if (p.right_) {
-                loadPage(p.right_, p);
-                ASSERT(!p.node_);
-                e   = p.leafPage().lentries_;
-                end = e + p.count_;
-            }
-            else {
-                return;
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::readAhead(std::vector<unsigned long>& pages) const {
+    BTree<K, V, S, L>* self = const_cast<BTree<K, V, S, L>*>(this);
+
+    if (map_ || !cacheReads_) {
+        return;
+    }
+
+    // pages modified after this are not cached from the read
+    size_t updates[shards_];
+    for (size_t i = 0; i < shards_; ++i) {
+        std::lock_guard<std::mutex> guard(cache_[i].mutex_);
+        updates[i] = cache_[i].updates_;
+    }
+
+    // Pages not cached, in file order
+    pages.erase(std::remove_if(pages.begin(), pages.end(),
+                               [this](unsigned long page) {
+                                   Shard& s = shard(page);
+                                   std::lock_guard<std::mutex> guard(s.mutex_);
+                                   return s.cache_.find(page) != s.cache_.end();
+                               }),
+                pages.end());
+    std::sort(pages.begin(), pages.end());
+
+    std::vector<Page> buffer;
+
+    for (size_t i = 0; i < pages.size();) {
+        // Run of consecutive pages, read at once
+        size_t n = 1;
+        while (i + n < pages.size() && pages[i + n] == pages[i] + n) {
+            ++n;
+        }
+
+        buffer.resize(n);
+        _loadPages(pages[i], buffer.data(), n);
+
+        for (size_t k = 0; k < n; ++k) {
+            ASSERT(buffer[k].id_ == pages[i + k]);
+
+            Shard& s = shard(pages[i + k]);
+            std::lock_guard<std::mutex> guard(s.mutex_);
+            if (s.updates_ == updates[pages[i + k] % shards_]) {
+                self->cache(s, buffer[k], false);
             }
+            s.stats_.readAheads_++;
         }
+
+        i += n;
     }
 }
 
@@ -520,16 +916,20 @@ off_t BTree<K, V, S, L>::pageOffset(unsigned long page) const {
 }
 
 
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::_loadPages(unsigned long first, Page* p, size_t count) const {
+    // positioned reads, as readers do not share the file offset
+    ssize_t len;
+    SYSCALL(len = ::pread(file_.fileno(), p, count * sizeof(Page), pageOffset(first)));
+    ASSERT(len == ssize_t(count * sizeof(Page)));
+}
+
+
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::_loadPage(unsigned long page, Page& p) const {
     // std::cout << "Load " << page << std::endl;
 
-    off_t o    = pageOffset(page);
-    off_t here = file_.seek(o);
-    ASSERT(here == o);
-
-    int len = file_.read(&p, sizeof(p));
-    ASSERT(len == sizeof(p));
+    _loadPages(page, &p, 1);
     ASSERT(page == p.id_);
 }
 
@@ -537,59 +937,137 @@ template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::loadPage(unsigned long page, Page& p) const {
     BTree<K, V, S, L>* self = const_cast<BTree<K, V, S, L>*>(this);
 
-    typename Cache::iterator j = self->cache_.find(page);
-    if (j != self->cache_.end()) {
-        // TODO: find someting better...
-        memcpy(&p, (*j).second.page_, sizeof(Page));
-        return;
+    if (map_) {
+        off_t o = pageOffset(page);
+        if (size_t(o) + sizeof(Page) <= mapSize_) {
+            memcpy(&p, static_cast<const char*>(map_) + o, sizeof(Page));
+            ASSERT(page == p.id_);
+            self->mappedReads_++;
+            return;
+        }
+        // page appended after mapping the file
+    }
+
+    // an optimistic reader records the version of the page, before the writer can modify it again
+    Snapshot* snap = snapshot();
+    if (snap != nullptr && snap->tree_ == this) {
+        const size_t stripe     = page % stripes_;
+        const unsigned long ver = versions_[stripe].load(std::memory_order_acquire);
+        snap->valid_            = snap->valid_ && (ver & 1) == 0;
+        snap->pages_.emplace_back(stripe, ver);
+    }
+
+    Shard& s = shard(page);
+
+    std::shared_ptr<const Page> q;
+    size_t updates;
+    {
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        q       = self->cached(s, page);
+        updates = s.updates_;
+        (q ? s.stats_.hits_ : s.stats_.misses_)++;
     }
 
+    // the page is copied (or read) outside the lock
+    if (q) {
+        memcpy(&p, q.get(), sizeof(Page));
+        return;
+    }
 
     _loadPage(page, p);
 
     if (cacheReads_) {
-        Page* q = new Page();
-        memcpy(q, &p, sizeof(Page));
-        self->cache_[p.id_] = _PageInfo(q);
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        if (s.updates_ == updates) {
+            self->cache(s, p, false);
+        }
     }
 }
 
+template <class K, class V, int S, class L>
+std::shared_ptr<const typename BTree<K, V, S, L>::Page> BTree<K, V, S, L>::cached(Shard& s, unsigned long page) {
+    typename Cache::iterator j = s.cache_.find(page);
+    if (j == s.cache_.end()) {
+        return nullptr;
+    }
+
+    s.lru_.splice(s.lru_.begin(), s.lru_, (*j).second.lru_);
+    return (*j).second.page_;
+}
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::cache(Shard& s, const Page& p, bool dirty) {
+    typename Cache::iterator j = s.cache_.find(p.id_);
+    if (j != s.cache_.end()) {
+        // a page read from the file is not newer than the cached one
+        if (dirty) {
+            (*j).second.page_  = std::make_shared<const Page>(p);
+            (*j).second.dirty_ = true;
+            s.updates_++;
+        }
+        s.lru_.splice(s.lru_.begin(), s.lru_, (*j).second.lru_);
+        return;
+    }
+
+    if (s.size_ == 0) {
+        ASSERT(!dirty);
+        return;
+    }
+
+    while (s.cache_.size() >= s.size_) {
+        evict(s);
+    }
+
+    if (dirty) {
+        s.updates_++;
+    }
+
+    s.lru_.push_front(p.id_);
+    s.cache_[p.id_] = _PageInfo{std::make_shared<const Page>(p), dirty, s.lru_.begin()};
+}
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::evict(Shard& s) {
+    ASSERT(!s.lru_.empty());
+
+    typename Cache::iterator j = s.cache_.find(s.lru_.back());
+    ASSERT(j != s.cache_.end());
+
+    if ((*j).second.dirty_) {
+        _savePage(*(*j).second.page_);
+        s.stats_.writeBacks_++;
+    }
+
+    s.cache_.erase(j);
+    s.lru_.pop_back();
+
+    s.stats_.evictions_++;
+}
+
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::_savePage(const Page& p) {
     ASSERT(!readOnly_);
     // std::cout << "Save " << p << std::endl;
 
-    off_t o = pageOffset(p.id_);
-    off_t here;
-    here = file_.seek(o);
-    ASSERT(here == o);
-
-    int len = file_.write(&p, sizeof(p));
+    // positioned writes, as pages are written back by the readers evicting them
+    ssize_t len;
+    SYSCALL(len = ::pwrite(file_.fileno(), &p, sizeof(p), pageOffset(p.id_)));
     ASSERT(len == sizeof(p));
 }
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::savePage(const Page& p) {
-    BTree<K, V, S, L>* self    = const_cast<BTree<K, V, S, L>*>(this);
-    typename Cache::iterator j = self->cache_.find(p.id_);
-    if (j != self->cache_.end()) {
-        // TODO: find someting better...
-        memcpy((*j).second.page_, &p, sizeof(Page));
-        (*j).second.dirty_ = true;
-        (*j).second.count_++;
-        return;
-    }
+    modifyPage(p.id_);
 
-    if (cacheWrites_) {
-        Page* q = new Page();
-        memcpy(q, &p, sizeof(Page));
-        self->cache_[p.id_] = _PageInfo(q);
-        j                   = self->cache_.find(p.id_);
-        (*j).second.dirty_  = true;
-        (*j).second.count_++;
+    Shard& s = shard(p.id_);
+    std::lock_guard<std::mutex> guard(s.mutex_);
+    if (s.size_ > 0 && (cacheWrites_ || s.cache_.find(p.id_) != s.cache_.end())) {
+        cache(s, p, true);
         return;
     }
 
+    // written under the lock, so that a reader of the old page does not cache it
+    s.updates_++;
     _savePage(p);
 }
 
@@ -616,18 +1094,23 @@ void BTree<K, V, S, L>::_newPage(Page& p) {
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::newPage(Page& p) {
+    // the file offset is only used by the writer
     _newPage(p);
 
     if (cacheReads_ || cacheWrites_) {
-        Page* q = new Page();
-        memcpy(q, &p, sizeof(Page));
-        cache_[p.id_] = _PageInfo(q);
+        Shard& s = shard(p.id_);
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        cache(s, p, false);
     }
 }
 
 template <class K, class V, int S, class L>
 size_t BTree<K, V, S, L>::count() const {
-    return count(1);
+    AutoSharedLock<BTree<K, V, S, L> > lock(const_cast<BTree*>(this));
+
+    size_t c = 0;
+    optimistic([&] { c = count(1); });
+    return c;
 }
 
 template <class K, class V, int S, class L>
@@ -654,19 +1137,336 @@ size_t BTree<K, V, S, L>::count(unsigned long page) const {
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::lockShared() {
-    L::lockRange(file_.fileno(), 0, 0, F_SETLKW, F_RDLCK);
+    if (writerThread_ == std::this_thread::get_id()) {
+        writerNested_++;  // only used by the writer thread
+        return;
+    }
+
+    auto& locks = sharedLocks();
+    auto j      = std::find_if(locks.begin(), locks.end(), [this](const auto& l) { return l.first == this; });
+
+    // a thread already holding a shared lock must not wait, the writer may be waiting for it
+    if (j != locks.end()) {
+        (*j).second++;
+        readers_++;
+        return;
+    }
+
+    // the file lock is held and no writer is taking its lock. Otherwise, whoever closed the entry counts the readers
+    // after closing it, and sees this one
+    readers_++;
+    if (readersEnter_) {
+        locks.emplace_back(this, 1);
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(lockMutex_);
+
+    if (--readers_ == waitingFor_) {
+        lockChanged_.notify_all();
+    }
+
+    lockChanged_.wait(guard, [this] { return !changing_ && (writerThread_ == std::thread::id() || writerActive_); });
+
+    // the file lock is taken by the first reader, unless the writer of this process holds it
+    if (fileLock_ == F_UNLCK) {
+        waitFileLock(guard, F_RDLCK);
+    }
+
+    readers_++;
+    locks.emplace_back(this, 1);
+    updateReadersEnter();
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::updateReadersEnter() {
+    // with lockMutex_ held. The file lock, and whether a writer is taking its lock, only change under lockMutex_,
+    // after closing the entry: a reader counts itself before checking the entry, the thread closing it counts the
+    // readers after closing it, so one of them sees the other
+    readersEnter_ =
+        fileLock_ != F_UNLCK && !changing_ && (writerThread_.load() == std::thread::id() || writerActive_);
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::waitFileLock(std::unique_lock<std::mutex>& guard, int type) {
+    ASSERT(!changing_);
+    changing_     = true;
+    readersEnter_ = false;
+    guard.unlock();
+
+    try {
+        L::lockRange(file_.fileno(), 0, 0, F_SETLKW, type);
+    }
+    catch (...) {
+        guard.lock();
+        changing_ = false;
+        updateReadersEnter();
+        lockChanged_.notify_all();
+        throw;
+    }
+
+    guard.lock();
+    fileLock_ = type;
+    changing_ = false;
+    updateReadersEnter();
+    lockChanged_.notify_all();
 }
 
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::lock() {
-    L::lockRange(file_.fileno(), 0, 0, F_SETLKW, readOnly_ ? F_RDLCK : F_WRLCK);
+    std::unique_lock<std::mutex> guard(lockMutex_);
+
+    const std::thread::id self = std::this_thread::get_id();
+
+    if (writerThread_ == self) {
+        writerDepth_++;
+        return;
+    }
+
+    lockChanged_.wait(guard, [this] { return writerThread_ == std::thread::id(); });
+    writerThread_ = self;
+    updateReadersEnter();
+
+    try {
+        const int type = readOnly_ ? F_RDLCK : F_WRLCK;
+
+        lockChanged_.wait(guard, [this] { return !changing_; });
+
+        if (fileLock_ != type) {
+            bool locked = true;
+            try {
+                L::lockRange(file_.fileno(), 0, 0, F_SETLK, type);
+            }
+            catch (FailedSystemCall&) {
+                locked = false;
+            }
+
+            if (locked) {
+                fileLock_ = type;
+            }
+            else {
+                // another process holds the file. Upgrading the read lock of the readers of this process while
+                // waiting would deadlock with another process doing the same, so let them release it first
+                const size_t mine = sharedDepth();
+
+                waitingFor_ = mine;
+                lockChanged_.wait(guard, [this, mine] { return readers_ == mine && !changing_; });
+                waitingFor_ = noReaders_;
+
+                if (mine == 0 && fileLock_ != F_UNLCK) {
+                    L::lockRange(file_.fileno(), 0, 0, F_SETLK, F_UNLCK);
+                    fileLock_ = F_UNLCK;
+                }
+
+                // a thread upgrading its own shared lock can only wait (or fail with EDEADLK)
+                waitFileLock(guard, type);
+            }
+        }
+
+        // readers waiting for a previous writer run unvalidated, and must finish before any update
+        lockChanged_.wait(guard, [this] { return fallbacks_ == 0; });
+        writerActive_ = true;
+        updateReadersEnter();
+    }
+    catch (...) {
+        waitingFor_   = noReaders_;
+        writerThread_ = std::thread::id();
+        updateReadersEnter();
+        lockChanged_.notify_all();
+        throw;
+    }
 }
 
 
 template <class K, class V, int S, class L>
 void BTree<K, V, S, L>::unlock() {
-    L::lockRange(file_.fileno(), 0, 0, F_SETLK, F_UNLCK);
+    if (writerThread_ == std::this_thread::get_id()) {
+        if (writerNested_ > 0) {
+            writerNested_--;
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(lockMutex_);
+
+        if (writerDepth_ > 0) {
+            writerDepth_--;
+            return;
+        }
+
+        releasePages();
+        writerThread_ = std::thread::id();
+        writerActive_ = false;
+
+        // downgrades the file lock if readers of this process still hold it
+        readersEnter_ = false;
+        fileLock_     = readers_ > 0 ? F_RDLCK : F_UNLCK;
+        L::lockRange(file_.fileno(), 0, 0, F_SETLK, fileLock_);
+        updateReadersEnter();
+
+        lockChanged_.notify_all();
+        return;
+    }
+
+    auto& locks = sharedLocks();
+    auto j      = std::find_if(locks.begin(), locks.end(), [this](const auto& l) { return l.first == this; });
+    ASSERT(j != locks.end());
+
+    if (--(*j).second == 0) {
+        *j = locks.back();
+        locks.pop_back();
+    }
+
+    const size_t n = --readers_;
+
+    if (n == 0) {
+        // the last reader releases the file lock, unless a writer of this process is waiting for the readers or
+        // holds the file lock
+        std::lock_guard<std::mutex> guard(lockMutex_);
+
+        if (writerThread_ == std::thread::id() && !changing_ && fileLock_ == F_RDLCK) {
+            readersEnter_ = false;
+            if (readers_ == 0) {
+                fileLock_ = F_UNLCK;
+                L::lockRange(file_.fileno(), 0, 0, F_SETLK, F_UNLCK);
+            }
+            updateReadersEnter();
+        }
+    }
+
+    if (n == waitingFor_) {
+        std::lock_guard<std::mutex> guard(lockMutex_);
+        lockChanged_.notify_all();
+    }
+}
+
+
+template <class K, class V, int S, class L>
+template <class F>
+void BTree<K, V, S, L>::optimistic(F f) const {
+    if (writerThread_ == std::this_thread::get_id()) {
+        // nothing can change under the writer
+        f();
+        return;
+    }
+
+    Snapshot s{this, true, {}};
+
+    struct Guard {
+        Guard(Snapshot& s) { snapshot() = &s; }
+        ~Guard() { snapshot() = nullptr; }
+    };
+
+    {
+        Guard guard(s);
+
+        for (size_t i = 0; i < attempts_; ++i) {
+            s.valid_ = true;
+            s.pages_.clear();
+
+            try {
+                f();
+            }
+            catch (...) {
+                // pages from before and after an update may not make sense together
+                if (validate(s)) {
+                    throw;
+                }
+                continue;
+            }
+
+            if (validate(s)) {
+                return;
+            }
+        }
+    }
+
+    // keeps conflicting with the writer, wait for it instead. The next writer waits for this reader, which holds a
+    // shared lock, before updating any page
+    BTree<K, V, S, L>* self = const_cast<BTree<K, V, S, L>*>(this);
+
+    struct Fallback {
+        Fallback(BTree* tree) : tree_(tree) {
+            std::unique_lock<std::mutex> guard(tree_->lockMutex_);
+            tree_->lockChanged_.wait(guard, [this] { return !tree_->writerActive_; });
+            tree_->fallbacks_++;
+        }
+        ~Fallback() {
+            std::lock_guard<std::mutex> guard(tree_->lockMutex_);
+            tree_->fallbacks_--;
+            tree_->lockChanged_.notify_all();
+        }
+        BTree* tree_;
+    };
+
+    Fallback fallback(self);
+    f();
+}
+
+
+template <class K, class V, int S, class L>
+bool BTree<K, V, S, L>::validate(const Snapshot& s) const {
+    // the pages are read before their versions are checked again
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!s.valid_) {
+        return false;
+    }
+
+    for (const auto& page : s.pages_) {
+        if (versions_[page.first].load(std::memory_order_relaxed) != page.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::modifyPage(unsigned long page) {
+    // pages of the same stripe are marked once
+    const size_t stripe = page % stripes_;
+    if ((versions_[stripe].load(std::memory_order_relaxed) & 1) == 0) {
+        versions_[stripe].fetch_add(1, std::memory_order_acq_rel);
+        modified_.push_back(stripe);
+    }
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::releasePages() {
+    for (size_t stripe : modified_) {
+        versions_[stripe].fetch_add(1, std::memory_order_release);
+    }
+    modified_.clear();
+}
+
+
+template <class K, class V, int S, class L>
+BTreeStatistics BTree<K, V, S, L>::statistics() const {
+    BTreeStatistics stats;
+    for (Shard& s : cache_) {
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        stats.hits_ += s.stats_.hits_;
+        stats.misses_ += s.stats_.misses_;
+        stats.readAheads_ += s.stats_.readAheads_;
+        stats.evictions_ += s.stats_.evictions_;
+        stats.writeBacks_ += s.stats_.writeBacks_;
+    }
+    stats.mapped_ = mappedReads_;
+    return stats;
+}
+
+
+template <class K, class V, int S, class L>
+void BTree<K, V, S, L>::resetStatistics() {
+    for (Shard& s : cache_) {
+        std::lock_guard<std::mutex> guard(s.mutex_);
+        s.stats_ = BTreeStatistics();
+    }
+    mappedReads_ = 0;
 }
 
 template <class K, class V, int S, class L>
@@ -16,7 +16,16 @@
 
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "eckit/container/BTree.h"
 #include "eckit/exception/Exceptions.h"
@@ -52,10 +61,41 @@ public:
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Page cache statistics of a BTree
+struct BTreeStatistics {
+    size_t hits_       = 0;  ///< page reads served from the cache
+    size_t misses_     = 0;  ///< page reads from the file
+    size_t mapped_     = 0;  ///< page reads served from a memory mapping
+    size_t readAheads_ = 0;  ///< pages read ahead (by coalesced reads)
+    size_t evictions_  = 0;  ///< pages evicted from the cache
+    size_t writeBacks_ = 0;  ///< dirty pages written on eviction
+
+    void print(std::ostream& s) const {
+        s << "BTreeStatistics[hits=" << hits_ << ",misses=" << misses_ << ",mapped=" << mapped_
+          << ",readAheads=" << readAheads_ << ",evictions=" << evictions_ << ",writeBacks=" << writeBacks_ << "]";
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const BTreeStatistics& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 /// B+Tree index
 ///
+/// Pages are cached in memory, up to a bounded number of pages with least-recently-used eviction; dirty pages are
+/// written back when evicted or on flush(). range() reads ahead the pages it is going to visit, coalescing reads of
+/// consecutive pages. Read-only trees can alternatively be served from a memory mapping of the file (see mmap()).
+///
+/// Within a process, a tree can be shared by many reading threads and one writing thread at a time. Readers do not
+/// block the writer: they run optimistically, recording the version of each page they visit, and restart if one of
+/// these pages has been modified in the meantime (after a few restarts, they wait for the writer instead). The writer
+/// marks the pages it modifies until the end of its update, so readers never combine pages from before and after it.
+/// Across processes, the locking policy L applies as before; the file lock is shared by the threads of the process.
+///
 /// @todo Deletion
-/// @todo Cache pages
 /// @invariant K and V needs to be PODs
 /// @invariant S is the page size padding
 /// @invariant L implements locking policy
@@ -80,6 +120,19 @@ public:
     bool get(const K&, V&);
     bool set(const K&, const V&);
 
+    /// Look up a batch of keys (in any order), sharing the descent from the root between keys of the same leaf
+    /// @returns number of keys found, with values[i] valid where found[i]
+    size_t get(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found);
+
+    /// Insert or replace a batch of entries (in any order, the last of equal keys wins), sharing the descent from
+    /// the root between keys of the same leaf
+    void set(const std::vector<result_type>& entries);
+
+    /// Build an empty tree bottom-up from entries sorted by strictly increasing key
+    /// @param fill fraction of the page capacity used, leaving room for later insertions without splits
+    template <class Iterator>
+    void build(Iterator begin, Iterator end, double fill = 1.);
+
     void preload();
 
     template <class T>
@@ -96,6 +149,7 @@ public:
     /// Counts the entries in a page of the tree
     size_t count(unsigned long page) const;
 
+    /// Exclusive lock of the writer, which its thread can take again (as set() does while it is held)
     void lock();
     void lockShared();
     void unlock();
@@ -108,6 +162,23 @@ public:
 
     const PathName& path() const { return path_; }
 
+    // -- Page cache
+
+    /// Maximum number of pages kept in memory (default from resource btreeCacheSize, in bytes), split between the
+    /// shards of the cache; each shard keeps at least one page, so at least 16 pages are kept
+    void cacheSize(size_t pages);
+    size_t cacheSize() const { return cacheSize_; }
+
+    /// Maximum number of pages read ahead by range() (default from resource btreeReadAhead), 0 to disable
+    void readAhead(size_t pages) { readAhead_ = pages; }
+
+    /// Serve page reads of a read-only tree from a memory mapping of the file, instead of the page cache
+    void mmap();
+
+    /// @returns a snapshot of the statistics, as other threads may be accessing the tree
+    BTreeStatistics statistics() const;
+    void resetStatistics();
+
 private:  // methods
     void dump(std::ostream&, unsigned long page, int depth) const;
 
@@ -229,17 +300,104 @@ private:
     off_t offset_;
 
     struct _PageInfo {
-        Page* page_;
-        unsigned long long count_;
-        time_t last_;
+        std::shared_ptr<const Page> page_;  ///< not modified once cached, readers copy it outside the lock
         bool dirty_;
+        std::list<unsigned long>::iterator lru_;
+    };
+
+    typedef std::unordered_map<unsigned long, _PageInfo> Cache;
 
-        _PageInfo(Page* page = 0) :
-            page_(page), count_(0), last_(time(nullptr)), dirty_(false) {}
+    /// Part of the page cache, holding the pages of the same id modulo shards_
+    struct Shard {
+        std::mutex mutex_;
+        Cache cache_;
+        std::list<unsigned long> lru_;  ///< cached pages, most recently used first
+        size_t size_    = 0;            ///< maximum number of pages
+        size_t updates_ = 0;            ///< pages modified, a page read from the file before is not cached
+        BTreeStatistics stats_;
     };
 
-    typedef std::map<unsigned long, _PageInfo> Cache;
-    Cache cache_;
+    static const size_t shards_ = 16;
+
+    mutable Shard cache_[shards_];
+
+    size_t cacheSize_;
+    size_t readAhead_;
+
+    void* map_;
+    size_t mapSize_;
+
+    // -- In-process concurrency
+
+    static const size_t stripes_  = 1024;  ///< page versions, shared by pages of the same id modulo stripes_
+    static const size_t attempts_ = 8;     ///< optimistic attempts of a reader before waiting for the writer
+
+    /// Pages visited by an optimistic reader, with their versions
+    struct Snapshot {
+        const BTree* tree_;
+        bool valid_;
+        std::vector<std::pair<size_t, unsigned long> > pages_;
+    };
+
+    /// State below, never held while waiting for the file lock. Readers only take it for the first shared lock of
+    /// the process (or while a writer is taking its lock), and to release the file lock with the last one
+    mutable std::mutex lockMutex_;
+    mutable std::condition_variable lockChanged_;
+
+    std::atomic<std::thread::id> writerThread_;  ///< thread holding (or taking) the writer lock
+    bool writerActive_;                          ///< the writer holds the file lock, and may update pages
+    size_t writerDepth_;                         ///< exclusive locks taken again by the writer thread
+    size_t writerNested_;                        ///< shared locks taken by the writer thread
+    std::atomic<size_t> readers_;                ///< shared locks taken by other threads
+    std::atomic<bool> readersEnter_;  ///< readers may take a shared lock without lockMutex_ (see updateReadersEnter())
+    std::atomic<size_t> waitingFor_;  ///< readers_ a writer is waiting for, to be notified of (noReaders_ otherwise)
+    size_t fallbacks_;                ///< readers waiting for the writer, running without validation
+    int fileLock_;                    ///< file lock held by the process, F_UNLCK, F_RDLCK or F_WRLCK
+    bool changing_;                   ///< a thread is waiting for the file lock
+
+    static const size_t noReaders_ = size_t(-1);
+
+    std::atomic<unsigned long> versions_[stripes_];  ///< even when stable, odd while being modified by the writer
+    std::vector<size_t> modified_;                   ///< stripes marked by the current update
+    std::atomic<size_t> mappedReads_;
+
+    static Snapshot*& snapshot() {
+        static thread_local Snapshot* s = nullptr;
+        return s;
+    }
+
+    /// Shared locks taken by the calling thread, per tree (a thread rarely holds locks of more than a few trees)
+    static std::vector<std::pair<const BTree*, size_t> >& sharedLocks() {
+        static thread_local std::vector<std::pair<const BTree*, size_t> > locks;
+        return locks;
+    }
+
+    /// Shared locks of this tree taken by the calling thread
+    size_t sharedDepth() const {
+        for (const auto& l : sharedLocks()) {
+            if (l.first == this) {
+                return l.second;
+            }
+        }
+        return 0;
+    }
+
+    void updateReadersEnter();
+
+    template <class F>
+    void optimistic(F f) const;
+    bool validate(const Snapshot&) const;
+
+    void modifyPage(unsigned long);
+    void releasePages();
+
+    void waitFileLock(std::unique_lock<std::mutex>&, int type);
+
+    Shard& shard(unsigned long page) const { return cache_[page % shards_]; }
+    std::shared_ptr<const Page> cached(Shard&, unsigned long);
+    void cache(Shard&, const Page&, bool dirty);
+    void evict(Shard&);
+    void readAhead(std::vector<unsigned long>&) const;
 
     void lockRange(off_t start, off_t len, int cmd, int type);
     bool search(unsigned long page, const K&, V&) const;
@@ -257,6 +415,7 @@ private:
 
     void _savePage(const Page&);
     void _loadPage(unsigned long, Page&) const;
+    void _loadPages(unsigned long first, Page*, size_t count) const;
     void _newPage(Page&);
 
     bool insert(unsigned long page, const K& key, const V& value, std::vector<unsigned long>& path);
@@ -264,6 +423,9 @@ private:
 
     unsigned long next(const K&, const Page&) const;
 
+    /// Load the leaf where key belongs, and the upper bound of the keys that belong to it (if bounded)
+    void leaf(const K& key, Page& p, K& limit, bool& bounded) const;
+
 
     // -- Friends
 
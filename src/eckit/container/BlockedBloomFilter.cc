@@ -0,0 +1,347 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/container/BlockedBloomFilter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+#include "eckit/eckit.h"
+
+#if eckit_HAVE_XXHASH
+#define XXH_INLINE_ALL
+#include "eckit/contrib/xxhash/xxhash.h"
+#endif
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/memory/MMap.h"
+#include "eckit/os/Stat.h"
+#include "eckit/serialisation/Stream.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr unsigned int VERSION = 1;
+
+#if eckit_HAVE_XXHASH
+constexpr unsigned int HASH = 1;  // XXH3 64 bits
+#else
+constexpr unsigned int HASH = 2;  // FNV-1a 64 bits, with a final mix
+#endif
+
+/// File header, padded so that the blocks that follow are aligned to a cache line
+struct Header {
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t hash_;
+    std::uint64_t blocks_;
+    std::uint64_t hashes_;
+    std::uint64_t insertions_;
+    char padding_[24];
+};
+
+static_assert(sizeof(Header) == 64, "Header should be one cache line");
+
+constexpr char MAGIC[8] = {'E', 'C', 'B', 'L', 'O', 'O', 'M', 0};
+
+/// Number of blocks and of hashes (bits set per key, one block pattern) that a filter can have, as allocate() asserts
+bool validShape(std::uint64_t blocks, std::uint64_t hashes) {
+    return 0 < blocks && blocks <= std::numeric_limits<std::uint32_t>::max() && 0 < hashes && hashes <= 16;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BlockedBloomFilter::BlockedBloomFilter(size_t entries, double falsePositiveRate) :
+    insertions_(0), data_(nullptr), mapped_(nullptr), mappedSize_(0) {
+    ASSERT(0. < falsePositiveRate && falsePositiveRate < 1.);
+
+    const double ln2        = std::log(2.);
+    const double bitsPerKey = -std::log(falsePositiveRate) / (ln2 * ln2);
+
+    hashes_ = std::min<size_t>(16, std::max<size_t>(1, size_t(std::lround(bitsPerKey * ln2))));
+    blocks_ = std::max<size_t>(1, size_t(std::ceil(double(std::max<size_t>(entries, 1)) * bitsPerKey / blockBits)));
+
+    allocate();
+}
+
+BlockedBloomFilter::BlockedBloomFilter(Stream& s) :
+    blocks_(0), hashes_(0), insertions_(0), data_(nullptr), mapped_(nullptr), mappedSize_(0) {
+    decode(s);
+}
+
+BlockedBloomFilter::BlockedBloomFilter(const PathName& path) :
+    blocks_(0), hashes_(0), insertions_(0), data_(nullptr), mapped_(nullptr), mappedSize_(0) {
+    int fd;
+    SYSCALL(fd = ::open(path.localPath(), O_RDONLY));
+
+    Stat::Struct s;
+    SYSCALL(Stat::fstat(fd, &s));
+    mappedSize_ = size_t(s.st_size);
+
+    Header header;
+    if (mappedSize_ < sizeof(header) || ::pread(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        ::close(fd);
+        throw BadValue("BlockedBloomFilter: " + path + " is too short");
+    }
+
+    if (std::memcmp(header.magic_, MAGIC, sizeof(MAGIC)) != 0 || header.version_ != VERSION ||
+        !validShape(header.blocks_, header.hashes_) || mappedSize_ != sizeof(Header) + header.blocks_ * sizeof(Block)) {
+        ::close(fd);
+        throw BadValue("BlockedBloomFilter: " + path + " is not a valid filter");
+    }
+
+    if (header.hash_ != HASH) {
+        ::close(fd);
+        throw BadValue("BlockedBloomFilter: " + path + " was saved with a different hash function");
+    }
+
+    blocks_     = header.blocks_;
+    hashes_     = header.hashes_;
+    insertions_ = header.insertions_;
+
+    mapped_ = MMap::mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapped_ == MAP_FAILED) {
+        mapped_ = nullptr;
+        Log::error() << "BlockedBloomFilter: mmap(" << path << ')' << Log::syserr << std::endl;
+        throw FailedSystemCall("mmap", Here());
+    }
+
+    data_ = reinterpret_cast<Block*>(static_cast<char*>(mapped_) + sizeof(Header));
+}
+
+BlockedBloomFilter::~BlockedBloomFilter() {
+    if (mapped_ != nullptr) {
+        MMap::munmap(mapped_, mappedSize_);
+    }
+}
+
+void BlockedBloomFilter::allocate() {
+    ASSERT(blocks_ > 0);
+    ASSERT(blocks_ <= std::numeric_limits<std::uint32_t>::max());
+    ASSERT(0 < hashes_ && hashes_ <= 16);
+
+    owned_.reset(new Block[blocks_]);
+    data_ = owned_.get();
+    std::memset(data_, 0, blocks_ * sizeof(Block));
+}
+
+void BlockedBloomFilter::insert(const char* key) {
+    insert(key, std::strlen(key));
+}
+
+bool BlockedBloomFilter::contains(const char* key) const {
+    return contains(key, std::strlen(key));
+}
+
+BlockedBloomFilter::hash_t BlockedBloomFilter::hash(const void* key, size_t length) {
+#if eckit_HAVE_XXHASH
+    return XXH3_64bits(key, length);
+#else
+    const auto* p = static_cast<const unsigned char*>(key);
+    hash_t h      = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    // FNV-1a does not spread low entropy keys over the high bits, which select the block
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+#endif
+}
+
+const BlockedBloomFilter::Block& BlockedBloomFilter::block(hash_t h) const {
+    // high 32 bits select the block (without a division), low 32 bits select the bits within it
+    return data_[((h >> 32) * blocks_) >> 32];
+}
+
+namespace {
+
+/// Bits of a key within its block, by double hashing
+inline void pattern(std::uint64_t h, size_t k, std::uint64_t mask[8]) {
+    std::fill_n(mask, 8, 0);
+
+    const auto h1 = std::uint32_t(h);
+    const auto h2 = std::uint32_t((h * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+    for (std::uint32_t i = 0; i < k; ++i) {
+        const std::uint32_t bit = (h1 + i * h2) & 511;
+        mask[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+    }
+}
+
+inline void prefetch(const void* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#endif
+}
+
+}  // namespace
+
+void BlockedBloomFilter::insertHash(hash_t h) {
+    ASSERT(!readOnly());
+
+    std::uint64_t mask[8];
+    pattern(h, hashes_, mask);
+
+    auto& words = const_cast<Block&>(block(h)).words_;
+    for (size_t w = 0; w < 8; ++w) {
+        words[w] |= mask[w];
+    }
+
+    insertions_++;
+}
+
+bool BlockedBloomFilter::containsHash(hash_t h) const {
+    std::uint64_t mask[8];
+    pattern(h, hashes_, mask);
+
+    const auto& words = block(h).words_;
+
+    std::uint64_t missing = 0;
+    for (size_t w = 0; w < 8; ++w) {
+        missing |= mask[w] & ~words[w];
+    }
+    return missing == 0;
+}
+
+void BlockedBloomFilter::insertHashes(const hash_t* h, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        prefetch(&block(h[i]));
+    }
+    for (size_t i = 0; i < n; ++i) {
+        insertHash(h[i]);
+    }
+}
+
+size_t BlockedBloomFilter::containsHashes(const hash_t* h, size_t n, bool* found) const {
+    for (size_t i = 0; i < n; ++i) {
+        prefetch(&block(h[i]));
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        found[i] = containsHash(h[i]);
+        count += found[i] ? 1 : 0;
+    }
+    return count;
+}
+
+BlockedBloomFilter& BlockedBloomFilter::operator|=(const BlockedBloomFilter& other) {
+    ASSERT(!readOnly());
+    ASSERT_MSG(blocks_ == other.blocks_ && hashes_ == other.hashes_, "BlockedBloomFilter: different geometries");
+
+    auto* a       = reinterpret_cast<std::uint64_t*>(data_);
+    const auto* b = reinterpret_cast<const std::uint64_t*>(other.data_);
+    for (size_t i = 0; i < blocks_ * 8; ++i) {
+        a[i] |= b[i];
+    }
+
+    insertions_ += other.insertions_;
+    return *this;
+}
+
+BlockedBloomFilter& BlockedBloomFilter::operator&=(const BlockedBloomFilter& other) {
+    ASSERT(!readOnly());
+    ASSERT_MSG(blocks_ == other.blocks_ && hashes_ == other.hashes_, "BlockedBloomFilter: different geometries");
+
+    auto* a       = reinterpret_cast<std::uint64_t*>(data_);
+    const auto* b = reinterpret_cast<const std::uint64_t*>(other.data_);
+    for (size_t i = 0; i < blocks_ * 8; ++i) {
+        a[i] &= b[i];
+    }
+
+    insertions_ = std::min(insertions_, other.insertions_);
+    return *this;
+}
+
+double BlockedBloomFilter::saturation() const {
+    const auto* a = reinterpret_cast<const std::uint64_t*>(data_);
+
+    size_t set = 0;
+    for (size_t i = 0; i < blocks_ * 8; ++i) {
+        set += std::bitset<64>(a[i]).count();
+    }
+    return double(set) / double(bits());
+}
+
+void BlockedBloomFilter::encode(Stream& s) const {
+    s << VERSION;
+    s << HASH;
+    s << blocks_;
+    s << hashes_;
+    s << insertions_;
+    s.writeLargeBlob(data_, footprint());
+}
+
+void BlockedBloomFilter::decode(Stream& s) {
+    unsigned int version;
+    unsigned int hash;
+    s >> version;
+    s >> hash;
+    ASSERT(version == VERSION);
+    ASSERT_MSG(hash == HASH, "BlockedBloomFilter: encoded with a different hash function");
+
+    s >> blocks_;
+    s >> hashes_;
+    s >> insertions_;
+
+    if (!validShape(blocks_, hashes_)) {
+        throw BadValue("BlockedBloomFilter: invalid number of blocks (" + std::to_string(blocks_) + ") or hashes (" +
+                       std::to_string(hashes_) + ")");
+    }
+
+    allocate();
+    s.readLargeBlob(data_, footprint());
+}
+
+void BlockedBloomFilter::save(const PathName& path) const {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic_, MAGIC, sizeof(MAGIC));
+    header.version_    = VERSION;
+    header.hash_       = HASH;
+    header.blocks_     = blocks_;
+    header.hashes_     = hashes_;
+    header.insertions_ = insertions_;
+
+    std::unique_ptr<DataHandle> handle(path.fileHandle());
+    handle->openForWrite(Length(sizeof(header) + footprint()));
+    AutoClose closer(*handle);
+
+    ASSERT(handle->write(&header, sizeof(header)) == sizeof(header));
+    ASSERT(size_t(handle->write(data_, long(footprint()))) == footprint());
+}
+
+void BlockedBloomFilter::print(std::ostream& s) const {
+    s << "BlockedBloomFilter(bits=" << bits() << ",hashes=" << hashes_ << ",insertions=" << insertions_
+      << (readOnly() ? ",mapped" : "") << ")";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
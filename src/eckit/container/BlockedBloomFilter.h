@@ -0,0 +1,208 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+class PathName;
+class Stream;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Blocked (cache-line) Bloom filter
+///
+/// Each key is hashed once (64-bit xxHash, XXH3) and the hash selects one block of 512 bits (a cache line), in which
+/// k bits are set or tested. Insertions and queries therefore touch a single cache line. The number of bits and of
+/// hash functions (k) are derived from the expected number of entries and the requested false-positive rate; the
+/// effective false-positive rate of a blocked filter is slightly higher than that of a classic one of the same size.
+///
+/// Filters can be serialised to a Stream, or saved to a file which can be memory-mapped (read-only) without copying.
+class BlockedBloomFilter : private NonCopyable {
+public:  // types
+    using hash_t = std::uint64_t;
+
+    static constexpr size_t blockBits = 512;
+
+public:  // methods
+    /// @param entries expected number of entries
+    /// @param falsePositiveRate target probability that contains() returns true for a key never inserted
+    BlockedBloomFilter(size_t entries, double falsePositiveRate = 0.01);
+
+    BlockedBloomFilter(Stream&);
+
+    /// Memory-map a filter saved with save(), read-only
+    BlockedBloomFilter(const PathName&);
+
+    ~BlockedBloomFilter();
+
+    // -- Keys
+
+    void insert(const void* key, size_t length) { insertHash(hash(key, length)); }
+    void insert(const std::string& key) { insert(key.data(), key.size()); }
+    void insert(std::string_view key) { insert(key.data(), key.size()); }
+    void insert(const char* key);
+
+    template <typename T>
+    void insert(const T& key) {
+        static_assert(isBytewiseKey<T>, "key is hashed bytewise");
+        insert(&key, sizeof(key));
+    }
+
+    bool contains(const void* key, size_t length) const { return containsHash(hash(key, length)); }
+    bool contains(const std::string& key) const { return contains(key.data(), key.size()); }
+    bool contains(std::string_view key) const { return contains(key.data(), key.size()); }
+    bool contains(const char* key) const;
+
+    template <typename T>
+    bool contains(const T& key) const {
+        static_assert(isBytewiseKey<T>, "key is hashed bytewise");
+        return contains(&key, sizeof(key));
+    }
+
+    // -- Bulk operations, prefetching the blocks of a batch of keys before accessing them
+
+    template <typename Iterator>
+    void insert(Iterator begin, Iterator end) {
+        hash_t hashes[batchSize];
+        while (begin != end) {
+            size_t n = 0;
+            for (; n < batchSize && begin != end; ++n, ++begin) {
+                hashes[n] = hashKey(*begin);
+            }
+            insertHashes(hashes, n);
+        }
+    }
+
+    /// Query keys in [begin, end), assigning the results (bool) to out
+    /// @returns number of keys (possibly) contained
+    template <typename Iterator, typename Output>
+    size_t contains(Iterator begin, Iterator end, Output out) const {
+        hash_t hashes[batchSize];
+        bool found[batchSize];
+        size_t count = 0;
+        while (begin != end) {
+            size_t n = 0;
+            for (; n < batchSize && begin != end; ++n, ++begin) {
+                hashes[n] = hashKey(*begin);
+            }
+            count += containsHashes(hashes, n, found);
+            for (size_t i = 0; i < n; ++i) {
+                *out++ = found[i];
+            }
+        }
+        return count;
+    }
+
+    // -- Hashes, for keys hashed by the caller (with hash())
+
+    void insertHash(hash_t);
+    bool containsHash(hash_t) const;
+
+    void insertHashes(const hash_t*, size_t n);
+    size_t containsHashes(const hash_t*, size_t n, bool* found) const;
+
+    static hash_t hash(const void* key, size_t length);
+
+    // -- Set operations, between filters of the same geometry (blocks and hashes)
+
+    /// Union: contains keys of either filter
+    BlockedBloomFilter& operator|=(const BlockedBloomFilter&);
+
+    /// Intersection: contains keys of both filters (with the false-positive rate of the larger filter)
+    BlockedBloomFilter& operator&=(const BlockedBloomFilter&);
+
+    // -- Accessors
+
+    bool empty() const { return insertions_ == 0; }
+
+    /// Number of insertions (an upper bound after an intersection)
+    size_t insertions() const { return insertions_; }
+
+    size_t bits() const { return blocks_ * blockBits; }
+    size_t hashes() const { return hashes_; }
+
+    /// Memory used by the bits
+    size_t footprint() const { return blocks_ * sizeof(Block); }
+
+    /// Fraction of bits set
+    double saturation() const;
+
+    bool readOnly() const { return mapped_ != nullptr; }
+
+    // -- I/O
+
+    void encode(Stream&) const;
+
+    /// Save to a file which can be memory-mapped by BlockedBloomFilter(const PathName&)
+    void save(const PathName&) const;
+
+private:  // types
+    struct alignas(64) Block {
+        std::uint64_t words_[blockBits / 64];
+    };
+
+    static constexpr size_t batchSize = 16;
+
+    /// Keys hashed by their object representation: equal keys must have equal bytes, so no padding, floating point
+    /// (0. and -0.) or pointers (including those of views, e.g. std::string_view, which has its own overloads)
+    template <typename T>
+    static constexpr bool isBytewiseKey = std::has_unique_object_representations_v<T> && !std::is_pointer_v<T>;
+
+private:  // methods
+    void allocate();
+
+    void decode(Stream&);
+
+    const Block& block(hash_t) const;
+
+    void print(std::ostream&) const;
+
+    static hash_t hashKey(const std::string& key) { return hash(key.data(), key.size()); }
+    static hash_t hashKey(std::string_view key) { return hash(key.data(), key.size()); }
+    static hash_t hashKey(const char* key) { return hashKey(std::string_view(key)); }
+
+    template <typename T>
+    static hash_t hashKey(const T& key) {
+        static_assert(isBytewiseKey<T>, "key is hashed bytewise");
+        return hash(&key, sizeof(key));
+    }
+
+private:  // members
+    size_t blocks_;
+    size_t hashes_;
+    size_t insertions_;
+
+    std::unique_ptr<Block[]> owned_;
+    Block* data_;
+
+    void* mapped_;  ///< file mapping, if read-only
+    size_t mappedSize_;
+
+private:  // friends
+    friend std::ostream& operator<<(std::ostream& s, const BlockedBloomFilter& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -35,6 +35,111 @@ std::string CacheManagerBase::loader() const {
     return loaderName_;
 }
 
+CacheManagerStatistics CacheManagerBase::statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+void CacheManagerBase::resetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_ = CacheManagerStatistics();
+}
+
+void CacheManagerBase::record(const std::function<void(CacheManagerStatistics&)>& update) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    update(statistics_);
+}
+
+PathName CacheManagerBase::coalesce(const std::string& key, const std::function<PathName()>& create) const {
+
+    std::promise<PathName> promise;
+    std::shared_future<PathName> future;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto j = inflight_.find(key);
+        if (j != inflight_.end()) {
+            future = j->second;
+        }
+        else {
+            inflight_.emplace(key, promise.get_future().share());
+        }
+    }
+
+    if (future.valid()) {
+        Log::debug<LibEcKit>() << "CACHE-MANAGER waiting for " << key << " (created by another thread)" << std::endl;
+
+        Timer timer;
+        PathName path        = future.get();  // rethrows the exception of the creating thread
+        const double elapsed = timer.elapsed();
+
+        record([elapsed](CacheManagerStatistics& s) {
+            s.coalesced_++;
+            s.waitTime_ += elapsed;
+        });
+        return path;
+    }
+
+    try {
+        PathName path = create();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_.erase(key);
+        }
+        promise.set_value(path);
+        return path;
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+std::shared_future<PathName> CacheManagerBase::background(const std::function<PathName()>& create,
+                                                          TaskScheduler* scheduler) const {
+
+    static const size_t threads = Resource<size_t>("cacheManagerThreads;$ECKIT_CACHE_MANAGER_THREADS", 2);
+    static TaskScheduler pool("cache-manager", std::max<size_t>(threads, 1));
+
+    struct Running {
+        const CacheManagerBase& owner_;
+        ~Running() {
+            std::lock_guard<std::mutex> lock(owner_.mutex_);
+            if (--owner_.background_ == 0) {
+                owner_.backgroundDone_.notify_all();
+            }
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        background_++;
+    }
+
+    try {
+        return (scheduler ? *scheduler : pool)
+            .submit([this, create]() {
+                Running running{*this};
+                return create();
+            })
+            .share();
+    }
+    catch (...) {
+        Running running{*this};
+        throw;
+    }
+}
+
+void CacheManagerBase::waitForBackground() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    backgroundDone_.wait(lock, [this] { return background_ == 0; });
+}
+
 template <class T>
 static bool compare(const T& a, const T& b) {
 
@@ -115,6 +220,8 @@ void CacheManagerBase::touch(const eckit::PathName& base, const eckit::PathName&
     // 2- where do we store the data (path)
     // 3- What is the threshold (size_t)
 
+    std::lock_guard<std::mutex> guard(touchMutex_);
+
     if (!maxCacheSize_) {
         return;
     }
@@ -237,6 +344,8 @@ void CacheManagerBase::touch(const eckit::PathName& base, const eckit::PathName&
                         unlinked = p.second.size_;
 
                         PathName(file + ".lock").unlink();
+
+                        record([](CacheManagerStatistics& s) { s.evictions_++; });
                     }
 
                     cache_entry_t zero = {0, 0, 0};
@@ -17,8 +17,12 @@
 
 #include <sys/stat.h>
 
+#include <condition_variable>
 #include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "eckit/config/LibEcKit.h"
@@ -27,10 +31,12 @@
 #include "eckit/filesystem/PathExpander.h"
 #include "eckit/filesystem/PathName.h"
 #include "eckit/io/FileLock.h"
+#include "eckit/log/Timer.h"
 #include "eckit/memory/NonCopyable.h"
 #include "eckit/os/AutoUmask.h"
 #include "eckit/os/Semaphore.h"
 #include "eckit/thread/AutoLock.h"
+#include "eckit/thread/TaskScheduler.h"
 #include "eckit/types/FixedString.h"
 #include "eckit/utils/MD5.h"
 #include "eckit/utils/StringTools.h"
@@ -45,6 +51,31 @@ class BTreeLock;
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Statistics of a CacheManager, in this process
+struct CacheManagerStatistics {
+    size_t hits_       = 0;  ///< entries found in the cache
+    size_t misses_     = 0;  ///< entries not found in the cache
+    size_t creations_  = 0;  ///< entries created
+    size_t coalesced_  = 0;  ///< misses served by another thread or process creating the same entry
+    size_t evictions_  = 0;  ///< entries removed to respect the maximum cache size
+    double createTime_ = 0;  ///< seconds creating entries
+    double waitTime_   = 0;  ///< seconds waiting for entries created by another thread or process
+    double loadTime_   = 0;  ///< seconds loading entries
+
+    void print(std::ostream& s) const {
+        s << "CacheManagerStatistics[hits=" << hits_ << ",misses=" << misses_ << ",creations=" << creations_
+          << ",coalesced=" << coalesced_ << ",evictions=" << evictions_ << ",createTime=" << createTime_
+          << ",waitTime=" << waitTime_ << ",loadTime=" << loadTime_ << "]";
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const CacheManagerStatistics& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 /// Filesystem Cache Manager
 
 class CacheManagerBase : private NonCopyable {
@@ -55,12 +86,30 @@ public:  // methods
 
     std::string loader() const;
 
+    CacheManagerStatistics statistics() const;
+    void resetStatistics();
+
 protected:
     void touch(const PathName& base, const PathName& path) const;
     void rescanCache(const eckit::PathName& base) const;
 
     bool writable(const PathName& path) const;
 
+    /// Call create() for a key, unless another thread of this process is already doing it: then wait for its result
+    /// (or exception) instead
+    PathName coalesce(const std::string& key, const std::function<PathName()>& create) const;
+
+    /// Update the statistics
+    void record(const std::function<void(CacheManagerStatistics&)>& update) const;
+
+    /// Run create() in the background, on the scheduler if given, otherwise on a pool shared by the cache managers
+    /// (resource cacheManagerThreads). The returned future does not block when destroyed.
+    std::shared_future<PathName> background(const std::function<PathName()>& create, TaskScheduler* scheduler) const;
+
+    /// Wait for the creations run in the background. To be called by the destructor of the derived class, as they use
+    /// its members.
+    void waitForBackground() const;
+
 private:  // members
     std::string loaderName_;
     size_t maxCacheSize_;
@@ -77,6 +126,14 @@ private:  // members
     typedef BTree<cache_key_t, cache_entry_t, 64 * 1024, BTreeLock> cache_btree_t;
 
     mutable std::unique_ptr<cache_btree_t> btree_;
+
+    mutable std::mutex touchMutex_;  ///< guards btree_
+
+    mutable std::mutex mutex_;  ///< guards the members below
+    mutable std::map<std::string, std::shared_future<PathName>> inflight_;
+    mutable CacheManagerStatistics statistics_;
+    mutable size_t background_ = 0;  ///< creations running in the background
+    mutable std::condition_variable backgroundDone_;
 };
 
 
@@ -136,9 +193,29 @@ public:  // methods
     explicit CacheManager(const std::string& loaderName, const std::string& roots, bool throwOnCacheMiss,
                           size_t maxCacheSize);
 
+    /// Waits for the creations run in the background
+    ~CacheManager();
+
+    /// Load the value of key from the cache, after creating it if necessary
+    ///
+    /// Concurrent creations of the same key are done once: threads of this process wait for the one creating it, and
+    /// other processes wait on the lock of the entry (see Traits::Locker).
     PathName getOrCreate(const key_t& key, CacheContentCreator& creator, value_type& value) const;
 
+    /// Create the entry of key in the background if it is not in the cache, without loading it
+    /// @param scheduler to run the creation, otherwise a pool shared by the cache managers
+    /// @returns the path of the entry, once created. getOrCreate() then finds it, or waits for it.
+    /// @note the creator is kept until the creation is done, and destroying this CacheManager waits for it
+    std::shared_future<PathName> getOrCreateAsync(const key_t& key, std::shared_ptr<CacheContentCreator> creator,
+                                                  TaskScheduler* scheduler = nullptr) const;
+
 private:  // methods
+    PathName obtain(const key_t& key, CacheContentCreator& creator, value_type& value, bool load) const;
+
+    PathName create(const key_t& key, CacheContentCreator& creator, value_type& value) const;
+
+    void load(value_type& value, const PathName& path) const;
+
     bool get(const key_t& key, PathName& path) const;
 
     PathName stage(const key_t& key, const PathName& root) const;
@@ -275,18 +352,71 @@ bool CacheManager<Traits>::commit(const key_t& key, const PathName& tmpfile, con
     return true;
 }
 
+template <class Traits>
+CacheManager<Traits>::~CacheManager() {
+    waitForBackground();
+}
+
 template <class Traits>
 PathName CacheManager<Traits>::getOrCreate(const key_t& key, CacheContentCreator& creator, value_type& value) const {
+    return obtain(key, creator, value, true);
+}
+
+template <class Traits>
+std::shared_future<PathName> CacheManager<Traits>::getOrCreateAsync(const key_t& key,
+                                                                    std::shared_ptr<CacheContentCreator> creator,
+                                                                    TaskScheduler* scheduler) const {
+    ASSERT(creator);
+
+    return background(
+        [this, key, creator]() {
+            value_type value;
+            return obtain(key, *creator, value, false);
+        },
+        scheduler);
+}
+
+template <class Traits>
+PathName CacheManager<Traits>::obtain(const key_t& key, CacheContentCreator& creator, value_type& value,
+                                      bool load) const {
 
     PathName path;
 
     if (get(key, path)) {
+        record([](CacheManagerStatistics& s) { s.hits_++; });
+
         Log::debug() << "Loading cache file " << path << std::endl;
 
-        Traits::load(*this, value, path);
+        if (load) {
+            this->load(value, path);
+        }
         return path;
     }
 
+    record([](CacheManagerStatistics& s) { s.misses_++; });
+
+    path = coalesce(key, [this, &key, &creator, &value] { return create(key, creator, value); });
+
+    // We reload from cache so we use the proper loader, e.g. mmap of shared-mem...
+    if (load) {
+        this->load(value, path);
+    }
+    return path;
+}
+
+template <class Traits>
+void CacheManager<Traits>::load(value_type& value, const PathName& path) const {
+    Timer timer;
+    Traits::load(*this, value, path);
+    const double elapsed = timer.elapsed();
+    record([elapsed](CacheManagerStatistics& s) { s.loadTime_ += elapsed; });
+}
+
+template <class Traits>
+PathName CacheManager<Traits>::create(const key_t& key, CacheContentCreator& creator, value_type& value) const {
+
+    PathName path;
+
     for (const PathName& root : roots_) {
 
         if (not writable(root)) {
@@ -299,12 +429,18 @@ PathName CacheManager<Traits>::getOrCreate(const key_t& key, CacheContentCreator
 
         try {
             typename Traits::Locker locker(file);
+
+            // another process creating the entry holds the lock until it is committed
+            Timer wait;
             AutoLock<typename Traits::Locker> lock(locker);
+            const double waited = wait.elapsed();
 
             if (!get(key, path)) {
 
                 Log::info() << "Creating cache file " << file << std::endl;
 
+                Timer timer;
+
                 PathName tmp = stage(key, root);
                 bool saved   = false;  // The creator may decide to save
 
@@ -316,15 +452,21 @@ PathName CacheManager<Traits>::getOrCreate(const key_t& key, CacheContentCreator
 
                 ASSERT(get(key, path));  // this includes the call to touch(path)
 
-                // We reload from cache so we use the proper loader, e.g. mmap of shared-mem...
-                Traits::load(*this, value, path);
+                const double elapsed = timer.elapsed();
+                record([elapsed](CacheManagerStatistics& s) {
+                    s.creations_++;
+                    s.createTime_ += elapsed;
+                });
             }
             else {
                 Log::debug() << "Loading cache file " << file << " (created by another process)"
                              << std::endl;
 
                 // touch() is done in the (successful) get() above
-                Traits::load(*this, value, path);
+                record([waited](CacheManagerStatistics& s) {
+                    s.coalesced_++;
+                    s.waitTime_ += waited;
+                });
             }
 
             return path;
@@ -0,0 +1,446 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/container/ColumnStore.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <set>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/memory/MMap.h"
+#include "eckit/os/Stat.h"
+#include "eckit/serialisation/FileStream.h"
+#include "eckit/utils/Compressor.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr unsigned long VERSION = 1;
+const char* const MAGIC         = "ECCOLSTR";
+
+bool uncompressed(const ColumnStore::Column& column) {
+    return column.compression_ == "none";
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ColumnStore::Column::Column(const std::string& name, Type type, size_t width, const std::string& compression,
+                            bool hasMissing, double missingValue) :
+    name_(name),
+    type_(type),
+    width_(width),
+    compression_(compression),
+    hasMissing_(hasMissing),
+    missingValue_(missingValue) {}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ColumnStore::ColumnStore(const PathName& directory, const std::vector<Column>& columns, size_t blockRows) :
+    directory_(directory),
+    columns_(columns),
+    blocks_(columns.size()),
+    blockRows_(blockRows),
+    rowWidth_(0),
+    rows_(0),
+    pending_(columns.size()),
+    pendingRows_(0),
+    mappings_(columns.size()),
+    compressors_(columns.size()) {
+    ASSERT(!columns_.empty());
+    ASSERT(blockRows_ > 0);
+
+    std::set<std::string> names;
+    for (const auto& column : columns_) {
+        if (!names.insert(column.name_).second) {
+            throw BadValue("ColumnStore: duplicate column " + column.name_);
+        }
+        if (column.width_ == 0 || (column.type_ != STRING && column.width_ != 1)) {
+            throw BadValue("ColumnStore: column " + column.name_ + " has an invalid width");
+        }
+        if (!uncompressed(column) && !CompressorFactory::instance().has(column.compression_)) {
+            throw BadValue("ColumnStore: column " + column.name_ + ", unknown compression " + column.compression_);
+        }
+        rowWidth_ += column.width_;
+    }
+
+    if (!directory_.exists()) {
+        directory_.mkdir();
+    }
+
+    // not readable until closed
+    if (indexPath().exists()) {
+        indexPath().unlink();
+    }
+
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        handles_.emplace_back(columnPath(c).fileHandle());
+        handles_.back()->openForWrite(0);
+        pending_[c].reserve(blockRows_ * columns_[c].width_);
+    }
+}
+
+ColumnStore::ColumnStore(const PathName& directory) :
+    directory_(directory), blockRows_(0), rowWidth_(0), rows_(0), pendingRows_(0) {
+    readIndex();
+
+    for (const auto& column : columns_) {
+        rowWidth_ += column.width_;
+    }
+
+    mappings_.resize(columns_.size());
+    compressors_.resize(columns_.size());
+}
+
+ColumnStore::~ColumnStore() {
+    if (!handles_.empty()) {
+        try {
+            close();
+        }
+        catch (std::exception& e) {
+            Log::error() << "ColumnStore: " << directory_ << " not closed: " << e.what() << std::endl;
+        }
+    }
+
+    for (auto& mapping : mappings_) {
+        if (mapping.address_ != nullptr) {
+            MMap::munmap(mapping.address_, mapping.length_);
+        }
+    }
+}
+
+PathName ColumnStore::columnPath(size_t c) const {
+    return directory_ / (std::to_string(c) + ".col");
+}
+
+PathName ColumnStore::indexPath() const {
+    return directory_ / "index";
+}
+
+size_t ColumnStore::columnIndex(const std::string& name) const {
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        if (columns_[c].name_ == name) {
+            return c;
+        }
+    }
+    throw BadValue("ColumnStore: no column " + name + " in " + directory_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ColumnStore::append(const double* row) {
+    ASSERT_MSG(!handles_.empty(), "ColumnStore: append to a closed store");
+
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const size_t width = columns_[c].width_;
+        pending_[c].insert(pending_[c].end(), row, row + width);
+        row += width;
+    }
+
+    rows_++;
+    if (++pendingRows_ == blockRows_) {
+        flushBlock();
+    }
+}
+
+void ColumnStore::append(const std::vector<double>& row) {
+    ASSERT(row.size() == rowWidth_);
+    append(row.data());
+}
+
+void ColumnStore::flushBlock() {
+    if (pendingRows_ == 0) {
+        return;
+    }
+
+    Buffer compressed;
+
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const Column& column       = columns_[c];
+        std::vector<double>& data  = pending_[c];
+        std::vector<Block>& blocks = blocks_[c];
+
+        Block block;
+        block.offset_ = blocks.empty() ? 0 : blocks.back().offset_ + blocks.back().length_;
+        block.rows_   = pendingRows_;
+
+        if (column.type_ != STRING) {
+            bool first = true;
+            for (double v : data) {
+                // NaNs compare false with any bound, and would make the zone map skip the block
+                if (std::isnan(v) || (column.hasMissing_ && v == column.missingValue_)) {
+                    block.missing_++;
+                }
+                else if (first) {
+                    block.min_ = block.max_ = v;
+                    first      = false;
+                }
+                else {
+                    block.min_ = std::min(block.min_, v);
+                    block.max_ = std::max(block.max_, v);
+                }
+            }
+        }
+
+        const size_t length = data.size() * sizeof(double);
+
+        if (uncompressed(column)) {
+            ASSERT(size_t(handles_[c]->write(data.data(), long(length))) == length);
+            block.length_ = length;
+        }
+        else {
+            block.length_ = compressor(c).compress(data.data(), length, compressed);
+            ASSERT(size_t(handles_[c]->write(compressed.data(), long(block.length_))) == block.length_);
+        }
+
+        blocks.push_back(block);
+        data.clear();
+    }
+
+    pendingRows_ = 0;
+}
+
+void ColumnStore::close() {
+    if (handles_.empty()) {
+        return;
+    }
+
+    flushBlock();
+
+    for (auto& handle : handles_) {
+        handle->close();
+    }
+    handles_.clear();
+    pending_.clear();
+
+    writeIndex();
+}
+
+void ColumnStore::writeIndex() const {
+    PathName tmp = directory_ / "index.tmp";
+
+    {
+        FileStream s(tmp, "w");
+
+        s << std::string(MAGIC);
+        s << VERSION;
+        s << static_cast<unsigned long long>(blockRows_);
+        s << static_cast<unsigned long long>(rows_);
+        s << static_cast<unsigned long long>(columns_.size());
+
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            const Column& column = columns_[c];
+            s << column.name_;
+            s << int(column.type_);
+            s << static_cast<unsigned long long>(column.width_);
+            s << column.compression_;
+            s << column.hasMissing_;
+            s << column.missingValue_;
+
+            s << static_cast<unsigned long long>(blocks_[c].size());
+            for (const Block& block : blocks_[c]) {
+                s << static_cast<unsigned long long>(block.offset_);
+                s << static_cast<unsigned long long>(block.length_);
+                s << static_cast<unsigned long long>(block.rows_);
+                s << static_cast<unsigned long long>(block.missing_);
+                s << block.min_;
+                s << block.max_;
+            }
+        }
+
+        s.close();
+    }
+
+    // readers never see a partial index
+    PathName::rename(tmp, indexPath());
+}
+
+void ColumnStore::readIndex() {
+    if (!indexPath().exists()) {
+        throw BadValue("ColumnStore: " + directory_ + " has no index, it was not closed");
+    }
+
+    FileStream s(indexPath(), "r");
+
+    std::string magic;
+    unsigned long version;
+    s >> magic;
+    s >> version;
+    if (magic != MAGIC || version != VERSION) {
+        throw BadValue("ColumnStore: " + directory_ + " is not a valid store");
+    }
+
+    unsigned long long blockRows;
+    unsigned long long rows;
+    unsigned long long columns;
+    s >> blockRows;
+    s >> rows;
+    s >> columns;
+
+    blockRows_ = blockRows;
+    rows_      = rows;
+
+    for (unsigned long long c = 0; c < columns; ++c) {
+        std::string name;
+        int type;
+        unsigned long long width;
+        std::string compression;
+        bool hasMissing;
+        double missingValue;
+        s >> name;
+        s >> type;
+        s >> width;
+        s >> compression;
+        s >> hasMissing;
+        s >> missingValue;
+
+        columns_.emplace_back(name, Type(type), width, compression, hasMissing, missingValue);
+
+        unsigned long long count;
+        s >> count;
+
+        std::vector<Block> blocks(count);
+        for (Block& block : blocks) {
+            unsigned long long offset, length, rows, missing;
+            s >> offset;
+            s >> length;
+            s >> rows;
+            s >> missing;
+            s >> block.min_;
+            s >> block.max_;
+
+            block.offset_  = offset;
+            block.length_  = length;
+            block.rows_    = rows;
+            block.missing_ = missing;
+        }
+        blocks_.push_back(std::move(blocks));
+    }
+
+    s.close();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const char* ColumnStore::mapped(size_t c) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Mapping& mapping = mappings_[c];
+    if (mapping.mapped_) {
+        return static_cast<const char*>(mapping.address_);
+    }
+
+    const PathName path = columnPath(c);
+
+    int fd;
+    SYSCALL(fd = ::open(path.localPath(), O_RDONLY));
+
+    Stat::Struct s;
+    SYSCALL(Stat::fstat(fd, &s));
+
+    const std::vector<Block>& blocks = blocks_[c];
+    const size_t length              = size_t(s.st_size);
+    if (!blocks.empty() && length < blocks.back().offset_ + blocks.back().length_) {
+        ::close(fd);
+        throw BadValue("ColumnStore: " + path + " is too short");
+    }
+
+    if (length > 0) {
+        void* address = MMap::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            Log::error() << "ColumnStore: mmap(" << path << ')' << Log::syserr << std::endl;
+            throw FailedSystemCall("mmap", Here());
+        }
+        mapping.address_ = address;
+        mapping.length_  = length;
+    }
+    ::close(fd);
+
+    mapping.mapped_ = true;
+    return static_cast<const char*>(mapping.address_);
+}
+
+const Compressor& ColumnStore::compressor(size_t c) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!compressors_[c]) {
+        compressors_[c].reset(CompressorFactory::instance().build(columns_[c].compression_));
+    }
+    return *compressors_[c];
+}
+
+const double* ColumnStore::read(size_t c, size_t b, Buffer& buffer) const {
+    ASSERT_MSG(handles_.empty(), "ColumnStore: read from a store being written");
+    ASSERT(c < columns_.size());
+    ASSERT(b < blocks_[c].size());
+
+    const Block& block = blocks_[c][b];
+    const char* data   = mapped(c) + block.offset_;
+
+    if (uncompressed(columns_[c])) {
+        return reinterpret_cast<const double*>(data);
+    }
+
+    const size_t length = block.rows_ * columns_[c].width_ * sizeof(double);
+    compressor(c).uncompress(data, block.length_, buffer, length);
+    return static_cast<const double*>(buffer.data());
+}
+
+void ColumnStore::read(size_t c, std::vector<double>& values) const {
+    const size_t width = columns_[c].width_;
+    values.resize(rows_ * width);
+
+    Buffer buffer;
+    double* out = values.data();
+    for (size_t b = 0; b < blocks_[c].size(); ++b) {
+        const size_t count = blocks_[c][b].rows_ * width;
+        std::memcpy(out, read(c, b, buffer), count * sizeof(double));
+        out += count;
+    }
+}
+
+std::vector<size_t> ColumnStore::select(size_t c, double min, double max) const {
+    ASSERT(c < columns_.size());
+    ASSERT_MSG(columns_[c].type_ != STRING, "ColumnStore: no zone maps for strings");
+
+    std::vector<size_t> result;
+    for (size_t b = 0; b < blocks_[c].size(); ++b) {
+        const Block& block = blocks_[c][b];
+        if (block.missing_ < block.rows_ && block.min_ <= max && min <= block.max_) {
+            result.push_back(b);
+        }
+    }
+    return result;
+}
+
+void ColumnStore::print(std::ostream& s) const {
+    s << "ColumnStore[directory=" << directory_ << ",columns=" << columns_.size() << ",rows=" << rows_
+      << ",blocks=" << blocks() << ",blockRows=" << blockRows_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
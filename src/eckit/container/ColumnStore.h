@@ -0,0 +1,169 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+class Buffer;
+class Compressor;
+class DataHandle;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Memory-mapped table of fixed-schema records, stored by column
+///
+/// A store is a directory, with one file per column and an index. Rows are appended, and written by blocks of rows;
+/// each block of each column is compressed on its own (see CompressorFactory). Columns are memory-mapped on first
+/// access, so that a scan only touches the columns it reads. Blocks of uncompressed columns are read in place.
+///
+/// Values are doubles, as in eckit::sql: integers are stored as doubles, and strings are packed in width() doubles.
+/// The index keeps, per block and column, the minimum and maximum values (zone maps) to skip the blocks that cannot
+/// match a range.
+///
+/// A store is either being written (until close()) or read, possibly by several threads and processes.
+class ColumnStore : private NonCopyable {
+public:  // types
+    enum Type
+    {
+        INTEGER,
+        REAL,
+        DOUBLE,
+        STRING
+    };
+
+    struct Column {
+        Column(const std::string& name, Type type, size_t width = 1, const std::string& compression = "none",
+               bool hasMissing = false, double missingValue = 0);
+
+        std::string name_;
+        Type type_;
+        size_t width_;             ///< in doubles, more than one for strings only
+        std::string compression_;  ///< name of the compressor
+        bool hasMissing_;
+        double missingValue_;
+    };
+
+    /// Block of rows of a column
+    struct Block {
+        size_t offset_  = 0;  ///< in the column file
+        size_t length_  = 0;  ///< bytes, compressed
+        size_t rows_    = 0;
+        size_t missing_ = 0;  ///< missing values, and NaNs
+        double min_     = 0;  ///< of the values not missing, not for strings
+        double max_     = 0;
+    };
+
+public:  // methods
+    /// Create a store, replacing any store in directory
+    ColumnStore(const PathName& directory, const std::vector<Column>& columns, size_t blockRows = 65536);
+
+    /// Open a store, read-only
+    explicit ColumnStore(const PathName& directory);
+
+    /// Closes a store being written
+    ~ColumnStore();
+
+    // -- Writing
+
+    /// Append a row, of rowWidth() doubles
+    void append(const double* row);
+    void append(const std::vector<double>& row);
+
+    /// Write the pending rows and the index, then the store is read-only
+    void close();
+
+    // -- Schema
+
+    const PathName& directory() const { return directory_; }
+
+    size_t columns() const { return columns_.size(); }
+    const Column& column(size_t c) const { return columns_[c]; }
+    size_t columnIndex(const std::string& name) const;
+
+    /// Doubles in a row
+    size_t rowWidth() const { return rowWidth_; }
+
+    size_t rows() const { return rows_; }
+
+    // -- Reading
+
+    size_t blocks() const { return blocks_.empty() ? 0 : blocks_.front().size(); }
+    const Block& block(size_t c, size_t b) const { return blocks_[c][b]; }
+
+    /// Values of a block of a column, rows() x width() doubles
+    /// @param buffer holds the values if the column is compressed, otherwise they are read in place
+    const double* read(size_t c, size_t b, Buffer& buffer) const;
+
+    /// All the values of a column
+    void read(size_t c, std::vector<double>& values) const;
+
+    /// Blocks of a (numeric) column that may hold values in [min, max], from the zone maps
+    std::vector<size_t> select(size_t c, double min, double max) const;
+
+    void print(std::ostream&) const;
+
+private:  // types
+    struct Mapping {
+        void* address_ = nullptr;
+        size_t length_ = 0;
+        bool mapped_   = false;
+    };
+
+private:  // methods
+    PathName columnPath(size_t c) const;
+    PathName indexPath() const;
+
+    void flushBlock();
+    void writeIndex() const;
+    void readIndex();
+
+    const char* mapped(size_t c) const;
+    const Compressor& compressor(size_t c) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const ColumnStore& p) {
+        p.print(s);
+        return s;
+    }
+
+private:  // members
+    PathName directory_;
+
+    std::vector<Column> columns_;
+    std::vector<std::vector<Block>> blocks_;  ///< per column
+
+    size_t blockRows_;
+    size_t rowWidth_;
+    size_t rows_;
+
+    // writing
+    std::vector<std::unique_ptr<DataHandle>> handles_;
+    std::vector<std::vector<double>> pending_;  ///< rows of the current block, per column
+    size_t pendingRows_;
+
+    // reading
+    mutable std::mutex mutex_;  ///< guards the members below
+    mutable std::vector<Mapping> mappings_;
+    mutable std::vector<std::unique_ptr<Compressor>> compressors_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,376 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Statistics of a ConcurrentCacheLRU
+struct CacheLRUStatistics {
+    size_t hits_      = 0;  ///< lookups that found the key
+    size_t misses_    = 0;  ///< lookups that did not find the key
+    size_t coalesced_ = 0;  ///< misses that waited for the same key being computed by another thread
+    size_t inserts_   = 0;  ///< entries inserted (or replaced)
+    size_t evictions_ = 0;  ///< entries evicted to respect the capacity
+
+    CacheLRUStatistics& operator+=(const CacheLRUStatistics& other) {
+        hits_ += other.hits_;
+        misses_ += other.misses_;
+        coalesced_ += other.coalesced_;
+        inserts_ += other.inserts_;
+        evictions_ += other.evictions_;
+        return *this;
+    }
+
+    void print(std::ostream& s) const {
+        s << "CacheLRUStatistics[hits=" << hits_ << ",misses=" << misses_ << ",coalesced=" << coalesced_
+          << ",inserts=" << inserts_ << ",evictions=" << evictions_ << "]";
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const CacheLRUStatistics& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Thread-safe least-recently-used cache, with a capacity in cost units (e.g. bytes)
+///
+/// Keys are distributed by hash over shards, each an LRU list and a hash table under its own mutex, so that threads
+/// accessing different keys rarely contend. Each shard holds an equal part of the capacity. The cost of an entry is
+/// given by a user function (1 per entry by default); entries costing more than a shard's capacity are not cached.
+///
+/// Values are held by shared pointers and lookups return them, without copying: an evicted value lives on while in use.
+/// getOrCompute() computes a missing value once, however many threads ask for the same key at the same time.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ConcurrentCacheLRU : private NonCopyable {
+public:  // types
+    using key_type   = K;
+    using value_type = V;
+    using handle     = std::shared_ptr<const V>;
+    using cost_type  = std::function<size_t(const K&, const V&)>;
+
+public:  // methods
+    /// @param capacity total cost of the entries
+    /// @param cost cost of an entry, 1 if not given
+    /// @param shards number of shards, rounded up to a power of 2
+    explicit ConcurrentCacheLRU(size_t capacity, cost_type cost = cost_type(), size_t shards = 16) :
+        capacity_(capacity), cost_(std::move(cost)) {
+        size_t n = 1;
+        while (n < shards) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+
+        shards_.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            shards_.emplace_back(new Shard);
+        }
+        this->capacity(capacity);
+    }
+
+    /// @returns the value of key, or a null handle if not cached
+    handle find(const K& key) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex_);
+
+        auto i = s.map_.find(key);
+        if (i == s.map_.end()) {
+            s.stats_.misses_++;
+            return handle();
+        }
+
+        s.stats_.hits_++;
+        s.lru_.splice(s.lru_.begin(), s.lru_, i->second);
+        return i->second->value_;
+    }
+
+    /// Insert, or replace, the value of key
+    /// @returns the cached value
+    handle insert(const K& key, V value) { return insert(key, std::make_shared<const V>(std::move(value))); }
+
+    handle insert(const K& key, handle value) {
+        ASSERT(value);
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex_);
+        store(s, key, value);
+        return value;
+    }
+
+    /// @returns the value of key, computed by compute() (returning a V) if not cached
+    ///
+    /// Concurrent misses on the same key are coalesced: one thread computes the value, the others wait for it. If
+    /// compute() (or the cost function) throws, the exception is rethrown to all of them and nothing is cached.
+    template <typename F>
+    handle getOrCompute(const K& key, F&& compute) {
+        Shard& s = shard(key);
+        std::shared_ptr<Pending> pending;
+        {
+            std::unique_lock<std::mutex> lock(s.mutex_);
+
+            auto i = s.map_.find(key);
+            if (i != s.map_.end()) {
+                s.stats_.hits_++;
+                s.lru_.splice(s.lru_.begin(), s.lru_, i->second);
+                return i->second->value_;
+            }
+
+            s.stats_.misses_++;
+
+            auto j = s.pending_.find(key);
+            if (j != s.pending_.end()) {
+                s.stats_.coalesced_++;
+                std::shared_ptr<Pending> other = j->second;
+                other->done_.wait(lock, [&other] { return other->finished_; });
+                if (other->error_) {
+                    std::rethrow_exception(other->error_);
+                }
+                return other->value_;
+            }
+
+            pending = std::make_shared<Pending>();
+            s.pending_.emplace(key, pending);
+        }
+
+        handle value;
+        std::exception_ptr error;
+        try {
+            value = std::make_shared<const V>(compute());
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(s.mutex_);
+            if (!error) {
+                try {
+                    store(s, key, value);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                    value.reset();
+                }
+            }
+            pending->value_    = value;
+            pending->error_    = error;
+            pending->finished_ = true;
+            s.pending_.erase(key);
+        }
+        pending->done_.notify_all();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return value;
+    }
+
+    /// @returns true if key was cached
+    bool remove(const K& key) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex_);
+
+        auto i = s.map_.find(key);
+        if (i == s.map_.end()) {
+            return false;
+        }
+        erase(s, i);
+        return true;
+    }
+
+    bool exists(const K& key) const {
+        const Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex_);
+        return s.map_.find(key) != s.map_.end();
+    }
+
+    void clear() {
+        for (auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mutex_);
+            s->lru_.clear();
+            s->map_.clear();
+            s->cost_ = 0;
+        }
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    /// Change the capacity, evicting entries if necessary
+    void capacity(size_t capacity) {
+        capacity_ = capacity;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Shard& s = *shards_[i];
+            std::lock_guard<std::mutex> lock(s.mutex_);
+            // remainder to the first shards, so that the shard capacities add up to the total
+            s.capacity_ = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+            trim(s);
+        }
+    }
+
+    /// @returns number of entries
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mutex_);
+            n += s->map_.size();
+        }
+        return n;
+    }
+
+    /// @returns total cost of the entries
+    size_t cost() const {
+        size_t n = 0;
+        for (const auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mutex_);
+            n += s->cost_;
+        }
+        return n;
+    }
+
+    size_t shards() const { return shards_.size(); }
+
+    CacheLRUStatistics statistics() const {
+        CacheLRUStatistics stats;
+        for (const auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mutex_);
+            stats += s->stats_;
+        }
+        return stats;
+    }
+
+    void resetStatistics() {
+        for (auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s->mutex_);
+            s->stats_ = CacheLRUStatistics();
+        }
+    }
+
+    void print(std::ostream& os) const {
+        os << "ConcurrentCacheLRU(capacity=" << capacity_ << ",shards=" << shards_.size() << ",size=" << size()
+           << ",cost=" << cost() << ")";
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const ConcurrentCacheLRU& p) {
+        p.print(s);
+        return s;
+    }
+
+private:  // types
+    struct Entry {
+        K key_;
+        handle value_;
+        size_t cost_;
+    };
+
+    using list_type = std::list<Entry>;
+
+    /// A value being computed by getOrCompute()
+    struct Pending {
+        std::condition_variable done_;
+        bool finished_ = false;
+        handle value_;
+        std::exception_ptr error_;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex_;
+        list_type lru_;  ///< most recently used first
+        std::unordered_map<K, typename list_type::iterator, Hash> map_;
+        std::unordered_map<K, std::shared_ptr<Pending>, Hash> pending_;
+        size_t capacity_ = 0;
+        size_t cost_     = 0;
+        CacheLRUStatistics stats_;
+    };
+
+private:  // methods
+    Shard& shard(const K& key) const {
+        // mix the hash, std::hash of integers is the identity
+        size_t h = Hash()(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return *shards_[h & mask_];
+    }
+
+    size_t costOf(const K& key, const V& value) const { return cost_ ? cost_(key, value) : 1; }
+
+    /// Insert or replace, with the shard locked. If the cost function or an allocation throws, the shard is unchanged
+    void store(Shard& s, const K& key, const handle& value) {
+        const size_t c = costOf(key, *value);
+
+        auto i = s.map_.find(key);
+        if (i != s.map_.end()) {
+            erase(s, i);
+        }
+
+        s.stats_.inserts_++;
+
+        if (c > s.capacity_) {
+            return;  // would evict everything, and still not fit
+        }
+
+        s.lru_.push_front(Entry{key, value, c});
+        try {
+            s.map_.emplace(key, s.lru_.begin());
+        }
+        catch (...) {
+            s.lru_.pop_front();
+            throw;
+        }
+        s.cost_ += c;
+        trim(s);
+    }
+
+    void erase(Shard& s, typename decltype(Shard::map_)::iterator i) {
+        s.cost_ -= i->second->cost_;
+        s.lru_.erase(i->second);
+        s.map_.erase(i);
+    }
+
+    void trim(Shard& s) {
+        while (s.cost_ > s.capacity_) {
+            const Entry& e = s.lru_.back();
+            s.cost_ -= e.cost_;
+            s.map_.erase(e.key_);
+            s.lru_.pop_back();
+            s.stats_.evictions_++;
+        }
+    }
+
+private:  // members
+    size_t capacity_;
+    cost_type cost_;
+
+    size_t mask_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
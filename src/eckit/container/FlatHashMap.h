@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <tuple>
+#include <utility>
+
+#include "eckit/container/FlatHashTable.h"
+#include "eckit/exception/Exceptions.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Hash map with open addressing, storing items inline (see detail::FlatHashTable)
+///
+/// Unlike DenseMap, items can be inserted, erased and looked up in any order, in constant time: there is no sort(), and
+/// iteration is in no particular order. Iterators and references are invalidated by insertions that grow the table
+/// (see reserve()) and by erasures of the item they refer to.
+///
+/// Lookups by a type other than K (e.g. std::string_view for std::string keys) are possible if Hash and Eq declare
+/// is_transparent.
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class FlatHashMap {
+public:  // types
+    typedef K key_type;    ///< key type
+    typedef V value_type;  ///< value type
+
+    typedef std::pair<const K, V> item_type;  ///< (key, value) item type
+
+private:  // types
+    struct KeyOf {
+        const K& operator()(const item_type& item) const { return item.first; }
+    };
+
+    using table_t = detail::FlatHashTable<K, item_type, KeyOf, Hash, Eq>;
+
+    template <typename Q>
+    using lookup_t =
+        std::enable_if_t<std::is_convertible_v<const Q&, const K&> || detail::FlatHashTransparent<Hash, Eq>::value>;
+
+public:  // methods
+    typedef typename table_t::iterator iterator;
+    typedef typename table_t::const_iterator const_iterator;
+
+    FlatHashMap(size_t s = 0) {
+        if (s > 0) {
+            reserve(s);
+        }
+    }
+
+    /// Make room for s items without rehashing
+    void reserve(size_t s) { table_.reserve(s); }
+
+    /// Inserts an item if the key is not in the map
+    /// @returns true if inserted
+    bool insert(const K& k, const V& v) { return emplace(k, v).second; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const K& k, Args&&... args) {
+        return table_.tryEmplace(k, std::piecewise_construct, std::forward_as_tuple(k),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    /// Inserts an item, or replaces the value of an existing key
+    void replace(const K& k, const V& v) {
+        auto r = emplace(k, v);
+        if (!r.second) {
+            r.first->second = v;
+        }
+    }
+
+    template <typename Q, typename = lookup_t<Q>>
+    size_t erase(const Q& k) {
+        return table_.erase(k);
+    }
+
+    iterator erase(iterator it) { return table_.erase(it); }
+    iterator erase(const_iterator it) { return table_.erase(it); }
+
+    void clear() { table_.clear(); }
+
+    /// No-ops, for DenseMap compatibility: lookups are always possible
+    void sort() {}
+    bool sorted() const { return true; }
+
+    size_t size() const { return table_.size(); }
+    bool empty() const { return table_.empty(); }
+
+    /// Number of slots
+    size_t capacity() const { return table_.capacity(); }
+
+    double loadFactor() const { return table_.loadFactor(); }
+
+    iterator begin() { return table_.begin(); }
+    const_iterator begin() const { return table_.begin(); }
+    const_iterator cbegin() const { return table_.begin(); }
+
+    iterator end() { return table_.end(); }
+    const_iterator end() const { return table_.end(); }
+    const_iterator cend() const { return table_.end(); }
+
+    template <typename Q, typename = lookup_t<Q>>
+    iterator find(const Q& k) {
+        return table_.find(k);
+    }
+
+    template <typename Q, typename = lookup_t<Q>>
+    const_iterator find(const Q& k) const {
+        return table_.find(k);
+    }
+
+    template <typename Q, typename = lookup_t<Q>>
+    bool contains(const Q& k) const {
+        return find(k) != cend();
+    }
+
+    /// @pre key must be in the map
+    template <typename Q, typename = lookup_t<Q>>
+    const value_type& get(const Q& k) const {
+        auto it = find(k);
+        ASSERT(it != cend());
+        return it->second;
+    }
+
+    template <typename Q, typename = lookup_t<Q>>
+    value_type& get(const Q& k) {
+        auto it = find(k);
+        ASSERT(it != end());
+        return it->second;
+    }
+
+    /// Value of the key, inserted (default constructed) if not in the map
+    value_type& operator[](const K& k) { return emplace(k).first->second; }
+
+    void print(std::ostream& s) const {
+        for (const auto& item : *this) {
+            s << item.first << " " << item.second << std::endl;
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const FlatHashMap& m) {
+        m.print(s);
+        return s;
+    }
+
+private:  // members
+    table_t table_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,110 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <utility>
+
+#include "eckit/container/FlatHashTable.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Hash set with open addressing, storing values inline (see detail::FlatHashTable)
+///
+/// Unlike DenseSet, values can be inserted, erased and looked up in any order, in constant time: there is no sort(), and
+/// iteration is in no particular order.
+template <typename V, typename Hash = std::hash<V>, typename Eq = std::equal_to<V>>
+class FlatHashSet {
+public:                    // types
+    typedef V value_type;  ///< value type
+
+private:  // types
+    struct KeyOf {
+        const V& operator()(const V& v) const { return v; }
+    };
+
+    using table_t = detail::FlatHashTable<V, V, KeyOf, Hash, Eq>;
+
+    template <typename Q>
+    using lookup_t =
+        std::enable_if_t<std::is_convertible_v<const Q&, const V&> || detail::FlatHashTransparent<Hash, Eq>::value>;
+
+public:  // methods
+    typedef const value_type& const_reference;
+
+    // values cannot be modified in place
+    typedef typename table_t::const_iterator iterator;
+    typedef typename table_t::const_iterator const_iterator;
+
+    FlatHashSet(size_t s = 0) {
+        if (s > 0) {
+            reserve(s);
+        }
+    }
+
+    void reserve(size_t s) { table_.reserve(s); }
+
+    /// @returns true if inserted
+    bool insert(const V& v) { return table_.tryEmplace(v, v).second; }
+    bool insert(V&& v) { return table_.tryEmplace(v, std::move(v)).second; }
+
+    template <typename Q, typename = lookup_t<Q>>
+    size_t erase(const Q& v) {
+        return table_.erase(v);
+    }
+
+    void clear() { table_.clear(); }
+
+    size_t size() const { return table_.size(); }
+    bool empty() const { return table_.empty(); }
+
+    size_t capacity() const { return table_.capacity(); }
+
+    double loadFactor() const { return table_.loadFactor(); }
+
+    const_iterator begin() const { return table_.begin(); }
+    const_iterator cbegin() const { return table_.begin(); }
+
+    const_iterator end() const { return table_.end(); }
+    const_iterator cend() const { return table_.end(); }
+
+    template <typename Q, typename = lookup_t<Q>>
+    const_iterator find(const Q& v) const {
+        return table_.find(v);
+    }
+
+    template <typename Q, typename = lookup_t<Q>>
+    bool contains(const Q& v) const {
+        return find(v) != cend();
+    }
+
+    void print(std::ostream& s) const {
+        for (const auto& v : *this) {
+            s << v << std::endl;
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const FlatHashSet& m) {
+        m.print(s);
+        return s;
+    }
+
+private:  // members
+    table_t table_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,458 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#define ECKIT_FLATHASH_SSE2 1
+#include <emmintrin.h>
+#else
+#define ECKIT_FLATHASH_SSE2 0
+#endif
+
+#include "eckit/exception/Exceptions.h"
+
+
+namespace eckit::detail {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Control bytes of a group of slots, matched all at once (SSE2, or 8 bytes in a word otherwise)
+///
+/// A control byte is kEmpty, kDeleted, or 7 bits of the hash of the key in a full slot.
+class FlatHashGroup {
+public:
+    static constexpr std::int8_t kEmpty   = -128;  // 0b10000000
+    static constexpr std::int8_t kDeleted = -2;    // 0b11111110
+
+    /// Bits of matching slots, iterated with lowest()/next()
+    class Mask {
+    public:
+        explicit Mask(std::uint64_t bits) :
+            bits_(bits) {}
+
+        explicit operator bool() const { return bits_ != 0; }
+
+        size_t lowest() const {
+#if defined(__GNUC__)
+            return size_t(__builtin_ctzll(bits_)) / stride;
+#else
+            size_t n = 0;
+            while (!(bits_ & (std::uint64_t(1) << n))) {
+                ++n;
+            }
+            return n / stride;
+#endif
+        }
+
+        void next() { bits_ &= bits_ - 1; }
+
+    private:
+        std::uint64_t bits_;
+    };
+
+#if ECKIT_FLATHASH_SSE2
+    static constexpr size_t width  = 16;
+    static constexpr size_t stride = 1;
+
+    explicit FlatHashGroup(const std::int8_t* ctrl) :
+        ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    Mask match(std::int8_t h2) const {
+        return Mask(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_))));
+    }
+
+    Mask empty() const { return Mask(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), ctrl_)))); }
+
+    /// Special bytes have their high bit set
+    Mask emptyOrDeleted() const { return Mask(std::uint32_t(_mm_movemask_epi8(ctrl_))); }
+
+private:
+    __m128i ctrl_;
+#else
+    static constexpr size_t width  = 8;
+    static constexpr size_t stride = 8;
+
+    explicit FlatHashGroup(const std::int8_t* ctrl) { std::memcpy(&ctrl_, ctrl, sizeof(ctrl_)); }
+
+    /// May report false positives after a true one, which the comparison of keys rules out
+    Mask match(std::int8_t h2) const {
+        const std::uint64_t x = ctrl_ ^ (lsbs * std::uint8_t(h2));
+        return Mask((x - lsbs) & ~x & msbs);
+    }
+
+    /// kEmpty is the only special byte with bit 1 clear
+    Mask empty() const { return Mask(ctrl_ & ~(ctrl_ << 6) & msbs); }
+
+    Mask emptyOrDeleted() const { return Mask(ctrl_ & msbs); }
+
+private:
+    static constexpr std::uint64_t lsbs = 0x0101010101010101ULL;
+    static constexpr std::uint64_t msbs = 0x8080808080808080ULL;
+
+    std::uint64_t ctrl_;
+#endif
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Open-addressing hash table in the style of Swiss tables, storing items of type T inline
+///
+/// Slots are organised in groups, whose control bytes are compared to 7 bits of the hash of a key in a few
+/// instructions, so that most lookups touch one group of control bytes and compare a single key. Groups are probed
+/// quadratically, and erased slots become tombstones unless their group has an empty slot.
+///
+/// KeyOf extracts the key of an item. Lookups by a type other than K are enabled if Hash and Eq are transparent.
+template <typename K, typename T, typename KeyOf, typename Hash, typename Eq>
+class FlatHashTable {
+public:  // types
+    template <bool Const>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = std::conditional_t<Const, const T*, T*>;
+        using reference         = std::conditional_t<Const, const T&, T&>;
+
+        Iterator() = default;
+
+        /// const from non-const
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other) :
+            ctrl_(other.ctrl_), slot_(other.slot_), end_(other.end_) {}
+
+        reference operator*() const { return *slot_; }
+        pointer operator->() const { return slot_; }
+
+        Iterator& operator++() {
+            ++ctrl_;
+            ++slot_;
+            skip();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator i(*this);
+            ++*this;
+            return i;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.slot_ == b.slot_; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.slot_ != b.slot_; }
+
+    private:
+        Iterator(const std::int8_t* ctrl, T* slot, const std::int8_t* end) :
+            ctrl_(ctrl), slot_(slot), end_(end) {}
+
+        void skip() {
+            while (ctrl_ != end_ && *ctrl_ < 0) {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+
+        const std::int8_t* ctrl_ = nullptr;
+        T* slot_                 = nullptr;
+        const std::int8_t* end_  = nullptr;
+
+        friend class FlatHashTable;
+        friend class Iterator<!Const>;
+    };
+
+    using iterator       = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    static constexpr size_t groupWidth = FlatHashGroup::width;
+
+public:  // methods
+    FlatHashTable() = default;
+
+    FlatHashTable(const FlatHashTable& other) {
+        if (other.size_ == 0) {
+            return;
+        }
+        reserve(other.size_);
+        for (const auto& item : other) {
+            insertUnique(hash(KeyOf()(item)), item);
+        }
+    }
+
+    FlatHashTable(FlatHashTable&& other) noexcept { swap(other); }
+
+    FlatHashTable& operator=(FlatHashTable other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~FlatHashTable() { destroy(); }
+
+    void swap(FlatHashTable& other) noexcept {
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(deleted_, other.deleted_);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /// Number of slots
+    size_t capacity() const { return capacity_; }
+
+    double loadFactor() const { return capacity_ ? double(size_) / double(capacity_) : 0.; }
+
+    /// Make room for n items without rehashing
+    void reserve(size_t n) {
+        size_t c = groupWidth;
+        while (maxLoad(c) < n) {
+            c <<= 1;
+        }
+        if (c > capacity_) {
+            rehash(c);
+        }
+    }
+
+    void clear() {
+        destroyItems();
+        if (capacity_) {
+            std::memset(ctrl_, FlatHashGroup::kEmpty, capacity_);
+        }
+        size_    = 0;
+        deleted_ = 0;
+    }
+
+    iterator begin() { return iteratorAt(0, true); }
+    iterator end() { return iteratorAt(capacity_, false); }
+    const_iterator begin() const { return const_cast<FlatHashTable*>(this)->begin(); }
+    const_iterator end() const { return const_cast<FlatHashTable*>(this)->end(); }
+
+    template <typename Q>
+    iterator find(const Q& key) {
+        const size_t i = lookup(key, hash(key));
+        return i == npos ? end() : iteratorAt(i, false);
+    }
+
+    template <typename Q>
+    const_iterator find(const Q& key) const {
+        return const_cast<FlatHashTable*>(this)->find(key);
+    }
+
+    /// Construct an item from args if its key (key) is not in the table
+    /// @returns the item with the key, and whether it was inserted
+    template <typename Q, typename... Args>
+    std::pair<iterator, bool> tryEmplace(const Q& key, Args&&... args) {
+        const size_t h = hash(key);
+        size_t i       = lookup(key, h);
+        if (i != npos) {
+            return {iteratorAt(i, false), false};
+        }
+
+        if (size_ + deleted_ + 1 > maxLoad(capacity_)) {
+            grow();
+        }
+
+        i = slotFor(h);
+        new (slots_ + i) T(std::forward<Args>(args)...);
+        use(i, h);
+        return {iteratorAt(i, false), true};
+    }
+
+    template <typename Q>
+    size_t erase(const Q& key) {
+        const size_t i = lookup(key, hash(key));
+        if (i == npos) {
+            return 0;
+        }
+        eraseAt(i);
+        return 1;
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    iterator erase(const_iterator pos) {
+        const size_t i = size_t(pos.ctrl_ - ctrl_);
+        eraseAt(i);
+        return iteratorAt(i, true);
+    }
+
+private:  // methods
+    static constexpr size_t npos = size_t(-1);
+
+    /// Maximum number of used (full or deleted) slots, 7/8 of the capacity
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    template <typename Q>
+    static size_t hash(const Q& key) {
+        // spread the bits of weak hashes (std::hash of integers is the identity) over the whole word
+        std::uint64_t h = Hash()(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return size_t(h);
+    }
+
+    static std::int8_t h2(size_t h) { return std::int8_t(h & 0x7f); }
+
+    size_t groups() const { return capacity_ / groupWidth; }
+
+    iterator iteratorAt(size_t i, bool skip) {
+        iterator it(ctrl_ + i, slots_ + i, ctrl_ + capacity_);
+        if (skip) {
+            it.skip();
+        }
+        return it;
+    }
+
+    template <typename Q>
+    size_t lookup(const Q& key, size_t h) const {
+        if (capacity_ == 0) {
+            return npos;
+        }
+
+        const size_t mask = groups() - 1;
+        size_t g          = (h >> 7) & mask;
+        for (size_t step = 1;; ++step) {
+            const FlatHashGroup group(ctrl_ + g * groupWidth);
+            for (auto m = group.match(h2(h)); m; m.next()) {
+                const size_t i = g * groupWidth + m.lowest();
+                if (Eq()(KeyOf()(slots_[i]), key)) {
+                    return i;
+                }
+            }
+            if (group.empty()) {
+                return npos;
+            }
+            g = (g + step) & mask;  // triangular numbers visit all groups of a power of 2
+        }
+    }
+
+    /// First empty or deleted slot of the probe sequence of a hash
+    size_t slotFor(size_t h) const {
+        const size_t mask = groups() - 1;
+        size_t g          = (h >> 7) & mask;
+        for (size_t step = 1;; ++step) {
+            const auto m = FlatHashGroup(ctrl_ + g * groupWidth).emptyOrDeleted();
+            if (m) {
+                return g * groupWidth + m.lowest();
+            }
+            g = (g + step) & mask;
+        }
+    }
+
+    void use(size_t i, size_t h) {
+        if (ctrl_[i] == FlatHashGroup::kDeleted) {
+            deleted_--;
+        }
+        ctrl_[i] = h2(h);
+        size_++;
+    }
+
+    void eraseAt(size_t i) {
+        slots_[i].~T();
+        size_--;
+
+        // probes stop at a group with an empty slot, so none goes through this one
+        const size_t g = i - i % groupWidth;
+        if (FlatHashGroup(ctrl_ + g).empty()) {
+            ctrl_[i] = FlatHashGroup::kEmpty;
+        }
+        else {
+            ctrl_[i] = FlatHashGroup::kDeleted;
+            deleted_++;
+        }
+    }
+
+    template <typename U>
+    void insertUnique(size_t h, U&& item) {
+        const size_t i = slotFor(h);
+        new (slots_ + i) T(std::forward<U>(item));
+        use(i, h);
+    }
+
+    void grow() {
+        // many tombstones: rehash in place (at the same capacity), otherwise double
+        rehash(capacity_ == 0 ? groupWidth : (size_ * 2 < maxLoad(capacity_) ? capacity_ : capacity_ * 2));
+    }
+
+    void rehash(size_t capacity) {
+        ASSERT(capacity >= groupWidth && (capacity & (capacity - 1)) == 0);
+
+        FlatHashTable other;
+        other.allocate(capacity);
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) {
+                other.insertUnique(hash(KeyOf()(slots_[i])), std::move(slots_[i]));
+            }
+        }
+        swap(other);
+    }
+
+    void allocate(size_t capacity) {
+        ctrl_  = static_cast<std::int8_t*>(::operator new(capacity));
+        slots_ = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+        std::memset(ctrl_, FlatHashGroup::kEmpty, capacity);
+        capacity_ = capacity;
+    }
+
+    void destroyItems() {
+        if (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < capacity_; ++i) {
+                if (ctrl_[i] >= 0) {
+                    slots_[i].~T();
+                }
+            }
+        }
+    }
+
+    void destroy() {
+        if (capacity_) {
+            destroyItems();
+            ::operator delete(ctrl_);
+            ::operator delete(slots_, std::align_val_t(alignof(T)));
+        }
+        ctrl_     = nullptr;
+        slots_    = nullptr;
+        capacity_ = 0;
+        size_     = 0;
+        deleted_  = 0;
+    }
+
+private:  // members
+    std::int8_t* ctrl_ = nullptr;  ///< control bytes, one per slot
+    T* slots_          = nullptr;
+    size_t capacity_   = 0;  ///< power of 2, multiple of the group width
+    size_t size_       = 0;
+    size_t deleted_    = 0;  ///< tombstones
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Transparent lookups, when both Hash and Eq declare is_transparent
+template <typename Hash, typename Eq, typename = void>
+struct FlatHashTransparent : std::false_type {};
+
+template <typename Hash, typename Eq>
+struct FlatHashTransparent<Hash, Eq, std::void_t<typename Hash::is_transparent, typename Eq::is_transparent>>
+    : std::true_type {};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::detail
@@ -0,0 +1,126 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/container/KDArena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/memory/MMap.h"
+
+
+namespace eckit {
+
+//------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+KDArena::KDArena(size_t blockSize, bool hugePages) :
+    blockSize_(blockSize), hugePages_(hugePages) {
+    ASSERT(blockSize_ > 0);
+}
+
+KDArena::~KDArena() {
+    for (auto& b : blocks_) {
+        MMap::munmap(b.data_, b.size_);
+    }
+}
+
+void* KDArena::allocate(size_t size, size_t alignment) {
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    while (block_ < blocks_.size()) {
+        const Block& b     = blocks_[block_];
+        const size_t start = roundUp(offset_, alignment);
+        if (start + size <= b.size_) {
+            wasted_ += start - offset_;
+            offset_ = start + size;
+            used_ += size;
+            peak_ = std::max(peak_, used_);
+            return b.data_ + start;
+        }
+
+        // the end of the block is lost
+        wasted_ += b.size_ - offset_;
+        block_++;
+        offset_ = 0;
+    }
+
+    const size_t page   = hugePages_ ? HUGE_PAGE_SIZE : size_t(::sysconf(_SC_PAGESIZE));
+    const size_t length = roundUp(std::max(size, blockSize_), page);
+
+    // not touched: pages are placed on first access, by the threads building the nodes
+    void* p = MMap::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        Log::error() << "KDArena: cannot map " << Bytes(double(length)) << Log::syserr << std::endl;
+        throw FailedSystemCall("mmap", Here());
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugePages_ && ::madvise(p, length, MADV_HUGEPAGE) != 0) {
+        Log::warning() << "KDArena: no huge pages" << Log::syserr << std::endl;
+    }
+#endif
+
+    blocks_.push_back({static_cast<char*>(p), length});
+    allocated_ += length;
+
+    block_  = blocks_.size() - 1;
+    offset_ = 0;
+
+    return allocate(size, alignment);
+}
+
+void KDArena::reset() {
+    block_  = 0;
+    offset_ = 0;
+    used_   = 0;
+    wasted_ = 0;
+}
+
+void KDArena::release() {
+    ASSERT(nbItems_ == 0);
+
+    for (auto& b : blocks_) {
+        MMap::munmap(b.data_, b.size_);
+    }
+    blocks_.clear();
+    allocated_ = 0;
+
+    reset();
+}
+
+double KDArena::fragmentation() const {
+    const size_t consumed = used_ + wasted_;
+    return consumed == 0 ? 0. : double(wasted_) / double(consumed);
+}
+
+void KDArena::statsPrint(std::ostream& s, bool fancy) const {
+    StatCollector::statsPrint(s, fancy);
+    s << "   arena: used " << Bytes(double(used_)) << ", peak " << Bytes(double(peak_)) << ", allocated "
+      << Bytes(double(allocated_)) << " in " << blocks_.size() << " blocks, fragmentation " << fragmentation()
+      << std::endl;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
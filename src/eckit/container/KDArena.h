@@ -0,0 +1,162 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef KDArena_H
+#define KDArena_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "eckit/container/StatCollector.h"
+
+//------------------------------------------------------------------------------------------------------
+
+namespace eckit {
+
+//------------------------------------------------------------------------------------------------------
+
+/// Node allocator of the spatial trees (the Alloc of SPTree), allocating from large blocks of memory
+///
+/// Nodes are allocated contiguously, by bumping a pointer, and released all at once when the last node of the trees
+/// using the arena is deleted. The blocks are then kept, so that an arena reused for the trees of successive requests
+/// does not go back to the system, until release().
+///
+/// Blocks are mapped anonymously and not touched until nodes are built: pages are placed on the NUMA node of the
+/// thread that builds them (first touch), e.g. on the threads of a parallel KDTree build. Blocks can also be backed
+/// by transparent huge pages, where available.
+///
+/// Usage, with the trees of successive requests reusing the memory of the first ones:
+///     KDArena arena;
+///     KDTreeX<TT<Traits, KDArena>> tree(arena);
+struct KDArena : public StatCollector {
+    typedef void* Ptr;
+
+    /// @param blockSize bytes of each block, larger requests get a block of their own
+    /// @param hugePages advise the system to back blocks with (transparent) huge pages
+    explicit KDArena(size_t blockSize = 4 * 1024 * 1024, bool hugePages = false);
+
+    KDArena(const KDArena&)            = delete;
+    KDArena& operator=(const KDArena&) = delete;
+
+    ~KDArena();
+
+    Ptr root() const { return nullptr; }
+    void root(Ptr) {}
+
+    template <class Node>
+    Ptr convert(Node* p) {
+        return p;
+    }
+
+    template <class Node>
+    Node* convert(Ptr p, const Node*) {
+        return static_cast<Node*>(p);
+    }
+
+    template <class Node, typename A>
+    Node* newNode1(const A& a, const Node*) {
+        Node* n = new (allocate(sizeof(Node), alignof(Node))) Node(a);
+        nbItems_++;
+        return n;
+    }
+
+    template <class Node, typename A, typename B>
+    Node* newNode2(const A& a, const B& b, const Node*) {
+        Node* n = new (allocate(sizeof(Node), alignof(Node))) Node(a, b);
+        nbItems_++;
+        return n;
+    }
+
+    template <class Node, typename A, typename B, typename C>
+    Node* newNode3(const A& a, const B& b, const C& c, const Node*) {
+        Node* n = new (allocate(sizeof(Node), alignof(Node))) Node(a, b, c);
+        nbItems_++;
+        return n;
+    }
+
+    /// Storage for n nodes, in one block, to be constructed by the caller
+    template <class Node>
+    Node* newNodes(size_t n, const Node*) {
+        void* p = allocate(n * sizeof(Node), alignof(Node));
+        nbItems_ += n;
+        return static_cast<Node*>(p);
+    }
+
+    template <class Node>
+    void deleteNode(Ptr p, const Node*) {
+        Node* n = static_cast<Node*>(p);
+        if (n) {
+            deleteNode(n->left(*this), n);
+            deleteNode(n->right(*this), n);
+            if (!std::is_trivially_destructible<Node>::value) {
+                n->~Node();
+            }
+            nbItems_--;
+        }
+
+        if (nbItems_ == 0) {
+            reset();
+        }
+    }
+
+    size_t nbItems() const { return nbItems_; }
+
+    /// Return the blocks to the system, there should be no nodes left
+    void release();
+
+    // -- Instrumentation
+
+    /// Bytes of the nodes
+    size_t bytesUsed() const { return used_; }
+
+    /// Bytes of the blocks
+    size_t bytesAllocated() const { return allocated_; }
+
+    /// Largest bytesUsed()
+    size_t bytesPeak() const { return peak_; }
+
+    size_t blocks() const { return blocks_.size(); }
+
+    /// Fraction of the memory consumed lost to alignment and to the ends of the blocks
+    double fragmentation() const;
+
+    void statsPrint(std::ostream&, bool fancy) const;
+
+private:
+    struct Block {
+        char* data_;
+        size_t size_;
+    };
+
+    void* allocate(size_t size, size_t alignment);
+    void reset();
+
+    size_t blockSize_;
+    bool hugePages_;
+
+    std::vector<Block> blocks_;
+    size_t block_{0};   ///< current block
+    size_t offset_{0};  ///< in the current block
+
+    size_t nbItems_{0};
+    size_t used_{0};
+    size_t wasted_{0};
+    size_t allocated_{0};
+    size_t peak_{0};
+};
+
+//------------------------------------------------------------------------------------------------------
+
+}  // end namespace eckit
+
+#endif
@@ -10,6 +10,7 @@
 
 #include "KDMapped.h"
 
+#include "eckit/config/Resource.h"
 #include "eckit/filesystem/PathName.h"
 #include "eckit/os/Stat.h"
 
@@ -18,73 +19,237 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <cstring>  // for memcpy
+#include <string>
+
+#include "eckit/eckit.h"
+
+#if eckit_HAVE_XXHASH
+#define XXH_INLINE_ALL
+#include "eckit/contrib/xxhash/xxhash.h"
+#endif
 
 #include "eckit/memory/MMap.h"
 
 
 namespace eckit {
 
+//----------------------------------------------------------------------------------------------------------------------
 
-KDMapped::KDMapped(const PathName& path, size_t itemCount, size_t itemSize, size_t metadataSize) :
-    path_(path), header_(itemCount, itemSize, metadataSize), size_(0), base_(0), root_(0), addr_(0), fd_(-1) {
+namespace {
 
-    int oflags = O_RDWR | O_CREAT;
-    int mflags = PROT_READ | PROT_WRITE;
+constexpr std::uint32_t VERSION = 2;
 
-    if (itemCount == 0) {
-        oflags = O_RDWR;
-        // mflags = PROT_READ;
-    }
+constexpr std::uint32_t XXH3 = 1;  // XXH3 64 bits
+constexpr std::uint32_t FNV  = 2;  // FNV-1a 64 bits, by words
 
-    size_t base;
+#if eckit_HAVE_XXHASH
+constexpr std::uint32_t HASH = XXH3;
+#else
+constexpr std::uint32_t HASH = FNV;
+#endif
 
-    SYSCALL(fd_ = ::open(path.localPath(), oflags, 0777));
-    if (itemCount == 0) {
-        readonly_ = true;
-        Stat::Struct s;
-        SYSCALL(Stat::stat(path.localPath(), &s));
-        size_ = s.st_size;
+constexpr char MAGIC[8] = {'E', 'C', 'K', 'D', 'T', 'R', 'E', 'E'};
 
+/// Files written before the versioned header start with the size of their header (4 size_t), and are not validated
+constexpr std::uint64_t LEGACY_HEADER_SIZE = 4 * sizeof(std::uint64_t);
 
-        int n;
-        SYSCALL(n = ::read(fd_, &header_, sizeof(header_)));
-        ASSERT(n == sizeof(header_));
-        lseek(fd_, 0, SEEK_SET);
+std::uint64_t fnv1a(const void* data, size_t length, std::uint64_t h = 14695981039346656037ULL) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    size_t i      = 0;
+    for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t)) {
+        std::uint64_t w;
+        std::memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 1099511628211ULL;
+    }
+    for (; i < length; ++i) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+KDMappedHeader::KDMappedHeader(size_t itemCount, size_t itemSize, size_t metadataSize, std::uint64_t signature,
+                               size_t dimensions) :
+    version_(VERSION),
+    hash_(HASH),
+    headerSize_(sizeof(KDMappedHeader)),
+    itemCount_(itemCount),
+    itemSize_(itemSize),
+    metadataSize_(metadataSize),
+    signature_(signature),
+    dimensions_(dimensions),
+    count_(0),
+    checksum_(0),
+    complete_(0) {
+    std::memcpy(magic_, MAGIC, sizeof(MAGIC));
+    std::memset(padding_, 0, sizeof(padding_));
+}
 
-        root_ = 1;
+//----------------------------------------------------------------------------------------------------------------------
 
-        ASSERT(header_.headerSize_ == sizeof(header_));
+KDMapped::KDMapped(const PathName& path, size_t itemCount, size_t itemSize, size_t metadataSize,
+                   std::uint64_t signature, size_t dimensions) :
+    path_(path),
+    header_(itemCount, itemSize, metadataSize, signature, dimensions),
+    size_(0),
+    base_(0),
+    root_(0),
+    addr_(0),
+    fd_(-1) {
 
-        base   = ((header_.headerSize_ + header_.metadataSize_ + header_.itemSize_ - 1) / header_.itemSize_) * header_.itemSize_;
-        count_ = header_.itemCount_;
+    static const bool hugePages = Resource<bool>("kdMappedHugePages;$ECKIT_KDMAPPED_HUGE_PAGES", true);
+    static const bool populate  = Resource<bool>("kdMappedPrefault;$ECKIT_KDMAPPED_PREFAULT", false);
+    static const bool validate  = Resource<bool>("kdMappedVerify;$ECKIT_KDMAPPED_VERIFY", false);
+
+    int oflags = O_RDWR | O_CREAT;
+    int mflags = PROT_READ | PROT_WRITE;
+    int flags  = MAP_SHARED;
+
+    readonly_ = itemCount == 0;
+    if (readonly_) {
+        oflags = O_RDONLY;
+        mflags = PROT_READ;
+#ifdef MAP_POPULATE
+        if (populate) {
+            flags |= MAP_POPULATE;
+        }
+#endif
     }
-    else {
-        readonly_ = false;
-        base      = ((header_.headerSize_ + header_.metadataSize_ + header_.itemSize_ - 1) / header_.itemSize_) * header_.itemSize_;
 
-        char c = 0;
+    SYSCALL(fd_ = ::open(path.localPath(), oflags, 0777));
 
+    if (readonly_) {
+        Stat::Struct s;
+        SYSCALL(Stat::fstat(fd_, &s));
+        size_ = s.st_size;
+
+        auto invalid = [&](const std::string& why) {
+            ::close(fd_);
+            fd_ = -1;
+            return BadValue("KDMapped: " + path + " " + why);
+        };
+
+        header_ = KDMappedHeader(0, 0, 0);
+        if (size_ < (long long)LEGACY_HEADER_SIZE || ::pread(fd_, &header_, sizeof(header_), 0) < (ssize_t)LEGACY_HEADER_SIZE) {
+            throw invalid("is too short");
+        }
+
+        if (std::memcmp(header_.magic_, MAGIC, sizeof(MAGIC)) == 0) {
+            if (header_.version_ != VERSION || header_.headerSize_ != sizeof(header_)) {
+                throw invalid("has an unsupported version");
+            }
+            if (!header_.complete_) {
+                throw invalid("is incomplete (the tree was not fully built)");
+            }
+            if (signature && header_.signature_ && signature != header_.signature_) {
+                throw invalid("was built with different tree traits");
+            }
+        }
+        else {
+            // legacy header, in place of the magic number
+            std::uint64_t legacy[4];
+            std::memcpy(legacy, &header_, sizeof(legacy));
+            if (legacy[0] != LEGACY_HEADER_SIZE) {
+                throw invalid("is not a tree file");
+            }
+
+            header_             = KDMappedHeader(legacy[1], legacy[2], legacy[3]);
+            header_.headerSize_ = LEGACY_HEADER_SIZE;
+            header_.count_      = legacy[1];
+            header_.hash_       = 0;
+        }
+
+        if (header_.itemSize_ != itemSize || header_.metadataSize_ != metadataSize) {
+            throw invalid("has a different node or metadata size");
+        }
+        if (header_.count_ > header_.itemCount_) {
+            throw invalid("is corrupted");
+        }
+
+        root_  = 1;
+        count_ = header_.count_;
+    }
+
+    size_t base = ((header_.headerSize_ + 2 * header_.dimensions_ * sizeof(double) + header_.metadataSize_ +
+                    header_.itemSize_ - 1) /
+                   header_.itemSize_) *
+                  header_.itemSize_;
+
+    if (readonly_) {
+        if (size_ < (long long)(base + (header_.itemCount_ + 1) * header_.itemSize_)) {
+            ::close(fd_);
+            fd_ = -1;
+            throw BadValue("KDMapped: " + path + " is truncated");
+        }
+    }
+    else {
         size_ = base + (itemCount + 1) * itemSize;
 
+        // not complete until finalise()
         lseek(fd_, 0, SEEK_SET);
         SYSCALL(::write(fd_, &header_, sizeof(header_)));
 
-        lseek(fd_, size_ - 1, SEEK_SET);
-        SYSCALL(::write(fd_, &c, 1));
+        // an existing, larger file would keep a stale tail, which readers checksum
+        SYSCALL(::ftruncate(fd_, size_));
     }
 
-    addr_ = MMap::mmap(0, size_, mflags, MAP_SHARED, fd_, 0);
+    addr_ = MMap::mmap(0, size_, mflags, flags, fd_, 0);
     if (addr_ == MAP_FAILED) {
+        addr_ = 0;
         Log::error() << "open(" << path << ')' << Log::syserr << std::endl;
+        ::close(fd_);
+        fd_ = -1;
         throw FailedSystemCall("mmap");
     }
 
+#ifdef MADV_HUGEPAGE
+    if (hugePages) {
+        ::madvise(addr_, size_, MADV_HUGEPAGE);  // a hint, ignored if not supported for this file system
+    }
+#endif
+
     base_ = reinterpret_cast<char*>(addr_) + base;
+
+    if (readonly_ && validate) {
+        auto release = [this] {
+            MMap::munmap(addr_, size_);
+            ::close(fd_);
+            addr_ = 0;
+            fd_   = -1;
+        };
+
+        bool valid = false;
+        try {
+            valid = verify();
+        }
+        catch (...) {
+            release();
+            throw;
+        }
+
+        if (!valid) {
+            release();
+            throw BadValue("KDMapped: " + path + " checksum mismatch");
+        }
+    }
 }
 
 KDMapped::~KDMapped() {
     if (addr_) {
+        if (!readonly_ && !finalised_) {
+            try {
+                finalise();
+            }
+            catch (std::exception& e) {
+                Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+                Log::error() << "** Exception is ignored" << std::endl;
+            }
+        }
         SYSCALL(munmap(addr_, size_));
     }
     if (fd_ >= 0) {
@@ -97,6 +262,8 @@ KDMapped::KDMapped(const KDMapped& other) :
     path_(other.path_),
     header_(other.header_),
     count_(other.count_),
+    readonly_(other.readonly_),
+    finalised_(other.finalised_),
     size_(other.size_),
     base_(other.base_),
     root_(other.root_),
@@ -108,12 +275,14 @@ KDMapped::KDMapped(const KDMapped& other) :
 
 // Warning, takes ownership of maps
 KDMapped& KDMapped::operator=(const KDMapped& other) {
-    path_  = other.path_;
-    count_ = other.count_;
-    size_  = other.size_;
-    addr_  = other.addr_;
-    fd_    = other.fd_;
-    root_  = other.root_;
+    path_      = other.path_;
+    count_     = other.count_;
+    readonly_  = other.readonly_;
+    finalised_ = other.finalised_;
+    size_      = other.size_;
+    addr_      = other.addr_;
+    fd_        = other.fd_;
+    root_      = other.root_;
 
     header_ = other.header_;
     base_   = other.base_;
@@ -125,16 +294,97 @@ KDMapped& KDMapped::operator=(const KDMapped& other) {
 }
 
 void KDMapped::setMetadata(const void* addr, size_t size) {
+    ASSERT(!readonly_);
     ASSERT(size == header_.metadataSize_);
-    char* start = static_cast<char*>(addr_);
-    ::memcpy(start + sizeof(header_), addr, size);
+    modified();
+    ::memcpy(metadata(), addr, size);
 }
 
 void KDMapped::getMetadata(void* addr, size_t size) {
     ASSERT(size == header_.metadataSize_);
-    char* start = static_cast<char*>(addr_);
-    ::memcpy(addr, start + sizeof(header_), size);
+    ::memcpy(addr, metadata(), size);
+}
+
+bool KDMapped::getBox(double* min, double* max) const {
+    if (header_.dimensions_ == 0 || header_.count_ == 0) {
+        return false;
+    }
+    const size_t n = header_.dimensions_ * sizeof(double);
+    ::memcpy(min, box(), n);
+    ::memcpy(max, box() + n, n);
+    return true;
+}
+
+void KDMapped::setBox(const double* min, const double* max) {
+    ASSERT(!readonly_);
+    modified();
+    const size_t n = header_.dimensions_ * sizeof(double);
+    ::memcpy(box(), min, n);
+    ::memcpy(box() + n, max, n);
+}
+
+std::uint64_t KDMapped::checksum(std::uint32_t hash) const {
+    const char* begin   = box();
+    const size_t length = static_cast<char*>(addr_) + size_ - begin;
+
+    switch (hash) {
+#if eckit_HAVE_XXHASH
+        case XXH3:
+            return XXH3_64bits(begin, length);
+#endif
+        case FNV:
+            return fnv1a(begin, length);
+        default:
+            throw BadValue("KDMapped: " + path_ + " checksum algorithm " + std::to_string(hash) +
+                           " is not available");
+    }
+}
+
+bool KDMapped::verify() const {
+    return header_.hash_ == 0 || checksum(header_.hash_) == header_.checksum_;
+}
+
+void KDMapped::prefault() const {
+#ifdef MADV_WILLNEED
+    ::madvise(addr_, size_, MADV_WILLNEED);
+#endif
+    const long page = ::sysconf(_SC_PAGESIZE);
+
+    const volatile char* p = static_cast<const char*>(addr_);
+    char sum               = 0;
+    for (long long i = 0; i < size_; i += page) {
+        sum ^= p[i];
+    }
+    (void)sum;
+}
+
+void KDMapped::finalise() {
+    ASSERT(!readonly_);
+    ASSERT(addr_);
+
+    header_.count_    = count_;
+    header_.checksum_ = checksum(header_.hash_);
+    header_.complete_ = 1;
+
+    ::memcpy(addr_, &header_, sizeof(header_));
+    SYSCALL(::msync(addr_, size_, MS_SYNC));
+
+    finalised_ = true;
+}
+
+void KDMapped::reopen() {
+    // readers opening the file from now on would see a checksum, or nodes, that do not match
+    header_.complete_ = 0;
+    ::memcpy(addr_, &header_, sizeof(header_));
+
+    finalised_ = false;
+}
+
+std::uint64_t KDMapped::signature(const char* type, size_t size) {
+    const std::uint64_t s = size;
+    return fnv1a(&s, sizeof(s), fnv1a(type, std::strlen(type)));
 }
 
+//----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit
@@ -11,26 +11,53 @@
 #ifndef KDMapped_H
 #define KDMapped_H
 
+#include <cstdint>
+
 #include "eckit/container/StatCollector.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/filesystem/PathName.h"
 
 namespace eckit {
 
+/// Header of a mapped tree file, followed by the bounding box (2 * dimensions_ doubles), the metadata and the nodes
+///
+/// Nodes refer to each other by index, so the file is position independent and can be mapped at any address, by any
+/// number of processes. The checksum covers everything after the header; it is computed, and the file marked complete,
+/// by KDMapped::finalise().
 struct KDMappedHeader {
-    size_t headerSize_;
-    size_t itemCount_;
-    size_t itemSize_;
-    size_t metadataSize_;
-
-    KDMappedHeader(size_t itemCount, size_t itemSize, size_t metadataSize) :
-        headerSize_(sizeof(KDMappedHeader)), itemCount_(itemCount), itemSize_(itemSize), metadataSize_(metadataSize) {}
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t hash_;  ///< checksum algorithm
+    std::uint64_t headerSize_;
+    std::uint64_t itemCount_;  ///< capacity
+    std::uint64_t itemSize_;
+    std::uint64_t metadataSize_;
+    std::uint64_t signature_;  ///< of the node type (see KDMapped::signature())
+    std::uint64_t dimensions_;
+    std::uint64_t count_;  ///< nodes stored
+    std::uint64_t checksum_;
+    std::uint64_t complete_;
+    char padding_[40];
+
+    KDMappedHeader(size_t itemCount, size_t itemSize, size_t metadataSize, std::uint64_t signature = 0,
+                   size_t dimensions = 0);
 };
 
+static_assert(sizeof(KDMappedHeader) == 128, "KDMappedHeader should be 128 bytes");
+
 
 class KDMapped : public StatCollector {
 public:
-    KDMapped(const PathName&, size_t itemCount, size_t itemSize, size_t metadataSize);
+    /// Create a file for itemCount nodes, or map an existing file read-only if itemCount is 0
+    ///
+    /// An existing file is validated from its header only (type signature, if not 0, sizes and completeness). The
+    /// checksum is verified on demand (see verify()), or on opening if the resource kdMappedVerify is set.
+    /// The resources kdMappedHugePages and kdMappedPrefault select transparent huge pages and prefaulting of the mapping.
+    ///
+    /// A created file can be opened by readers once finalise() is called, which the trees do after a build; the
+    /// destructor finalises a file that was modified since.
+    KDMapped(const PathName&, size_t itemCount, size_t itemSize, size_t metadataSize, std::uint64_t signature = 0,
+             size_t dimensions = 0);
     ~KDMapped();
 
     KDMapped(const KDMapped& other);
@@ -64,6 +91,7 @@ public:
     Node* newNode1(const A& a, const Node* dummy) {
         Node* r = base(dummy);
         ASSERT(!readonly_);
+        modified();
         // ASSERT(count_ * sizeof(Node) < size_);
         return new (&r[++count_]) Node(a);
     }
@@ -72,6 +100,7 @@ public:
     Node* newNode2(const A& a, const B& b, const Node* dummy) {
         Node* r = base(dummy);
         ASSERT(!readonly_);
+        modified();
         // ASSERT(count_ * sizeof(Node) < size_);
         return new (&r[++count_]) Node(a, b);
     }
@@ -80,11 +109,24 @@ public:
     Node* newNode3(const A& a, const B& b, const C& c, const Node* dummy) {
         Node* r = base(dummy);
         ASSERT(!readonly_);
+        modified();
         // ASSERT(count_ * sizeof(Node) < size_);
         return new (&r[++count_]) Node(a, b, c);
     }
 
 
+    /// Storage for n consecutive nodes, to be constructed by the caller
+    template <class Node>
+    Node* newNodes(size_t n, const Node* dummy) {
+        Node* r = base(dummy);
+        ASSERT(!readonly_);
+        ASSERT(count_ + n <= header_.itemCount_);
+        modified();
+        Node* p = &r[count_ + 1];
+        count_ += n;
+        return p;
+    }
+
     template <class Node>
     void deleteNode(Ptr p, Node* n) {
         // Ignore
@@ -106,6 +148,48 @@ public:
 
     size_t nbItems() const { return count_; }
 
+    bool readOnly() const { return readonly_; }
+
+    // -- Bounding box of the points, of the dimensions given on creation
+
+    size_t dimensions() const { return header_.dimensions_; }
+
+    /// @returns false if the file has no bounding box
+    bool getBox(double* min, double* max) const;
+    void setBox(const double* min, const double* max);
+
+    // -- File
+
+    /// Record the number of nodes and the checksum, mark the file complete and write it to disk. The file can then be
+    /// opened by readers, and verified. Further modifications mark it incomplete until finalised again
+    void finalise();
+
+    bool finalised() const { return finalised_; }
+
+    /// Recompute the checksum of the file, with the algorithm it was saved with
+    /// @returns false if it does not match the header (always true for files without checksum)
+    /// @throws BadValue if that algorithm is not available in this build
+    bool verify() const;
+
+    /// Load all pages of the file into memory, so that queries do not fault
+    void prefault() const;
+
+    /// Type signature, for the validation of files by readers
+    static std::uint64_t signature(const char* type, size_t size);
+
+private:
+    void modified() {
+        if (finalised_) {
+            reopen();
+        }
+    }
+
+    void reopen();
+    std::uint64_t checksum(std::uint32_t hash) const;
+
+    char* box() const { return static_cast<char*>(addr_) + header_.headerSize_; }
+    char* metadata() const { return box() + 2 * header_.dimensions_ * sizeof(double); }
+
 private:
     PathName path_;
 
@@ -113,6 +197,7 @@ private:
 
     size_t count_{0};
     bool readonly_{true};
+    bool finalised_{false};
 
     long long size_;
     char* base_;
@@ -15,6 +15,9 @@
 
 #include <cmath>
 #include <limits>
+#include <new>
+#include <utility>
+#include <vector>
 
 #include "eckit/container/StatCollector.h"
 
@@ -58,21 +61,52 @@ struct KDMemory : public StatCollector {
         return new Node(a, b, c);
     }
 
+    /// Storage for n nodes, in one block, to be constructed by the caller
+    template <class Node>
+    Node* newNodes(size_t n, const Node*) {
+        void* p = ::operator new(n * sizeof(Node));
+        blocks_.emplace_back(static_cast<char*>(p), n * sizeof(Node));
+        nbItems_ += n;
+        return static_cast<Node*>(p);
+    }
+
     template <class Node>
     void deleteNode(Ptr p, const Node*) {
         Node* n = static_cast<Node*>(p);
         if (n) {
             deleteNode(n->left(*this), n);
             deleteNode(n->right(*this), n);
-            delete n;
+            if (inBlock(n)) {
+                n->~Node();
+            }
+            else {
+                delete n;
+            }
             nbItems_--;
         }
+
+        if (nbItems_ == 0) {
+            for (auto& b : blocks_) {
+                ::operator delete(b.first);
+            }
+            blocks_.clear();
+        }
     }
 
     size_t nbItems() const { return nbItems_; }
 
 private:
+    bool inBlock(const void* p) const {
+        for (const auto& b : blocks_) {
+            if (b.first <= p && p < b.first + b.second) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     size_t nbItems_{0};
+    std::vector<std::pair<char*, size_t> > blocks_;
 };
 
 template <class T, class A>
@@ -11,9 +11,17 @@
 #ifndef KDTree_H
 #define KDTree_H
 
+#include <algorithm>
+#include <cstdint>
+#include <typeinfo>
+#include <utility>
+
 #include "eckit/container/kdtree/KDNode.h"
 #include "eckit/container/sptree/SPTree.h"
+#include "eckit/log/CodeLocation.h"
+#include "eckit/log/Log.h"
 
+#include "KDArena.h"
 #include "KDMapped.h"
 #include "KDMemory.h"
 
@@ -53,6 +61,23 @@ public:
         build(b, e);
     }
 
+    /// Parallel build, with the tasks of the scheduler
+    /// ITER must be a random access iterator
+    /// WARNING: container is changed (sorted)
+    template <typename ITER>
+    void build(ITER begin, ITER end, TaskScheduler& scheduler) {
+        Alloc& a    = this->alloc_;
+        this->root_ = a.convert(Node::build(a, begin, end, scheduler));
+        a.root(this->root_);
+    }
+
+    /// Parallel build, with the tasks of the scheduler
+    /// WARNING: container is changed (sorted)
+    template <typename Container>
+    void build(Container& c, TaskScheduler& scheduler) {
+        build(c.begin(), c.end(), scheduler);
+    }
+
     //
     void insert(const Value& value) {
         Alloc& a   = this->alloc_;
@@ -79,8 +104,18 @@ public:
 public:
     KDTreeMemory() :
         KDTree(alloc_) {}
+
+    /// Nodes are released while the allocator is alive
+    ~KDTreeMemory() {
+        alloc_.deleteNode(this->root_, (typename KDTree::Node*)0);
+        this->root_ = 0;
+    }
 };
 
+/// KDTree with its nodes in an arena, which can outlive it and be reused by the next trees
+template <class Traits>
+using KDTreeArena = KDTreeX<TT<Traits, KDArena> >;
+
 template <class Traits>
 class KDTreeMapped : public KDTreeX<TT<Traits, KDMapped> > {
     KDMapped alloc_;
@@ -93,8 +128,79 @@ public:
     typedef typename KDTree::Node Node;
 
 public:
+    /// Create a file for itemCount points, or map an existing file read-only if itemCount is 0
     KDTreeMapped(const eckit::PathName& path, size_t itemCount, size_t metadataSize) :
-        KDTree(alloc_), alloc_(path, itemCount, sizeof(Node), metadataSize) {}
+        KDTree(alloc_), alloc_(path, itemCount, sizeof(Node), metadataSize, signature(), Point::DIMS) {}
+
+    /// Finalises a file that was modified after the last build (e.g. by insert)
+    ~KDTreeMapped() {
+        if (alloc_.readOnly() || alloc_.finalised()) {
+            return;
+        }
+        try {
+            finalise();
+        }
+        catch (std::exception& e) {
+            Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+            Log::error() << "** Exception is ignored" << std::endl;
+        }
+    }
+
+    /// Build the tree (see KDTreeX::build), then finalise the file
+    template <typename... Args>
+    void build(Args&&... args) {
+        KDTree::build(std::forward<Args>(args)...);
+        finalise();
+    }
+
+    /// Record the bounding box of the points and the checksum, and mark the file complete so it can be opened by
+    /// readers while this tree still exists
+    void finalise() {
+        if (alloc_.nbItems() > 0) {
+            setBox();
+        }
+        alloc_.finalise();
+    }
+
+    /// Bounding box of the points, without visiting the tree
+    /// @returns false if the tree is empty
+    bool boundingBox(Point& min, Point& max) const {
+        double lo[Point::DIMS];
+        double hi[Point::DIMS];
+        if (alloc_.dimensions() != Point::DIMS || !alloc_.getBox(lo, hi)) {
+            return false;
+        }
+        min = Point(lo);
+        max = Point(hi);
+        return true;
+    }
+
+    /// Recompute the checksum of the file
+    bool verify() const { return alloc_.verify(); }
+
+    /// Load the whole file into memory
+    void prefault() const { alloc_.prefault(); }
+
+    /// Signature of the node type, which files are validated against
+    static std::uint64_t signature() { return KDMapped::signature(typeid(Node).name(), sizeof(Node)); }
+
+private:
+    void setBox() {
+        const Node* nodes = alloc_.convert(1, (Node*)0);
+
+        double min[Point::DIMS];
+        double max[Point::DIMS];
+        for (size_t d = 0; d < Point::DIMS; ++d) {
+            min[d] = max[d] = nodes[0].point().x(d);
+        }
+        for (size_t i = 1; i < alloc_.nbItems(); ++i) {
+            for (size_t d = 0; d < Point::DIMS; ++d) {
+                min[d] = std::min(min[d], nodes[i].point().x(d));
+                max[d] = std::max(max[d], nodes[i].point().x(d));
+            }
+        }
+        alloc_.setBox(min, max);
+    }
 };
 
 }  // namespace eckit
@@ -0,0 +1,866 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Adaptive radix tree (ART) mapping byte strings to values of type T
+///
+/// A more compact and faster alternative to Trie for long keys sharing prefixes: runs of bytes without branches are
+/// stored in a single node (path compression), and inner nodes hold 4, 16, 48 or 256 children depending on their
+/// fanout, growing and shrinking as keys are inserted and removed. Leaves only store the part of their key below their
+/// parent.
+///
+/// Keys are arbitrary bytes (including '\0') and are ordered as std::string, so visits are in lexicographic order.
+template <typename T>
+class RadixTree : private NonCopyable {
+public:  // methods
+    RadixTree() = default;
+
+    ~RadixTree() { destroy(root_); }
+
+    bool empty() const { return size_ == 0; }
+
+    /// Number of keys
+    size_t size() const { return size_; }
+
+    /// Insert a value, or replace the value of an existing key
+    /// @returns true if the key was inserted
+    bool insert(std::string_view key, T value);
+
+    /// @returns true if the key was removed
+    bool remove(std::string_view key) {
+        if (remove(root_, key, 0)) {
+            size_--;
+            return true;
+        }
+        return false;
+    }
+
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    /// @returns the value of the key, or null if not found
+    T* find(std::string_view key) { return const_cast<T*>(static_cast<const RadixTree&>(*this).find(key)); }
+    const T* find(std::string_view key) const;
+
+    /// @returns the value of the longest key which is a prefix of key (possibly key itself), or null if none
+    /// @param length if not null, set to the length of that key
+    const T* longestPrefix(std::string_view key, size_t* length = nullptr) const;
+
+    /// Call f(const std::string& key, const T& value) for all keys, in order
+    template <typename F>
+    void visit(F f) const {
+        std::string key;
+        visit(root_, key, f);
+    }
+
+    /// Call f(const std::string& key, const T& value) for all keys starting with prefix, in order
+    template <typename F>
+    void visitPrefix(std::string_view prefix, F f) const;
+
+    void clear() {
+        destroy(root_);
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    /// Bytes of memory held by the nodes and the key fragments they store (excluding the values' own allocations)
+    size_t footprint() const { return footprint(root_); }
+
+    void print(std::ostream& s) const {
+        visit([&s](const std::string& key, const T& value) { s << key << " (" << value << ")" << std::endl; });
+    }
+
+    friend std::ostream& operator<<(std::ostream& s, const RadixTree& p) {
+        p.print(s);
+        return s;
+    }
+
+private:  // types
+    enum NodeType : std::uint8_t
+    {
+        LEAF,
+        NODE4,
+        NODE16,
+        NODE48,
+        NODE256
+    };
+
+    struct Node {
+        explicit Node(NodeType type) :
+            type_(type) {}
+        NodeType type_;
+    };
+
+    struct Leaf : Node {
+        Leaf(std::string_view suffix, T&& value) :
+            Node(LEAF), suffix_(suffix), value_(std::move(value)) {}
+        std::string suffix_;  ///< key bytes below the parent
+        T value_;
+    };
+
+    struct Inner : Node {
+        using Node::Node;
+        std::uint16_t count_ = 0;  ///< number of children
+        std::string prefix_;       ///< compressed path, bytes common to all keys below
+        Leaf* value_ = nullptr;    ///< key ending at this node (with an empty suffix)
+    };
+
+    struct Node4 : Inner {
+        Node4() :
+            Inner(NODE4) {}
+        std::uint8_t keys_[4];  ///< sorted
+        Node* children_[4];
+    };
+
+    struct Node16 : Inner {
+        Node16() :
+            Inner(NODE16) {}
+        std::uint8_t keys_[16];  ///< sorted
+        Node* children_[16];
+    };
+
+    struct Node48 : Inner {
+        Node48() :
+            Inner(NODE48) {
+            std::memset(index_, 0, sizeof(index_));
+            std::fill(children_, children_ + 48, nullptr);
+        }
+        std::uint8_t index_[256];  ///< 1 + slot of the child of a byte, 0 if none
+        Node* children_[48];
+    };
+
+    struct Node256 : Inner {
+        Node256() :
+            Inner(NODE256) { std::fill(children_, children_ + 256, nullptr); }
+        Node* children_[256];
+    };
+
+private:  // methods
+    static size_t mismatch(std::string_view a, std::string_view b) {
+        const size_t n = std::min(a.size(), b.size());
+        size_t i       = 0;
+        while (i < n && a[i] == b[i]) {
+            ++i;
+        }
+        return i;
+    }
+
+    static bool startsWith(std::string_view s, std::string_view prefix) {
+        return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    static Node* const* findChild(const Inner* n, std::uint8_t b);
+    static Node** findChild(Inner* n, std::uint8_t b) {
+        return const_cast<Node**>(findChild(static_cast<const Inner*>(n), b));
+    }
+
+    /// Call f(byte, child) for all children of n, in byte order
+    template <typename F>
+    static void forEachChild(const Inner* n, F f);
+
+    /// Add a child to n, replacing n (in ref) with a larger node if full
+    static void addChild(Node*& ref, Inner* n, std::uint8_t b, Node* child);
+
+    /// Remove the child of a byte from n, replacing n (in ref) with a smaller node if sparse
+    static void removeChild(Node*& ref, Inner* n, std::uint8_t b);
+
+    /// Place a leaf under a new node, whose prefix covers the first p bytes of the leaf suffix
+    static void attach(Node*& ref, Leaf* leaf, size_t p) {
+        Inner* n = static_cast<Inner*>(ref);
+        if (leaf->suffix_.size() == p) {
+            leaf->suffix_.clear();
+            n->value_ = leaf;
+            return;
+        }
+        const std::uint8_t b = leaf->suffix_[p];
+        leaf->suffix_.erase(0, p + 1);
+        addChild(ref, n, b, leaf);
+    }
+
+    /// Move the fields common to all inner nodes
+    static void moveHeader(Inner* to, Inner* from) {
+        to->count_  = from->count_;
+        to->prefix_ = std::move(from->prefix_);
+        to->value_  = from->value_;
+    }
+
+    /// Merge a node with a single child or no child into its parent's slot
+    static void compact(Node*& ref);
+
+    bool remove(Node*& ref, std::string_view key, size_t depth);
+
+    template <typename F>
+    static void visit(const Node* node, std::string& key, F& f);
+
+    static size_t footprint(const Node* node);
+
+    /// Delete a node only
+    static void deleteNode(Node* node);
+
+    /// Delete a node and everything below
+    static void destroy(Node* node);
+
+private:  // members
+    Node* root_  = nullptr;
+    size_t size_ = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+bool RadixTree<T>::insert(std::string_view key, T value) {
+    Node** ref   = &root_;
+    size_t depth = 0;
+
+    for (;;) {
+        Node* node = *ref;
+
+        if (node == nullptr) {
+            *ref = new Leaf(key.substr(depth), std::move(value));
+            break;
+        }
+
+        const std::string_view rest = key.substr(depth);
+
+        if (node->type_ == LEAF) {
+            auto* leaf = static_cast<Leaf*>(node);
+            if (leaf->suffix_ == rest) {
+                leaf->value_ = std::move(value);
+                return false;
+            }
+
+            // split the leaf at the first difference
+            const size_t p = mismatch(leaf->suffix_, rest);
+            auto* n        = new Node4;
+            n->prefix_.assign(rest.substr(0, p));
+
+            Node* r = n;
+            attach(r, leaf, p);
+            attach(r, new Leaf(rest, std::move(value)), p);
+            *ref = r;
+            break;
+        }
+
+        auto* n        = static_cast<Inner*>(node);
+        const size_t p = mismatch(n->prefix_, rest);
+
+        if (p < n->prefix_.size()) {
+            // split the compressed path at the first difference
+            auto* m = new Node4;
+            m->prefix_.assign(n->prefix_, 0, p);
+
+            const std::uint8_t b = n->prefix_[p];
+            n->prefix_.erase(0, p + 1);
+
+            Node* r = m;
+            addChild(r, m, b, n);
+            attach(r, new Leaf(rest, std::move(value)), p);
+            *ref = r;
+            break;
+        }
+
+        depth += p;
+
+        if (depth == key.size()) {
+            if (n->value_) {
+                n->value_->value_ = std::move(value);
+                return false;
+            }
+            n->value_ = new Leaf(std::string_view(), std::move(value));
+            break;
+        }
+
+        const std::uint8_t b = key[depth];
+        if (Node** child = findChild(n, b)) {
+            ref = child;
+            depth++;
+            continue;
+        }
+
+        addChild(*ref, n, b, new Leaf(key.substr(depth + 1), std::move(value)));
+        break;
+    }
+
+    size_++;
+    return true;
+}
+
+template <typename T>
+const T* RadixTree<T>::find(std::string_view key) const {
+    const Node* node = root_;
+    size_t depth     = 0;
+
+    while (node) {
+        const std::string_view rest = key.substr(depth);
+
+        if (node->type_ == LEAF) {
+            auto* leaf = static_cast<const Leaf*>(node);
+            return leaf->suffix_ == rest ? &leaf->value_ : nullptr;
+        }
+
+        auto* n = static_cast<const Inner*>(node);
+        if (!startsWith(rest, n->prefix_)) {
+            return nullptr;
+        }
+
+        depth += n->prefix_.size();
+        if (depth == key.size()) {
+            return n->value_ ? &n->value_->value_ : nullptr;
+        }
+
+        Node* const* child = findChild(n, key[depth]);
+        node               = child ? *child : nullptr;
+        depth++;
+    }
+
+    return nullptr;
+}
+
+template <typename T>
+const T* RadixTree<T>::longestPrefix(std::string_view key, size_t* length) const {
+    const Node* node = root_;
+    size_t depth     = 0;
+
+    const T* best = nullptr;
+    size_t len    = 0;
+
+    while (node) {
+        const std::string_view rest = key.substr(depth);
+
+        if (node->type_ == LEAF) {
+            auto* leaf = static_cast<const Leaf*>(node);
+            if (startsWith(rest, leaf->suffix_)) {
+                best = &leaf->value_;
+                len  = depth + leaf->suffix_.size();
+            }
+            break;
+        }
+
+        auto* n = static_cast<const Inner*>(node);
+        if (!startsWith(rest, n->prefix_)) {
+            break;
+        }
+
+        depth += n->prefix_.size();
+        if (n->value_) {
+            best = &n->value_->value_;
+            len  = depth;
+        }
+        if (depth == key.size()) {
+            break;
+        }
+
+        Node* const* child = findChild(n, key[depth]);
+        node               = child ? *child : nullptr;
+        depth++;
+    }
+
+    if (best && length) {
+        *length = len;
+    }
+    return best;
+}
+
+template <typename T>
+template <typename F>
+void RadixTree<T>::visitPrefix(std::string_view prefix, F f) const {
+    const Node* node = root_;
+    size_t depth     = 0;
+
+    while (node) {
+        const std::string_view rest = prefix.substr(depth);
+
+        if (node->type_ == LEAF) {
+            if (startsWith(static_cast<const Leaf*>(node)->suffix_, rest)) {
+                break;
+            }
+            return;
+        }
+
+        auto* n = static_cast<const Inner*>(node);
+        if (rest.size() <= n->prefix_.size()) {
+            if (startsWith(n->prefix_, rest)) {
+                break;
+            }
+            return;
+        }
+
+        if (!startsWith(rest, n->prefix_)) {
+            return;
+        }
+
+        depth += n->prefix_.size();
+        Node* const* child = findChild(n, prefix[depth]);
+        node               = child ? *child : nullptr;
+        depth++;
+    }
+
+    if (node) {
+        std::string key(prefix.substr(0, depth));
+        visit(node, key, f);
+    }
+}
+
+template <typename T>
+bool RadixTree<T>::remove(Node*& ref, std::string_view key, size_t depth) {
+    if (ref == nullptr) {
+        return false;
+    }
+
+    const std::string_view rest = key.substr(depth);
+
+    if (ref->type_ == LEAF) {
+        if (static_cast<Leaf*>(ref)->suffix_ != rest) {
+            return false;
+        }
+        delete static_cast<Leaf*>(ref);
+        ref = nullptr;
+        return true;
+    }
+
+    auto* n = static_cast<Inner*>(ref);
+    if (!startsWith(rest, n->prefix_)) {
+        return false;
+    }
+
+    depth += n->prefix_.size();
+
+    if (depth == key.size()) {
+        if (!n->value_) {
+            return false;
+        }
+        delete n->value_;
+        n->value_ = nullptr;
+    }
+    else {
+        const std::uint8_t b = key[depth];
+        Node** child         = findChild(n, b);
+        if (!child || !remove(*child, key, depth + 1)) {
+            return false;
+        }
+        if (*child == nullptr) {
+            removeChild(ref, n, b);
+        }
+    }
+
+    compact(ref);
+    return true;
+}
+
+template <typename T>
+void RadixTree<T>::compact(Node*& ref) {
+    auto* n = static_cast<Inner*>(ref);
+
+    if (n->count_ == 0) {
+        // only a value (or nothing) is left, which becomes a leaf with the compressed path as suffix
+        Leaf* leaf = n->value_;
+        if (leaf) {
+            leaf->suffix_ = std::move(n->prefix_);
+        }
+        n->value_ = nullptr;
+        deleteNode(n);
+        ref = leaf;
+        return;
+    }
+
+    if (n->count_ == 1 && n->value_ == nullptr) {
+        // extend the path of the only child
+        std::uint8_t b = 0;
+        Node* child    = nullptr;
+        forEachChild(n, [&](std::uint8_t k, Node* c) {
+            b     = k;
+            child = c;
+        });
+
+        std::string& path =
+            child->type_ == LEAF ? static_cast<Leaf*>(child)->suffix_ : static_cast<Inner*>(child)->prefix_;
+
+        std::string merged = std::move(n->prefix_);
+        merged.push_back(char(b));
+        merged.append(path);
+        path = std::move(merged);
+
+        deleteNode(n);
+        ref = child;
+    }
+}
+
+template <typename T>
+typename RadixTree<T>::Node* const* RadixTree<T>::findChild(const Inner* n, std::uint8_t b) {
+    switch (n->type_) {
+        case NODE4: {
+            auto* m = static_cast<const Node4*>(n);
+            for (size_t i = 0; i < m->count_; ++i) {
+                if (m->keys_[i] == b) {
+                    return &m->children_[i];
+                }
+            }
+            return nullptr;
+        }
+        case NODE16: {
+            auto* m = static_cast<const Node16*>(n);
+#if defined(__SSE2__) && defined(__GNUC__)
+            const __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m->keys_));
+            const unsigned bits =
+                unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(char(b)), keys))) & ((1U << m->count_) - 1);
+            if (bits) {
+                return &m->children_[__builtin_ctz(bits)];
+            }
+#else
+            const std::uint8_t* k = std::lower_bound(m->keys_, m->keys_ + m->count_, b);
+            if (k != m->keys_ + m->count_ && *k == b) {
+                return &m->children_[k - m->keys_];
+            }
+#endif
+            return nullptr;
+        }
+        case NODE48: {
+            auto* m = static_cast<const Node48*>(n);
+            return m->index_[b] ? &m->children_[m->index_[b] - 1] : nullptr;
+        }
+        case NODE256: {
+            auto* m = static_cast<const Node256*>(n);
+            return m->children_[b] ? &m->children_[b] : nullptr;
+        }
+        default:
+            NOTIMP;
+    }
+}
+
+template <typename T>
+template <typename F>
+void RadixTree<T>::forEachChild(const Inner* n, F f) {
+    switch (n->type_) {
+        case NODE4: {
+            auto* m = static_cast<const Node4*>(n);
+            for (size_t i = 0; i < m->count_; ++i) {
+                f(m->keys_[i], m->children_[i]);
+            }
+            break;
+        }
+        case NODE16: {
+            auto* m = static_cast<const Node16*>(n);
+            for (size_t i = 0; i < m->count_; ++i) {
+                f(m->keys_[i], m->children_[i]);
+            }
+            break;
+        }
+        case NODE48: {
+            auto* m = static_cast<const Node48*>(n);
+            for (size_t b = 0; b < 256; ++b) {
+                if (m->index_[b]) {
+                    f(std::uint8_t(b), m->children_[m->index_[b] - 1]);
+                }
+            }
+            break;
+        }
+        case NODE256: {
+            auto* m = static_cast<const Node256*>(n);
+            for (size_t b = 0; b < 256; ++b) {
+                if (m->children_[b]) {
+                    f(std::uint8_t(b), m->children_[b]);
+                }
+            }
+            break;
+        }
+        default:
+            NOTIMP;
+    }
+}
+
+template <typename T>
+void RadixTree<T>::addChild(Node*& ref, Inner* n, std::uint8_t b, Node* child) {
+    // sorted insertion into the keys and children of a Node4 or Node16
+    auto insertSorted = [b, child](auto* m) {
+        size_t i = 0;
+        while (i < m->count_ && m->keys_[i] < b) {
+            ++i;
+        }
+        std::memmove(m->keys_ + i + 1, m->keys_ + i, (m->count_ - i) * sizeof(m->keys_[0]));
+        std::memmove(m->children_ + i + 1, m->children_ + i, (m->count_ - i) * sizeof(m->children_[0]));
+        m->keys_[i]     = b;
+        m->children_[i] = child;
+        m->count_++;
+    };
+
+    switch (n->type_) {
+        case NODE4: {
+            auto* m = static_cast<Node4*>(n);
+            if (m->count_ < 4) {
+                insertSorted(m);
+                return;
+            }
+            auto* g = new Node16;
+            std::copy(m->keys_, m->keys_ + 4, g->keys_);
+            std::copy(m->children_, m->children_ + 4, g->children_);
+            moveHeader(g, m);
+            delete m;
+            insertSorted(g);
+            ref = g;
+            return;
+        }
+        case NODE16: {
+            auto* m = static_cast<Node16*>(n);
+            if (m->count_ < 16) {
+                insertSorted(m);
+                return;
+            }
+            auto* g = new Node48;
+            for (size_t i = 0; i < 16; ++i) {
+                g->index_[m->keys_[i]] = std::uint8_t(i + 1);
+                g->children_[i]        = m->children_[i];
+            }
+            moveHeader(g, m);
+            delete m;
+            ref = g;
+            addChild(ref, g, b, child);
+            return;
+        }
+        case NODE48: {
+            auto* m = static_cast<Node48*>(n);
+            if (m->count_ < 48) {
+                size_t i = 0;
+                while (m->children_[i]) {
+                    ++i;
+                }
+                m->index_[b]    = std::uint8_t(i + 1);
+                m->children_[i] = child;
+                m->count_++;
+                return;
+            }
+            auto* g = new Node256;
+            for (size_t k = 0; k < 256; ++k) {
+                if (m->index_[k]) {
+                    g->children_[k] = m->children_[m->index_[k] - 1];
+                }
+            }
+            moveHeader(g, m);
+            delete m;
+            ref = g;
+            addChild(ref, g, b, child);
+            return;
+        }
+        case NODE256: {
+            auto* m = static_cast<Node256*>(n);
+            ASSERT(m->children_[b] == nullptr);
+            m->children_[b] = child;
+            m->count_++;
+            return;
+        }
+        default:
+            NOTIMP;
+    }
+}
+
+template <typename T>
+void RadixTree<T>::removeChild(Node*& ref, Inner* n, std::uint8_t b) {
+    auto removeSorted = [b](auto* m) {
+        size_t i = 0;
+        while (m->keys_[i] != b) {
+            ++i;
+        }
+        std::memmove(m->keys_ + i, m->keys_ + i + 1, (m->count_ - i - 1) * sizeof(m->keys_[0]));
+        std::memmove(m->children_ + i, m->children_ + i + 1, (m->count_ - i - 1) * sizeof(m->children_[0]));
+        m->count_--;
+    };
+
+    // shrink below these sizes, leaving room to avoid growing again on the next insertion
+    switch (n->type_) {
+        case NODE4:
+            removeSorted(static_cast<Node4*>(n));
+            return;
+        case NODE16: {
+            auto* m = static_cast<Node16*>(n);
+            removeSorted(m);
+            if (m->count_ > 3) {
+                return;
+            }
+            auto* s = new Node4;
+            std::copy(m->keys_, m->keys_ + m->count_, s->keys_);
+            std::copy(m->children_, m->children_ + m->count_, s->children_);
+            moveHeader(s, m);
+            delete m;
+            ref = s;
+            return;
+        }
+        case NODE48: {
+            auto* m                        = static_cast<Node48*>(n);
+            m->children_[m->index_[b] - 1] = nullptr;
+            m->index_[b]                   = 0;
+            m->count_--;
+            if (m->count_ > 12) {
+                return;
+            }
+            auto* s  = new Node16;
+            size_t i = 0;
+            for (size_t k = 0; k < 256; ++k) {
+                if (m->index_[k]) {
+                    s->keys_[i]     = std::uint8_t(k);
+                    s->children_[i] = m->children_[m->index_[k] - 1];
+                    ++i;
+                }
+            }
+            moveHeader(s, m);
+            delete m;
+            ref = s;
+            return;
+        }
+        case NODE256: {
+            auto* m         = static_cast<Node256*>(n);
+            m->children_[b] = nullptr;
+            m->count_--;
+            if (m->count_ > 40) {
+                return;
+            }
+            auto* s  = new Node48;
+            size_t i = 0;
+            for (size_t k = 0; k < 256; ++k) {
+                if (m->children_[k]) {
+                    s->index_[k]    = std::uint8_t(i + 1);
+                    s->children_[i] = m->children_[k];
+                    ++i;
+                }
+            }
+            moveHeader(s, m);
+            delete m;
+            ref = s;
+            return;
+        }
+        default:
+            NOTIMP;
+    }
+}
+
+template <typename T>
+template <typename F>
+void RadixTree<T>::visit(const Node* node, std::string& key, F& f) {
+    if (node == nullptr) {
+        return;
+    }
+
+    const size_t length = key.size();
+
+    if (node->type_ == LEAF) {
+        auto* leaf = static_cast<const Leaf*>(node);
+        key.append(leaf->suffix_);
+        f(static_cast<const std::string&>(key), static_cast<const T&>(leaf->value_));
+        key.resize(length);
+        return;
+    }
+
+    auto* n = static_cast<const Inner*>(node);
+    key.append(n->prefix_);
+
+    // a key sorts before the keys it is a prefix of
+    if (n->value_) {
+        f(static_cast<const std::string&>(key), static_cast<const T&>(n->value_->value_));
+    }
+
+    forEachChild(n, [&key, &f](std::uint8_t b, const Node* child) {
+        key.push_back(char(b));
+        visit(child, key, f);
+        key.pop_back();
+    });
+
+    key.resize(length);
+}
+
+template <typename T>
+size_t RadixTree<T>::footprint(const Node* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+
+    // heap allocated characters of a string (short strings are stored inline)
+    auto chars = [](const std::string& s) { return s.capacity() >= sizeof(std::string) ? s.capacity() + 1 : 0; };
+
+    if (node->type_ == LEAF) {
+        return sizeof(Leaf) + chars(static_cast<const Leaf*>(node)->suffix_);
+    }
+
+    auto* n = static_cast<const Inner*>(node);
+
+    size_t s = chars(n->prefix_) + footprint(n->value_);
+    switch (n->type_) {
+        case NODE4:
+            s += sizeof(Node4);
+            break;
+        case NODE16:
+            s += sizeof(Node16);
+            break;
+        case NODE48:
+            s += sizeof(Node48);
+            break;
+        default:
+            s += sizeof(Node256);
+            break;
+    }
+
+    forEachChild(n, [&s](std::uint8_t, const Node* child) { s += footprint(child); });
+    return s;
+}
+
+template <typename T>
+void RadixTree<T>::deleteNode(Node* node) {
+    switch (node->type_) {
+        case LEAF:
+            delete static_cast<Leaf*>(node);
+            break;
+        case NODE4:
+            delete static_cast<Node4*>(node);
+            break;
+        case NODE16:
+            delete static_cast<Node16*>(node);
+            break;
+        case NODE48:
+            delete static_cast<Node48*>(node);
+            break;
+        case NODE256:
+            delete static_cast<Node256*>(node);
+            break;
+    }
+}
+
+template <typename T>
+void RadixTree<T>::destroy(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->type_ != LEAF) {
+        auto* n = static_cast<Inner*>(node);
+        forEachChild(n, [](std::uint8_t, Node* child) { destroy(child); });
+        delete n->value_;
+    }
+    deleteNode(node);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,410 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_container_RingQueue_h
+#define eckit_container_RingQueue_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Bounded multi-producer multi-consumer queue, lock-free on its fast path
+///
+/// Elements are stored in a ring of cells, each with a sequence number telling producers and consumers whether the
+/// cell is free or filled for their position (D. Vyukov's bounded MPMC queue). Producers and consumers only contend
+/// on their own (head or tail) counter, and do not wake each other up unless the other side is actually waiting.
+///
+/// Blocking operations spin (yielding) for a while before parking on a condition variable. close() and interrupt()
+/// have the semantics of eckit::Queue: a closed queue can be drained, but not pushed to; an interrupted queue throws
+/// the interrupting exception from all operations. Producers are counted while they push, so that consumers of a closed
+/// queue also receive the elements of pushes that started before close(), rather than report the queue drained.
+///
+/// An element is constructed in its cell once the cell is claimed, where an exception would leave the cell claimed but
+/// never filled: elements that cannot be constructed from the arguments without throwing are constructed beforehand,
+/// and moved to the cell, which must not throw.
+template <typename ELEM>
+class RingQueue {
+
+public:  // methods
+    /// @param max capacity, rounded up to a power of 2 (at least 2)
+    /// @param spin number of attempts of a blocking operation before parking the calling thread
+    explicit RingQueue(size_t max, size_t spin = 128) :
+        cells_(nullptr), mask_(capacity(max) - 1), spin_(spin), head_(0), tail_(0), waiting_(0), pushing_(0) {
+        ASSERT(max > 0);
+        cells_.reset(new Cell[mask_ + 1]);
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RingQueue() {
+        for (auto pos = head_.value_.load(); pos != tail_.value_.load(); ++pos) {
+            cells_[pos & mask_].value()->~ELEM();
+        }
+    }
+
+    RingQueue(const RingQueue&)            = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    RingQueue(RingQueue&& rhs)            = delete;
+    RingQueue& operator=(RingQueue&& rhs) = delete;
+
+    size_t maxSize() const { return mask_ + 1; }
+
+    /// @returns number of elements, exact only in the absence of concurrent operations
+    size_t size() const {
+        auto head = head_.value_.load(std::memory_order_acquire);
+        auto tail = tail_.value_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    void close() {
+        closed_ = true;
+        wakeAll();
+    }
+
+    bool closed() const { return closed_ || interrupted_; }
+
+    bool checkInterrupt() {
+        if (interrupted_) {
+            std::rethrow_exception(interrupt_);
+        }
+        return true;
+    }
+
+    void interrupt(std::exception_ptr expn) {
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            if (!interrupted_) {
+                interrupt_   = expn;
+                interrupted_ = true;
+            }
+        }
+        wakeAll();
+    }
+
+    // -- Non-blocking
+
+    /// @returns false if the queue is full
+    bool tryPush(const ELEM& e) { return tryEmplace(e); }
+    bool tryPush(ELEM&& e) { return tryEmplace(std::move(e)); }
+
+    template <typename... Args>
+    bool tryEmplace(Args&&... args) {
+        if constexpr (!inPlace<Args...>()) {
+            static_assert(inPlace<ELEM>(), "RingQueue: elements must be moved without throwing");
+            return tryEmplace(ELEM(std::forward<Args>(args)...));
+        }
+        else {
+            checkInterrupt();
+            Pushing pushing(*this);
+            ASSERT(!closed_);
+            if (enqueue(std::forward<Args>(args)...)) {
+                notify(notEmpty_);
+                return true;
+            }
+            return false;
+        }
+    }
+
+    /// @returns false if the queue is empty
+    bool tryPop(ELEM& e) {
+        checkInterrupt();
+        if (dequeue(e)) {
+            notify(notFull_);
+            return true;
+        }
+        return false;
+    }
+
+    // -- Blocking
+
+    /// Blocks while the queue is full, fails if the queue is (or gets) closed
+    /// @returns number of elements after the push
+    size_t push(const ELEM& e) { return emplace(e); }
+    size_t push(ELEM&& e) { return emplace(std::move(e)); }
+
+    template <typename... Args>
+    size_t emplace(Args&&... args) {
+        if constexpr (!inPlace<Args...>()) {
+            static_assert(inPlace<ELEM>(), "RingQueue: elements must be moved without throwing");
+            return emplace(ELEM(std::forward<Args>(args)...));
+        }
+        else {
+            Pushing pushing(*this);
+            ASSERT(!closed_);
+            const bool pushed = wait(notFull_, [&] { return enqueue(std::forward<Args>(args)...); });
+            ASSERT_MSG(pushed, "RingQueue: push to a closed queue");
+            notify(notEmpty_);
+            return size();
+        }
+    }
+
+    /// Push all elements, blocking while the queue is full
+    /// @returns number of elements after the push
+    size_t push(const std::vector<ELEM>& elems) {
+        Pushing pushing(*this);
+        ASSERT(!closed_);
+        size_t i = 0;
+        while (i < elems.size()) {
+            const bool pushed = wait(notFull_, [&] {
+                const size_t start = i;
+                if constexpr (inPlace<const ELEM&>()) {
+                    for (; i < elems.size() && enqueue(elems[i]); ++i) {}
+                }
+                else {
+                    for (; i < elems.size() && enqueue(ELEM(elems[i])); ++i) {}
+                }
+                return i > start;
+            });
+            ASSERT_MSG(pushed, "RingQueue: push to a closed queue");
+            notifyAll(notEmpty_);
+        }
+        return size();
+    }
+
+    /// @returns number of elements remaining after the pop, or -1 if the queue is closed and empty
+    long pop(ELEM& e) {
+        if (!wait(notEmpty_, [&] { return dequeue(e); })) {
+            return -1;
+        }
+        notify(notFull_);
+        return long(size());
+    }
+
+    /// Pop up to elems.size() elements, blocking until at least one is available
+    /// @returns number of elements popped, or -1 if the queue is closed and empty
+    long pop(std::vector<ELEM>& elems) {
+        if (elems.empty()) {
+            return 0;
+        }
+
+        size_t count = 0;
+        if (!wait(notEmpty_, [&] {
+                for (; count < elems.size() && dequeue(elems[count]); ++count) {}
+                return count > 0;
+            })) {
+            return -1;
+        }
+        notifyAll(notFull_);
+        return long(count);
+    }
+
+private:  // types
+    struct Cell {
+        std::atomic<size_t> sequence_;
+        alignas(ELEM) unsigned char storage_[sizeof(ELEM)];  ///< element, constructed while the cell is filled
+
+        ELEM* value() { return std::launder(reinterpret_cast<ELEM*>(storage_)); }
+    };
+
+    /// Separates members written by producers and by consumers, to avoid false sharing
+    struct alignas(64) Counter {
+        Counter(size_t value) :
+            value_(value) {}
+        std::atomic<size_t> value_;
+    };
+
+    struct Waiting {
+        explicit Waiting(std::atomic<size_t>& count) :
+            count_(count) {
+            count_++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Waiting() { count_--; }
+        std::atomic<size_t>& count_;
+    };
+
+    /// Producer in flight: counted before it checks closed_, until its elements are published
+    struct Pushing {
+        explicit Pushing(RingQueue& queue) :
+            queue_(queue) {
+            queue_.pushing_++;
+        }
+        ~Pushing() {
+            if (--queue_.pushing_ == 0 && queue_.closed_) {
+                queue_.wakeAll();  // consumers waiting for the last producer to report the queue drained
+            }
+        }
+        RingQueue& queue_;
+    };
+
+private:  // methods
+    /// Elements constructed from these arguments can be constructed in their cell
+    template <typename... Args>
+    static constexpr bool inPlace() {
+        return std::is_nothrow_constructible<ELEM, Args&&...>::value;
+    }
+
+    static size_t capacity(size_t max) {
+        size_t n = 2;  // a single cell cannot tell a full ring from an empty one
+        while (n < max) {
+            n <<= 1;
+        }
+        return n;
+    }
+
+    template <typename... Args>
+    bool enqueue(Args&&... args) {
+        static_assert(inPlace<Args...>(), "RingQueue: elements must be moved without throwing");
+
+        auto pos = tail_.value_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            auto seq   = cell.sequence_.load(std::memory_order_acquire);
+            auto diff  = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.value_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (cell.storage_) ELEM(std::forward<Args>(args)...);
+                    cell.sequence_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // full
+            }
+            else {
+                pos = tail_.value_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool dequeue(ELEM& e) {
+        auto pos = head_.value_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            auto seq   = cell.sequence_.load(std::memory_order_acquire);
+            auto diff  = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.value_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    // the cell is freed even if the assignment throws, losing the element
+                    struct Release {
+                        ~Release() {
+                            cell_.value()->~ELEM();
+                            cell_.sequence_.store(sequence_, std::memory_order_release);
+                        }
+                        Cell& cell_;
+                        size_t sequence_;
+                    } release{cell, pos + mask_ + 1};
+
+                    e = std::move(*cell.value());
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // empty
+            }
+            else {
+                pos = head_.value_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// The operation cannot succeed anymore: the queue is closed and, for consumers, no producer is still pushing
+    /// (then a consumer's last attempt is conclusive, as it follows the publication of all elements)
+    bool done(bool consumer) const { return closed_ && (!consumer || pushing_ == 0); }
+
+    /// Retry an operation until it succeeds, spinning then parking on cv
+    /// @returns false if the queue is closed (and, for consumers, drained) before the operation succeeds
+    template <typename Op>
+    bool wait(std::condition_variable& cv, Op&& op) {
+        const bool consumer = &cv == &notEmpty_;
+
+        for (size_t i = 0; i < spin_; ++i) {
+            checkInterrupt();
+            if (op()) {
+                return true;
+            }
+            if (done(consumer)) {
+                return consumer && op();
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> locker(mutex_);
+        for (;;) {
+            checkInterrupt();
+            if (done(consumer)) {
+                return consumer && op();
+            }
+
+            // announce before retrying, so that a concurrent notify() cannot be missed
+            Waiting guard(waiting_);
+            if (op()) {
+                return true;
+            }
+            if (!done(consumer) && !interrupted_) {
+                cv.wait(locker);
+            }
+        }
+    }
+
+    void notify(std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> locker(mutex_);
+            cv.notify_one();
+        }
+    }
+
+    void notifyAll(std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> locker(mutex_);
+            cv.notify_all();
+        }
+    }
+
+    void wakeAll() {
+        std::lock_guard<std::mutex> locker(mutex_);
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:  // members
+    std::unique_ptr<Cell[]> cells_;
+    const size_t mask_;
+    const size_t spin_;
+
+    Counter head_;
+    Counter tail_;
+
+    std::atomic<size_t> waiting_;
+    std::atomic<size_t> pushing_;  ///< producers in flight
+    std::atomic<bool> closed_{false};
+    std::atomic<bool> interrupted_{false};
+    std::exception_ptr interrupt_;
+
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif  // eckit_container_RingQueue_h
@@ -0,0 +1,252 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "eckit/container/SharedMemHashTable.h"
+
+#include "eckit/config/LibEcKit.h"
+#include "eckit/eckit.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/log/Log.h"
+#include "eckit/memory/MMap.h"
+#include "eckit/os/Semaphore.h"
+#include "eckit/os/Stat.h"
+#include "eckit/thread/AutoLock.h"
+
+#if eckit_HAVE_XXHASH
+#define XXH_INLINE_ALL
+#include "eckit/contrib/xxhash/xxhash.h"
+#endif
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr char MAGIC[8]          = {'E', 'C', 'S', 'H', 'M', 'H', 'T', 'B'};
+constexpr std::uint32_t VERSION  = 1;
+constexpr size_t STRIPES         = 256;
+constexpr size_t CACHE_LINE      = 64;
+constexpr size_t HEADER_SIZE     = 4096;
+constexpr size_t STRIPES_SIZE    = STRIPES * CACHE_LINE;
+constexpr size_t SPINS_PER_CHECK = 1024;
+
+}  // namespace
+
+struct SharedMemHashTableBase::Header {
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t keySize_;
+    std::uint32_t valueSize_;
+    std::uint32_t bucketSize_;
+    std::uint64_t buckets_;
+    std::atomic<std::uint64_t> size_;  ///< entries
+    std::atomic<std::uint64_t> used_;  ///< buckets full or deleted
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SharedMemHashTableBase::SharedMemHashTableBase(const PathName& path, const std::string& shmName, size_t capacity,
+                                               size_t keySize, size_t valueSize, size_t bucketSize) :
+    base_(nullptr), buckets_(16), name_(shmName), header_(nullptr), map_(nullptr), length_(0), fd_(-1) {
+    static_assert(sizeof(Header) <= HEADER_SIZE, "SharedMemHashTable header too large");
+
+    // at most 7/8 of the buckets in use, so that probe sequences stay short
+    while (buckets_ - buckets_ / 8 < capacity) {
+        buckets_ <<= 1;
+    }
+    maxUsed_ = buckets_ - buckets_ / 8;
+
+    length_ = HEADER_SIZE + STRIPES_SIZE + buckets_ * bucketSize;
+
+    Log::debug<LibEcKit>() << "SharedMemHashTable semaphore path=" << path << ", shmName=" << shmName
+                           << ", buckets=" << buckets_ << ", length=" << length_ << std::endl;
+
+    // the semaphore is released by the system if this process dies
+    Semaphore sem(path);
+    AutoLock<Semaphore> lock(sem);
+
+    fd_ = ::shm_open(name_.c_str(), O_RDWR | O_CREAT, 0777);
+    if (fd_ < 0) {
+        Log::error() << "shm_open(" << name_ << ')' << Log::syserr << std::endl;
+        throw FailedSystemCall("shm_open", Here());
+    }
+
+    Stat::Struct s;
+    SYSCALL(Stat::fstat(fd_, &s));
+
+    const bool create = s.st_size == 0;
+    if (create) {
+        SYSCALL(::ftruncate(fd_, length_));
+    }
+    else if (size_t(s.st_size) != length_) {
+        ::close(fd_);
+        throw BadValue("SharedMemHashTable: " + name_ + " exists with a different size");
+    }
+
+    map_ = MMap::mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        Log::error() << "SharedMemHashTable name=" << name_ << " length=" << length_ << " fails to mmap"
+                     << Log::syserr << std::endl;
+        ::close(fd_);
+        throw FailedSystemCall("mmap", Here());
+    }
+
+    header_ = static_cast<Header*>(map_);
+    base_   = static_cast<char*>(map_) + HEADER_SIZE + STRIPES_SIZE;
+
+    if (create) {
+        // ftruncate zero fills: buckets are empty and unlocked
+        std::memcpy(header_->magic_, MAGIC, sizeof(MAGIC));
+        header_->version_    = VERSION;
+        header_->keySize_    = keySize;
+        header_->valueSize_  = valueSize;
+        header_->bucketSize_ = bucketSize;
+        header_->buckets_    = buckets_;
+        header_->size_       = 0;
+        header_->used_       = 0;
+    }
+    else if (std::memcmp(header_->magic_, MAGIC, sizeof(MAGIC)) != 0 || header_->version_ != VERSION ||
+             header_->keySize_ != keySize || header_->valueSize_ != valueSize ||
+             header_->bucketSize_ != bucketSize || header_->buckets_ != buckets_) {
+        MMap::munmap(map_, length_);
+        ::close(fd_);
+        throw BadValue("SharedMemHashTable: " + name_ + " exists with a different layout");
+    }
+}
+
+SharedMemHashTableBase::~SharedMemHashTableBase() {
+    if (map_) {
+        MMap::munmap(map_, length_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+size_t SharedMemHashTableBase::size() const {
+    return header_->size_.load(std::memory_order_relaxed);
+}
+
+void SharedMemHashTableBase::unlink(const std::string& shmName) {
+    if (::shm_unlink(shmName.c_str()) < 0 && errno != ENOENT) {
+        throw FailedSystemCall("shm_unlink(" + shmName + ")", Here());
+    }
+}
+
+bool SharedMemHashTableBase::lock(Owner& owner, pid_t pid) {
+    for (size_t spins = 0;; ++spins) {
+        pid_t current = owner.load(std::memory_order_relaxed);
+        if (current == 0) {
+            if (owner.compare_exchange_weak(current, pid, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return false;
+            }
+        }
+        else if (spins % SPINS_PER_CHECK == SPINS_PER_CHECK - 1 && !alive(current)) {
+            // (if the pid was reused by a new process meanwhile, the lock is only taken over when it exits)
+            if (owner.compare_exchange_strong(current, pid, std::memory_order_acquire, std::memory_order_relaxed)) {
+                Log::warning() << "SharedMemHashTable: took over a lock of dead process " << current << std::endl;
+                return true;
+            }
+        }
+        backoff(spins);
+    }
+}
+
+void SharedMemHashTableBase::unlock(Owner& owner) {
+    owner.store(0, std::memory_order_release);
+}
+
+bool SharedMemHashTableBase::alive(pid_t pid) {
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+
+void SharedMemHashTableBase::backoff(size_t spins) {
+    if (spins >= 64) {
+        ::sched_yield();
+    }
+}
+
+std::uint64_t SharedMemHashTableBase::hash(const void* key, size_t size) {
+#if eckit_HAVE_XXHASH
+    return XXH3_64bits(key, size);
+#else
+    // FNV-1a, then mixed (the low bits select the bucket)
+    const auto* p   = static_cast<const unsigned char*>(key);
+    std::uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+#endif
+}
+
+SharedMemHashTableBase::Owner& SharedMemHashTableBase::stripe(std::uint64_t h) const {
+    // high bits, the low ones select the bucket
+    char* p = static_cast<char*>(map_) + HEADER_SIZE + ((h >> 56) % STRIPES) * CACHE_LINE;
+    return *reinterpret_cast<Owner*>(p);
+}
+
+size_t SharedMemHashTableBase::recoverStripes() {
+    const pid_t pid = ::getpid();
+
+    size_t released = 0;
+    for (size_t i = 0; i < STRIPES; ++i) {
+        Owner& owner  = stripe(std::uint64_t(i) << 56);
+        pid_t current = owner.load(std::memory_order_relaxed);
+        if (current != 0 && current != pid && !alive(current) &&
+            owner.compare_exchange_strong(current, 0, std::memory_order_release, std::memory_order_relaxed)) {
+            released++;
+        }
+    }
+    return released;
+}
+
+void SharedMemHashTableBase::lockAll(pid_t pid) {
+    // always in the same order
+    for (size_t i = 0; i < STRIPES; ++i) {
+        lock(stripe(std::uint64_t(i) << 56), pid);
+    }
+}
+
+void SharedMemHashTableBase::unlockAll() {
+    for (size_t i = 0; i < STRIPES; ++i) {
+        unlock(stripe(std::uint64_t(i) << 56));
+    }
+}
+
+std::atomic<std::uint64_t>& SharedMemHashTableBase::sizeCounter() const {
+    return header_->size_;
+}
+
+std::atomic<std::uint64_t>& SharedMemHashTableBase::usedCounter() const {
+    return header_->used_;
+}
+
+void SharedMemHashTableBase::full() const {
+    throw Exception("SharedMemHashTable: " + name_ + " is full (capacity " + std::to_string(maxUsed_) + ")", Here());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
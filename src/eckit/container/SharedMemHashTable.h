@@ -0,0 +1,499 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+class PathName;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Part of SharedMemHashTable independent of the types of keys and values: the shared memory segment, and locks
+/// robust to the death of the process holding them
+class SharedMemHashTableBase : private NonCopyable {
+public:  // methods
+    /// Maximum number of entries (including removed entries whose buckets were not reused yet)
+    size_t capacity() const { return maxUsed_; }
+
+    size_t buckets() const { return buckets_; }
+
+    /// Number of entries (approximate after the crash of a writer, until recover())
+    size_t size() const;
+
+    bool empty() const { return size() == 0; }
+
+    const std::string& name() const { return name_; }
+
+    /// Remove a shared memory segment, which otherwise persists after all processes are gone
+    static void unlink(const std::string& shmName);
+
+protected:  // types
+    struct Header;
+
+    using Owner = std::atomic<pid_t>;
+
+    /// RAII for the robust locks
+    class Lock : private NonCopyable {
+    public:
+        Lock(Owner& owner, pid_t pid) :
+            owner_(owner), recovered_(SharedMemHashTableBase::lock(owner, pid)) {}
+        ~Lock() { SharedMemHashTableBase::unlock(owner_); }
+
+        /// The lock was taken over from a dead process
+        bool recovered() const { return recovered_; }
+
+    private:
+        Owner& owner_;
+        bool recovered_;
+    };
+
+protected:  // methods
+    SharedMemHashTableBase(const PathName& path, const std::string& shmName, size_t capacity, size_t keySize,
+                           size_t valueSize, size_t bucketSize);
+
+    ~SharedMemHashTableBase();
+
+    /// Spin until owner is unset, and set it to pid
+    /// @returns true if the lock was taken over from a dead process
+    static bool lock(Owner& owner, pid_t pid);
+    static void unlock(Owner& owner);
+
+    static bool alive(pid_t pid);
+
+    /// Spin a little, then yield
+    static void backoff(size_t spins);
+
+    static std::uint64_t hash(const void* key, size_t size);
+
+    /// Lock of the writers of keys with a given hash
+    Owner& stripe(std::uint64_t h) const;
+
+    /// Release the locks of dead processes
+    /// @returns the number of stripes released
+    size_t recoverStripes();
+
+    /// Lock all stripes, for operations on the whole table
+    void lockAll(pid_t pid);
+    void unlockAll();
+
+    std::atomic<std::uint64_t>& sizeCounter() const;
+    std::atomic<std::uint64_t>& usedCounter() const;
+
+    [[noreturn]] void full() const;
+
+protected:  // members
+    char* base_;  ///< first bucket
+    size_t buckets_;
+    size_t maxUsed_;
+
+private:  // members
+    std::string name_;
+    Header* header_;
+    void* map_;
+    size_t length_;
+    int fd_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Hash table in POSIX shared memory, for processes (e.g. forked workers) to share a lookup table
+///
+/// Keys and values must be plain data, copyable byte by byte (e.g. numbers, FixedString), keys are compared and
+/// hashed byte by byte (so must not have uninitialised padding). The number of buckets is fixed when the shared
+/// memory segment is created; insertions fail (throw) when the table is full.
+///
+/// Open addressing with linear probing. Readers do not lock: each bucket carries a version, odd while being written,
+/// which readers check before and after copying the bucket (a sequence lock). Writers lock a stripe covering the key,
+/// so that keys are inserted once, then the bucket they write. Locks hold the pid of their owner: a process waiting
+/// for a lock held by a dead process takes it over, and drops the entry that was being written if any. recover()
+/// does the same for all locks, e.g. after a worker was killed.
+template <typename K, typename V>
+class SharedMemHashTable : public SharedMemHashTableBase {
+    // copied byte by byte, in and out of shared memory, between processes
+    static_assert(std::is_trivially_copyable<K>::value, "SharedMemHashTable keys must be plain data");
+    static_assert(std::is_trivially_copyable<V>::value, "SharedMemHashTable values must be plain data");
+    static_assert(Owner::is_always_lock_free, "SharedMemHashTable requires lock-free atomics");
+
+public:  // types
+    typedef K key_type;
+    typedef V value_type;
+
+public:  // methods
+    /// @param path of the semaphore guarding the creation of the shared memory segment
+    /// @param shmName name of the shared memory segment, starting with '/'
+    /// @param capacity maximum number of entries
+    SharedMemHashTable(const PathName& path, const std::string& shmName, size_t capacity) :
+        SharedMemHashTableBase(path, shmName, capacity, sizeof(K), sizeof(V), sizeof(Bucket)) {}
+
+    /// Insert an entry, or replace the value of an existing key
+    /// @returns true if the key was inserted
+    bool insert(const K& key, const V& value);
+
+    /// @returns true if the key was found, and its value
+    bool find(const K& key, V& value) const;
+
+    bool contains(const K& key) const;
+
+    /// @returns true if the key was removed
+    bool remove(const K& key);
+
+    /// Modify the value of a key, with f(V&), atomically with respect to other readers and writers. f() modifies a
+    /// copy, stored only if it returns (if it throws, the value is unchanged)
+    /// @returns true if the key was found
+    template <typename F>
+    bool update(const K& key, F f);
+
+    /// Call f(const K&, const V&) for all entries, each read consistently (but not all at the same time)
+    template <typename F>
+    void forEach(F f) const;
+
+    /// Remove all entries (concurrent writers wait)
+    void clear();
+
+    /// Release locks held by dead processes, drop entries they were writing, and recount the entries
+    /// @returns the number of locks released
+    size_t recover();
+
+private:  // types
+    enum State : std::uint32_t
+    {
+        EMPTY   = 0,
+        FULL    = 1,
+        DELETED = 2
+    };
+
+    struct Bucket {
+        std::atomic<std::uint32_t> version_;  ///< odd while being written
+        Owner owner_;                         ///< pid of the writer, 0 if none
+        std::atomic<std::uint32_t> state_;
+        K key_;
+        V value_;
+    };
+
+    struct Entry {
+        std::uint32_t state_;
+        K key_;
+        V value_;
+    };
+
+    static constexpr size_t npos = size_t(-1);
+
+private:  // methods
+    Bucket& bucket(size_t i) const { return reinterpret_cast<Bucket*>(base_)[i]; }
+
+    size_t slot(std::uint64_t h, size_t i) const { return (h + i) & (buckets_ - 1); }
+
+    static bool equal(const K& a, const K& b) { return std::memcmp(&a, &b, sizeof(K)) == 0; }
+
+    /// Consistent copy of a bucket (of its state and key only, unless value)
+    void read(const Bucket& b, Entry& e, bool value) const;
+
+    /// Lock a bucket, dropping the entry a dead writer left half-written
+    static void repair(Bucket& b, bool recovered);
+
+    static void beginWrite(Bucket& b) {
+        b.version_.store(b.version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void endWrite(Bucket& b) {
+        b.version_.store(b.version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// @returns the bucket of the key, or npos
+    size_t lookup(const K& key, std::uint64_t h) const;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+template <typename K, typename V>
+void SharedMemHashTable<K, V>::read(const Bucket& b, Entry& e, bool value) const {
+    for (size_t spins = 0;; ++spins) {
+        const std::uint32_t v = b.version_.load(std::memory_order_acquire);
+        if ((v & 1) == 0) {
+            e.state_ = b.state_.load(std::memory_order_relaxed);
+            std::memcpy(static_cast<void*>(&e.key_), &b.key_, sizeof(K));
+            if (value) {
+                std::memcpy(static_cast<void*>(&e.value_), &b.value_, sizeof(V));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (b.version_.load(std::memory_order_relaxed) == v) {
+                return;
+            }
+        }
+        else if (spins > 0 && spins % 4096 == 0) {
+            // the writer may be dead, wait for its lock (or take it over)
+            Bucket& w = const_cast<Bucket&>(b);
+            Lock lock(w.owner_, ::getpid());
+            repair(w, lock.recovered());
+        }
+        backoff(spins);
+    }
+}
+
+template <typename K, typename V>
+void SharedMemHashTable<K, V>::repair(Bucket& b, bool recovered) {
+    if (recovered && (b.version_.load(std::memory_order_relaxed) & 1)) {
+        b.state_.store(DELETED, std::memory_order_relaxed);
+        endWrite(b);
+    }
+}
+
+template <typename K, typename V>
+size_t SharedMemHashTable<K, V>::lookup(const K& key, std::uint64_t h) const {
+    Entry e;
+    for (size_t i = 0; i < buckets_; ++i) {
+        const size_t j = slot(h, i);
+        read(bucket(j), e, false);
+        if (e.state_ == EMPTY) {
+            break;
+        }
+        if (e.state_ == FULL && equal(e.key_, key)) {
+            return j;
+        }
+    }
+    return npos;
+}
+
+template <typename K, typename V>
+bool SharedMemHashTable<K, V>::insert(const K& key, const V& value) {
+    const pid_t pid       = ::getpid();
+    const std::uint64_t h = hash(&key, sizeof(K));
+
+    Lock guard(stripe(h), pid);
+
+    for (;;) {
+        // the key is in the table, or is inserted in the first deleted or empty bucket of its probe sequence
+        size_t target = npos;
+        Entry e;
+        for (size_t i = 0; i < buckets_; ++i) {
+            const size_t j = slot(h, i);
+            read(bucket(j), e, false);
+            if (e.state_ == FULL && equal(e.key_, key)) {
+                target = j;
+                break;
+            }
+            if (e.state_ != FULL && target == npos) {
+                target = j;
+            }
+            if (e.state_ == EMPTY) {
+                break;
+            }
+        }
+
+        if (target == npos) {
+            full();
+        }
+
+        Bucket& b = bucket(target);
+        Lock lock(b.owner_, pid);
+        repair(b, lock.recovered());
+
+        const std::uint32_t state = b.state_.load(std::memory_order_relaxed);
+
+        if (state == FULL) {
+            if (!equal(b.key_, key)) {
+                continue;  // taken by another key in the meantime
+            }
+            beginWrite(b);
+            std::memcpy(static_cast<void*>(&b.value_), &value, sizeof(V));
+            endWrite(b);
+            return false;
+        }
+
+        if (state == EMPTY) {
+            if (usedCounter().load(std::memory_order_relaxed) >= maxUsed_) {
+                full();
+            }
+            usedCounter()++;
+        }
+
+        beginWrite(b);
+        b.state_.store(FULL, std::memory_order_relaxed);
+        std::memcpy(static_cast<void*>(&b.key_), &key, sizeof(K));
+        std::memcpy(static_cast<void*>(&b.value_), &value, sizeof(V));
+        endWrite(b);
+
+        sizeCounter()++;
+        return true;
+    }
+}
+
+template <typename K, typename V>
+bool SharedMemHashTable<K, V>::find(const K& key, V& value) const {
+    const std::uint64_t h = hash(&key, sizeof(K));
+
+    Entry e;
+    for (size_t i = 0; i < buckets_; ++i) {
+        const Bucket& b = bucket(slot(h, i));
+        read(b, e, false);
+        if (e.state_ == EMPTY) {
+            return false;
+        }
+        if (e.state_ == FULL && equal(e.key_, key)) {
+            read(b, e, true);
+            if (e.state_ != FULL || !equal(e.key_, key)) {
+                return false;  // removed in the meantime
+            }
+            value = e.value_;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename V>
+bool SharedMemHashTable<K, V>::contains(const K& key) const {
+    return lookup(key, hash(&key, sizeof(K))) != npos;
+}
+
+template <typename K, typename V>
+bool SharedMemHashTable<K, V>::remove(const K& key) {
+    const pid_t pid       = ::getpid();
+    const std::uint64_t h = hash(&key, sizeof(K));
+
+    Lock guard(stripe(h), pid);
+
+    const size_t j = lookup(key, h);
+    if (j == npos) {
+        return false;
+    }
+
+    Bucket& b = bucket(j);
+    Lock lock(b.owner_, pid);
+    repair(b, lock.recovered());
+
+    if (b.state_.load(std::memory_order_relaxed) != FULL) {
+        return false;
+    }
+
+    beginWrite(b);
+    b.state_.store(DELETED, std::memory_order_relaxed);
+    endWrite(b);
+
+    sizeCounter()--;
+    return true;
+}
+
+template <typename K, typename V>
+template <typename F>
+bool SharedMemHashTable<K, V>::update(const K& key, F f) {
+    const pid_t pid       = ::getpid();
+    const std::uint64_t h = hash(&key, sizeof(K));
+
+    Lock guard(stripe(h), pid);
+
+    const size_t j = lookup(key, h);
+    if (j == npos) {
+        return false;
+    }
+
+    Bucket& b = bucket(j);
+    Lock lock(b.owner_, pid);
+    repair(b, lock.recovered());
+
+    if (b.state_.load(std::memory_order_relaxed) != FULL) {
+        return false;
+    }
+
+    // no other writer while the bucket is locked
+    V value;
+    std::memcpy(static_cast<void*>(&value), &b.value_, sizeof(V));
+
+    f(value);
+
+    beginWrite(b);
+    std::memcpy(static_cast<void*>(&b.value_), &value, sizeof(V));
+    endWrite(b);
+    return true;
+}
+
+template <typename K, typename V>
+template <typename F>
+void SharedMemHashTable<K, V>::forEach(F f) const {
+    Entry e;
+    for (size_t i = 0; i < buckets_; ++i) {
+        read(bucket(i), e, true);
+        if (e.state_ == FULL) {
+            f(static_cast<const K&>(e.key_), static_cast<const V&>(e.value_));
+        }
+    }
+}
+
+template <typename K, typename V>
+void SharedMemHashTable<K, V>::clear() {
+    const pid_t pid = ::getpid();
+
+    lockAll(pid);
+    try {
+        for (size_t i = 0; i < buckets_; ++i) {
+            Bucket& b = bucket(i);
+            Lock lock(b.owner_, pid);
+            if (b.state_.load(std::memory_order_relaxed) != EMPTY) {
+                beginWrite(b);
+                b.state_.store(EMPTY, std::memory_order_relaxed);
+                endWrite(b);
+            }
+        }
+        sizeCounter() = 0;
+        usedCounter() = 0;
+    }
+    catch (...) {
+        unlockAll();
+        throw;
+    }
+    unlockAll();
+}
+
+template <typename K, typename V>
+size_t SharedMemHashTable<K, V>::recover() {
+    const pid_t pid = ::getpid();
+
+    size_t released = recoverStripes();
+
+    size_t size = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < buckets_; ++i) {
+        Bucket& b         = bucket(i);
+        const pid_t owner = b.owner_.load(std::memory_order_relaxed);
+        if (owner != 0 && owner != pid && !alive(owner)) {
+            Lock lock(b.owner_, pid);
+            repair(b, lock.recovered());
+            released += lock.recovered() ? 1 : 0;
+        }
+
+        const std::uint32_t state = b.state_.load(std::memory_order_relaxed);
+        size += state == FULL ? 1 : 0;
+        used += state != EMPTY ? 1 : 0;
+    }
+
+    sizeCounter() = size;
+    usedCounter() = used;
+
+    return released;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -31,23 +31,44 @@ namespace eckit {
 struct StatCollector {
     StatCollector() {
         statsReset();
-        depth_ = 0;
+        depth_   = 0;
+        enabled_ = true;
     }
 
 
     // -- Methods
 
-    void statsCall() { calls_++; }
-    void statsVisitNode() { nodes_++; }
+    void statsCall(size_t n = 1) { calls_ += n; }
+    void statsVisitNode() {
+        if (enabled_) {
+            nodes_++;
+        }
+    }
     void statsDepth(size_t d) {
         if (d > depth_) {
             depth_ = d;
         }
     }
 
-    void statsNewCandidateOK() { newCandidateOK_++; }
-    void statsNewCandidateMiss() { newCandidateMiss_++; }
-    void statsCrossOver() { crossOvers_++; }
+    void statsNewCandidateOK() {
+        if (enabled_) {
+            newCandidateOK_++;
+        }
+    }
+    void statsNewCandidateMiss() {
+        if (enabled_) {
+            newCandidateMiss_++;
+        }
+    }
+    void statsCrossOver() {
+        if (enabled_) {
+            crossOvers_++;
+        }
+    }
+
+    /// Stop (or resume) counting visits, e.g. while queries run on several threads
+    void statsEnable(bool enabled) { enabled_ = enabled; }
+    bool statsEnabled() const { return enabled_; }
     void statsReset() { crossOvers_ = calls_ = newCandidateOK_ = newCandidateMiss_ = nodes_ = 0; }
 
     void print(std::ostream& s) const {
@@ -80,6 +101,8 @@ struct StatCollector {
     size_t newCandidateOK_;
     size_t crossOvers_;
 
+    bool enabled_;
+
 
     // -- Friends
 
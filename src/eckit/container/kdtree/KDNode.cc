@@ -19,9 +19,13 @@
 #include <algorithm>
 #include <cstdio>
 #include <limits>
+#include <vector>
 
 #include "KDNode.h"
 
+#include "eckit/exception/Exceptions.h"
+#include "eckit/thread/TaskScheduler.h"
+
 namespace eckit {
 
 
@@ -158,6 +162,120 @@ KDNode<Traits>* KDNode<Traits>::build(Alloc& a, const ITER& begin, const ITER& e
 }
 
 
+template <class Traits>
+void KDNode<Traits>::subtrees(size_t begin, size_t end, size_t depth, std::vector<std::pair<size_t, size_t> >& result) {
+    if (begin == end) {
+        return;
+    }
+
+    if (depth == 0) {
+        result.emplace_back(begin, end);
+        return;
+    }
+
+    size_t median = begin + (end - begin) / 2;
+    subtrees(begin, median, depth - 1, result);
+    subtrees(median + 1, end, depth - 1, result);
+}
+
+
+template <class Traits>
+void KDNode<Traits>::layout(size_t begin, size_t end, size_t levels, std::vector<size_t>& slots, size_t& next) {
+    if (begin == end) {
+        return;
+    }
+
+    if (levels == 1) {
+        slots[begin + (end - begin) / 2] = next++;
+        return;
+    }
+
+    // the top half of the levels, then each subtree below it, recursively
+    size_t top = levels / 2;
+    layout(begin, end, top, slots, next);
+
+    std::vector<std::pair<size_t, size_t> > bottom;
+    subtrees(begin, end, top, bottom);
+    for (const auto& b : bottom) {
+        layout(b.first, b.second, levels - top, slots, next);
+    }
+}
+
+
+template <class Traits>
+template <typename ITER>
+void KDNode<Traits>::build(Alloc& a, const ITER& first, size_t begin, size_t end, int depth, Node* nodes,
+                           const std::vector<size_t>& slots, TaskGroup& group) {
+    // below this size, subtrees are built by the task that reaches them
+    const size_t grain = 16 * 1024;
+
+    size_t k    = Point::DIMS;
+    size_t axis = depth % k;
+
+    size_t median = begin + (end - begin) / 2;
+
+    std::nth_element(first + begin, first + median, first + end, sorter<Value>(axis));
+
+    Node* n = new (&nodes[slots[median]]) Node(*(first + median), axis);
+
+    for (const auto& child : {std::make_pair(begin, median), std::make_pair(median + 1, end)}) {
+        if (child.first == child.second) {
+            continue;
+        }
+
+        Node* c = &nodes[slots[child.first + (child.second - child.first) / 2]];
+        if (child.first == begin) {
+            n->left(a, c);
+        }
+        else {
+            n->right(a, c);
+        }
+
+        if (child.second - child.first > grain) {
+            group.run([&a, &first, child, depth, nodes, &slots, &group] {
+                build(a, first, child.first, child.second, depth + 1, nodes, slots, group);
+            });
+        }
+        else {
+            build(a, first, child.first, child.second, depth + 1, nodes, slots, group);
+        }
+    }
+}
+
+
+template <class Traits>
+template <typename ITER>
+KDNode<Traits>* KDNode<Traits>::build(Alloc& a, const ITER& begin, const ITER& end, TaskScheduler& scheduler) {
+    if (end == begin)
+        return 0;
+
+    const size_t size = end - begin;
+
+    size_t levels = 0;
+    for (size_t n = size; n > 0; n >>= 1) {
+        levels++;
+    }
+
+    a.statsDepth(levels - 1);
+
+    // storage first, so that a read-only allocator fails before the points are reordered
+    Node* nodes = a.newNodes(size, (Node*)0);
+
+    // The shape of the tree (median splits) only depends on the number of points, so does the layout:
+    // slot of the node of each subtree, indexed by the position of its median
+    std::vector<size_t> slots(size);
+    size_t next = 0;
+    layout(0, size, levels, slots, next);
+    ASSERT(next == size);
+
+    TaskGroup group(scheduler);
+    build(a, begin, 0, size, 0, nodes, slots, group);
+    group.wait();
+
+    return &nodes[slots[size / 2]];
+}
+
+
 template <class Traits>
 KDNode<Traits>* KDNode<Traits>::insert(Alloc& a, const Value& value, KDNode<Traits>* node, int depth) {
 
@@ -11,10 +11,15 @@
 #ifndef KDNode_H
 #define KDNode_H
 
+#include <utility>
+#include <vector>
+
 #include "eckit/container/sptree/SPNode.h"
 
 namespace eckit {
 
+class TaskGroup;
+class TaskScheduler;
 
 template <class Traits>
 class KDNode : public SPNode<Traits, KDNode<Traits> > {
@@ -42,11 +47,28 @@ public:
     template <typename ITER>
     static KDNode* build(Alloc& a, const ITER& begin, const ITER& end, int depth = 0);
 
+    /// Build the same tree as above, with subtrees built in parallel, and the nodes allocated in one block in van Emde
+    /// Boas order (each subtree of a few levels is contiguous, so that a query descending the tree touches few pages
+    /// and cache lines, whatever the size of the tree)
+    template <typename ITER>
+    static KDNode* build(Alloc& a, const ITER& begin, const ITER& end, TaskScheduler&);
+
     static KDNode<Traits>* insert(Alloc& a, const Value& value, KDNode<Traits>* node, int depth = 0);
 
     /// Return the axis along which this node is split.
     size_t axis() const { return axis_; }
 
+private:
+    template <typename ITER>
+    static void build(Alloc& a, const ITER& first, size_t begin, size_t end, int depth, Node* nodes,
+                      const std::vector<size_t>& slots, TaskGroup&);
+
+    /// Slots of the nodes of the top levels of the subtree of points [begin, end), in van Emde Boas order
+    static void layout(size_t begin, size_t end, size_t levels, std::vector<size_t>& slots, size_t& next);
+
+    /// Subtrees (of points [begin, end)) at a depth below the subtree of points [begin, end)
+    static void subtrees(size_t begin, size_t end, size_t depth, std::vector<std::pair<size_t, size_t> >&);
+
 public:
     void nearestNeighbourX(Alloc& a, const Point& p, Node*& best, double& max, int depth);
     void findInSphereX(Alloc& a, const Point& p, double radius, NodeList& result, int depth);
@@ -0,0 +1,125 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Order of points along a Hilbert curve through their bounding box
+///
+/// Points close along the curve are close in space, so that queries processed in this order visit mostly the same
+/// nodes of a tree one after the other. Coordinates are quantised to 64/DIMS bits per axis (at most 32), and keys are
+/// computed with J. Skilling's transpose algorithm ("Programming the Hilbert curve", AIP Conf. Proc. 707, 2004).
+template <class Point>
+class SPHilbert {
+public:
+    static constexpr size_t DIMS = Point::DIMS;
+    static constexpr size_t BITS = std::max<size_t>(1, std::min<size_t>(32, 64 / DIMS));
+
+    using Key = std::uint64_t;
+
+    /// @returns indices of points [0, n) sorted along the curve
+    static std::vector<size_t> order(const Point* points, size_t n) {
+        std::vector<size_t> result(n);
+        if (n == 0) {
+            return result;
+        }
+
+        std::array<double, DIMS> lo;
+        std::array<double, DIMS> scale;
+        lo.fill(std::numeric_limits<double>::max());
+        scale.fill(-std::numeric_limits<double>::max());  // high bound, until converted
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t d = 0; d < DIMS; ++d) {
+                lo[d]    = std::min(lo[d], points[i].x(d));
+                scale[d] = std::max(scale[d], points[i].x(d));
+            }
+        }
+
+        const double cells = double((std::uint64_t(1) << BITS) - 1);
+        for (size_t d = 0; d < DIMS; ++d) {
+            scale[d] = scale[d] > lo[d] ? cells / (scale[d] - lo[d]) : 0.;
+        }
+
+        std::vector<std::pair<Key, size_t>> keys(n);
+        std::array<std::uint32_t, DIMS> axes;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t d = 0; d < DIMS; ++d) {
+                axes[d] = std::uint32_t(std::min(cells, (points[i].x(d) - lo[d]) * scale[d]));
+            }
+            keys[i] = {key(axes), i};
+        }
+
+        std::sort(keys.begin(), keys.end());
+
+        for (size_t i = 0; i < n; ++i) {
+            result[i] = keys[i].second;
+        }
+        return result;
+    }
+
+    /// Hilbert index of a point of the grid [0, 2^BITS)^DIMS (the most significant 64 bits, for DIMS > 64)
+    static Key key(std::array<std::uint32_t, DIMS> x) {
+        const std::uint32_t M = std::uint32_t(1) << (BITS - 1);
+
+        // inverse undo
+        for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+            const std::uint32_t P = Q - 1;
+            for (size_t i = 0; i < DIMS; ++i) {
+                if (x[i] & Q) {
+                    x[0] ^= P;
+                }
+                else {
+                    const std::uint32_t t = (x[0] ^ x[i]) & P;
+                    x[0] ^= t;
+                    x[i] ^= t;
+                }
+            }
+        }
+
+        // Gray encode
+        for (size_t i = 1; i < DIMS; ++i) {
+            x[i] ^= x[i - 1];
+        }
+        std::uint32_t t = 0;
+        for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+            if (x[DIMS - 1] & Q) {
+                t ^= Q - 1;
+            }
+        }
+        for (size_t i = 0; i < DIMS; ++i) {
+            x[i] ^= t;
+        }
+
+        // interleave the transposed bits, most significant first
+        Key k       = 0;
+        size_t used = 0;
+        for (size_t b = BITS; b-- > 0 && used < 64;) {
+            for (size_t i = 0; i < DIMS && used < 64; ++i, ++used) {
+                k = (k << 1) | ((x[i] >> b) & 1);
+            }
+        }
+        return k;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -35,6 +35,15 @@ SPNodeInfo<Traits, NodeType> SPNode<Traits, NodeType>::nearestNeighbour(Alloc& a
     return NodeInfo(best, a.convert(best), max);
 }
 
+template <class Traits, class NodeType>
+SPNodeInfo<Traits, NodeType> SPNode<Traits, NodeType>::nearestNeighbour(Alloc& a, const Point& p, Node* hint) {
+    // nodes are only replaced by strictly closer ones, so any starting node gives the nearest distance
+    Node* best = hint ? hint : this->asNode();
+    double max = Point::distance(p, best->point());
+    asNode()->nearestNeighbourX(a, p, best, max, 0);
+    return NodeInfo(best, a.convert(best), max);
+}
+
 
 template <class Traits, class NodeType>
 SPNodeInfo<Traits, NodeType> SPNode<Traits, NodeType>::nearestNeighbourBruteForce(Alloc& a, const Point& p) {
@@ -73,6 +82,14 @@ typename SPNode<Traits, NodeType>::NodeList SPNode<Traits, NodeType>::kNearestNe
     return result;
 }
 
+template <class Traits, class NodeType>
+void SPNode<Traits, NodeType>::kNearestNeighbours(Alloc& a, const Point& p, size_t k, NodeQueue& queue,
+                                                  NodeList& result) {
+    result.clear();
+    asNode()->kNearestNeighboursX(a, p, k, queue, 0);
+    queue.fill(result);  // leaves the queue empty
+}
+
 template <class Traits, class NodeType>
 void SPNode<Traits, NodeType>::kNearestNeighboursBruteForceX(Alloc& a, const Point& p, size_t k, NodeQueue& result,
                                                              int depth) {
@@ -129,6 +146,13 @@ typename SPNode<Traits, NodeType>::NodeList SPNode<Traits, NodeType>::findInSphe
     return result;
 }
 
+template <class Traits, class NodeType>
+void SPNode<Traits, NodeType>::findInSphere(Alloc& a, const Point& p, double radius, NodeList& result) {
+    result.clear();
+    asNode()->findInSphereX(a, p, radius, result, 0);
+    std::sort(result.begin(), result.end());
+}
+
 template <class Traits, class NodeType>
 void SPNode<Traits, NodeType>::findInSphereBruteForceX(Alloc& a, const Point& p, double radius, NodeList& result,
                                                        int depth) {
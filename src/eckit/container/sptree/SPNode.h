@@ -57,6 +57,13 @@ public:
     NodeList findInSphere(Alloc& a, const Point& p, double radius);
     NodeList kNearestNeighbours(Alloc& a, const Point& p, size_t k);
 
+    // For batches of queries, reusing the result of a previous query or the caller's containers
+
+    /// Nearest neighbour, with the search bounded from the start by the distance to hint (a node of this tree)
+    NodeInfo nearestNeighbour(Alloc& a, const Point& p, Node* hint);
+    void findInSphere(Alloc& a, const Point& p, double radius, NodeList& result);
+    void kNearestNeighbours(Alloc& a, const Point& p, size_t k, NodeQueue& queue, NodeList& result);
+
     const Point& point() const { return value_.point(); }
     const Payload& payload() const { return value_.payload(); }
     Value& value() { return value_; }
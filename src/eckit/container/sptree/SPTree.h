@@ -11,10 +11,16 @@
 #ifndef SPTree_H
 #define SPTree_H
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "eckit/container/sptree/SPHilbert.h"
 #include "eckit/container/sptree/SPIterator.h"
 #include "eckit/container/sptree/SPMetadata.h"
 #include "eckit/container/sptree/SPNode.h"
 #include "eckit/exception/Exceptions.h"
+#include "eckit/thread/TaskScheduler.h"
 
 namespace eckit {
 
@@ -93,6 +99,105 @@ public:
         return alloc_.convert(root_, (Node*)0)->kNearestNeighbours(alloc_, p, k);
     }
 
+    // Batches of queries
+    //
+    // The points are queried along a Hilbert curve through them, so that consecutive queries visit mostly the same
+    // nodes (for nearest neighbours, the result of the previous query also bounds the search of the next one), and in
+    // parallel over chunks of the curve if a scheduler is given. Results are written in the order of the points, into
+    // the caller's arrays. Visits are not counted in the statistics of parallel batches.
+
+    /// @param payloads, distances n results
+    void nearestNeighbours(const Point* points, size_t n, Payload* payloads, double* distances,
+                           TaskScheduler* scheduler = nullptr) {
+        Node* root = batchRoot(n);
+        batch(SPHilbert<Point>::order(points, n), scheduler, [&](size_t, const size_t* begin, const size_t* end) {
+            Node* hint = nullptr;
+            for (const size_t* i = begin; i != end; ++i) {
+                NodeInfo info = root->nearestNeighbour(alloc_, points[*i], hint);
+                hint          = const_cast<Node*>(info.node_);
+
+                payloads[*i]  = info.payload();
+                distances[*i] = info.distance();
+            }
+        });
+    }
+
+    /// @param payloads, distances n * k results, row-major by point and sorted by distance (if the tree has less than
+    ///        k items, the distances of missing neighbours are infinite and their payloads are left unchanged)
+    void kNearestNeighbours(const Point* points, size_t n, size_t k, Payload* payloads, double* distances,
+                            TaskScheduler* scheduler = nullptr) {
+        Node* root = batchRoot(n);
+        batch(SPHilbert<Point>::order(points, n), scheduler, [&](size_t, const size_t* begin, const size_t* end) {
+            typename Node::NodeQueue queue(k);
+            NodeList result;
+            for (const size_t* i = begin; i != end; ++i) {
+                root->kNearestNeighbours(alloc_, points[*i], k, queue, result);
+
+                size_t j = *i * k;
+                for (const auto& info : result) {
+                    payloads[j]    = info.payload();
+                    distances[j++] = info.distance();
+                }
+                std::fill(distances + j, distances + (*i + 1) * k, std::numeric_limits<double>::infinity());
+            }
+        });
+    }
+
+    /// @param offsets n + 1 offsets, the results of point i are [offsets[i], offsets[i + 1]) of payloads and distances,
+    ///        sorted by distance
+    void findInSphere(const Point* points, size_t n, double radius, std::vector<size_t>& offsets,
+                      std::vector<Payload>& payloads, std::vector<double>& distances,
+                      TaskScheduler* scheduler = nullptr) {
+        Node* root = batchRoot(n);
+
+        // results per chunk, in curve order, then gathered in the order of the points
+        struct Chunk {
+            const size_t* begin = nullptr;  ///< indices of the points of the chunk
+            std::vector<size_t> offsets;
+            std::vector<Payload> payloads;
+            std::vector<double> distances;
+        };
+
+        const std::vector<size_t> order = SPHilbert<Point>::order(points, n);
+
+        std::vector<Chunk> chunks((n + batchGrain - 1) / batchGrain);
+        offsets.assign(n + 1, 0);
+
+        batch(order, scheduler, [&](size_t c, const size_t* begin, const size_t* end) {
+            Chunk& chunk = chunks[c];
+            chunk.begin  = begin;
+            chunk.offsets.reserve(end - begin + 1);
+            chunk.offsets.push_back(0);
+
+            NodeList result;
+            for (const size_t* i = begin; i != end; ++i) {
+                root->findInSphere(alloc_, points[*i], radius, result);
+                for (const auto& info : result) {
+                    chunk.payloads.push_back(info.payload());
+                    chunk.distances.push_back(info.distance());
+                }
+                chunk.offsets.push_back(chunk.payloads.size());
+                offsets[*i + 1] = result.size();
+            }
+        });
+
+        for (size_t i = 0; i < n; ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        payloads.resize(offsets[n]);
+        distances.resize(offsets[n]);
+        for (const auto& chunk : chunks) {
+            for (size_t j = 0; j + 1 < chunk.offsets.size(); ++j) {
+                const size_t i = chunk.begin[j];
+                std::copy(chunk.payloads.begin() + chunk.offsets[j], chunk.payloads.begin() + chunk.offsets[j + 1],
+                          payloads.begin() + offsets[i]);
+                std::copy(chunk.distances.begin() + chunk.offsets[j], chunk.distances.begin() + chunk.offsets[j + 1],
+                          distances.begin() + offsets[i]);
+            }
+        }
+    }
+
     // For testing only...
     NodeInfo nearestNeighbourBruteForce(const Point& p) {
         if (!root_) {
@@ -162,6 +267,49 @@ public:
     bool empty() const { return size() == 0; }
 
     size_t size() const { return alloc_.nbItems(); }
+
+private:
+    /// Queries per task, and per chunk of the Hilbert order
+    static constexpr size_t batchGrain = 1024;
+
+    Node* batchRoot(size_t n) {
+        if (!root_) {
+            root_ = alloc_.root();
+        }
+        ASSERT(root_);
+        alloc_.statsCall(n);
+        return alloc_.convert(root_, (Node*)0);
+    }
+
+    /// Apply f(chunk, begin, end) to the chunks of an order of the points (ranges of indices of points), in parallel
+    /// if a scheduler is given
+    template <class F>
+    void batch(const std::vector<size_t>& order, TaskScheduler* scheduler, F f) {
+        const size_t n      = order.size();
+        const size_t* begin = order.data();
+
+        if (scheduler == nullptr || n <= batchGrain) {
+            for (size_t i = 0; i < n; i += batchGrain) {
+                f(i / batchGrain, begin + i, begin + std::min(n, i + batchGrain));
+            }
+            return;
+        }
+
+        const bool enabled = alloc_.statsEnabled();
+        alloc_.statsEnable(false);
+        try {
+            TaskGroup group(*scheduler);
+            for (size_t i = 0; i < n; i += batchGrain) {
+                group.run([&f, begin, i, n] { f(i / batchGrain, begin + i, begin + std::min(n, i + batchGrain)); });
+            }
+            group.wait();
+        }
+        catch (...) {
+            alloc_.statsEnable(enabled);
+            throw;
+        }
+        alloc_.statsEnable(enabled);
+    }
 };
 
 }  // namespace eckit
@@ -286,7 +286,7 @@ void AIOHandle::openForWrite(const Length&) {
 void AIOHandle::openForAppend(const Length&) {
     used_ = 0;
     SYSCALL2(fd_ = ::open(path_.localPath(), O_WRONLY | O_CREAT | O_APPEND, 0777), path_);
-    SYSCALL2(pos_ = ::lseek(fd_, 0, SEEK_CUR), path_);
+    SYSCALL2(pos_ = ::lseek(fd_, 0, SEEK_END), path_);
 }
 
 long AIOHandle::read(void*, long) {
@@ -8,39 +8,320 @@
  * does it submit to any jurisdiction.
  */
 
-#include <cstring>
+#include <fcntl.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "eckit/config/LibEcKit.h"
+#include "eckit/config/Resource.h"
+#include "eckit/eckit.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/io/BufferedHandle.h"
+#include "eckit/log/Log.h"
 
 namespace eckit {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+namespace {
+
+/// Buffers read one after the other before reading ahead
+constexpr size_t SEQUENTIAL = 2;
+
+size_t defaultReadAhead() {
+    static size_t readAhead = Resource<size_t>("bufferedHandleReadAhead;$ECKIT_BUFFERED_HANDLE_READ_AHEAD", 0);
+    return readAhead;
+}
+
+size_t defaultWriteBehind() {
+    static size_t writeBehind = Resource<size_t>("bufferedHandleWriteBehind;$ECKIT_BUFFERED_HANDLE_WRITE_BEHIND", 0);
+    return writeBehind;
+}
+
+double now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+/// Whether the handle reads a regular file: reads of pipes and sockets cannot be interrupted, so would block
+/// stopping the background thread
+bool regularFile(DataHandle& handle) {
+    OffsetList offsets;
+    LengthList lengths;
+    return handle.zeroCopySource(offsets, lengths) >= 0;
+}
+
+/// Tell the system how the file read by the handle, if any, is going to be read (hints only, errors are ignored)
+void advise(DataHandle& handle, bool sequential, size_t ahead) {
+#if eckit_HAVE_POSIX_FADVISE
+    OffsetList offsets;
+    LengthList lengths;
+    const int fd = handle.zeroCopySource(offsets, lengths);
+    if (fd < 0) {
+        return;
+    }
+
+    ::posix_fadvise(fd, 0, 0, sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_NORMAL);
+
+    if (sequential && !offsets.empty()) {
+        const long long length = std::min<long long>(lengths.front(), (long long)ahead);
+        ::posix_fadvise(fd, off_t((long long)offsets.front()), off_t(length), POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Thread reading buffers ahead of the reader, or writing the buffers handed over by the writer
+class BufferedHandle::Background {
+public:
+    Background(DataHandle& handle, size_t buffers, size_t size, bool read) :
+        handle_(handle), buffers_(buffers), size_(size), allocated_(0), busy_(false), stop_(false), eof_(false) {
+        thread_ = std::thread([this, read] { read ? readLoop() : writeLoop(); });
+    }
+
+    ~Background() { stop(); }
+
+    /// Swap the buffer with the next buffer read, returning its length, 0 at the end of the handle
+    long next(Buffer& buffer) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !queue_.empty() || eof_ || error_; });
+
+        if (queue_.empty()) {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return 0;
+        }
+
+        Chunk chunk = std::move(queue_.front());
+        queue_.pop_front();
+        std::swap(buffer, chunk.buffer_);
+        free_.push_back(std::move(chunk.buffer_));
+        cond_.notify_all();
+        return chunk.length_;
+    }
+
+    /// Hand over the buffer to be written, replacing it with a free one
+    void push(Buffer& buffer, size_t length) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !free_.empty() || allocated_ < buffers_ || error_; });
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        Buffer next;
+        if (free_.empty()) {
+            next = Buffer(size_);
+            allocated_++;
+        }
+        else {
+            next = std::move(free_.back());
+            free_.pop_back();
+        }
+
+        queue_.push_back({std::move(buffer), long(length)});
+        buffer = std::move(next);
+        cond_.notify_all();
+    }
+
+    /// Wait for the buffers handed over to be written
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return (queue_.empty() && !busy_) || error_; });
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:  // types
+    struct Chunk {
+        Buffer buffer_;
+        long length_;
+    };
+
+private:  // methods
+    void readLoop() {
+        for (;;) {
+            Buffer buffer;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stop_ || queue_.size() < buffers_; });
+                if (stop_) {
+                    return;
+                }
+                if (free_.empty()) {
+                    buffer = Buffer(size_);
+                }
+                else {
+                    buffer = std::move(free_.back());
+                    free_.pop_back();
+                }
+            }
+
+            long length = 0;
+            try {
+                length = handle_.read(buffer, long(size_));
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = std::current_exception();
+                cond_.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (length <= 0) {
+                eof_ = true;
+                cond_.notify_all();
+                return;
+            }
+            queue_.push_back({std::move(buffer), length});
+            cond_.notify_all();
+        }
+    }
+
+    void writeLoop() {
+        for (;;) {
+            Chunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                if (stop_) {
+                    return;
+                }
+                chunk = std::move(queue_.front());
+                queue_.pop_front();
+                busy_ = true;
+            }
+
+            try {
+                long written = handle_.write(chunk.buffer_, chunk.length_);
+                ASSERT(written == chunk.length_);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = std::current_exception();
+                busy_  = false;
+                cond_.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(std::move(chunk.buffer_));
+            busy_ = false;
+            cond_.notify_all();
+        }
+    }
+
+private:  // members
+    DataHandle& handle_;
+    size_t buffers_;
+    size_t size_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+    std::deque<Chunk> queue_;  ///< buffers read, or to write
+    std::vector<Buffer> free_;
+    size_t allocated_;  ///< buffers handed over to the writer, in addition to its own
+    bool busy_;         ///< writing a buffer
+    bool stop_;
+    bool eof_;
+    std::exception_ptr error_;
+
+    std::thread thread_;  // must be last
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void BufferedHandleStatistics::print(std::ostream& s) const {
+    s << "BufferedHandleStatistics[reads=" << reads_ << ",readAhead=" << readAhead_ << ",writes=" << writes_
+      << ",writeBehind=" << writeBehind_ << ",readStall=" << readStall_ << ",writeStall=" << writeStall_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 BufferedHandle::BufferedHandle(DataHandle* h, size_t size, bool opened) :
-    HandleHolder(h), buffer_(size), pos_(0), size_(size), used_(0), eof_(false), read_(false), position_(0), opened_(opened) {}
+    HandleHolder(h),
+    buffer_(size),
+    pos_(0),
+    size_(size),
+    used_(0),
+    eof_(false),
+    read_(false),
+    position_(0),
+    opened_(opened),
+    readAhead_(defaultReadAhead()),
+    writeBehind_(defaultWriteBehind()),
+    sequential_(0),
+    regular_(false) {}
 
 BufferedHandle::BufferedHandle(DataHandle& h, size_t size, bool opened) :
-    HandleHolder(h), buffer_(size), pos_(0), size_(size), used_(0), eof_(false), read_(false), position_(0), opened_(opened) {}
+    HandleHolder(h),
+    buffer_(size),
+    pos_(0),
+    size_(size),
+    used_(0),
+    eof_(false),
+    read_(false),
+    position_(0),
+    opened_(opened),
+    readAhead_(defaultReadAhead()),
+    writeBehind_(defaultWriteBehind()),
+    sequential_(0),
+    regular_(false) {}
 
 BufferedHandle::~BufferedHandle() {}
 
 Length BufferedHandle::openForRead() {
-    read_ = true;
-    used_ = pos_ = 0;
-    eof_         = false;
-    position_    = 0;
-    if (opened_) {
-        return handle().estimate();
-    }
-    return handle().openForRead();
+    stopBackground();
+    read_       = true;
+    used_       = pos_ = 0;
+    eof_        = false;
+    position_   = 0;
+    sequential_ = 0;
+    statistics_ = BufferedHandleStatistics();
+    estimate_   = opened_ ? handle().estimate() : handle().openForRead();
+    regular_    = readAhead_ > 0 && regularFile(handle());
+    return estimate_;
 }
 
 void BufferedHandle::openForWrite(const Length& length) {
-    read_     = false;
-    pos_      = 0;
-    position_ = 0;
+    stopBackground();
+    read_       = false;
+    pos_        = 0;
+    position_   = 0;
+    statistics_ = BufferedHandleStatistics();
     handle().openForWrite(length);
+
+    if (writeBehind_ > 0) {
+        background_.reset(new Background(handle(), writeBehind_, size_, false));
+    }
 }
 
 void BufferedHandle::openForAppend(const Length&) {
@@ -58,9 +339,79 @@ void BufferedHandle::skip(const Length& len) {
         return;
     }
 
+    // Within the buffers read ahead: cheaper to drop them than to seek and start reading ahead again
+    if (background_ && n - left <= readAhead_ * size_) {
+        position_ += left;
+        n -= left;
+        pos_ = used_;
+        while (n > 0 && !eof_) {
+            bufferFill();
+            if (used_ == 0) {
+                eof_ = true;
+                break;
+            }
+            pos_ = size_t(std::min<unsigned long long>(n, used_));
+            position_ += pos_;
+            n -= pos_;
+        }
+        return;
+    }
+
     seek(position() + len);
 }
 
+void BufferedHandle::bufferFill() {
+    const double start = now();
+
+    if (!background_ && regular_ && sequential_ >= SEQUENTIAL) {
+        startReadAhead();
+    }
+
+    long len = 0;
+    if (background_) {
+        len = background_->next(buffer_);
+        if (len > 0) {
+            statistics_.readAhead_++;
+        }
+    }
+    else {
+        len = handle().read(buffer_, size_);
+    }
+
+    used_ = len > 0 ? size_t(len) : 0;
+    pos_  = 0;
+    sequential_++;
+
+    if (used_ > 0) {
+        statistics_.reads_++;
+    }
+    statistics_.readStall_ += now() - start;
+}
+
+void BufferedHandle::startReadAhead() {
+    advise(handle(), true, readAhead_ * size_);
+    background_.reset(new Background(handle(), readAhead_, size_, true));
+}
+
+void BufferedHandle::stopBackground() {
+    if (background_) {
+        // buffers queued for the write behind thread have been reported as written
+        if (!read_) {
+            try {
+                background_->drain();
+            }
+            catch (...) {
+                background_.reset();
+                throw;
+            }
+        }
+        background_.reset();
+        if (read_) {
+            advise(handle(), false, 0);
+        }
+    }
+}
+
 long BufferedHandle::read(void* buffer, long length) {
     long len  = 0;
     long size = length;
@@ -78,8 +429,7 @@ long BufferedHandle::read(void* buffer, long length) {
 
         if (left == 0 && !eof_) {
             // read() is supposed to return a non-negative number
-            used_ = handle().read(buffer_, size_);
-            pos_  = 0;
+            bufferFill();
             if (used_ <= 0) {
                 eof_ = true;
                 if (len > 0) {
@@ -140,26 +490,46 @@ long BufferedHandle::write(const void* buffer, long length) {
 void BufferedHandle::close() {
     if (!read_) {
         bufferFlush();
+        if (background_) {
+            const double start = now();
+            background_->drain();
+            statistics_.writeStall_ += now() - start;
+        }
     }
+
+    if (readAhead_ > 0 || writeBehind_ > 0) {
+        Log::debug<LibEcKit>() << *this << ": " << statistics_ << std::endl;
+    }
+
+    stopBackground();
     handle().close();
 }
 
 void BufferedHandle::flush() {
     bufferFlush();
+    if (background_ && !read_) {
+        const double start = now();
+        background_->drain();
+        statistics_.writeStall_ += now() - start;
+    }
     handle().flush();
 }
 
 void BufferedHandle::rewind() {
-    position_ = 0;
-    used_ = pos_ = 0;
-    eof_         = false;
+    stopBackground();
+    position_   = 0;
+    used_       = pos_ = 0;
+    eof_        = false;
+    sequential_ = 0;
     handle().rewind();
 }
 
 Offset BufferedHandle::seek(const Offset& off) {
-    used_ = pos_ = 0;
-    eof_         = false;
-    position_    = handle().seek(off);
+    stopBackground();
+    used_       = pos_ = 0;
+    eof_        = false;
+    sequential_ = 0;
+    position_   = handle().seek(off);
     return position_;
 }
 
@@ -171,6 +541,10 @@ void BufferedHandle::print(std::ostream& s) const {
 }
 
 Length BufferedHandle::estimate() {
+    // the handle may be being read by the background thread
+    if (read_ && background_) {
+        return estimate_;
+    }
     return handle().estimate();
 }
 
@@ -181,8 +555,17 @@ Offset BufferedHandle::position() {
 
 void BufferedHandle::bufferFlush() {
     if (pos_) {
-        long len = handle().write(buffer_, pos_);
-        ASSERT((size_t)len == pos_);
+        const double start = now();
+        if (background_) {
+            background_->push(buffer_, pos_);
+            statistics_.writeBehind_++;
+        }
+        else {
+            long len = handle().write(buffer_, pos_);
+            ASSERT((size_t)len == pos_);
+        }
+        statistics_.writes_++;
+        statistics_.writeStall_ += now() - start;
         pos_ = 0;
     }
 }
@@ -196,7 +579,10 @@ void BufferedHandle::collectMetrics(const std::string& what) const {
 }
 
 DataHandle* BufferedHandle::clone() const {
-    return new BufferedHandle(handle().clone(), buffer_.size());
+    BufferedHandle* h = new BufferedHandle(handle().clone(), buffer_.size());
+    h->readAhead(readAhead_);
+    h->writeBehind(writeBehind_);
+    return h;
 }
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -14,6 +14,9 @@
 #ifndef eckit_filesystem_BufferedHandle_h
 #define eckit_filesystem_BufferedHandle_h
 
+#include <iosfwd>
+#include <memory>
+
 #include "eckit/io/Buffer.h"
 #include "eckit/io/HandleHolder.h"
 
@@ -23,6 +26,32 @@ namespace eckit {
 
 //-----------------------------------------------------------------------------
 
+struct BufferedHandleStatistics {
+    size_t reads_       = 0;  ///< buffers read from the handle
+    size_t readAhead_   = 0;  ///< of which by the background thread
+    size_t writes_      = 0;  ///< buffers written to the handle
+    size_t writeBehind_ = 0;  ///< of which by the background thread
+    double readStall_   = 0;  ///< time spent by read() waiting for the handle
+    double writeStall_  = 0;  ///< time spent by write(), flush() and close() waiting for the handle
+
+    void print(std::ostream&) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const BufferedHandleStatistics& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//-----------------------------------------------------------------------------
+
+/// Buffers the reads and writes of a handle
+///
+/// With read-ahead, once the buffers are read sequentially, a background thread reads up to that many buffers ahead
+/// of the reader; seeking stops it until the reads are sequential again. Only handles reading a regular file (see
+/// DataHandle::zeroCopySource()) are read ahead, as a read of a pipe or socket could not be interrupted. With
+/// write-behind, full buffers are handed to a background thread writing them, while the writer fills the next ones.
+/// Both are off by default (see the bufferedHandleReadAhead and bufferedHandleWriteBehind resources). The time the
+/// caller waits for the handle is reported in statistics().
 class BufferedHandle : public DataHandle, public HandleHolder {
 public:
     /// Contructor, taking ownership
@@ -37,6 +66,19 @@ public:
 
     ~BufferedHandle() override;
 
+    // -- Methods
+
+    /// Number of buffers read ahead by a background thread, 0 to read synchronously. To set before opening
+    /// @note the wrapped handle is then read from the background thread: it must not be used meanwhile by other
+    ///       threads, nor share state with other handles that are (e.g. the thread-local pool of a PooledHandle)
+    void readAhead(size_t buffers) { readAhead_ = buffers; }
+
+    /// Number of buffers written behind by a background thread, 0 to write synchronously. To set before opening
+    /// @note as with readAhead(), the wrapped handle is then written from the background thread
+    void writeBehind(size_t buffers) { writeBehind_ = buffers; }
+
+    const BufferedHandleStatistics& statistics() const { return statistics_; }
+
     // From DataHandle
 
     Length openForRead() override;
@@ -60,8 +102,15 @@ public:
 
     DataHandle* clone() const override;
 
+private:  // types
+    class Background;
+
 private:  // methods
     void bufferFlush();
+    void bufferFill();
+
+    void startReadAhead();
+    void stopBackground();
 
 private:  // members
     Buffer buffer_;
@@ -73,6 +122,14 @@ private:  // members
     Offset position_;
     bool opened_;
 
+    size_t readAhead_;
+    size_t writeBehind_;
+    size_t sequential_;  ///< buffers read since opening or seeking
+    Length estimate_;
+    bool regular_;  ///< reading a regular file, that can be read ahead
+    std::unique_ptr<Background> background_;
+    BufferedHandleStatistics statistics_;
+
     std::string title() const override;
     void collectMetrics(const std::string& what) const override;
 };
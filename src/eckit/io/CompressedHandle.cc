@@ -0,0 +1,495 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/io/CompressedHandle.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/thread/TaskScheduler.h"
+#include "eckit/utils/Compressor.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr char MAGIC[]        = "ECKITCZ1";
+constexpr size_t MAGIC_SIZE   = 8;
+constexpr size_t HEADER_SIZE  = MAGIC_SIZE + 2 * 8;
+constexpr size_t FRAME_SIZE   = 2 * 8;
+constexpr size_t ENTRY_SIZE   = 3 * 8;
+constexpr size_t TRAILER_SIZE = 2 * 8 + MAGIC_SIZE;
+
+void put(char*& p, unsigned long long value) {
+    for (int i = 7; i >= 0; --i) {
+        *p++ = char((value >> (8 * i)) & 0xff);
+    }
+}
+
+unsigned long long get(const char*& p) {
+    unsigned long long value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | static_cast<unsigned char>(*p++);
+    }
+    return value;
+}
+
+/// (Un)compresses the blocks of a batch in parallel, with a pool shared by all the handles
+TaskScheduler* compressionScheduler() {
+    static const long threads = Resource<long>("compressionThreads;$ECKIT_COMPRESSION_THREADS", 4);
+    if (threads <= 1) {
+        return nullptr;
+    }
+    static TaskScheduler scheduler("compression", size_t(threads));
+    return &scheduler;
+}
+
+size_t batchSize() {
+    TaskScheduler* scheduler = compressionScheduler();
+    return scheduler ? scheduler->size() : 1;
+}
+
+template <typename F>
+void forEach(size_t count, F f) {
+    TaskScheduler* scheduler = count > 1 ? compressionScheduler() : nullptr;
+    if (!scheduler) {
+        for (size_t i = 0; i < count; ++i) {
+            f(i);
+        }
+        return;
+    }
+
+    TaskGroup group(*scheduler);
+    for (size_t i = 0; i < count; ++i) {
+        group.run([&f, i] { f(i); });
+    }
+    group.wait();
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CompressedHandle::CompressedHandle(DataHandle* h, const std::string& compression, size_t blockSize) :
+    HandleHolder(h),
+    compression_(compression.empty() ? CompressorFactory::instance().defaultCompression() : compression),
+    blockSize_(blockSize),
+    count_(0),
+    current_(0),
+    pos_(0),
+    first_(0),
+    offset_(0),
+    size_(0),
+    position_(0),
+    read_(false),
+    eof_(false),
+    indexed_(false) {
+    ASSERT(blockSize_ > 0);
+}
+
+CompressedHandle::CompressedHandle(DataHandle& h, const std::string& compression, size_t blockSize) :
+    HandleHolder(h),
+    compression_(compression.empty() ? CompressorFactory::instance().defaultCompression() : compression),
+    blockSize_(blockSize),
+    count_(0),
+    current_(0),
+    pos_(0),
+    first_(0),
+    offset_(0),
+    size_(0),
+    position_(0),
+    read_(false),
+    eof_(false),
+    indexed_(false) {
+    ASSERT(blockSize_ > 0);
+}
+
+CompressedHandle::~CompressedHandle() {}
+
+Length CompressedHandle::openForRead() {
+    read_ = true;
+
+    const Length estimate = handle().openForRead();
+
+    char header[HEADER_SIZE];
+    offset_ = 0;
+    readFully(header, HEADER_SIZE);
+
+    if (::memcmp(header, MAGIC, MAGIC_SIZE) != 0) {
+        throw ReadError(title() + ": not a compressed stream", Here());
+    }
+
+    const char* p = header + MAGIC_SIZE;
+    blockSize_    = size_t(get(p));
+
+    std::string name(size_t(get(p)), '\0');
+    readFully(&name[0], name.size());
+
+    compression_ = name;
+    compressor_.reset(CompressorFactory::instance().build(compression_));
+
+    blocks_.resize(batchSize());
+    count_    = current_ = pos_ = first_ = 0;
+    size_     = 0;
+    position_ = 0;
+    eof_      = false;
+
+    index_.clear();
+    indexed_ = canSeek() && readIndex(estimate);
+
+    return indexed_ ? Length(size_) : Length(0);
+}
+
+void CompressedHandle::openForWrite(const Length& length) {
+    read_    = false;
+    indexed_ = false;
+
+    compressor_.reset(CompressorFactory::instance().build(compression_));
+
+    blocks_.resize(batchSize());
+    count_    = current_ = pos_ = first_ = 0;
+    offset_   = 0;
+    size_     = 0;
+    position_ = 0;
+
+    index_.clear();
+
+    handle().openForWrite(length);
+
+    Buffer header(HEADER_SIZE + compression_.size());
+    char* p = header;
+    ::memcpy(p, MAGIC, MAGIC_SIZE);
+    p += MAGIC_SIZE;
+    put(p, blockSize_);
+    put(p, compression_.size());
+    ::memcpy(p, compression_.c_str(), compression_.size());
+
+    writeFully(header, header.size());
+}
+
+void CompressedHandle::openForAppend(const Length&) {
+    NOTIMP;
+}
+
+long CompressedHandle::read(void* buffer, long length) {
+    ASSERT(read_);
+    return consume(static_cast<char*>(buffer), length);
+}
+
+long CompressedHandle::consume(char* buffer, unsigned long long length) {
+    unsigned long long done = 0;
+
+    while (done < length) {
+        if (current_ == count_) {
+            if (eof_) {
+                break;
+            }
+            readBlocks();
+            if (count_ == 0) {
+                break;
+            }
+        }
+
+        const Block& b = blocks_[current_];
+        const size_t n = size_t(std::min<unsigned long long>(b.length_ - pos_, length - done));
+        if (buffer) {
+            ::memcpy(buffer + done, static_cast<const char*>(b.data_) + pos_, n);
+        }
+        done += n;
+        pos_ += n;
+
+        if (pos_ == b.length_) {
+            current_++;
+            pos_ = 0;
+        }
+    }
+
+    position_ += Length(done);
+    return long(done);
+}
+
+long CompressedHandle::write(const void* buffer, long length) {
+    ASSERT(!read_);
+    ASSERT(compressor_);
+
+    const char* p = static_cast<const char*>(buffer);
+    long written  = 0;
+
+    while (written < length) {
+        if (count_ == 0 || blocks_[count_ - 1].length_ == blockSize_) {
+            if (count_ == blocks_.size()) {
+                writeBlocks();
+            }
+            Block& b = blocks_[count_++];
+            if (b.data_.size() < blockSize_) {
+                b.data_.resize(blockSize_);
+            }
+            b.length_ = 0;
+        }
+
+        Block& b       = blocks_[count_ - 1];
+        const size_t n = std::min(blockSize_ - b.length_, size_t(length - written));
+        ::memcpy(static_cast<char*>(b.data_) + b.length_, p + written, n);
+        b.length_ += n;
+        written += long(n);
+    }
+
+    position_ += written;
+    return written;
+}
+
+void CompressedHandle::writeBlocks() {
+    forEach(count_, [this](size_t i) {
+        Block& b            = blocks_[i];
+        b.compressedLength_ = compressor_->compress(b.data_, b.length_, b.compressed_);
+    });
+
+    for (size_t i = 0; i < count_; ++i) {
+        const Block& b = blocks_[i];
+
+        index_.push_back({offset_, size_, b.length_, b.compressedLength_});
+        size_ += b.length_;
+
+        char frame[FRAME_SIZE];
+        char* p = frame;
+        put(p, b.length_);
+        put(p, b.compressedLength_);
+
+        writeFully(frame, FRAME_SIZE);
+        writeFully(b.compressed_, b.compressedLength_);
+    }
+
+    count_ = 0;
+}
+
+void CompressedHandle::writeFully(const void* buffer, size_t length) {
+    if (handle().write(buffer, long(length)) != long(length)) {
+        throw WriteError(title(), Here());
+    }
+    offset_ += length;
+}
+
+void CompressedHandle::readFully(void* buffer, size_t length) {
+    char* p     = static_cast<char*>(buffer);
+    size_t done = 0;
+    while (done < length) {
+        long n = handle().read(p + done, long(length - done));
+        if (n <= 0) {
+            throw ShortFile(title(), Here());
+        }
+        done += size_t(n);
+    }
+    offset_ += length;
+}
+
+bool CompressedHandle::readIndex(const Length& estimate) {
+    const unsigned long long start = offset_;
+    const unsigned long long end   = (long long)estimate;
+
+    if (end < start + FRAME_SIZE + TRAILER_SIZE) {
+        return false;
+    }
+
+    char trailer[TRAILER_SIZE];
+    handle().seek(end - TRAILER_SIZE);
+    readFully(trailer, TRAILER_SIZE);
+
+    const char* p                        = trailer;
+    const unsigned long long indexOffset = get(p);
+    const unsigned long long count       = get(p);
+
+    // not the end of a complete stream, e.g. still being written: read sequentially
+    if (::memcmp(p, MAGIC, MAGIC_SIZE) != 0 || indexOffset + count * ENTRY_SIZE + TRAILER_SIZE != end) {
+        handle().seek(start);
+        offset_ = start;
+        return false;
+    }
+
+    Buffer index(count * ENTRY_SIZE);
+    handle().seek(indexOffset);
+    readFully(index, index.size());
+
+    p = index;
+    for (unsigned long long i = 0; i < count; ++i) {
+        const unsigned long long offset = get(p);
+        const size_t length             = size_t(get(p));
+        const size_t compressedLength   = size_t(get(p));
+        index_.push_back({offset, size_, length, compressedLength});
+        size_ += length;
+    }
+
+    handle().seek(start);
+    offset_ = start;
+    return true;
+}
+
+void CompressedHandle::readBlocks() {
+    first_ += count_;
+    count_ = current_ = pos_ = 0;
+
+    while (count_ < blocks_.size() && !eof_) {
+        char frame[FRAME_SIZE];
+        readFully(frame, FRAME_SIZE);
+
+        const char* p                 = frame;
+        const size_t length           = size_t(get(p));
+        const size_t compressedLength = size_t(get(p));
+
+        if (length == 0) {
+            eof_ = true;
+            break;
+        }
+
+        Block& b = blocks_[count_++];
+        if (b.compressed_.size() < compressedLength) {
+            b.compressed_.resize(compressedLength);
+        }
+        readFully(b.compressed_, compressedLength);
+
+        b.length_           = length;
+        b.compressedLength_ = compressedLength;
+    }
+
+    forEach(count_, [this](size_t i) {
+        Block& b = blocks_[i];
+        compressor_->uncompress(b.compressed_, b.compressedLength_, b.data_, b.length_);
+    });
+}
+
+void CompressedHandle::close() {
+    if (!read_ && compressor_) {
+        writeBlocks();
+
+        char end[FRAME_SIZE];
+        char* p = end;
+        put(p, 0);
+        put(p, 0);
+        writeFully(end, FRAME_SIZE);
+
+        const unsigned long long indexOffset = offset_;
+
+        Buffer index(index_.size() * ENTRY_SIZE);
+        p = index;
+        for (const auto& e : index_) {
+            put(p, e.offset_);
+            put(p, e.length_);
+            put(p, e.compressedLength_);
+        }
+        writeFully(index, index.size());
+
+        char trailer[TRAILER_SIZE];
+        p = trailer;
+        put(p, indexOffset);
+        put(p, index_.size());
+        ::memcpy(p, MAGIC, MAGIC_SIZE);
+        writeFully(trailer, TRAILER_SIZE);
+    }
+
+    compressor_.reset();
+    handle().close();
+}
+
+void CompressedHandle::flush() {
+    if (!read_ && compressor_) {
+        writeBlocks();
+    }
+    handle().flush();
+}
+
+void CompressedHandle::rewind() {
+    seek(0);
+}
+
+Offset CompressedHandle::seek(const Offset& off) {
+    ASSERT(read_);
+
+    const unsigned long long target = (long long)off;
+
+    if (!indexed_) {
+        if (target < (unsigned long long)(long long)position_) {
+            throw NotImplemented(title() + ": cannot seek backwards in a compressed stream without index", Here());
+        }
+        consume(nullptr, target - (long long)position_);
+        return position_;
+    }
+
+    if (target >= size_) {
+        first_    = index_.size();
+        count_    = current_ = pos_ = 0;
+        eof_      = true;
+        position_ = size_;
+        return position_;
+    }
+
+    auto j = std::upper_bound(index_.begin(), index_.end(), target,
+                              [](unsigned long long t, const IndexEntry& e) { return t < e.start_; });
+    const size_t block = size_t(j - index_.begin()) - 1;
+
+    if (block >= first_ && block < first_ + count_) {
+        current_ = block - first_;
+    }
+    else {
+        offset_ = index_[block].offset_;
+        handle().seek(offset_);
+
+        first_ = block;
+        count_ = 0;
+        eof_   = false;
+        readBlocks();
+        ASSERT(count_ > 0);
+    }
+
+    pos_      = size_t(target - index_[block].start_);
+    position_ = target;
+    return position_;
+}
+
+void CompressedHandle::skip(const Length& len) {
+    ASSERT(read_);
+    if (indexed_) {
+        seek(position_ + len);
+        return;
+    }
+    consume(nullptr, (long long)len);
+}
+
+Length CompressedHandle::estimate() {
+    return read_ && indexed_ ? Length(size_) : Length(0);
+}
+
+Offset CompressedHandle::position() {
+    return position_;
+}
+
+void CompressedHandle::print(std::ostream& s) const {
+    s << "CompressedHandle[compression=" << compression_ << ",blockSize=" << blockSize_ << ",";
+    handle().print(s);
+    s << ']';
+}
+
+std::string CompressedHandle::title() const {
+    return std::string("{") + handle().title() + "}";
+}
+
+void CompressedHandle::collectMetrics(const std::string& what) const {
+    handle().collectMetrics(what);
+}
+
+DataHandle* CompressedHandle::clone() const {
+    return new CompressedHandle(handle().clone(), compression_, blockSize_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
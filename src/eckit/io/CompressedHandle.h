@@ -0,0 +1,139 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_io_CompressedHandle_h
+#define eckit_io_CompressedHandle_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/HandleHolder.h"
+
+namespace eckit {
+
+class Compressor;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Compresses the data written to a handle, and uncompresses the data read from it, with any Compressor
+///
+/// The data is cut into blocks compressed independently of each other, several blocks being (un)compressed in
+/// parallel. The stream starts with the name of the compressor, so that it is read back without knowing it, and ends
+/// with an index of the blocks: if the underlying handle can seek, the handle read can seek too, uncompressing only
+/// the blocks from the new position, and its size is known when opened.
+///
+/// Layout of the stream (integers are 64 bits big-endian):
+///     header : magic, block size, length of the name of the compressor, name
+///     blocks : uncompressed length, compressed length, compressed data
+///     end    : a block of length 0
+///     index  : for each block, its offset in the stream, its uncompressed and compressed lengths
+///     trailer: offset of the index, number of blocks, magic
+class CompressedHandle : public DataHandle, public HandleHolder {
+public:
+    /// Contructor, taking ownership
+    /// @param compression name of the compressor used for writing, the default compressor if empty
+    /// @param blockSize uncompressed size of the blocks written
+    CompressedHandle(DataHandle*, const std::string& compression = "", size_t blockSize = 4 * 1024 * 1024);
+
+    /// Contructor, not taking ownership
+    CompressedHandle(DataHandle&, const std::string& compression = "", size_t blockSize = 4 * 1024 * 1024);
+
+    /// Destructor
+
+    ~CompressedHandle() override;
+
+    // -- Methods
+
+    /// Name of the compressor, read from the stream once opened for reading
+    const std::string& compression() const { return compression_; }
+
+    /// Number of blocks written, or in the index of the stream read
+    size_t blocks() const { return index_.size(); }
+
+    // From DataHandle
+
+    Length openForRead() override;
+    void openForWrite(const Length&) override;
+    void openForAppend(const Length&) override;
+
+    long read(void*, long) override;
+    long write(const void*, long) override;
+    void close() override;
+    void flush() override;
+    void rewind() override;
+    void print(std::ostream&) const override;
+    void skip(const Length&) override;
+
+    Offset seek(const Offset&) override;
+    bool canSeek() const override { return handle().canSeek(); }
+
+    Length estimate() override;
+    Offset position() override;
+
+    DataHandle* clone() const override;
+
+private:  // types
+    struct Block {
+        Buffer data_;  ///< uncompressed
+        size_t length_ = 0;
+        Buffer compressed_;
+        size_t compressedLength_ = 0;
+    };
+
+    struct IndexEntry {
+        unsigned long long offset_;  ///< of the block in the stream
+        unsigned long long start_;   ///< of the uncompressed data of the block
+        size_t length_;
+        size_t compressedLength_;
+    };
+
+private:  // methods
+    void writeBlocks();
+    void writeFully(const void*, size_t);
+
+    bool readIndex(const Length& estimate);
+    void readBlocks();
+    void readFully(void*, size_t);
+
+    /// Copy the data read into the buffer, or skip it if the buffer is null
+    long consume(char*, unsigned long long);
+
+private:  // members
+    std::string compression_;
+    size_t blockSize_;
+    std::unique_ptr<Compressor> compressor_;
+
+    std::vector<Block> blocks_;  ///< batch of blocks (un)compressed together
+    size_t count_;               ///< of blocks in the batch
+    size_t current_;             ///< block of the batch read
+    size_t pos_;                 ///< in the current block
+
+    std::vector<IndexEntry> index_;
+    size_t first_;  ///< index of the first block of the batch read, if indexed_
+
+    unsigned long long offset_;  ///< in the stream, of the next block to write or read
+    unsigned long long size_;    ///< uncompressed, if indexed_
+    Offset position_;
+
+    bool read_;
+    bool eof_;
+    bool indexed_;
+
+    std::string title() const override;
+    void collectMetrics(const std::string& what) const override;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif
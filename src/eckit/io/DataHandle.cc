@@ -21,6 +21,8 @@
 #include "eckit/io/DataHandle.h"
 #include "eckit/io/DblBuffer.h"
 #include "eckit/io/MoverTransfer.h"
+#include "eckit/io/ParallelCopy.h"
+#include "eckit/io/ZeroCopyTransfer.h"
 #include "eckit/log/Bytes.h"
 #include "eckit/log/Progress.h"
 #include "eckit/log/Timer.h"
@@ -88,6 +90,19 @@ Length DataHandle::saveInto(DataHandle& other, TransferWatcher& watcher) {
     }
 
 
+    static const bool parallelCopy = Resource<bool>("parallelCopy;$ECKIT_PARALLEL_COPY", 0);
+
+    if (parallelCopy && doubleBufferOK() && other.doubleBufferOK()) {
+        static const long streams   = Resource<long>("parallelCopyStreams;$ECKIT_PARALLEL_COPY_STREAMS", 4);
+        static const long chunkSize = Resource<long>("parallelCopyChunkSize;$ECKIT_PARALLEL_COPY_CHUNK_SIZE",
+                                                     4 * 1024 * 1024);
+
+        Metrics::set("parallel_copy", true);
+
+        ParallelCopy copy(size_t(streams), size_t(chunkSize), watcher);
+        return copy.copy(*this, other);
+    }
+
     static const bool doubleBuffer = Resource<bool>("doubleBuffer", 0);
 
     if (doubleBuffer && doubleBufferOK() && other.doubleBufferOK()) {
@@ -123,7 +138,16 @@ Length DataHandle::saveInto(DataHandle& other, TransferWatcher& watcher) {
     double writeTime = 0;
     double lastWrite = 0;
     Timer timer("Save into");
-    bool more = true;
+
+    const bool zeroCopy = ZeroCopyTransfer(watcher).transfer(*this, other, 0, total);
+    if (zeroCopy) {
+        length    = 0;
+        readTime  = timer.elapsed();
+        writeTime = readTime;
+        progress(total);
+    }
+
+    bool more = !zeroCopy;
 
     while (more) {
         more = false;
@@ -187,10 +211,21 @@ Length DataHandle::saveInto(DataHandle& other, TransferWatcher& watcher) {
     Metrics::set("read_time", readTime);
     Metrics::set("write_time", writeTime);
     Metrics::set("double_buffering", false);
+    Metrics::set("zero_copy", zeroCopy);
 
     return total;
 }
 
+int DataHandle::zeroCopySource(OffsetList&, LengthList&) {
+    return -1;
+}
+
+int DataHandle::zeroCopyTarget() {
+    return -1;
+}
+
+void DataHandle::zeroCopyWritten(const Length&) {}
+
 Length DataHandle::saveInto(const PathName& path, TransferWatcher& w) {
     std::unique_ptr<DataHandle> file{path.fileHandle()};
     return saveInto(*file, w);
@@ -216,14 +251,19 @@ Length DataHandle::copyTo(DataHandle& other, long bufsize, Length maxsize, Trans
     Length total = 0;
     long length  = -1;
 
-    while ((toRead <= Length(0) || total < toRead) && (length = read(buffer, toRead <= Length(0) ? bufsize : std::min(bufsize, (long)(toRead - total)))) > 0) {
+    if (ZeroCopyTransfer(watcher).transfer(*this, other, toRead, total)) {
+        length = 0;
+    }
+    else {
+        while ((toRead <= Length(0) || total < toRead) && (length = read(buffer, toRead <= Length(0) ? bufsize : std::min(bufsize, (long)(toRead - total)))) > 0) {
 
-        if (other.write((const char*)buffer, length) != length) {
-            throw WriteError(name() + " into " + other.name());
-        }
+            if (other.write((const char*)buffer, length) != length) {
+                throw WriteError(name() + " into " + other.name());
+            }
 
-        watcher.watch(buffer, length);
-        total += length;
+            watcher.watch(buffer, length);
+            total += length;
+        }
     }
 
     if (length < 0) {
@@ -366,6 +406,46 @@ long DataHandle::read(void*, long) {
     throw NotImplemented(os.str(), Here());
 }
 
+void DataHandle::readv(const ReadRanges& ranges) {
+    if (!canSeek()) {
+        std::ostringstream os;
+        os << "DataHandle::readv() [" << *this << "]";
+        throw NotImplemented(os.str(), Here());
+    }
+
+    ReadSpans spans(ranges);
+    Buffer buffer;
+
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const ReadSpans::Span& span = spans[i];
+        const size_t length         = size_t((long long)span.length_);
+
+        char* direct = static_cast<char*>(spans.direct(i));
+        if (!direct && buffer.size() < length) {
+            buffer.resize(length);
+        }
+        char* p = direct ? direct : static_cast<char*>(buffer.data());
+
+        seek(span.offset_);
+
+        size_t done = 0;
+        while (done < length) {
+            long n = read(p + done, long(length - done));
+            if (n <= 0) {
+                std::ostringstream os;
+                os << "DataHandle::readv(): read " << done << " bytes out of " << length << " at offset "
+                   << span.offset_ << " [" << *this << "]";
+                throw ReadError(os.str(), Here());
+            }
+            done += n;
+        }
+
+        if (!direct) {
+            spans.scatter(i, p);
+        }
+    }
+}
+
 long DataHandle::write(const void*, long) {
     std::ostringstream os;
     os << "DataHandle::write() [" << *this << "]";
@@ -21,6 +21,7 @@
 #include "eckit/filesystem/PathName.h"
 #include "eckit/io/Length.h"
 #include "eckit/io/Offset.h"
+#include "eckit/io/ReadRange.h"
 #include "eckit/io/TransferWatcher.h"
 #include "eckit/serialisation/Streamable.h"
 
@@ -72,6 +73,13 @@ public:
     virtual void openForAppend(const Length&);  //< Receive estimated length
 
     virtual long read(void*, long);
+
+    /// Read several ranges of the data, each into its own buffer (scatter read)
+    /// Ranges close to each other are merged and read at once (see ReadSpans), ranges can be in any order and
+    /// overlap. The position of the handle after the call is unspecified. Throws ReadError if a range is past the end.
+    /// The default seeks to each merged range, handles that can do better (e.g. FileHandle) override it
+    virtual void readv(const ReadRanges&);
+
     virtual long write(const void*, long);
     virtual void close();
     virtual void flush();
@@ -89,6 +97,17 @@ public:
 
     virtual DataHandle* clone() const;
 
+    /// Zero-copy transfers (see ZeroCopyTransfer)
+    /// The descriptor of the regular file read by a handle opened for read, and the parts of it left to read (offsets
+    /// in the file and lengths). Returns -1 if the handle does not read a file directly
+    virtual int zeroCopySource(OffsetList&, LengthList&);
+
+    /// The descriptor written by a handle opened for write, -1 if the handle does not write to a descriptor directly
+    virtual int zeroCopyTarget();
+
+    /// Bytes written directly to the descriptor of zeroCopyTarget()
+    virtual void zeroCopyWritten(const Length&);
+
     /// Save into an other datahandle
     virtual Length saveInto(DataHandle&, TransferWatcher& = TransferWatcher::dummy());
 
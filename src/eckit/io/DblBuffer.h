@@ -25,6 +25,8 @@
 namespace eckit {
 
 
+/// Copy with a reader and a writer thread, through a fixed set of buffers
+/// See also ParallelCopy, which also reads seekable sources with several streams
 class DblBuffer : private NonCopyable {
 public:
     // -- Contructors
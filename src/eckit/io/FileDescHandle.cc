@@ -8,10 +8,12 @@
  * does it submit to any jurisdiction.
  */
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "eckit/exception/Exceptions.h"
 #include "eckit/io/FileDescHandle.h"
+#include "eckit/os/Stat.h"
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -75,6 +77,27 @@ void FileDescHandle::skip(const Length& l) {
     SYSCALL(::lseek(fd_, l, SEEK_CUR));
 }
 
+int FileDescHandle::zeroCopySource(OffsetList& offsets, LengthList& lengths) {
+    if (fd_ == -1) {
+        return -1;
+    }
+
+    Stat::Struct info;
+    SYSCALL(Stat::fstat(fd_, &info));
+    if (!S_ISREG(info.st_mode)) {
+        return -1;
+    }
+
+    off_t pos;
+    SYSCALL(pos = ::lseek(fd_, 0, SEEK_CUR));
+    if (info.st_size > pos) {
+        offsets.push_back(pos);
+        lengths.push_back(info.st_size - pos);
+    }
+
+    return fd_;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit
@@ -50,6 +50,9 @@ public:
     bool canSeek() const override { return true; }
     void skip(const Length&) override;
 
+    int zeroCopySource(OffsetList&, LengthList&) override;
+    int zeroCopyTarget() override { return fd_; }
+
     // From Streamable
 
     void encode(Stream&) const override;
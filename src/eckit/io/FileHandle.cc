@@ -10,6 +10,10 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <sstream>
 
 #include "eckit/eckit.h"
 
@@ -21,6 +25,7 @@
 #include "eckit/log/Bytes.h"
 #include "eckit/log/Log.h"
 #include "eckit/os/Stat.h"
+#include "eckit/thread/TaskScheduler.h"
 #include "eckit/utils/MD5.h"
 
 
@@ -109,6 +114,74 @@ long FileHandle::read(void* buffer, long length) {
     return ::fread(buffer, 1, length, file_);
 }
 
+namespace {
+
+/// Reads the merged ranges of readv() in parallel, with a pool shared by all the handles
+TaskScheduler* readvScheduler() {
+    static const long threads = Resource<long>("readvThreads;$ECKIT_READV_THREADS", 4);
+    if (threads <= 1) {
+        return nullptr;
+    }
+    static TaskScheduler scheduler("readv", size_t(threads));
+    return &scheduler;
+}
+
+void pread(int fd, char* buffer, size_t length, off_t offset, const std::string& path) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd, buffer + done, length - done, offset + off_t(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::ostringstream os;
+            os << "FileHandle::readv(): read " << done << " bytes out of " << length << " at offset " << offset
+               << " of " << path;
+            throw ReadError(os.str(), Here());
+        }
+        done += n;
+    }
+}
+
+}  // namespace
+
+void FileHandle::readv(const ReadRanges& ranges) {
+    ASSERT(file_);
+
+    // pread() does not move the position of the stream, nor uses its buffer
+    const int fd = ::fileno(file_);
+
+    ReadSpans spans(ranges);
+
+    auto readSpan = [&spans, fd, this](size_t i) {
+        const ReadSpans::Span& span = spans[i];
+        const size_t length         = size_t((long long)span.length_);
+
+        if (char* direct = static_cast<char*>(spans.direct(i))) {
+            pread(fd, direct, length, off_t((long long)span.offset_), name_);
+            return;
+        }
+
+        Buffer buffer(length);
+        pread(fd, buffer, length, off_t((long long)span.offset_), name_);
+        spans.scatter(i, buffer);
+    };
+
+    TaskScheduler* scheduler = spans.size() > 1 ? readvScheduler() : nullptr;
+    if (!scheduler) {
+        for (size_t i = 0; i < spans.size(); ++i) {
+            readSpan(i);
+        }
+        return;
+    }
+
+    TaskGroup group(*scheduler);
+    for (size_t i = 0; i < spans.size(); ++i) {
+        group.run([&readSpan, i] { readSpan(i); });
+    }
+    group.wait();
+}
+
 long FileHandle::write(const void* buffer, long length) {
     ASSERT(buffer);
 
@@ -297,6 +370,41 @@ std::string FileHandle::metricsTag() const {
 }
 
 
+int FileHandle::zeroCopySource(OffsetList& offsets, LengthList& lengths) {
+    if (!file_ || !read_) {
+        return -1;
+    }
+
+    const int fd = ::fileno(file_);
+
+    Stat::Struct info;
+    SYSCALL(Stat::fstat(fd, &info));
+    if (!S_ISREG(info.st_mode)) {
+        return -1;
+    }
+
+    off_t pos = ::ftello(file_);
+    if (info.st_size > pos) {
+        offsets.push_back(pos);
+        lengths.push_back(info.st_size - pos);
+    }
+
+    return fd;
+}
+
+int FileHandle::zeroCopyTarget() {
+    if (!file_ || read_) {
+        return -1;
+    }
+
+    // the data buffered by the stream goes first
+    if (::fflush(file_)) {
+        throw WriteError(std::string("fflush(") + name_ + ")", Here());
+    }
+
+    return ::fileno(file_);
+}
+
 DataHandle* FileHandle::clone() const {
     return new FileHandle(name_, overwrite_);
 }
@@ -43,6 +43,7 @@ public:
     void openForAppend(const Length&) override;
 
     long read(void*, long) override;
+    void readv(const ReadRanges&) override;
     long write(const void*, long) override;
     void close() override;
     void flush() override;
@@ -67,6 +68,8 @@ public:
     void skip(const Length&) override;
 
     DataHandle* clone() const override;
+    int zeroCopySource(OffsetList&, LengthList&) override;
+    int zeroCopyTarget() override;
     void hash(MD5& md5) const override;
 
     // From Streamable
@@ -0,0 +1,487 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/io/ParallelCopy.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <thread>
+
+#include "eckit/config/LibEcKit.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/os/Stat.h"
+#include "eckit/runtime/Metrics.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Chunks take about that long to read, in seconds
+constexpr double READ_TIME = 0.1;
+
+/// Another stream is added if it increased the throughput by that much
+constexpr double GAIN = 1.1;
+
+double now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool seekable(DataHandle& handle) {
+    try {
+        return handle.canSeek();
+    }
+    catch (NotImplemented&) {
+        return false;
+    }
+}
+
+void pwrite(int fd, const char* buffer, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pwrite(fd, buffer + done, length - done, offset + off_t(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::ostringstream os;
+            os << "ParallelCopy: wrote " << done << " bytes out of " << length << " at offset " << offset;
+            throw WriteError(os.str(), Here());
+        }
+        done += n;
+    }
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ParallelCopyStatistics::print(std::ostream& s) const {
+    s << "ParallelCopyStatistics[bytes=" << bytes_ << ",chunks=" << chunks_ << ",streams=" << streams_
+      << ",chunkSize=" << chunkSize_ << ",parallel=" << parallel_ << ",positional=" << positional_
+      << ",readTime=" << readTime_ << ",writeTime=" << writeTime_ << ",readWait=" << readWait_
+      << ",writeWait=" << writeWait_ << ",time=" << time_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ParallelCopy::ParallelCopy(size_t streams, size_t chunkSize, TransferWatcher& watcher) :
+    maxStreams_(std::max<size_t>(streams, 1)), initialChunkSize_(chunkSize), watcher_(watcher) {
+    ASSERT(initialChunkSize_ > 0);
+}
+
+ParallelCopy::~ParallelCopy() = default;
+
+Length ParallelCopy::copy(DataHandle& in, DataHandle& out) {
+    const double start = now();
+
+    in.compress();
+
+    Length estimate = in.openForRead();
+    AutoClose c1(in);
+    watcher_.fromHandleOpened();
+    out.openForWrite(estimate);
+    AutoClose c2(out);
+    watcher_.toHandleOpened();
+
+    statistics_ = ParallelCopyStatistics();
+
+    Offset from  = 0;
+    Length total = 0;
+
+    bool more = true;
+    while (more) {
+        more = false;
+        try {
+            total = Length((long long)from) + copy(in, out, from, estimate - Length((long long)from));
+        }
+        catch (RestartTransfer& retry) {
+            Log::warning() << "Retrying transfer from " << retry.from() << " (" << Bytes(retry.from()) << ")"
+                           << std::endl;
+            in.restartReadFrom(retry.from());
+            out.restartWriteFrom(retry.from());
+            watcher_.restartFrom(retry.from());
+            from = retry.from();
+            more = true;
+        }
+    }
+
+    if (estimate != Length(0) && total != estimate) {
+        std::ostringstream os;
+        os << "ParallelCopy::copy() copied " << total << " bytes out of " << estimate;
+        throw ReadError(os.str());
+    }
+
+    statistics_.time_ = now() - start;
+
+    Log::info() << "Transfer rate " << Bytes(double(total), statistics_.time_) << ", " << statistics_ << std::endl;
+
+    in.collectMetrics("source");
+    out.collectMetrics("target");
+    Metrics::set("size", total);
+    Metrics::set("time", statistics_.time_);
+    Metrics::set("read_time", statistics_.readTime_);
+    Metrics::set("write_time", statistics_.writeTime_);
+
+    return total;
+}
+
+Length ParallelCopy::copy(DataHandle& in, DataHandle& out, const Offset& from, const Length& estimate) {
+
+    // several streams read a seekable source of known size, each from a clone of the source (see stream())
+    std::vector<std::unique_ptr<DataHandle>> clones;
+    if (maxStreams_ > 1 && estimate > Length(initialChunkSize_) && seekable(in)) {
+        try {
+            for (size_t i = 0; i < maxStreams_; ++i) {
+                clones.emplace_back(in.clone());
+            }
+        }
+        catch (NotImplemented&) {
+            clones.clear();
+        }
+    }
+
+    parallel_   = !clones.empty();
+    positional_ = false;
+    fd_         = -1;
+    base_       = 0;
+
+    // chunks written at their offsets by the streams, if the watcher does not need them in order
+    // (not with O_APPEND, pwrite() would then append them in the order they are read)
+    if (parallel_ && !watcher_.needsData()) {
+        fd_ = out.zeroCopyTarget();
+        Stat::Struct info;
+        if (fd_ >= 0 && Stat::fstat(fd_, &info) == 0 && S_ISREG(info.st_mode)) {
+            int flags = 0;
+            SYSCALL(flags = ::fcntl(fd_, F_GETFL));
+            if (!(flags & O_APPEND)) {
+                positional_ = true;
+                SYSCALL(base_ = ::lseek(fd_, 0, SEEK_CUR));
+            }
+        }
+    }
+
+    from_      = from;
+    size_      = estimate;
+    next_      = from;
+    nextChunk_ = 0;
+    chunkSize_ = initialChunkSize_;
+    chunks_    = 0;
+    eof_       = false;
+
+    active_    = 1;
+    reading_   = 0;
+    read_      = 0;
+    lastAdapt_ = now();
+    lastBytes_ = 0;
+    lastChunk_ = 0;
+    bestRate_  = 0;
+    growing_   = parallel_;
+
+    ready_.clear();
+    written_ = 0;
+    bytes_   = 0;
+    error_   = nullptr;
+
+    statistics_.parallel_   = parallel_;
+    statistics_.positional_ = positional_;
+
+    LOG_DEBUG_LIB(LibEcKit) << "ParallelCopy: " << in << " => " << out << ", parallel=" << parallel_
+                            << ", positional=" << positional_ << std::endl;
+
+    std::vector<std::thread> streams;
+    const size_t count = parallel_ ? maxStreams_ : 1;
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            std::unique_ptr<DataHandle> clone(parallel_ ? clones[i].release() : nullptr);
+            streams.emplace_back(
+                [this, i, &in, clone = std::move(clone)]() mutable { stream(i, in, std::move(clone)); });
+        }
+    }
+    catch (...) {
+        // the streams already started stop on the error
+        fail(std::current_exception());
+        for (auto& t : streams) {
+            t.join();
+        }
+        throw;
+    }
+
+    if (!positional_) {
+        write(out);
+    }
+
+    for (auto& t : streams) {
+        t.join();
+    }
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+    if (positional_) {
+        SYSCALL(::lseek(fd_, base_ + (long long)bytes_, SEEK_SET));
+        out.zeroCopyWritten(bytes_);
+    }
+
+    return bytes_;
+}
+
+void ParallelCopy::stream(size_t index, DataHandle& in, std::unique_ptr<DataHandle> clone) {
+    try {
+        DataHandle& handle = clone ? *clone : in;
+
+        std::unique_ptr<AutoClose> closer;
+        if (clone) {
+            handle.openForRead();
+            closer = std::make_unique<AutoClose>(handle);
+        }
+
+        for (;;) {
+            size_t chunk;
+            Offset offset;
+            size_t size;
+
+            double wait = now();
+            if (!next(index, chunk, offset, size)) {
+                break;
+            }
+
+            Chunk data{allocate(size), 0};
+            wait = now() - wait;
+
+            const double startRead = now();
+
+            if (parallel_) {
+                handle.seek(offset);
+                while (data.length_ < long(size)) {
+                    long n = handle.read(static_cast<char*>(data.buffer_) + data.length_, long(size) - data.length_);
+                    if (n <= 0) {
+                        std::ostringstream os;
+                        os << "ParallelCopy: read " << data.length_ << " bytes out of " << size << " at offset "
+                           << offset << " of " << handle;
+                        throw ReadError(os.str(), Here());
+                    }
+                    data.length_ += n;
+                }
+            }
+            else {
+                data.length_ = handle.read(data.buffer_, long(size));
+                if (data.length_ < 0) {
+                    throw ReadError("ParallelCopy: reading " + handle.name(), Here());
+                }
+            }
+
+            const double readTime   = now() - startRead;
+            const double startWrite = now();
+
+            if (positional_) {
+                pwrite(fd_, static_cast<char*>(data.buffer_), size_t(data.length_), off_t(base_ + ((long long)offset - (long long)from_)));
+            }
+
+            done(chunk, std::move(data), readTime, positional_ ? now() - startWrite : 0, wait);
+        }
+
+        closer.reset();
+        clone.reset();
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+bool ParallelCopy::next(size_t index, size_t& chunk, Offset& offset, size_t& size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // chunks read and not yet written
+    const size_t window = 2 * maxStreams_;
+
+    cond_.wait(lock, [this, index, window] {
+        return error_ || eof_ || (index < active_ && (positional_ || nextChunk_ - written_ < window));
+    });
+
+    if (error_ || eof_) {
+        return false;
+    }
+
+    chunk  = nextChunk_++;
+    offset = next_;
+
+    if (parallel_) {
+        const long long left = (long long)size_ - ((long long)next_ - (long long)from_);
+        size                 = size_t(std::min<long long>(chunkSize_, left));
+        next_ += Length((long long)size);
+        if (next_ == from_ + size_) {
+            eof_    = true;
+            chunks_ = nextChunk_;
+        }
+    }
+    else {
+        size = chunkSize_;
+    }
+
+    reading_++;
+    statistics_.streams_ = std::max(statistics_.streams_, reading_);
+
+    return true;
+}
+
+void ParallelCopy::done(size_t chunk, Chunk&& data, double readTime, double writeTime, double wait) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    reading_--;
+
+    statistics_.readTime_ += readTime;
+    statistics_.writeTime_ += writeTime;
+    statistics_.readWait_ += wait;
+
+    if (data.length_ == 0 && !parallel_) {
+        // end of a sequential source
+        eof_    = true;
+        chunks_ = chunk;
+        free_.push_back(std::move(data.buffer_));
+        cond_.notify_all();
+        return;
+    }
+
+    adapt(size_t(data.length_), readTime);
+
+    if (positional_) {
+        watcher_.watch(data.buffer_, data.length_);
+        bytes_ += data.length_;
+        statistics_.bytes_ += data.length_;
+        statistics_.chunks_++;
+        written_++;
+        free_.push_back(std::move(data.buffer_));
+    }
+    else {
+        ready_.emplace(chunk, std::move(data));
+    }
+
+    cond_.notify_all();
+}
+
+void ParallelCopy::adapt(size_t bytes, double readTime) {
+
+    // chunks as large as can be read in about READ_TIME
+    if (readTime < READ_TIME / 2 && bytes == chunkSize_ && chunkSize_ * 2 <= initialChunkSize_ * 16) {
+        chunkSize_ *= 2;
+    }
+    else if (readTime > READ_TIME * 2 && chunkSize_ / 2 >= std::max<size_t>(initialChunkSize_ / 4, 1)) {
+        chunkSize_ /= 2;
+    }
+
+    statistics_.chunkSize_ = bytes;
+
+    // add streams while they increase the throughput, measured over a couple of chunks per stream
+    read_ += Length((long long)bytes);
+
+    if (growing_ && nextChunk_ - lastChunk_ >= 2 * active_) {
+        const double t    = now();
+        const double rate = double((long long)read_ - (long long)lastBytes_) / std::max(t - lastAdapt_, 1e-9);
+
+        if (rate > bestRate_ * GAIN && active_ < maxStreams_) {
+            bestRate_ = rate;
+            active_++;
+        }
+        else {
+            growing_ = false;
+        }
+
+        lastAdapt_ = t;
+        lastBytes_ = read_;
+        lastChunk_ = nextChunk_;
+    }
+}
+
+void ParallelCopy::write(DataHandle& out) {
+    try {
+        for (size_t i = 0;; ++i) {
+            Chunk data{Buffer(0), 0};
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+
+                const double wait = now();
+                cond_.wait(lock, [this, i] { return error_ || ready_.count(i) || (eof_ && i >= chunks_); });
+                statistics_.writeWait_ += now() - wait;
+
+                if (error_ || ready_.count(i) == 0) {
+                    return;
+                }
+
+                auto j = ready_.find(i);
+                data   = std::move(j->second);
+                ready_.erase(j);
+            }
+
+            const double start = now();
+            if (out.write(data.buffer_, data.length_) != data.length_) {
+                throw WriteError("ParallelCopy: writing " + out.name(), Here());
+            }
+            const double writeTime = now() - start;
+
+            watcher_.watch(data.buffer_, data.length_);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            statistics_.writeTime_ += writeTime;
+            statistics_.bytes_ += data.length_;
+            statistics_.chunks_++;
+            bytes_ += data.length_;
+            written_++;
+            free_.push_back(std::move(data.buffer_));
+            cond_.notify_all();
+        }
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+Buffer ParallelCopy::allocate(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (free_.empty()) {
+        return Buffer(size);
+    }
+
+    Buffer b(std::move(free_.back()));
+    free_.pop_back();
+
+    if (b.size() < size) {
+        b.resize(size);
+    }
+    return b;
+}
+
+void ParallelCopy::fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+        error_ = e;
+    }
+    cond_.notify_all();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,152 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_io_ParallelCopy_h
+#define eckit_io_ParallelCopy_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/Length.h"
+#include "eckit/io/Offset.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace eckit {
+
+class DataHandle;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct ParallelCopyStatistics {
+    Length bytes_     = 0;
+    size_t chunks_    = 0;
+    size_t streams_   = 0;  ///< largest number of streams reading at once
+    size_t chunkSize_ = 0;  ///< size of the last chunk read
+    bool parallel_    = false;  ///< source read by several streams
+    bool positional_  = false;  ///< target written at the offsets of the chunks, by the streams
+    double readTime_  = 0;  ///< summed over the streams
+    double writeTime_ = 0;  ///< summed over the streams, or of the writer
+    double readWait_  = 0;  ///< streams waiting for the writer to free a buffer
+    double writeWait_ = 0;  ///< writer waiting for the next chunk
+    double time_      = 0;
+
+    void print(std::ostream&) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const ParallelCopyStatistics& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Copies a handle into another with several concurrent streams, each reading chunks of the source
+///
+/// A seekable source of known size, that can be cloned, is split into chunks read by up to @c streams clones of the
+/// source at once. If the target is a regular file (see DataHandle::zeroCopyTarget()), each stream writes its chunks
+/// at their offsets; otherwise a writer puts the chunks back in order into the target. Any other source is read by
+/// a single stream, the writer writing the previous chunks meanwhile (double buffering).
+///
+/// The number of streams starts at one and grows while it increases the throughput. The size of the chunks adapts
+/// to the time taken to read them, between a quarter and 16 times the initial size. The time spent by each stage is
+/// reported in statistics() and in the Metrics of the transfer.
+///
+/// The watcher sees the data in order, unless it does not need the data (see TransferWatcher::needsData()).
+class ParallelCopy : private NonCopyable {
+public:  // methods
+    /// @param streams largest number of streams reading the source at once
+    /// @param chunkSize initial size of the chunks
+    explicit ParallelCopy(size_t streams = 4, size_t chunkSize = 4 * 1024 * 1024,
+                          TransferWatcher& = TransferWatcher::dummy());
+
+    ~ParallelCopy();
+
+    /// Open the handles and copy
+    Length copy(DataHandle& in, DataHandle& out);
+
+    const ParallelCopyStatistics& statistics() const { return statistics_; }
+
+private:  // types
+    struct Chunk {
+        Buffer buffer_;
+        long length_;
+    };
+
+private:  // methods
+    Length copy(DataHandle& in, DataHandle& out, const Offset& from, const Length& estimate);
+
+    /// Read chunks from the source, or from a clone of it: the clone is opened, closed and destroyed by the thread of
+    /// the stream, as handles such as PooledHandle register in a pool of the thread that opens them
+    void stream(size_t index, DataHandle& in, std::unique_ptr<DataHandle> clone);
+    void write(DataHandle& out);
+
+    /// Next chunk for a stream: offset and size, false if no more
+    bool next(size_t index, size_t& chunk, Offset& offset, size_t& size);
+    void done(size_t chunk, Chunk&& data, double readTime, double writeTime, double wait);
+    void adapt(size_t bytes, double readTime);
+    void fail(std::exception_ptr);
+
+    Buffer allocate(size_t size);
+
+private:  // members
+    size_t maxStreams_;
+    size_t initialChunkSize_;
+    TransferWatcher& watcher_;
+
+    ParallelCopyStatistics statistics_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+
+    // state of a copy, guarded by mutex_
+
+    bool parallel_;
+    bool positional_;
+    int fd_;
+    long long base_;  ///< offset in the target of the first chunk
+
+    Offset from_;
+    Length size_;       ///< of the source, from from_, if parallel_
+    Offset next_;       ///< offset of the next chunk to read
+    size_t nextChunk_;  ///< index of the next chunk to read
+    size_t chunkSize_;
+    size_t chunks_;  ///< number of chunks, once known
+    bool eof_;
+
+    size_t active_;  ///< streams allowed to read
+    size_t reading_;
+    Length read_;
+    double lastAdapt_;
+    Length lastBytes_;
+    size_t lastChunk_;
+    double bestRate_;
+    bool growing_;
+
+    std::map<size_t, Chunk> ready_;  ///< chunks read, waiting for the writer
+    size_t written_;                 ///< chunks written
+    Length bytes_;
+
+    std::vector<Buffer> free_;
+
+    std::exception_ptr error_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif
@@ -9,6 +9,7 @@
  */
 
 
+#include <algorithm>
 #include <numeric>
 
 #include "eckit/io/cluster/NodeInfo.h"
@@ -141,6 +142,19 @@ long PartFileHandle::read1(char* buffer, long length) {
 
 
 long PartFileHandle::read(void* buffer, long length) {
+
+    // a read over several parts is a scatter read of the file
+    if (index_ < length_.size() && Length(pos_) + Length(length) > length_[index_]) {
+        const Offset from    = position();
+        const long long left = (long long)estimate() - (long long)from;
+        const long n         = long(std::min<long long>(length, left));
+        if (n > 0) {
+            readv({ReadRange(from, n, buffer)});
+            seek(from + Length(n));
+        }
+        return n;
+    }
+
     char* p = (char*)buffer;
 
     long n     = 0;
@@ -155,6 +169,48 @@ long PartFileHandle::read(void* buffer, long length) {
     return total > 0 ? total : n;
 }
 
+void PartFileHandle::readv(const ReadRanges& ranges) {
+    ASSERT(handle_);
+
+    // start of each part in the data of the handle
+    std::vector<long long> starts(length_.size() + 1, 0);
+    for (size_t i = 0; i < length_.size(); ++i) {
+        starts[i + 1] = starts[i] + (long long)length_[i];
+    }
+
+    ReadRanges parts;
+    parts.reserve(ranges.size());
+
+    for (const ReadRange& range : ranges) {
+        long long offset = range.offset_;
+        long long length = range.length_;
+        char* buffer     = static_cast<char*>(range.buffer_);
+
+        size_t i = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+
+        while (length > 0) {
+            if (i >= length_.size()) {
+                std::ostringstream s;
+                s << path_ << ": cannot read " << range.length_ << " at offset " << range.offset_ << ", only "
+                  << starts.back() << " bytes";
+                throw ReadError(s.str());
+            }
+
+            const long long within = offset - starts[i];
+            const long long n      = std::min(length, (long long)length_[i] - within);
+            if (n > 0) {
+                parts.emplace_back((long long)offset_[i] + within, n, buffer);
+                offset += n;
+                buffer += n;
+                length -= n;
+            }
+            i++;
+        }
+    }
+
+    handle_->readv(parts);
+}
+
 long PartFileHandle::write(const void*, long) {
     NOTIMP;
 }
@@ -226,6 +282,31 @@ bool PartFileHandle::canSeek() const {
     return true;
 }
 
+int PartFileHandle::zeroCopySource(OffsetList& offsets, LengthList& lengths) {
+    if (!handle_) {
+        return -1;
+    }
+
+    // the extents of the whole file are not needed
+    OffsetList fileOffsets;
+    LengthList fileLengths;
+    const int fd = handle_->zeroCopySource(fileOffsets, fileLengths);
+    if (fd < 0) {
+        return -1;
+    }
+
+    for (Ordinal i = index_; i < offset_.size(); ++i) {
+        const long long skip = (i == index_) ? pos_ : 0;
+        const Length length  = length_[i] - Length(skip);
+        if (length > Length(0)) {
+            offsets.push_back(offset_[i] + Length(skip));
+            lengths.push_back(length);
+        }
+    }
+
+    return fd;
+}
+
 bool PartFileHandle::merge(DataHandle* other) {
     if (other->isEmpty()) {
         return true;
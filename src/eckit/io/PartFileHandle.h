@@ -48,6 +48,7 @@ public:  // methods
     void openForAppend(const Length&) override;
 
     long read(void*, long) override;
+    void readv(const ReadRanges&) override;
     long write(const void*, long) override;
     void close() override;
     void rewind() override;
@@ -63,6 +64,8 @@ public:  // methods
     Offset seek(const Offset&) override;
     bool canSeek() const override;
 
+    int zeroCopySource(OffsetList&, LengthList&) override;
+
     void cost(std::map<std::string, Length>&, bool) const override;
     std::string title() const override;
     std::string metricsTag() const override;
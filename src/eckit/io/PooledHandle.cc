@@ -176,6 +176,27 @@ public:
         return n;
     }
 
+    void readv(const PooledHandle* handle, const ReadRanges& ranges) {
+        auto s = statuses_.find(handle);
+        ASSERT(s != statuses_.end());
+        ASSERT(s->second.opened_);
+
+        // the position of the pooled handle is restored by its next read()
+        handle_->readv(ranges);
+
+        nbReads_++;
+    }
+
+    int zeroCopySource(const PooledHandle* handle, OffsetList& offsets, LengthList& lengths) {
+        auto s = statuses_.find(handle);
+        ASSERT(s != statuses_.end());
+        ASSERT(s->second.opened_);
+
+        ASSERT(handle_->seek(s->second.position_) == s->second.position_);
+
+        return handle_->zeroCopySource(offsets, lengths);
+    }
+
     long seek(const PooledHandle* handle, Offset position) {
         auto s = statuses_.find(handle);
         ASSERT(s != statuses_.end());
@@ -263,6 +284,16 @@ long PooledHandle::read(void* buffer, long len) {
     return entry_->read(this, buffer, len);
 }
 
+void PooledHandle::readv(const ReadRanges& ranges) {
+    ASSERT(entry_);
+    entry_->readv(this, ranges);
+}
+
+int PooledHandle::zeroCopySource(OffsetList& offsets, LengthList& lengths) {
+    ASSERT(entry_);
+    return entry_->zeroCopySource(this, offsets, lengths);
+}
+
 void PooledHandle::hash(MD5& md5) const {
     md5 << "PooledHandle";
     md5 << std::string(entry_->path_);
@@ -36,12 +36,14 @@ public:
     void openForAppend(const Length&) override;
 
     long read(void*, long) override;
+    void readv(const ReadRanges&) override;
     long write(const void*, long) override;
     void close() override;
     Offset seek(const Offset&) override;
     bool canSeek() const override { return true; }
     void hash(MD5& md5) const override;
     Offset position() override;
+    int zeroCopySource(OffsetList&, LengthList&) override;
 
     // for testing
 
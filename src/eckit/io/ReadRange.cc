@@ -0,0 +1,100 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/io/ReadRange.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <ostream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+Length defaultGap() {
+    static const long long gap = Resource<long long>("readvGap;$ECKIT_READV_GAP", 64 * 1024);
+    return gap;
+}
+
+Length defaultMaxSpan() {
+    static const long long maxSpan = Resource<long long>("readvMaxSpan;$ECKIT_READV_MAX_SPAN", 16 * 1024 * 1024);
+    return maxSpan;
+}
+
+}  // namespace
+
+ReadSpans::ReadSpans(const ReadRanges& ranges) :
+    ReadSpans(ranges, defaultGap(), defaultMaxSpan()) {}
+
+ReadSpans::ReadSpans(const ReadRanges& ranges, const Length& gap, const Length& maxSpan) :
+    ranges_(ranges) {
+
+    std::vector<size_t> order(ranges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&ranges](size_t a, size_t b) { return ranges[a].offset_ < ranges[b].offset_; });
+
+    for (size_t i : order) {
+        const ReadRange& r = ranges[i];
+        if (r.length_ == Length(0)) {
+            continue;
+        }
+
+        const long long begin = r.offset_;
+        const long long end   = begin + (long long)r.length_;
+
+        if (!spans_.empty()) {
+            Span& last             = spans_.back();
+            const long long lbegin = last.offset_;
+            const long long lend   = lbegin + (long long)last.length_;
+            const long long merged = std::max(end, lend) - lbegin;
+
+            if (begin <= lend + (long long)gap && merged <= (long long)maxSpan) {
+                last.length_ = merged;
+                last.ranges_.push_back(i);
+                continue;
+            }
+        }
+
+        spans_.push_back(Span{r.offset_, r.length_, {i}});
+    }
+}
+
+void* ReadSpans::direct(size_t i) const {
+    const Span& span = spans_[i];
+    if (span.ranges_.size() == 1) {
+        ASSERT(ranges_[span.ranges_.front()].length_ == span.length_);
+        return ranges_[span.ranges_.front()].buffer_;
+    }
+    return nullptr;
+}
+
+void ReadSpans::scatter(size_t i, const char* data) const {
+    const Span& span = spans_[i];
+    for (size_t r : span.ranges_) {
+        const ReadRange& range = ranges_[r];
+        std::memcpy(range.buffer_, data + ((long long)range.offset_ - (long long)span.offset_),
+                    size_t((long long)range.length_));
+    }
+}
+
+void ReadSpans::print(std::ostream& s) const {
+    s << "ReadSpans[ranges=" << ranges_.size() << ",spans=" << spans_.size() << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,83 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_io_ReadRange_h
+#define eckit_io_ReadRange_h
+
+#include <iosfwd>
+#include <vector>
+
+#include "eckit/io/Length.h"
+#include "eckit/io/Offset.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Part of the data of a DataHandle, and the buffer to read it into (see DataHandle::readv())
+struct ReadRange {
+    ReadRange(const Offset& offset, const Length& length, void* buffer) :
+        offset_(offset), length_(length), buffer_(buffer) {}
+
+    Offset offset_;
+    Length length_;
+    void* buffer_;
+};
+
+using ReadRanges = std::vector<ReadRange>;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Merges the ranges of a readv() close to each other, so that they are read with a single request
+///
+/// Ranges are sorted by offset, and merged when the gap between them is at most @c gap bytes and the merged span is
+/// at most @c maxSpan bytes. The data of a span is read at once, then copied to the buffers of its ranges; a span of
+/// a single range is read directly into its buffer.
+class ReadSpans {
+public:  // types
+    struct Span {
+        Offset offset_;
+        Length length_;
+        std::vector<size_t> ranges_;  ///< indices in the ranges
+    };
+
+public:  // methods
+    ReadSpans(const ReadRanges&, const Length& gap, const Length& maxSpan);
+
+    /// From the readvGap and readvMaxSpan resources
+    explicit ReadSpans(const ReadRanges&);
+
+    const std::vector<Span>& spans() const { return spans_; }
+    size_t size() const { return spans_.size(); }
+    const Span& operator[](size_t i) const { return spans_[i]; }
+
+    /// Buffer into which span i can be read directly, or nullptr if it should be read elsewhere, then scattered
+    void* direct(size_t i) const;
+
+    /// Copy the data of span i, read into data, to the buffers of its ranges
+    void scatter(size_t i, const char* data) const;
+
+    void print(std::ostream&) const;
+
+private:  // members
+    const ReadRanges& ranges_;
+    std::vector<Span> spans_;
+
+    friend std::ostream& operator<<(std::ostream& s, const ReadSpans& p) {
+        p.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif
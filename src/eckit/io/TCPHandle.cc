@@ -74,6 +74,10 @@ void TCPHandle::rewind() {
     NOTIMP;
 }
 
+int TCPHandle::zeroCopyTarget() {
+    return connection_.socket();
+}
+
 DataHandle* TCPHandle::clone() const {
     return new TCPHandle(host_, port_);
 }
@@ -53,6 +53,8 @@ public:
 
     bool canSeek() const override { return false; }
 
+    int zeroCopyTarget() override;
+
     // From Streamable
 
     void encode(Stream&) const override;
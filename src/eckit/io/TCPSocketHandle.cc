@@ -56,6 +56,14 @@ long InstantTCPSocketHandle::write(const void* buffer, long length) {
     return n;
 }
 
+int InstantTCPSocketHandle::zeroCopyTarget() {
+    return read_ ? -1 : connection_.socket();
+}
+
+void InstantTCPSocketHandle::zeroCopyWritten(const Length& length) {
+    position_ += length;
+}
+
 void InstantTCPSocketHandle::close() {}
 
 void InstantTCPSocketHandle::rewind() {
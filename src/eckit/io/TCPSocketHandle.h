@@ -53,6 +53,9 @@ public:
     Offset seek(const Offset&) override;
     bool canSeek() const override { return true; }
 
+    int zeroCopyTarget() override;
+    void zeroCopyWritten(const Length&) override;
+
     // From Streamable
 
 
@@ -31,6 +31,10 @@ public:
     virtual void fromHandleOpened() {}
     virtual void toHandleOpened() {}
 
+    /// Whether watch() inspects the data transferred. If not, transfers between files and sockets can bypass user
+    /// space (see ZeroCopyTransfer), and watch() is then given a null pointer and the number of bytes transferred
+    virtual bool needsData() const { return true; }
+
     virtual ~TransferWatcher() {}
 
     // -- Class methods
@@ -0,0 +1,902 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/eckit.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/AIOHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/URingHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/maths/Functions.h"
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/memory/Zero.h"
+#include "eckit/os/Stat.h"
+#include "eckit/runtime/Metrics.h"
+
+#if eckit_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Satisfies the alignment requirements of O_DIRECT on all common filesystems
+constexpr size_t alignment = 4096;
+
+bool useURing() {
+    static bool use = Resource<bool>("useIOUring;$ECKIT_USE_IO_URING", true);
+    return use;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct URingBuffer : private eckit::NonCopyable {
+
+    enum State
+    {
+        Free,
+        Filling,
+        InFlight,
+        Ready
+    };
+
+public:  // methods
+    explicit URingBuffer(size_t size) :
+        size_(size) {
+        if (::posix_memalign(&data_, alignment, size_) != 0) {
+            throw OutOfMemory();
+        }
+    }
+
+    ~URingBuffer() { ::free(data_); }
+
+    char* data() { return static_cast<char*>(data_); }
+
+public:  // members
+    void* data_;
+    size_t size_;
+
+    off_t offset_    = 0;  // file offset of the first byte of the buffer
+    size_t length_   = 0;  // bytes to transfer
+    size_t done_     = 0;  // bytes transferred so far
+    size_t consumed_ = 0;  // bytes already returned to the reader
+
+    State state_ = Free;
+
+    clock_type::time_point start_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#if eckit_HAVE_IO_URING
+
+/// Minimal wrapper around the raw io_uring kernel interface (no liburing dependency)
+
+class URing : private eckit::NonCopyable {
+public:  // methods
+    /// @returns nullptr if the kernel does not support io_uring, or the rings cannot be mapped (errno is set)
+    static URing* create(unsigned entries) {
+        io_uring_params params;
+        zero(params);
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<URing> ring(new URing(fd, params));
+        if (!ring->map(params)) {
+            int err = errno;
+            ring.reset();
+            errno = err;
+            return nullptr;
+        }
+        return ring.release();
+    }
+
+    ~URing() { unmap(); }
+
+    io_uring_sqe& next() {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        ASSERT(tail_ - head < sqEntries_);
+
+        unsigned index    = tail_ & *sqMask_;
+        sqArray_[index]   = index;
+        io_uring_sqe& sqe = sqes_[index];
+        zero(sqe);
+
+        tail_++;
+        return sqe;
+    }
+
+    /// Submit all prepared entries, then wait until at least @p wait completions are available
+    void submit(unsigned wait) {
+        __atomic_store_n(sqTail_, tail_, __ATOMIC_RELEASE);
+
+        for (;;) {
+            unsigned todo = tail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (todo == 0 && ready() >= wait) {
+                return;
+            }
+
+            unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+            if (::syscall(__NR_io_uring_enter, fd_, todo, wait, flags, nullptr, 0) < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                throw FailedSystemCall("io_uring_enter");
+            }
+
+            if (tail_ == __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) && ready() >= wait) {
+                return;
+            }
+        }
+    }
+
+    bool pop(io_uring_cqe& cqe) {
+        unsigned head = *cqHead_;
+        if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        cqe = cqes_[head & *cqMask_];
+        __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool registerBuffers(const std::vector<iovec>& iov) {
+        // May fail if RLIMIT_MEMLOCK is too low, in which case we use unregistered buffers
+        return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov.data(), iov.size()) == 0;
+    }
+
+    /// @returns true if the kernel supports the opcode, false also if it cannot be probed (before Linux 5.6, which
+    /// supports only the vectored and fixed-buffer reads and writes)
+    bool supports(unsigned opcode) {
+        constexpr unsigned ops = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, ops) != 0) {
+            return false;
+        }
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+private:  // methods
+    URing(int fd, const io_uring_params& p) :
+        fd_(fd), sqEntries_(p.sq_entries) {}
+
+    /// Map the rings shared with the kernel, @returns false on failure (e.g. address space limit)
+    bool map(const io_uring_params& p) {
+        sqSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sqSize_ = cqSize_ = std::max(sqSize_, cqSize_);
+        }
+
+        sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ = map(sqSize_, IORING_OFF_SQ_RING);
+        cq_ = single ? sq_ : map(cqSize_, IORING_OFF_CQ_RING);
+        if (!sq_ || !cq_) {
+            return false;
+        }
+
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+        if (!sqes_) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sq_);
+        sqHead_  = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sqTail_  = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqMask_  = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+        char* cq = static_cast<char*>(cq_);
+        cqHead_  = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail_  = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask_  = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_    = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        tail_ = *sqTail_;
+        return true;
+    }
+
+    void* map(size_t size, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    void unmap() {
+        if (sqes_) {
+            ::munmap(sqes_, sqesSize_);
+        }
+        if (cq_ && cq_ != sq_) {
+            ::munmap(cq_, cqSize_);
+        }
+        if (sq_) {
+            ::munmap(sq_, sqSize_);
+        }
+        ::close(fd_);
+    }
+
+    unsigned ready() const { return __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) - *cqHead_; }
+
+private:  // members
+    int fd_;
+    unsigned sqEntries_;
+    unsigned tail_ = 0;
+
+    void* sq_           = nullptr;
+    void* cq_           = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+
+    size_t sqSize_   = 0;
+    size_t cqSize_   = 0;
+    size_t sqesSize_ = 0;
+
+    unsigned* sqHead_  = nullptr;
+    unsigned* sqTail_  = nullptr;
+    unsigned* sqMask_  = nullptr;
+    unsigned* sqArray_ = nullptr;
+
+    unsigned* cqHead_   = nullptr;
+    unsigned* cqTail_   = nullptr;
+    unsigned* cqMask_   = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+#else  // NO eckit_HAVE_IO_URING
+
+class URing : private eckit::NonCopyable {};
+
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+
+URingHandle::URingHandle(const PathName& path, size_t count, size_t buffsize, bool fsync, bool direct) :
+    path_(path),
+    count_(std::max<size_t>(count, 1)),
+    buffsize_(eckit::round(std::max<size_t>(buffsize, 1), alignment)),
+    batch_(std::max<size_t>(count_ / 4, 1)),
+    current_(0),
+    pending_(0),
+    inflight_(0),
+    fd_(-1),
+    pos_(0),
+    ahead_(0),
+    fileSize_(0),
+    fsync_(fsync),
+    direct_(direct),
+    odirect_(false),
+    registered_(false),
+    reading_(false),
+    uring_(false),
+    requests_(0),
+    completed_(0),
+    submissions_(0),
+    maxDepth_(0),
+    latency_(0),
+    maxLatency_(0) {}
+
+URingHandle::~URingHandle() {
+    closeRing();  // before releasing the buffers the kernel may still reference
+    if (fd_ != -1) {
+        ::close(fd_);
+    }
+    for (URingBuffer* b : buffers_) {
+        delete b;
+    }
+}
+
+bool URingHandle::supported() {
+#if eckit_HAVE_IO_URING
+    static bool supported = [] {
+        std::unique_ptr<URing> ring(URing::create(1));
+        return bool(ring);
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool URingHandle::openRing() {
+
+    fallback_.reset();
+    closeRing();
+
+    requests_    = 0;
+    completed_   = 0;
+    submissions_ = 0;
+    maxDepth_    = 0;
+    latency_     = 0;
+    maxLatency_  = 0;
+
+    current_ = 0;
+    uring_   = false;
+
+#if eckit_HAVE_IO_URING
+    if (!useURing()) {
+        return false;
+    }
+
+    // one extra entry for the fsync request
+    ring_.reset(URing::create(count_ + 1));
+    if (!ring_) {
+        Log::debug() << "URingHandle: io_uring not available (" << Log::syserr << "), falling back" << std::endl;
+        return false;
+    }
+
+    if (buffers_.empty()) {
+        buffers_.reserve(count_);
+        for (size_t i = 0; i < count_; i++) {
+            buffers_.push_back(new URingBuffer(buffsize_));
+        }
+    }
+
+    std::vector<iovec> iov(count_);
+    for (size_t i = 0; i < count_; i++) {
+        buffers_[i]->state_ = URingBuffer::Free;
+        iov[i].iov_base     = buffers_[i]->data_;
+        iov[i].iov_len      = buffers_[i]->size_;
+    }
+    registered_ = ring_->registerBuffers(iov);
+
+    // unregistered buffers are transferred with IORING_OP_READ/WRITE (Linux 5.6), which would fail every request
+    if (!registered_ && !ring_->supports(reading_ ? IORING_OP_READ : IORING_OP_WRITE)) {
+        Log::debug() << "URingHandle: buffers not registered and io_uring lacks unregistered reads/writes, falling back"
+                     << std::endl;
+        ring_.reset();
+        return false;
+    }
+
+    uring_ = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void URingHandle::openFallback(bool write) {
+#if eckit_HAVE_AIO
+    if (write) {
+        fallback_.reset(new AIOHandle(path_, count_, buffsize_, fsync_));
+        return;
+    }
+#endif
+    fallback_.reset(new FileHandle(path_));
+}
+
+void URingHandle::closeRing() {
+#if eckit_HAVE_IO_URING
+    // after an error, requests may still be in flight: wait for them whatever their outcome, as the kernel
+    // references the buffers until they complete
+    try {
+        io_uring_cqe cqe;
+        while (ring_ && inflight_ > 0) {
+            ring_->submit(1);
+            while (ring_->pop(cqe)) {
+                inflight_--;
+            }
+        }
+    }
+    catch (std::exception& e) {
+        Log::error() << "URingHandle: " << e.what() << ", " << inflight_
+                     << " requests still in flight, buffers not released" << std::endl;
+        buffers_.clear();
+    }
+#endif
+    ring_.reset();
+    registered_ = false;
+    pending_    = 0;
+    inflight_   = 0;
+}
+
+void URingHandle::openFile(int flags) {
+    odirect_ = false;
+#ifdef O_DIRECT
+    if (direct_) {
+        fd_ = ::open(path_.localPath(), flags | O_DIRECT, 0777);
+        if (fd_ >= 0) {
+            odirect_ = true;
+            return;
+        }
+        if (errno != EINVAL) {
+            throw FailedSystemCall(path_.asString(), "open", Here(), errno);
+        }
+        // filesystem does not support O_DIRECT (e.g. tmpfs)
+        Log::debug() << "URingHandle: O_DIRECT not supported for " << path_ << std::endl;
+    }
+#endif
+    SYSCALL2(fd_ = ::open(path_.localPath(), flags, 0777), path_);
+}
+
+void URingHandle::directOff() {
+#ifdef O_DIRECT
+    if (odirect_) {
+        drain();
+        int flags;
+        SYSCALL2(flags = ::fcntl(fd_, F_GETFL), path_);
+        SYSCALL2(::fcntl(fd_, F_SETFL, flags & ~O_DIRECT), path_);
+        odirect_ = false;
+    }
+#endif
+}
+
+Length URingHandle::openForRead() {
+    reading_ = true;
+
+    if (!openRing()) {
+        openFallback(false);
+        return fallback_->openForRead();
+    }
+
+    openFile(O_RDONLY);
+
+    Stat::Struct info;
+    SYSCALL2(Stat::fstat(fd_, &info), path_);
+    fileSize_ = info.st_size;
+
+    restartReadAhead(0);
+
+    return fileSize_;
+}
+
+void URingHandle::openForWrite(const Length& length) {
+    reading_ = false;
+
+    if (!openRing()) {
+        openFallback(true);
+        fallback_->openForWrite(length);
+        return;
+    }
+
+    openFile(O_WRONLY | O_CREAT | O_TRUNC);
+    pos_ = 0;
+}
+
+void URingHandle::openForAppend(const Length& length) {
+    reading_ = false;
+
+    if (!openRing()) {
+        openFallback(true);
+        fallback_->openForAppend(length);
+        return;
+    }
+
+    // Requests carry explicit offsets and may complete out of order, so O_APPEND cannot be used
+    openFile(O_WRONLY | O_CREAT);
+    SYSCALL2(pos_ = ::lseek(fd_, 0, SEEK_END), path_);
+
+    if (pos_ % alignment) {
+        directOff();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+size_t URingHandle::getFreeSlot() {
+    for (;;) {
+        for (size_t i = 0; i < count_; i++) {
+            size_t n = (current_ + i) % count_;
+            if (buffers_[n]->state_ == URingBuffer::Free) {
+                return n;
+            }
+        }
+        reap(1);
+    }
+}
+
+void URingHandle::queue(size_t slot) {
+#if eckit_HAVE_IO_URING
+    URingBuffer& b = *buffers_[slot];
+
+    io_uring_sqe& sqe = ring_->next();
+    if (registered_) {
+        sqe.opcode    = reading_ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe.buf_index = static_cast<__u16>(slot);
+    }
+    else {
+        sqe.opcode = reading_ ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    sqe.fd        = fd_;
+    sqe.off       = b.offset_ + b.done_;
+    sqe.addr      = reinterpret_cast<__u64>(b.data() + b.done_);
+    sqe.len       = static_cast<__u32>(b.length_ - b.done_);
+    sqe.user_data = slot;
+
+    b.state_ = URingBuffer::InFlight;
+
+    pending_++;
+    inflight_++;
+    maxDepth_ = std::max(maxDepth_, inflight_);
+
+    if (pending_ >= batch_) {
+        submit(0);
+    }
+#else
+    NOTIMP;
+#endif
+}
+
+void URingHandle::queueWrite(size_t slot) {
+    URingBuffer& b = *buffers_[slot];
+    b.done_        = 0;
+    b.start_       = clock_type::now();
+    requests_++;
+    queue(slot);
+}
+
+void URingHandle::queueRead(size_t slot, off_t offset) {
+    URingBuffer& b = *buffers_[slot];
+    b.offset_      = offset;
+    b.length_      = buffsize_;
+    b.done_        = 0;
+    b.consumed_    = 0;
+    b.start_       = clock_type::now();
+    requests_++;
+    queue(slot);
+}
+
+void URingHandle::submit(size_t wait) {
+#if eckit_HAVE_IO_URING
+    if (pending_) {
+        submissions_++;
+    }
+    ring_->submit(static_cast<unsigned>(wait));
+    pending_ = 0;
+#else
+    NOTIMP;
+#endif
+}
+
+void URingHandle::reap(size_t wait) {
+#if eckit_HAVE_IO_URING
+    submit(wait);
+
+    io_uring_cqe cqe;
+    while (ring_->pop(cqe)) {
+
+        inflight_--;
+
+        if (cqe.user_data >= count_) {  // fsync
+            if (cqe.res < 0) {
+                throw FailedSystemCall(path_.asString(), "io_uring fsync", Here(), -cqe.res);
+            }
+            continue;
+        }
+
+        size_t slot    = cqe.user_data;
+        URingBuffer& b = *buffers_[slot];
+
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            queue(slot);
+            continue;
+        }
+
+        if (cqe.res < 0) {
+            b.state_ = URingBuffer::Free;
+            throw FailedSystemCall(path_.asString(), reading_ ? "io_uring read" : "io_uring write", Here(), -cqe.res);
+        }
+
+        b.done_ += cqe.res;
+
+        if (b.done_ < b.length_) {
+            if (!reading_ && cqe.res == 0) {
+                std::ostringstream os;
+                os << "URingHandle: only " << b.done_ << " bytes written instead of " << b.length_;
+                throw WriteError(os.str());
+            }
+            // short transfer: continue with the remainder, unless we reached the end of file
+            if (!reading_ || (cqe.res > 0 && b.offset_ + off_t(b.done_) < fileSize_)) {
+                queue(slot);
+                continue;
+            }
+        }
+
+        double latency = std::chrono::duration<double>(clock_type::now() - b.start_).count();
+        latency_ += latency;
+        maxLatency_ = std::max(maxLatency_, latency);
+        completed_++;
+
+        b.state_ = reading_ ? URingBuffer::Ready : URingBuffer::Free;
+    }
+#else
+    NOTIMP;
+#endif
+}
+
+void URingHandle::drain() {
+    submit(0);
+    while (inflight_ > 0) {
+        reap(1);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+long URingHandle::write(const void* buffer, long length) {
+    if (fallback_) {
+        return fallback_->write(buffer, length);
+    }
+
+    ASSERT(fd_ != -1 && !reading_);
+
+    const char* p = static_cast<const char*>(buffer);
+    size_t left   = length;
+
+    while (left > 0) {
+        URingBuffer* b = buffers_[current_];
+
+        if (b->state_ != URingBuffer::Filling) {
+            current_ = getFreeSlot();
+            b        = buffers_[current_];
+
+            b->state_  = URingBuffer::Filling;
+            b->offset_ = pos_;
+            b->length_ = 0;
+        }
+
+        size_t n = std::min(left, b->size_ - b->length_);
+        ::memcpy(b->data() + b->length_, p, n);
+
+        b->length_ += n;
+        pos_ += n;
+        p += n;
+        left -= n;
+
+        if (b->length_ == b->size_) {
+            queueWrite(current_);
+        }
+    }
+
+    return length;
+}
+
+void URingHandle::flush() {
+    if (fallback_) {
+        fallback_->flush();
+        return;
+    }
+
+    if (fd_ == -1 || reading_) {
+        return;
+    }
+
+    URingBuffer& b = *buffers_[current_];
+    if (b.state_ == URingBuffer::Filling) {
+        if (b.length_ % alignment) {
+            // the next write would start at an unaligned offset
+            directOff();
+        }
+        queueWrite(current_);
+    }
+
+    drain();
+
+#if eckit_HAVE_IO_URING
+    if (fsync_) {
+        io_uring_sqe& sqe = ring_->next();
+        sqe.opcode        = IORING_OP_FSYNC;
+        sqe.fd            = fd_;
+        sqe.user_data     = count_;
+        pending_++;
+        inflight_++;
+        drain();
+    }
+#endif
+}
+
+long URingHandle::read(void* buffer, long length) {
+    if (fallback_) {
+        return fallback_->read(buffer, length);
+    }
+
+    ASSERT(fd_ != -1 && reading_);
+
+    char* p    = static_cast<char*>(buffer);
+    long total = 0;
+
+    while (total < length) {
+        URingBuffer& b = *buffers_[current_];
+
+        if (b.state_ == URingBuffer::Free) {  // nothing more was read ahead
+            break;
+        }
+
+        while (b.state_ == URingBuffer::InFlight) {
+            reap(1);
+        }
+
+        if (b.consumed_ < b.done_) {
+            size_t n = std::min<size_t>(b.done_ - b.consumed_, length - total);
+            ::memcpy(p + total, b.data() + b.consumed_, n);
+            b.consumed_ += n;
+            total += n;
+            pos_ += n;
+        }
+
+        if (b.consumed_ >= b.done_) {
+            bool eof = b.done_ < b.length_;
+
+            b.state_ = URingBuffer::Free;
+            if (!eof && ahead_ < fileSize_) {
+                queueRead(current_, ahead_);
+                ahead_ += buffsize_;
+            }
+            current_ = (current_ + 1) % count_;
+
+            if (eof) {
+                break;
+            }
+        }
+    }
+
+    if (pending_) {
+        submit(0);
+    }
+
+    return total;
+}
+
+void URingHandle::restartReadAhead(off_t from) {
+    drain();
+
+    for (URingBuffer* b : buffers_) {
+        b->state_ = URingBuffer::Free;
+    }
+
+    // with O_DIRECT, reads must start on an aligned offset
+    off_t start = odirect_ ? from - (from % alignment) : from;
+
+    current_ = 0;
+    ahead_   = start;
+    pos_     = from;
+
+    for (size_t i = 0; i < count_ && ahead_ < fileSize_; i++) {
+        queueRead(i, ahead_);
+        ahead_ += buffsize_;
+    }
+
+    submit(0);
+
+    buffers_[0]->consumed_ = from - start;
+}
+
+Offset URingHandle::seek(const Offset& offset) {
+    if (fallback_) {
+        return fallback_->seek(offset);
+    }
+
+    ASSERT(reading_);
+
+    off_t to = offset;
+    if (to == pos_) {
+        return pos_;
+    }
+
+    // stay within the current buffer if possible
+    URingBuffer& b = *buffers_[current_];
+    if (b.state_ != URingBuffer::Free && to >= b.offset_ && to < b.offset_ + off_t(b.length_)) {
+        while (b.state_ == URingBuffer::InFlight) {
+            reap(1);
+        }
+        b.consumed_ = to - b.offset_;
+        pos_        = to;
+        return pos_;
+    }
+
+    restartReadAhead(to);
+    return pos_;
+}
+
+void URingHandle::skip(const Length& length) {
+    seek(position() + length);
+}
+
+void URingHandle::rewind() {
+    if (fallback_) {
+        fallback_->rewind();
+        return;
+    }
+    if (!reading_) {
+        NOTIMP;
+    }
+    seek(0);
+}
+
+void URingHandle::close() {
+    if (fallback_) {
+        fallback_->close();
+        fallback_.reset();
+        return;
+    }
+
+    if (fd_ != -1) {
+        if (reading_) {
+            drain();  // wait for pending read-ahead
+        }
+        else {
+            flush();  // this waits for the async requests to finish
+        }
+        SYSCALL(::close(fd_));
+        fd_ = -1;
+    }
+
+    closeRing();
+}
+
+void URingHandle::print(std::ostream& s) const {
+    s << "URingHandle[" << path_ << ']';
+}
+
+Length URingHandle::size() {
+    if (fallback_) {
+        return fallback_->size();
+    }
+    if (fd_ == -1) {
+        return path_.size();
+    }
+    Stat::Struct info;
+    SYSCALL(Stat::fstat(fd_, &info));
+    return info.st_size;
+}
+
+Length URingHandle::estimate() {
+    return size();
+}
+
+Offset URingHandle::position() {
+    if (fallback_) {
+        return fallback_->position();
+    }
+    return pos_;
+}
+
+void URingHandle::collectMetrics(const std::string& what) const {
+    DataHandle::collectMetrics(what);
+    Metrics::set(what + "_io_uring", uring_);
+    if (uring_) {
+        Metrics::set(what + "_io_requests", requests_);
+        Metrics::set(what + "_io_submissions", submissions_);
+        Metrics::set(what + "_io_queue_depth", maxDepth_);
+        Metrics::set(what + "_io_latency_avg", completed_ ? latency_ / completed_ : 0.);
+        Metrics::set(what + "_io_latency_max", maxLatency_);
+    }
+}
+
+std::string URingHandle::title() const {
+    return std::string("URING[") + PathName::shorten(path_) + "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
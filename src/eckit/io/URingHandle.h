@@ -0,0 +1,126 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_io_URingHandle_h
+#define eckit_io_URingHandle_h
+
+#include <memory>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+
+namespace eckit {
+
+class URing;
+struct URingBuffer;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// DataHandle performing asynchronous reads and writes through the Linux io_uring interface.
+///
+/// Data is staged in @c count aligned buffers of @c buffsize bytes, registered with the kernel when possible.
+/// Writes are coalesced into full buffers and submitted in batches; reads are issued ahead of the consumer.
+/// When the kernel (or the build) lacks io_uring support, or a ring cannot be set up, the handle transparently
+/// falls back to AIOHandle for writing and FileHandle for reading.
+
+class URingHandle : public DataHandle {
+
+public:  // methods
+    URingHandle(const PathName& path, size_t count = 16, size_t buffsize = 1024 * 1024, bool fsync = false,
+                bool direct = false);
+
+    ~URingHandle() override;
+
+    Length openForRead() override;
+    void openForWrite(const Length&) override;
+    void openForAppend(const Length&) override;
+
+    long read(void*, long) override;
+    long write(const void*, long) override;
+    void close() override;
+    void flush() override;
+    void rewind() override;
+    void print(std::ostream&) const override;
+
+    Length size() override;
+    Length estimate() override;
+    Offset position() override;
+    Offset seek(const Offset&) override;
+    void skip(const Length&) override;
+
+    bool canSeek() const override { return reading_; }
+
+    void collectMetrics(const std::string& what) const override;
+
+    /// @returns true if io_uring is usable on this system
+    static bool supported();
+
+private:  // methods
+    bool openRing();
+    void openFallback(bool write);
+    void closeRing();
+
+    size_t getFreeSlot();
+    void queue(size_t slot);
+    void queueWrite(size_t slot);
+    void queueRead(size_t slot, off_t offset);
+    void submit(size_t wait);
+    void reap(size_t wait);
+    void drain();
+    void restartReadAhead(off_t from);
+    void openFile(int flags);
+    void directOff();
+
+    std::string title() const override;
+
+protected:  // members
+    PathName path_;
+
+private:  // members
+    std::unique_ptr<URing> ring_;
+    std::unique_ptr<DataHandle> fallback_;
+    std::vector<URingBuffer*> buffers_;
+
+    size_t count_;
+    size_t buffsize_;
+    size_t batch_;
+
+    size_t current_;  // buffer being filled (write) or consumed (read)
+    size_t pending_;  // requests prepared but not yet submitted
+    size_t inflight_;
+
+    int fd_;
+    off_t pos_;
+    off_t ahead_;  // next offset to be read ahead
+    off_t fileSize_;
+
+    bool fsync_;
+    bool direct_;   // O_DIRECT requested
+    bool odirect_;  // O_DIRECT active on fd_
+    bool registered_;
+    bool reading_;
+    bool uring_;
+
+    // statistics, reported by collectMetrics()
+
+    size_t requests_;
+    size_t completed_;
+    size_t submissions_;
+    size_t maxDepth_;
+    double latency_;
+    double maxLatency_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/io/ZeroCopyTransfer.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+
+#include "eckit/eckit.h"
+
+#if eckit_HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
+#include "eckit/config/LibEcKit.h"
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/os/Stat.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Errors of copy_file_range() and sendfile() when they do not support the descriptors
+bool unsupported(int error) {
+    return error == EINVAL || error == ENOSYS || error == EXDEV || error == EOPNOTSUPP || error == EBADF;
+}
+
+/// Bytes per system call, the watcher is called after each
+long long chunkSize() {
+    static const long long size = Resource<long long>("zeroCopyChunkSize;$ECKIT_ZERO_COPY_CHUNK_SIZE",
+                                                      64 * 1024 * 1024);
+    return size;
+}
+
+}  // namespace
+
+ZeroCopyTransfer::ZeroCopyTransfer(TransferWatcher& watcher) :
+    watcher_(watcher), buffer_(0), copyFileRange_(eckit_HAVE_COPY_FILE_RANGE), sendfile_(eckit_HAVE_SENDFILE) {}
+
+bool ZeroCopyTransfer::transfer(DataHandle& from, DataHandle& to, const Length& maxsize, Length& total) {
+
+    static const bool zeroCopy = Resource<bool>("zeroCopy;$ECKIT_ZERO_COPY", true);
+
+    if (!zeroCopy || watcher_.needsData()) {
+        return false;
+    }
+
+    OffsetList offsets;
+    LengthList lengths;
+    const int in = from.zeroCopySource(offsets, lengths);
+    if (in < 0) {
+        return false;
+    }
+
+    const int out = to.zeroCopyTarget();
+    if (out < 0) {
+        return false;
+    }
+
+    ASSERT(offsets.size() == lengths.size());
+
+    // copy_file_range() only copies between files
+    Stat::Struct info;
+    SYSCALL(Stat::fstat(out, &info));
+    copyFileRange_ = copyFileRange_ && S_ISREG(info.st_mode);
+
+    LOG_DEBUG_LIB(LibEcKit) << "ZeroCopyTransfer: " << from << " => " << to << std::endl;
+
+    long long left = maxsize > Length(0) ? (long long)maxsize : -1;
+    long long done = 0;
+
+    for (size_t i = 0; i < offsets.size() && left != 0; ++i) {
+        long long length = lengths[i];
+        if (left > 0) {
+            length = std::min(length, left);
+            left -= length;
+        }
+
+        done += copy(in, offsets[i], out, length);
+    }
+
+    from.skip(done);
+    to.zeroCopyWritten(done);
+
+    total = done;
+    return true;
+}
+
+long long ZeroCopyTransfer::copy(int in, long long offset, int out, long long length) {
+    long long done = 0;
+
+    while (done < length) {
+        const size_t chunk = size_t(std::min(length - done, chunkSize()));
+        const ssize_t n    = copyChunk(in, offset + done, out, chunk);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n < 0) {
+            throw FailedSystemCall("ZeroCopyTransfer", Here(), errno);
+        }
+
+        if (n == 0) {
+            std::ostringstream os;
+            os << "ZeroCopyTransfer: copied " << done << " bytes out of " << length << " at offset " << offset;
+            throw ReadError(os.str(), Here());
+        }
+
+        done += n;
+        watcher_.watch(nullptr, long(n));
+    }
+
+    return done;
+}
+
+ssize_t ZeroCopyTransfer::copyChunk(int in, long long offset, int out, size_t length) {
+
+#if eckit_HAVE_COPY_FILE_RANGE
+    if (copyFileRange_) {
+        loff_t pos = offset;
+        ssize_t n  = ::copy_file_range(in, &pos, out, nullptr, length, 0);
+        if (n >= 0 || !unsupported(errno)) {
+            return n;
+        }
+        copyFileRange_ = false;
+    }
+#endif
+
+#if eckit_HAVE_SENDFILE
+    if (sendfile_) {
+        off_t pos = offset;
+        ssize_t n = ::sendfile(out, in, &pos, length);
+        if (n >= 0 || !unsupported(errno)) {
+            return n;
+        }
+        sendfile_ = false;
+    }
+#endif
+
+    if (buffer_.size() < length) {
+        buffer_.resize(length);
+    }
+
+    ssize_t n = ::pread(in, buffer_, length, offset);
+
+    for (ssize_t written = 0; written < n;) {
+        ssize_t w = ::write(out, buffer_ + written, n - written);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            throw WriteError("ZeroCopyTransfer", Here());
+        }
+        written += w;
+    }
+
+    return n;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,62 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_io_ZeroCopyTransfer_h
+#define eckit_io_ZeroCopyTransfer_h
+
+#include <sys/types.h>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/Length.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace eckit {
+
+class DataHandle;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Copies data between handles backed by file descriptors without going through user space
+///
+/// The source must read a regular file (DataHandle::zeroCopySource(), e.g. FileHandle, PartFileHandle,
+/// FileDescHandle), the target write to a descriptor (DataHandle::zeroCopyTarget(), e.g. FileHandle, FileDescHandle,
+/// TCPHandle, TCPSocketHandle). The data is copied with copy_file_range() between files, and sendfile() otherwise,
+/// falling back to read() and write() where the system does not support these for the descriptors.
+///
+/// Used by DataHandle::copyTo() and DataHandle::saveInto(), unless disabled with the zeroCopy resource or the
+/// watcher needs the data (see TransferWatcher::needsData()).
+class ZeroCopyTransfer : private NonCopyable {
+public:  // methods
+    explicit ZeroCopyTransfer(TransferWatcher& = TransferWatcher::dummy());
+
+    /// Copy the data left in from, both handles opened
+    /// @param maxsize bytes to copy at most, all if not positive
+    /// @param total bytes copied
+    /// @return false, having copied nothing, if the handles or the watcher do not allow a zero-copy transfer
+    bool transfer(DataHandle& from, DataHandle& to, const Length& maxsize, Length& total);
+
+private:  // methods
+    long long copy(int in, long long offset, int out, long long length);
+    ssize_t copyChunk(int in, long long offset, int out, size_t length);
+
+private:  // members
+    TransferWatcher& watcher_;
+    Buffer buffer_;  ///< where neither copy_file_range() nor sendfile() can be used
+
+    bool copyFileRange_;
+    bool sendfile_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
+
+#endif
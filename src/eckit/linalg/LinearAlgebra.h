@@ -95,6 +95,18 @@ public:
         LinearAlgebraSparse::backend().spmm(A, X, Y);
     }
 
+    /// Compute the product of a single precision sparse matrix A and vector x
+    /// @note y must be allocated and sized correctly
+    static void spmv(const SparseMatrixFloat& A, const Vector& x, Vector& y) {
+        LinearAlgebraSparse::backend().spmv(A, x, y);
+    }
+
+    /// Compute the product of a single precision sparse matrix A and dense matrix X
+    /// @note Y must be allocated and sized correctly
+    static void spmm(const SparseMatrixFloat& A, const Matrix& X, Matrix& Y) {
+        LinearAlgebraSparse::backend().spmm(A, X, Y);
+    }
+
     /// Compute the product x A' y with x and y diagonal matrices stored as
     /// vectors and A a sparse matrix
     /// @note B does NOT need to be allocated/sized correctly
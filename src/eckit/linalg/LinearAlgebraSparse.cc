@@ -77,6 +77,16 @@ LinearAlgebraSparse::LinearAlgebraSparse(const std::string& name) {
 }
 
 
+void LinearAlgebraSparse::spmv(const SparseMatrixFloat& A, const Vector& x, Vector& y) const {
+    getBackend("generic").spmv(A, x, y);
+}
+
+
+void LinearAlgebraSparse::spmm(const SparseMatrixFloat& A, const Matrix& X, Matrix& Y) const {
+    getBackend("generic").spmm(A, X, Y);
+}
+
+
 //-----------------------------------------------------------------------------
 
 }  // namespace eckit::linalg
@@ -54,6 +54,14 @@ public:
     /// @note B does NOT need to be allocated/sized correctly
     virtual void dsptd(const Vector& x, const SparseMatrix& A, const Vector& y, SparseMatrix& B) const = 0;
 
+    /// Compute the product of a single precision sparse matrix A and vector x, accumulating in double precision
+    /// @note y must be allocated and sized correctly; backends not overriding this use the "generic" backend
+    virtual void spmv(const SparseMatrixFloat& A, const Vector& x, Vector& y) const;
+
+    /// Compute the product of a single precision sparse matrix A and dense matrix X, accumulating in double precision
+    /// @note Y must be allocated and sized correctly; backends not overriding this use the "generic" backend
+    virtual void spmm(const SparseMatrixFloat& A, const Matrix& X, Matrix& Y) const;
+
 protected:
     LinearAlgebraSparse() = default;
     LinearAlgebraSparse(const std::string& name);
@@ -15,6 +15,7 @@
 #include <cstring>
 #include <iterator>
 #include <numeric>
+#include <type_traits>
 
 #include "eckit/eckit.h"  // for endianness
 
@@ -24,6 +25,7 @@
 #include "eckit/io/AutoCloser.h"
 #include "eckit/io/BufferedHandle.h"
 #include "eckit/io/MemoryHandle.h"
+#include "eckit/linalg/detail/SparseFormat.h"
 #include "eckit/log/Bytes.h"
 #include "eckit/memory/MemoryBuffer.h"
 #include "eckit/serialisation/FileStream.h"
@@ -37,33 +39,55 @@ static const bool littleEndian = true;
 static const bool littleEndian = false;
 #endif
 
+struct SPMInfo {
+    size_t size_;  ///< non-zeros
+    size_t rows_;  ///< rows
+    size_t cols_;  ///< columns
+    ptrdiff_t data_;
+    ptrdiff_t outer_;
+    ptrdiff_t inner_;
+};
+
+/// Precedes SPMInfo in dumps of single precision entries, distinguishing them from (double precision) dumps
+static constexpr char floatMagic[8] = "SPMF32";
+
+template <typename S>
+static constexpr bool isDouble = std::is_same_v<S, Scalar>;
+
+template <typename S>
+static constexpr size_t headerSize = (isDouble<S> ? 0 : sizeof(floatMagic)) + sizeof(SPMInfo);
+
 //----------------------------------------------------------------------------------------------------------------------
 
 namespace detail {
 
-class StandardAllocator : public SparseMatrix::Allocator {
+template <typename S>
+class StandardAllocator : public SparseMatrixT<S>::Allocator {
 public:
+    using Layout = typename SparseMatrixT<S>::Layout;
+    using Shape  = typename SparseMatrixT<S>::Shape;
+
     StandardAllocator() :
         membuff_(0) {}
 
-    virtual SparseMatrix::Layout allocate(SparseMatrix::Shape& shape) {
+    virtual Layout allocate(Shape& shape) {
 
         if (shape.allocSize() > membuff_.size()) {
             membuff_.resize(shape.allocSize());
         }
 
-        SparseMatrix::Layout p;
+        Layout p;
 
         char* addr = membuff_;
 
-        p.data_  = reinterpret_cast<Scalar*>(addr);
+        p.data_  = reinterpret_cast<S*>(addr);
         p.outer_ = reinterpret_cast<Index*>(addr + shape.sizeofData());
         p.inner_ = reinterpret_cast<Index*>(addr + shape.sizeofData() + shape.sizeofOuter());
 
         return p;
     }
 
-    virtual void deallocate(SparseMatrix::Layout p, SparseMatrix::Shape) {}
+    virtual void deallocate(Layout p, Shape) {}
 
     virtual bool inSharedMemory() const { return false; }
 
@@ -72,23 +96,25 @@ public:
     eckit::MemoryBuffer membuff_;
 };
 
-class BufferAllocator : public SparseMatrix::Allocator {
+template <typename S>
+class BufferAllocator : public SparseMatrixT<S>::Allocator {
 public:
+    using Layout = typename SparseMatrixT<S>::Layout;
+    using Shape  = typename SparseMatrixT<S>::Shape;
+
     BufferAllocator(const MemoryBuffer& buffer) :
         buffer_(buffer, buffer.size()) {}
 
-    virtual eckit::linalg::SparseMatrix::Layout allocate(eckit::linalg::SparseMatrix::Shape& shape) {
-
-        using namespace eckit::linalg;
+    virtual Layout allocate(Shape& shape) {
 
-        SparseMatrix::Layout layout;
+        Layout layout;
 
-        eckit::linalg::SparseMatrix::load(buffer_.data(), buffer_.size(), layout, shape);
+        SparseMatrixT<S>::load(buffer_.data(), buffer_.size(), layout, shape);
 
         return layout;
     }
 
-    virtual void deallocate(eckit::linalg::SparseMatrix::Layout, eckit::linalg::SparseMatrix::Shape) {}
+    virtual void deallocate(Layout, Shape) {}
 
     virtual bool inSharedMemory() const { return false; }
 
@@ -101,18 +127,21 @@ public:
 
 //----------------------------------------------------------------------------------------------------------------------
 
-SparseMatrix::SparseMatrix(Allocator* alloc) {
-    owner_.reset(alloc ? alloc : new detail::StandardAllocator());
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(Allocator* alloc) {
+    owner_.reset(alloc ? alloc : new detail::StandardAllocator<S>());
     spm_ = owner_->allocate(shape_);
 }
 
-SparseMatrix::SparseMatrix(Size rows, Size cols, Allocator* alloc) {
-    owner_.reset(alloc ? alloc : new detail::StandardAllocator());
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(Size rows, Size cols, Allocator* alloc) {
+    owner_.reset(alloc ? alloc : new detail::StandardAllocator<S>());
     reserve(rows, cols, 1);
 }
 
-SparseMatrix::SparseMatrix(Size rows, Size cols, const std::vector<Triplet>& triplets) :
-    owner_(new detail::StandardAllocator()) {
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(Size rows, Size cols, const std::vector<Triplet>& triplets) :
+    owner_(new detail::StandardAllocator<S>()) {
 
     // Count number of non-zeros
     Size nnz{0};
@@ -146,7 +175,7 @@ SparseMatrix::SparseMatrix(Size rows, Size cols, const std::vector<Triplet>& tri
             }
 
             spm_.inner_[pos] = Index(it->col());
-            spm_.data_[pos]  = it->value();
+            spm_.data_[pos]  = static_cast<Value>(it->value());
             ++pos;
         }
     }
@@ -159,19 +188,48 @@ SparseMatrix::SparseMatrix(Size rows, Size cols, const std::vector<Triplet>& tri
 }
 
 
-SparseMatrix::SparseMatrix(Stream& s) {
-    owner_.reset(new detail::StandardAllocator());
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(Stream& s) {
+    owner_.reset(new detail::StandardAllocator<S>());
     decode(s);
 }
 
-SparseMatrix::SparseMatrix(const MemoryBuffer& buffer) {
-    owner_.reset(new detail::BufferAllocator(buffer));
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(const MemoryBuffer& buffer) {
+    owner_.reset(new detail::BufferAllocator<S>(buffer));
     spm_ = owner_->allocate(shape_);
+
+    // storage format, following the CRS arrays (see dump())
+    const size_t offset = headerSize<S> + shape_.allocSize();
+    if (buffer.size() > offset) {
+        format_.reset(detail::SparseFormat::load(static_cast<const char*>(buffer.data()) + offset,
+                                                 buffer.size() - offset));
+    }
 }
 
-SparseMatrix::SparseMatrix(const SparseMatrix& other) {
+template <typename S>
+template <typename T>
+SparseMatrixT<S>::SparseMatrixT(const SparseMatrixT<T>& other, Allocator* alloc) {
 
-    owner_.reset(new detail::StandardAllocator());
+    owner_.reset(alloc ? alloc : new detail::StandardAllocator<S>());
+
+    if (other.empty()) {
+        spm_ = owner_->allocate(shape_);
+        return;
+    }
+
+    reserve(other.rows(), other.cols(), other.nonZeros());
+
+    ::memcpy(spm_.outer_, other.outer(), shape_.sizeofOuter());
+    ::memcpy(spm_.inner_, other.inner(), shape_.sizeofInner());
+    std::transform(other.data(), other.data() + nonZeros(), spm_.data_, [](T v) { return static_cast<Value>(v); });
+}
+
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(const SparseMatrixT& other) :
+    accumulation_(other.accumulation_) {
+
+    owner_.reset(new detail::StandardAllocator<S>());
 
     if (!other.empty()) {  // in case we copy an other that was constructed empty
 
@@ -183,32 +241,38 @@ SparseMatrix::SparseMatrix(const SparseMatrix& other) {
     }
 }
 
-SparseMatrix::SparseMatrix(SparseMatrix&& other) :
-    SparseMatrix() {
+template <typename S>
+SparseMatrixT<S>::SparseMatrixT(SparseMatrixT&& other) :
+    SparseMatrixT() {
     swap(other);
 }
 
-SparseMatrix& SparseMatrix::operator=(const SparseMatrix& other) {
-    SparseMatrix copy(other);
+template <typename S>
+SparseMatrixT<S>& SparseMatrixT<S>::operator=(const SparseMatrixT& other) {
+    SparseMatrixT copy(other);
     swap(copy);
     return *this;
 }
 
-SparseMatrix::~SparseMatrix() {
+template <typename S>
+SparseMatrixT<S>::~SparseMatrixT() {
     reset();
 }
 
-void SparseMatrix::reset() {
+template <typename S>
+void SparseMatrixT<S>::reset() {
 
     owner_->deallocate(spm_, shape_);
 
     spm_.reset();
     shape_.reset();
+    format_.reset();
 }
 
 
 // variables into this method must be by value
-void SparseMatrix::reserve(Size rows, Size cols, Size nnz) {
+template <typename S>
+void SparseMatrixT<S>::reserve(Size rows, Size cols, Size nnz) {
 
     ASSERT(nnz > 0);
     ASSERT(nnz <= rows * cols);
@@ -224,34 +288,48 @@ void SparseMatrix::reserve(Size rows, Size cols, Size nnz) {
 }
 
 
-void SparseMatrix::save(const eckit::PathName& path) const {
+template <typename S>
+void SparseMatrixT<S>::save(const eckit::PathName& path) const {
     FileStream s(path, "w");
     auto c = closer(s);
     encode(s);
+
+    if (format_) {
+        s << std::string("format");
+        format_->encode(s);
+    }
 }
 
 
-void SparseMatrix::load(const eckit::PathName& path) {
+template <typename S>
+void SparseMatrixT<S>::load(const eckit::PathName& path) {
     FileStream s(path, "r");
     auto c = closer(s);
     decode(s);
-}
 
-struct SPMInfo {
-    size_t size_;  ///< non-zeros
-    size_t rows_;  ///< rows
-    size_t cols_;  ///< columns
-    ptrdiff_t data_;
-    ptrdiff_t outer_;
-    ptrdiff_t inner_;
-};
+    // storage format, optional
+    std::string tag;
+    if (s.next(tag)) {
+        ASSERT(tag == "format");
+        format_.reset(detail::SparseFormat::decode(s));
+        ASSERT(format_->rows() == rows() && format_->cols() == cols());
+    }
+}
 
-void SparseMatrix::load(const void* buffer, size_t bufferSize, Layout& layout, Shape& shape) {
+template <typename S>
+void SparseMatrixT<S>::load(const void* buffer, size_t bufferSize, Layout& layout, Shape& shape) {
     const char* b = static_cast<const char*>(buffer);
 
     eckit::MemoryHandle mh(buffer, bufferSize);
     mh.openForRead();
 
+    if constexpr (!isDouble<S>) {
+        char magic[sizeof(floatMagic)] = {};
+        mh.read(magic, sizeof(magic));
+        ASSERT_MSG(::memcmp(magic, floatMagic, sizeof(magic)) == 0,
+                   "SparseMatrix: buffer does not contain single precision entries");
+    }
+
     struct SPMInfo info;
     mh.read(&info, sizeof(SPMInfo));
 
@@ -268,11 +346,11 @@ void SparseMatrix::load(const void* buffer, size_t bufferSize, Layout& layout, S
                            << " rows " << shape.rows_ << " cols " << shape.cols_ << " nnzs " << shape.size_
                            << " allocSize " << shape.allocSize() << std::endl;
 
-    ASSERT(bufferSize >= sizeof(SPMInfo) + shape.sizeofData() + shape.sizeofOuter() + shape.sizeofInner());
+    ASSERT(bufferSize >= headerSize<S> + shape.sizeofData() + shape.sizeofOuter() + shape.sizeofInner());
 
     char* addr = const_cast<char*>(b);
 
-    layout.data_  = reinterpret_cast<Scalar*>(addr + info.data_);
+    layout.data_  = reinterpret_cast<Value*>(addr + info.data_);
     layout.outer_ = reinterpret_cast<Index*>(addr + info.outer_);
     layout.inner_ = reinterpret_cast<Index*>(addr + info.inner_);
 
@@ -283,13 +361,16 @@ void SparseMatrix::load(const void* buffer, size_t bufferSize, Layout& layout, S
     ASSERT(info.inner_ + shape.sizeofInner() <= bufferSize);
 }
 
-void SparseMatrix::dump(MemoryBuffer& buffer) const {
-    SparseMatrix::dump(buffer.data(), buffer.size());
+template <typename S>
+void SparseMatrixT<S>::dump(MemoryBuffer& buffer) const {
+    SparseMatrixT::dump(buffer.data(), buffer.size());
 }
 
-void SparseMatrix::dump(void* buffer, size_t size) const {
+template <typename S>
+void SparseMatrixT<S>::dump(void* buffer, size_t size) const {
 
-    size_t minimum = sizeof(SPMInfo) + shape_.sizeofData() + shape_.sizeofOuter() + shape_.sizeofInner();
+    size_t minimum = headerSize<S> + shape_.sizeofData() + shape_.sizeofOuter() + shape_.sizeofInner() +
+                     (format_ ? format_->footprint() : 0);
     ASSERT(size >= minimum);
 
     MemoryHandle mh(buffer, size);
@@ -301,7 +382,7 @@ void SparseMatrix::dump(void* buffer, size_t size) const {
     info.rows_ = rows();
     info.cols_ = cols();
 
-    info.data_  = sizeof(SPMInfo);
+    info.data_  = headerSize<S>;
     info.outer_ = info.data_ + shape_.sizeofData();
     info.inner_ = info.outer_ + shape_.sizeofOuter();
 
@@ -311,36 +392,76 @@ void SparseMatrix::dump(void* buffer, size_t size) const {
 
     /// @todo we should try to get these memory aligned (to say 64 bytes)
 
+    if constexpr (!isDouble<S>) {
+        mh.write(floatMagic, sizeof(floatMagic));
+    }
+
     mh.write(&info, sizeof(SPMInfo));
 
     ASSERT(mh.write(spm_.data_, shape_.sizeofData()) == long(shape_.sizeofData()));
     ASSERT(mh.write(spm_.outer_, shape_.sizeofOuter()) == long(shape_.sizeofOuter()));
     ASSERT(mh.write(spm_.inner_, shape_.sizeofInner()) == long(shape_.sizeofInner()));
+
+    if (format_) {
+        format_->dump(mh);
+    }
 }
 
-void SparseMatrix::swap(SparseMatrix& other) {
+template <typename S>
+void SparseMatrixT<S>::swap(SparseMatrixT& other) {
 
     std::swap(spm_, other.spm_);
     std::swap(shape_, other.shape_);
+    std::swap(accumulation_, other.accumulation_);
 
     owner_.swap(other.owner_);
+    format_.swap(other.format_);
 }
 
-void SparseMatrix::cols(Size cols) {
+template <typename S>
+void SparseMatrixT<S>::cols(Size cols) {
     ASSERT(cols > 0);
     shape_.cols_ = cols;
+    format_.reset();
+}
+
+template <typename S>
+size_t SparseMatrixT<S>::footprint() const {
+    return sizeof(*this) + shape_.allocSize() + (format_ ? format_->footprint() : 0);
+}
+
+template <typename S>
+SparseMatrixT<S>& SparseMatrixT<S>::format(Format f) {
+    if constexpr (isDouble<S>) {
+        format_.reset(f == Format::CSR || empty() ? nullptr : detail::SparseFormat::build(*this, f));
+    }
+    else if (f != Format::CSR) {
+        throw UserError("SparseMatrix: storage formats require double precision entries");
+    }
+    return *this;
+}
+
+template <typename S>
+typename SparseMatrixT<S>::Format SparseMatrixT<S>::format() const {
+    return format_ ? format_->format() : Format::CSR;
 }
 
-size_t SparseMatrix::footprint() const {
-    return sizeof(*this) + shape_.allocSize();
+template <typename S>
+typename SparseMatrixT<S>::Format SparseMatrixT<S>::bestFormat() const {
+    if constexpr (isDouble<S>) {
+        return empty() ? Format::CSR : detail::SparseFormat::choose(*this);
+    }
+    return Format::CSR;
 }
 
-bool SparseMatrix::inSharedMemory() const {
+template <typename S>
+bool SparseMatrixT<S>::inSharedMemory() const {
     ASSERT(owner_.get());
     return owner_->inSharedMemory();
 }
 
-void SparseMatrix::dump(std::ostream& os) const {
+template <typename S>
+void SparseMatrixT<S>::dump(std::ostream& os) const {
     for (Size i = 0; i < rows(); ++i) {
 
         const_iterator itr  = begin(i);
@@ -358,11 +479,17 @@ void SparseMatrix::dump(std::ostream& os) const {
     }
 }
 
-void SparseMatrix::print(std::ostream& os) const {
-    os << "SparseMatrix[" << shape_ << "," << *owner_ << "]";
+template <typename S>
+void SparseMatrixT<S>::print(std::ostream& os) const {
+    os << (isDouble<S> ? "SparseMatrix[" : "SparseMatrixFloat[") << shape_ << "," << *owner_;
+    if (format_) {
+        os << "," << *format_;
+    }
+    os << "]";
 }
 
-SparseMatrix& SparseMatrix::setIdentity(Size rows, Size cols) {
+template <typename S>
+SparseMatrixT<S>& SparseMatrixT<S>::setIdentity(Size rows, Size cols) {
 
     ASSERT(rows > 0 && cols > 0);
 
@@ -380,14 +507,15 @@ SparseMatrix& SparseMatrix::setIdentity(Size rows, Size cols) {
     }
 
     for (Size i = 0; i < shape_.size_; ++i) {
-        spm_.data_[i] = Scalar(1);
+        spm_.data_[i] = Value(1);
     }
 
     return *this;
 }
 
 
-SparseMatrix& SparseMatrix::transpose() {
+template <typename S>
+SparseMatrixT<S>& SparseMatrixT<S>::transpose() {
 
     /// @note Can SparseMatrix::transpose() be done more efficiently?
     ///       We are building another matrix and then swapping
@@ -403,14 +531,16 @@ SparseMatrix& SparseMatrix::transpose() {
 
     std::sort(triplets.begin(), triplets.end());  // triplets must be sorted by row
 
-    SparseMatrix tmp(shape_.cols_, shape_.rows_, triplets);
+    SparseMatrixT tmp(shape_.cols_, shape_.rows_, triplets);
+    tmp.accumulation_ = accumulation_;
 
     swap(tmp);
 
     return *this;
 }
 
-SparseMatrix SparseMatrix::rowReduction(const std::vector<size_t>& p) const {
+template <typename S>
+SparseMatrixT<S> SparseMatrixT<S>::rowReduction(const std::vector<size_t>& p) const {
     ASSERT(p.size() <= rows());
 
     std::vector<Triplet> triplets;
@@ -431,13 +561,14 @@ SparseMatrix SparseMatrix::rowReduction(const std::vector<size_t>& p) const {
         }
     }
 
-    return SparseMatrix(p.size(), cols(), triplets);
+    return SparseMatrixT(p.size(), cols(), triplets);
 }
 
 
-SparseMatrix& SparseMatrix::prune(linalg::Scalar val) {
+template <typename S>
+SparseMatrixT<S>& SparseMatrixT<S>::prune(Value val) {
 
-    std::vector<Scalar> v;
+    std::vector<Value> v;
     std::vector<Index> inner;
 
     Size nnz = 0;
@@ -454,10 +585,11 @@ SparseMatrix& SparseMatrix::prune(linalg::Scalar val) {
     }
     spm_.outer_[shape_.rows_] = Index(nnz);
 
-    SparseMatrix tmp;
+    SparseMatrixT tmp;
     tmp.reserve(shape_.rows_, shape_.cols_, nnz);
+    tmp.accumulation_ = accumulation_;
 
-    ::memcpy(tmp.spm_.data_, v.data(), nnz * sizeof(Scalar));
+    ::memcpy(tmp.spm_.data_, v.data(), nnz * sizeof(Value));
     ::memcpy(tmp.spm_.outer_, spm_.outer_, shape_.outerSize() * sizeof(Index));
     ::memcpy(tmp.spm_.inner_, inner.data(), nnz * sizeof(Index));
 
@@ -466,13 +598,15 @@ SparseMatrix& SparseMatrix::prune(linalg::Scalar val) {
     return *this;
 }
 
-const SparseMatrix::Allocator& SparseMatrix::owner() const {
+template <typename S>
+const typename SparseMatrixT<S>::Allocator& SparseMatrixT<S>::owner() const {
     ASSERT(owner_.get());
     return *(owner_.get());
 }
 
 
-void SparseMatrix::encode(Stream& s) const {
+template <typename S>
+void SparseMatrixT<S>::encode(Stream& s) const {
 
     s << shape_.rows_;
     s << shape_.cols_;
@@ -480,7 +614,7 @@ void SparseMatrix::encode(Stream& s) const {
 
     s << littleEndian;
     s << sizeof(Index);
-    s << sizeof(Scalar);
+    s << sizeof(Value);
     s << sizeof(Size);
 
     Log::debug<LibEcKit>() << "Encoding matrix : "
@@ -489,11 +623,21 @@ void SparseMatrix::encode(Stream& s) const {
 
     s.writeLargeBlob(spm_.outer_, shape_.outerSize() * sizeof(Index));
     s.writeLargeBlob(spm_.inner_, shape_.innerSize() * sizeof(Index));
-    s.writeLargeBlob(spm_.data_, shape_.dataSize() * sizeof(Scalar));
+    s.writeLargeBlob(spm_.data_, shape_.dataSize() * sizeof(Value));
 }
 
 
-void SparseMatrix::decode(Stream& s) {
+/// Read entries of another precision, converting them
+template <typename From, typename To>
+static void readConverted(Stream& s, To* data, Size size) {
+    std::vector<From> other(size);
+    s.readLargeBlob(other.data(), size * sizeof(From));
+    std::transform(other.begin(), other.end(), data, [](From v) { return static_cast<To>(v); });
+}
+
+
+template <typename S>
+void SparseMatrixT<S>::decode(Stream& s) {
 
     Size rows;
     Size cols;
@@ -513,7 +657,7 @@ void SparseMatrix::decode(Stream& s) {
 
     size_t scalar_size;
     s >> scalar_size;
-    ASSERT(scalar_size == sizeof(Scalar));
+    ASSERT(scalar_size == sizeof(double) || scalar_size == sizeof(float));
 
     size_t size_size;
     s >> size_size;
@@ -521,7 +665,7 @@ void SparseMatrix::decode(Stream& s) {
 
     reset();
 
-    owner_.reset(new detail::StandardAllocator());
+    owner_.reset(new detail::StandardAllocator<S>());
 
     reserve(rows, cols, nnz);
 
@@ -531,46 +675,61 @@ void SparseMatrix::decode(Stream& s) {
 
     s.readLargeBlob(spm_.outer_, shape_.outerSize() * sizeof(Index));
     s.readLargeBlob(spm_.inner_, shape_.innerSize() * sizeof(Index));
-    s.readLargeBlob(spm_.data_, shape_.dataSize() * sizeof(Scalar));
+
+    if (scalar_size == sizeof(Value)) {
+        s.readLargeBlob(spm_.data_, shape_.dataSize() * sizeof(Value));
+    }
+    else if (scalar_size == sizeof(float)) {
+        readConverted<float>(s, spm_.data_, nnz);
+    }
+    else {
+        readConverted<double>(s, spm_.data_, nnz);
+    }
 }
 
 
-Stream& operator<<(Stream& s, const SparseMatrix& v) {
+template <typename S>
+Stream& operator<<(Stream& s, const SparseMatrixT<S>& v) {
     v.encode(s);
     return s;
 }
 
 
-SparseMatrix::const_iterator SparseMatrix::const_iterator::operator++(int) {
+template <typename S>
+typename SparseMatrixT<S>::const_iterator SparseMatrixT<S>::const_iterator::operator++(int) {
     const_iterator it = *this;
     ++(*this);
     return it;
 }
 
 
-SparseMatrix::const_iterator& SparseMatrix::const_iterator::operator=(const SparseMatrix::const_iterator& other) {
+template <typename S>
+typename SparseMatrixT<S>::const_iterator& SparseMatrixT<S>::const_iterator::operator=(const const_iterator& other) {
     matrix_ = other.matrix_;
     index_  = other.index_;
     row_    = other.row_;
     return *this;
 }
 
-bool SparseMatrix::const_iterator::operator==(const SparseMatrix::const_iterator& other) const {
+template <typename S>
+bool SparseMatrixT<S>::const_iterator::operator==(const const_iterator& other) const {
     ASSERT(other.matrix_ == matrix_);
     return other.index_ == index_;
 }
 
 
-SparseMatrix::const_iterator::const_iterator(const SparseMatrix& matrix) :
-    matrix_(const_cast<SparseMatrix*>(&matrix)), index_(0), row_(0) {
+template <typename S>
+SparseMatrixT<S>::const_iterator::const_iterator(const SparseMatrixT& matrix) :
+    matrix_(const_cast<SparseMatrixT*>(&matrix)), index_(0), row_(0) {
     const Index* outer = matrix_->outer();
     while (outer[row_ + 1] == 0) {
         ++row_;
     }
 }
 
-SparseMatrix::const_iterator::const_iterator(const SparseMatrix& matrix, Size row) :
-    matrix_(const_cast<SparseMatrix*>(&matrix)), row_(row) {
+template <typename S>
+SparseMatrixT<S>::const_iterator::const_iterator(const SparseMatrixT& matrix, Size row) :
+    matrix_(const_cast<SparseMatrixT*>(&matrix)), row_(row) {
     const Size rows = matrix_->rows();
     if (row_ > rows) {
         row_ = rows;
@@ -578,17 +737,20 @@ SparseMatrix::const_iterator::const_iterator(const SparseMatrix& matrix, Size ro
     index_ = Size(matrix_->outer()[row_]);
 }
 
-Size SparseMatrix::const_iterator::col() const {
+template <typename S>
+Size SparseMatrixT<S>::const_iterator::col() const {
     assert(matrix_ && index_ < matrix_->nonZeros());
     return Size(matrix_->inner()[index_]);
 }
 
-Size SparseMatrix::const_iterator::row() const {
+template <typename S>
+Size SparseMatrixT<S>::const_iterator::row() const {
     return row_;
 }
 
 
-SparseMatrix::const_iterator& SparseMatrix::const_iterator::operator++() {
+template <typename S>
+typename SparseMatrixT<S>::const_iterator& SparseMatrixT<S>::const_iterator::operator++() {
     if (lastOfRow()) {
         row_++;
     }
@@ -597,24 +759,41 @@ SparseMatrix::const_iterator& SparseMatrix::const_iterator::operator++() {
 }
 
 
-const Scalar& SparseMatrix::const_iterator::operator*() const {
+template <typename S>
+const typename SparseMatrixT<S>::Value& SparseMatrixT<S>::const_iterator::operator*() const {
     assert(matrix_ && index_ < matrix_->nonZeros());
     return matrix_->spm_.data_[index_];
 }
 
-void eckit::linalg::SparseMatrix::const_iterator::print(std::ostream& os) const {
+template <typename S>
+void SparseMatrixT<S>::const_iterator::print(std::ostream& os) const {
     os << "SparseMatrix::iterator(row=" << row_ << ", index=" << index_ << ")" << std::endl;
 }
 
 
-Scalar& SparseMatrix::iterator::operator*() {
-    assert(matrix_ && index_ < matrix_->nonZeros());
-    return matrix_->spm_.data_[index_];
+template <typename S>
+typename SparseMatrixT<S>::Value& SparseMatrixT<S>::iterator::operator*() {
+    assert(this->matrix_ && this->index_ < this->matrix_->nonZeros());
+    this->matrix_->format_.reset();  // entries may be modified, a converted format would be stale
+    return this->matrix_->spm_.data_[this->index_];
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-SparseMatrix::Allocator::~Allocator() {}
+template <typename S>
+SparseMatrixT<S>::Allocator::~Allocator() {}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Explicit template instantiation to minimise dynamic library code bloat
+template class SparseMatrixT<double>;
+template class SparseMatrixT<float>;
+
+template SparseMatrixT<double>::SparseMatrixT(const SparseMatrixT<float>&, Allocator*);
+template SparseMatrixT<float>::SparseMatrixT(const SparseMatrixT<double>&, Allocator*);
+
+template Stream& operator<<(Stream&, const SparseMatrixT<double>&);
+template Stream& operator<<(Stream&, const SparseMatrixT<float>&);
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -18,6 +18,7 @@
 #include <cassert>
 #include <iosfwd>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "eckit/io/MemoryHandle.h"
@@ -33,12 +34,41 @@ class PathName;
 }  // namespace eckit
 
 namespace eckit::linalg {
+namespace detail {
+class SparseFormat;
+}
 
 //----------------------------------------------------------------------------------------------------------------------
 
-/// Sparse matrix in CRS (compressed row storage) format
-class SparseMatrix {
+/// Storage formats, used by the spmv/spmm of CPU backends in addition to the (always available) CRS arrays
+enum class SparseMatrixFormat : int
+{
+    CSR  = 0,  ///< compressed sparse row only
+    SELL = 1,  ///< sliced ELLPACK (SELL-C-sigma), for near-constant row lengths
+    BCSR = 2   ///< blocked compressed sparse row, for matrices with a dense block sub-structure
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Sparse matrix in CRS (compressed row storage) format, with entries of type S
+///
+/// SparseMatrix has double precision entries. SparseMatrixFloat, with single precision entries, keeps large (e.g.
+/// interpolation) matrices resident in 8 bytes per non-zero (entry and 32-bit column index) instead of 12; products
+/// with double precision vectors and matrices are then accumulated in double precision, or in single precision if
+/// chosen with accumulation() (see LinearAlgebraSparse).
+template <typename S>
+class SparseMatrixT {
 public:  // types
+    using Value  = S;
+    using Format = SparseMatrixFormat;
+
+    /// Precision of the sums of products computed by the sparse backends, for single precision entries
+    enum class Accumulation : int
+    {
+        Double = 0,  ///< default, as for double precision entries
+        Float  = 1   ///< as single precision libraries, e.g. for reproducing their results
+    };
+
     struct Layout {
 
         Layout() :
@@ -50,7 +80,7 @@ public:  // types
             inner_ = nullptr;
         }
 
-        Scalar* data_;  ///< matrix entries, sized with number of non-zeros (nnz)
+        Value* data_;   ///< matrix entries, sized with number of non-zeros (nnz)
         Index* outer_;  ///< start of rows,  sized number of rows + 1
         Index* inner_;  ///< column indices, sized with number of non-zeros (nnz)
     };
@@ -87,7 +117,7 @@ public:  // types
 
         size_t allocSize() const { return sizeofData() + sizeofOuter() + sizeofInner(); }
 
-        size_t sizeofData() const { return dataSize() * sizeof(Scalar); }
+        size_t sizeofData() const { return dataSize() * sizeof(Value); }
         size_t sizeofOuter() const { return outerSize() * sizeof(Index); }
         size_t sizeofInner() const { return innerSize() * sizeof(Index); }
 
@@ -134,47 +164,53 @@ public:  // methods
     // -- Constructors
 
     /// Default constructor, empty matrix
-    SparseMatrix(Allocator* alloc = nullptr);
+    SparseMatrixT(Allocator* alloc = nullptr);
 
     /// Constructs an identity matrix with provided dimensions
-    SparseMatrix(Size rows, Size cols, Allocator* alloc = nullptr);
+    SparseMatrixT(Size rows, Size cols, Allocator* alloc = nullptr);
 
     /// Constructor from triplets
-    SparseMatrix(Size rows, Size cols, const std::vector<Triplet>& triplets);
+    SparseMatrixT(Size rows, Size cols, const std::vector<Triplet>& triplets);
 
-    /// Constructor from Stream
-    SparseMatrix(Stream& v);
+    /// Constructor from Stream, of single or double precision entries
+    SparseMatrixT(Stream& v);
 
     /// Constructor from MemoryBuffer
-    SparseMatrix(const MemoryBuffer&);
+    SparseMatrixT(const MemoryBuffer&);
+
+    /// Constructor from a matrix of another precision, converting entries (CRS only)
+    template <typename T>
+    explicit SparseMatrixT(const SparseMatrixT<T>&, Allocator* alloc = nullptr);
 
     /// Move constructor
-    SparseMatrix(SparseMatrix&&);
+    SparseMatrixT(SparseMatrixT&&);
 
     /// Copy constructor
-    SparseMatrix(const SparseMatrix&);
+    SparseMatrixT(const SparseMatrixT&);
 
-    ~SparseMatrix();
+    ~SparseMatrixT();
 
     /// Assignment operator (allocates and copies data)
-    SparseMatrix& operator=(const SparseMatrix&);
+    SparseMatrixT& operator=(const SparseMatrixT&);
 
 public:
     /// Prune entries with exactly the given value
-    SparseMatrix& prune(Scalar val = Scalar(0));
+    SparseMatrixT& prune(Value val = Value(0));
 
     /// Set matrix to the identity
-    SparseMatrix& setIdentity(Size rows, Size cols);
+    SparseMatrixT& setIdentity(Size rows, Size cols);
 
     /// Transpose matrix in-place
-    SparseMatrix& transpose();
+    SparseMatrixT& transpose();
 
     /// @returns a sparse matrix that is a row reduction and reorder accoring to indexes passed in vector
-    SparseMatrix rowReduction(const std::vector<size_t>& p) const;
+    SparseMatrixT rowReduction(const std::vector<size_t>& p) const;
 
     // -- I/O
 
     void save(const eckit::PathName& path) const;
+
+    /// Load from file, saved with single or double precision entries
     void load(const eckit::PathName& path);
 
     void dump(eckit::MemoryBuffer& buffer) const;
@@ -182,7 +218,7 @@ public:
 
     static void load(const void* buffer, size_t bufferSize, Layout& layout, Shape& shape);  ///< from dump()
 
-    void swap(SparseMatrix& other);
+    void swap(SparseMatrixT& other);
 
     /// @returns number of rows
     Size rows() const { return shape_.rows_; }
@@ -196,8 +232,14 @@ public:
     /// @returns true if this matrix does not contain non-zero entries
     bool empty() const { return !nonZeros(); }
 
+    /// @returns precision of the accumulation of products (not saved with the matrix)
+    Accumulation accumulation() const { return accumulation_; }
+
+    /// Set the precision of the accumulation of products, double by default (and for double precision entries)
+    void accumulation(Accumulation a) { accumulation_ = a; }
+
     /// @returns read-only view of the data vector
-    const Scalar* data() const { return spm_.data_; }
+    const Value* data() const { return spm_.data_; }
 
     /// @returns read-only view of the outer index vector
     const Index* outer() const { return spm_.outer_; }
@@ -218,13 +260,28 @@ public:
     /// Is the memory shared
     bool inSharedMemory() const;
 
+    /// Convert to a storage format, kept alongside the CRS arrays and used by the spmv/spmm of the generic, openmp,
+    /// simd and eigen backends. Conversion is a snapshot: non-const access to entries (iterator) resets the format to
+    /// CRS, as do copies. Formats are preserved by save()/load() and dump()/SparseMatrix(const MemoryBuffer&), and
+    /// require double precision entries
+    SparseMatrixT& format(Format);
+
+    /// @returns storage format
+    Format format() const;
+
+    /// @returns storage format expected to perform best for this matrix, based on row-length statistics and block fill
+    Format bestFormat() const;
+
+    /// @returns storage for the converted format, or nullptr if CSR
+    const detail::SparseFormat* formatted() const { return format_.get(); }
+
     void dump(std::ostream&) const;
 
     void print(std::ostream&) const;
 
     const Allocator& owner() const;
 
-    friend std::ostream& operator<<(std::ostream& os, const SparseMatrix& m) {
+    friend std::ostream& operator<<(std::ostream& os, const SparseMatrixT& m) {
         m.print(os);
         return os;
     }
@@ -232,8 +289,8 @@ public:
 public:  // iterators
     struct const_iterator {
 
-        const_iterator(const SparseMatrix& matrix);
-        const_iterator(const SparseMatrix& matrix, Size row);
+        const_iterator(const SparseMatrixT& matrix);
+        const_iterator(const SparseMatrixT& matrix, Size row);
 
         const_iterator(const const_iterator& other) { *this = other; }
 
@@ -249,24 +306,24 @@ public:  // iterators
         bool operator!=(const const_iterator& other) const { return !operator==(other); }
         bool operator==(const const_iterator& other) const;
 
-        const Scalar& operator*() const;
+        const Value& operator*() const;
 
         void print(std::ostream&) const;
 
         bool lastOfRow() const { return ((index_ + 1) == Size(matrix_->outer()[row_ + 1])); }
 
     protected:
-        SparseMatrix* matrix_;
+        SparseMatrixT* matrix_;
         Size index_;
         Size row_;
     };
 
     struct iterator : const_iterator {
-        iterator(SparseMatrix& matrix) :
+        iterator(SparseMatrixT& matrix) :
             const_iterator(matrix) {}
-        iterator(SparseMatrix& matrix, Size row) :
+        iterator(SparseMatrixT& matrix, Size row) :
             const_iterator(matrix, row) {}
-        Scalar& operator*();
+        Value& operator*();
     };
 
     /// const iterators to begin/end of row
@@ -300,13 +357,76 @@ private:  // members
 
     Shape shape_;
 
-    std::unique_ptr<SparseMatrix::Allocator> owner_;  ///< memory manager / allocator
+    Accumulation accumulation_ = Accumulation::Double;
+
+    std::unique_ptr<Allocator> owner_;  ///< memory manager / allocator
+
+    std::unique_ptr<detail::SparseFormat> format_;  ///< storage in a format other than CSR, if converted
 
-    friend Stream& operator<<(Stream&, const SparseMatrix&);
+    template <typename T>
+    friend Stream& operator<<(Stream&, const SparseMatrixT<T>&);
 };
 
 
-Stream& operator<<(Stream&, const SparseMatrix&);
+template <typename S>
+Stream& operator<<(Stream&, const SparseMatrixT<S>&);
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Sparse matrix with double precision entries
+///
+/// A class rather than an alias of SparseMatrixT<Scalar>, so forward declarations (class SparseMatrix;) and the
+/// (mangled) signatures of functions taking it are kept. Operations returning the matrix return a SparseMatrix.
+class SparseMatrix : public SparseMatrixT<Scalar> {
+public:
+    using SparseMatrixT::SparseMatrixT;
+
+    explicit SparseMatrix(const SparseMatrixT& other) :
+        SparseMatrixT(other) {}
+
+    explicit SparseMatrix(SparseMatrixT&& other) :
+        SparseMatrixT(std::move(other)) {}
+
+    SparseMatrix& prune(Value val = Value(0)) {
+        SparseMatrixT::prune(val);
+        return *this;
+    }
+
+    SparseMatrix& setIdentity(Size rows, Size cols) {
+        SparseMatrixT::setIdentity(rows, cols);
+        return *this;
+    }
+
+    SparseMatrix& transpose() {
+        SparseMatrixT::transpose();
+        return *this;
+    }
+
+    SparseMatrix rowReduction(const std::vector<size_t>& p) const {
+        return SparseMatrix(SparseMatrixT::rowReduction(p));
+    }
+
+    using SparseMatrixT::format;
+
+    SparseMatrix& format(Format f) {
+        SparseMatrixT::format(f);
+        return *this;
+    }
+};
+
+
+/// Sparse matrix with single precision entries, see SparseMatrixT
+class SparseMatrixFloat : public SparseMatrixT<float> {
+public:
+    using SparseMatrixT::SparseMatrixT;
+
+    explicit SparseMatrixFloat(const SparseMatrixT& other) :
+        SparseMatrixT(other) {}
+
+    explicit SparseMatrixFloat(SparseMatrixT&& other) :
+        SparseMatrixT(std::move(other)) {}
+};
 
 
 //----------------------------------------------------------------------------------------------------------------------
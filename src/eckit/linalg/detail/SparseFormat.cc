@@ -0,0 +1,691 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+
+#include "eckit/linalg/detail/SparseFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <ostream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/eckit.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/serialisation/Stream.h"
+
+namespace eckit::linalg::detail {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Formats padding (or filling blocks) beyond these ratios of stored entries over non-zeros are not worth it
+constexpr double maxSELLFill = 1.25;
+constexpr double maxBCSRFill = 1.25;
+
+/// Candidate BCSR block sizes, in order of preference
+constexpr Size bcsrCandidates[][2] = {{4, 4}, {3, 3}, {2, 2}};
+
+constexpr char dumpMagic[8] = "SPMFMT2";
+
+struct SPMFormatInfo {
+    char magic_[8];
+    int format_;
+    int parameters_;
+};
+
+
+Size sellChunk() {
+    static const Size chunk = Resource<Size>("sparseMatrixSELLChunk;$ECKIT_SPARSE_MATRIX_SELL_CHUNK", 8);
+    if (chunk != 4 && chunk != 8 && chunk != 16) {
+        throw UserError("SparseMatrix: SELL chunk size should be 4, 8 or 16 (ECKIT_SPARSE_MATRIX_SELL_CHUNK)");
+    }
+    return chunk;
+}
+
+
+Size sellSigma() {
+    static const Size sigma = Resource<Size>("sparseMatrixSELLSigma;$ECKIT_SPARSE_MATRIX_SELL_SIGMA", 256);
+    return std::max(sigma, Size(1));
+}
+
+
+Index checkedIndex(Size n) {
+    if (n > Size(std::numeric_limits<Index>::max())) {
+        throw SeriousBug("SparseMatrix: storage size exceeds Index range");
+    }
+    return Index(n);
+}
+
+
+Size rowLength(const SparseMatrixT<Scalar>& A, Index row) {
+    return row < 0 ? 0 : Size(A.outer()[row + 1] - A.outer()[row]);
+}
+
+
+/// Sort rows by decreasing length within windows of sigma (rounded up to a multiple of chunk) rows
+std::vector<Index> sellPermutation(const SparseMatrixT<Scalar>& A, Size chunk, Size sigma) {
+    const auto Ni     = A.rows();
+    const auto chunks = (Ni + chunk - 1) / chunk;
+    const auto window = ((sigma + chunk - 1) / chunk) * chunk;
+
+    std::vector<Index> perm(chunks * chunk, -1);
+    std::iota(perm.begin(), perm.begin() + Ni, 0);
+
+    for (Size w = 0; w < Ni; w += window) {
+        auto first = perm.begin() + w;
+        auto last  = perm.begin() + std::min(w + window, Ni);
+        std::stable_sort(first, last, [&A](Index a, Index b) { return rowLength(A, a) > rowLength(A, b); });
+    }
+
+    return perm;
+}
+
+
+/// Count non-empty blocks, marking each block column with the last block row it was seen in
+template <typename F>
+void bcsrBlocks(const SparseMatrixT<Scalar>& A, Size R, Size C, F&& blockRow) {
+    const auto Ni  = A.rows();
+    const auto* ia = A.outer();
+    const auto* ja = A.inner();
+    const auto Nbr = (Ni + R - 1) / R;
+    const auto Nbc = (A.cols() + C - 1) / C;
+
+    std::vector<Index> mark(Nbc, -1);
+    std::vector<Index> blocks;
+
+    for (Size br = 0; br < Nbr; ++br) {
+        blocks.clear();
+        for (Size i = br * R; i < std::min(Ni, (br + 1) * R); ++i) {
+            for (auto k = ia[i]; k < ia[i + 1]; ++k) {
+                const auto bc = Index(Size(ja[k]) / C);
+                if (mark[bc] != Index(br)) {
+                    mark[bc] = Index(br);
+                    blocks.push_back(bc);
+                }
+            }
+        }
+        blockRow(br, blocks);
+    }
+}
+
+
+/// Padding and block fill entries are zeros, and 0 * x is not zero for non-finite x: these entries are then skipped
+bool finite(const Scalar* x, Size n) {
+    return std::all_of(x, x + n, [](Scalar v) { return std::isfinite(v); });
+}
+
+
+template <bool Guarded, Size C>
+void sellMultiply(Size Ni, Size Nj, Size chunks, const Index* perm, const Index* start, const Index* length,
+                  const Index* inner, const Scalar* data, const Scalar* x, Scalar* y, Size Nk) {
+#if eckit_HAVE_OMP
+#pragma omp parallel for
+#endif
+    for (Size c = 0; c < chunks; ++c) {
+        const auto* p   = perm + c * C;
+        const auto* n   = length + c * C;
+        const auto* col = inner + start[c];
+        const auto* val = data + start[c];
+        const auto len  = Size(start[c + 1] - start[c]) / C;
+
+        for (Size k = 0; k < Nk; ++k) {
+            const auto* xk = x + k * Nj;
+            auto* yk       = y + k * Ni;
+
+            Scalar sum[C] = {};
+            for (Size j = 0; j < len; ++j) {
+                for (Size r = 0; r < C; ++r) {
+                    if (!Guarded || Index(j) < n[r]) {
+                        sum[r] += val[j * C + r] * xk[col[j * C + r]];
+                    }
+                }
+            }
+
+            for (Size r = 0; r < C; ++r) {
+                if (p[r] >= 0) {
+                    yk[p[r]] = sum[r];
+                }
+            }
+        }
+    }
+}
+
+
+template <bool Guarded, typename... Args>
+void sellDispatch(Size chunk, Args... args) {
+    switch (chunk) {
+        case 4:
+            return sellMultiply<Guarded, 4>(args...);
+        case 8:
+            return sellMultiply<Guarded, 8>(args...);
+        case 16:
+            return sellMultiply<Guarded, 16>(args...);
+        default:
+            NOTIMP;
+    }
+}
+
+
+template <bool Guarded, Size R, Size C>
+void bcsrMultiply(Size Ni, Size Nj, Size Nbr, const Index* outer, const Index* inner, const std::uint16_t* mask,
+                  const Scalar* data, const Scalar* x, Scalar* y, Size Nk) {
+#if eckit_HAVE_OMP
+#pragma omp parallel for
+#endif
+    for (Size br = 0; br < Nbr; ++br) {
+        for (Size k = 0; k < Nk; ++k) {
+            const auto* xk = x + k * Nj;
+            auto* yk       = y + k * Ni;
+
+            Scalar sum[R] = {};
+            for (auto b = outer[br]; b < outer[br + 1]; ++b) {
+                const auto j0   = Size(inner[b]) * C;
+                const auto* val = data + Size(b) * R * C;
+                const auto m    = Guarded ? mask[b] : 0;
+
+                if (j0 + C <= Nj) {
+                    for (Size r = 0; r < R; ++r) {
+                        for (Size c = 0; c < C; ++c) {
+                            if (!Guarded || (m >> (r * C + c)) & 1U) {
+                                sum[r] += val[r * C + c] * xk[j0 + c];
+                            }
+                        }
+                    }
+                }
+                else {
+                    // last block column, partially outside of the matrix
+                    for (Size r = 0; r < R; ++r) {
+                        for (Size c = 0; c < Nj - j0; ++c) {
+                            if (!Guarded || (m >> (r * C + c)) & 1U) {
+                                sum[r] += val[r * C + c] * xk[j0 + c];
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (Size r = 0; r < R && br * R + r < Ni; ++r) {
+                yk[br * R + r] = sum[r];
+            }
+        }
+    }
+}
+
+
+template <bool Guarded, Size R, typename... Args>
+void bcsrDispatchCols(Size C, Args... args) {
+    switch (C) {
+        case 1:
+            return bcsrMultiply<Guarded, R, 1>(args...);
+        case 2:
+            return bcsrMultiply<Guarded, R, 2>(args...);
+        case 3:
+            return bcsrMultiply<Guarded, R, 3>(args...);
+        case 4:
+            return bcsrMultiply<Guarded, R, 4>(args...);
+        default:
+            NOTIMP;
+    }
+}
+
+
+template <bool Guarded, typename... Args>
+void bcsrDispatch(Size R, Size C, Args... args) {
+    switch (R) {
+        case 1:
+            return bcsrDispatchCols<Guarded, 1>(C, args...);
+        case 2:
+            return bcsrDispatchCols<Guarded, 2>(C, args...);
+        case 3:
+            return bcsrDispatchCols<Guarded, 3>(C, args...);
+        case 4:
+            return bcsrDispatchCols<Guarded, 4>(C, args...);
+        default:
+            NOTIMP;
+    }
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SparseFormat::~SparseFormat() = default;
+
+
+size_t SparseFormat::footprint() const {
+    size_t size = sizeof(SPMFormatInfo) + parameters().size() * sizeof(Size);
+    for (const auto& a : arrays()) {
+        size += a.second;
+    }
+    return size;
+}
+
+
+void SparseFormat::encode(Stream& s) const {
+    const auto p = parameters();
+
+    s << static_cast<int>(format());
+    s << p.size();
+    for (const auto& v : p) {
+        s << v;
+    }
+
+    for (const auto& a : arrays()) {
+        s.writeLargeBlob(a.first, a.second);
+    }
+}
+
+
+SparseFormat* SparseFormat::decode(Stream& s) {
+    int format;
+    s >> format;
+
+    size_t n;
+    s >> n;
+
+    std::vector<Size> p(n);
+    for (auto& v : p) {
+        s >> v;
+    }
+
+    std::unique_ptr<SparseFormat> f(create(static_cast<Format>(format), p));
+    for (const auto& a : f->arrays()) {
+        s.readLargeBlob(a.first, a.second);
+    }
+
+    return f.release();
+}
+
+
+void SparseFormat::dump(MemoryHandle& mh) const {
+    const auto p = parameters();
+
+    SPMFormatInfo info;
+    ::memcpy(info.magic_, dumpMagic, sizeof(info.magic_));
+    info.format_     = static_cast<int>(format());
+    info.parameters_ = static_cast<int>(p.size());
+
+    ASSERT(mh.write(&info, sizeof(info)) == long(sizeof(info)));
+    ASSERT(mh.write(p.data(), p.size() * sizeof(Size)) == long(p.size() * sizeof(Size)));
+
+    for (const auto& a : arrays()) {
+        ASSERT(mh.write(a.first, a.second) == long(a.second));
+    }
+}
+
+
+SparseFormat* SparseFormat::load(const void* buffer, size_t size) {
+    const auto* b = static_cast<const char*>(buffer);
+
+    SPMFormatInfo info;
+    if (size < sizeof(info)) {
+        return nullptr;
+    }
+
+    ::memcpy(&info, b, sizeof(info));
+    if (::memcmp(info.magic_, dumpMagic, sizeof(info.magic_)) != 0) {
+        return nullptr;
+    }
+
+    ASSERT(info.parameters_ >= 0);
+    size_t pos = sizeof(info);
+
+    std::vector<Size> p(static_cast<size_t>(info.parameters_));
+    ASSERT(pos + p.size() * sizeof(Size) <= size);
+    ::memcpy(p.data(), b + pos, p.size() * sizeof(Size));
+    pos += p.size() * sizeof(Size);
+
+    std::unique_ptr<SparseFormat> f(create(static_cast<Format>(info.format_), p));
+    for (const auto& a : f->arrays()) {
+        ASSERT(pos + a.second <= size);
+        ::memcpy(a.first, b + pos, a.second);
+        pos += a.second;
+    }
+
+    return f.release();
+}
+
+
+SparseFormat* SparseFormat::create(Format format, const std::vector<Size>& p) {
+    switch (format) {
+        case Format::SELL:
+            return new SELL(p);
+        case Format::BCSR:
+            return new BCSR(p);
+        default:
+            throw SeriousBug("SparseMatrix: unknown storage format " + std::to_string(static_cast<int>(format)));
+    }
+}
+
+
+SparseFormat* SparseFormat::build(const SparseMatrixT<Scalar>& A, Format format) {
+    ASSERT(!A.empty());
+
+    switch (format) {
+        case Format::SELL:
+            return new SELL(A, sellChunk(), sellSigma());
+        case Format::BCSR: {
+            auto s = statistics(A);
+            return new BCSR(A, s.bcsrRows_, s.bcsrCols_);
+        }
+        default:
+            throw BadParameter("SparseMatrix: cannot build storage format " +
+                               std::to_string(static_cast<int>(format)));
+    }
+}
+
+
+SparseFormat::Statistics SparseFormat::statistics(const SparseMatrixT<Scalar>& A) {
+    Statistics s;
+
+    s.rows_          = A.rows();
+    s.nnz_           = A.nonZeros();
+    s.maxRowLength_  = 0;
+    s.meanRowLength_ = s.rows_ > 0 ? double(s.nnz_) / double(s.rows_) : 0.;
+    s.sellFill_      = std::numeric_limits<double>::infinity();
+    s.bcsrFill_      = std::numeric_limits<double>::infinity();
+    s.bcsrRows_      = 1;
+    s.bcsrCols_      = 1;
+
+    if (A.empty()) {
+        return s;
+    }
+
+    for (Size i = 0; i < A.rows(); ++i) {
+        s.maxRowLength_ = std::max(s.maxRowLength_, rowLength(A, Index(i)));
+    }
+
+    s.sellFill_ = double(SELL::storedSize(A, sellChunk(), sellSigma())) / double(s.nnz_);
+
+    // prefer the largest block within the acceptable fill, otherwise the best fill
+    for (const auto& bs : bcsrCandidates) {
+        auto fill = double(BCSR::storedSize(A, bs[0], bs[1])) / double(s.nnz_);
+        if (fill < s.bcsrFill_ && (s.bcsrFill_ > maxBCSRFill)) {
+            s.bcsrFill_ = fill;
+            s.bcsrRows_ = bs[0];
+            s.bcsrCols_ = bs[1];
+        }
+    }
+
+    return s;
+}
+
+
+SparseFormat::Format SparseFormat::choose(const SparseMatrixT<Scalar>& A) {
+    if (A.rows() < sellChunk()) {
+        return Format::CSR;
+    }
+
+    auto s = statistics(A);
+
+    if (s.bcsrFill_ <= maxBCSRFill) {
+        return Format::BCSR;
+    }
+
+    if (s.sellFill_ <= maxSELLFill) {
+        return Format::SELL;
+    }
+
+    return Format::CSR;
+}
+
+
+void SparseFormat::Statistics::print(std::ostream& out) const {
+    out << "Statistics[rows=" << rows_ << ",nnz=" << nnz_ << ",maxRowLength=" << maxRowLength_
+        << ",meanRowLength=" << meanRowLength_ << ",sellFill=" << sellFill_ << ",bcsrFill=" << bcsrFill_
+        << ",bcsrBlock=" << bcsrRows_ << "x" << bcsrCols_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SELL::SELL(const SparseMatrixT<Scalar>& A, Size chunk, Size sigma) :
+    SparseFormat(A.rows(), A.cols()), chunk_(chunk), sigma_(sigma) {
+    ASSERT(chunk_ == 4 || chunk_ == 8 || chunk_ == 16);
+    ASSERT(sigma_ > 0);
+
+    const auto* ia = A.outer();
+    const auto* ja = A.inner();
+    const auto* a  = A.data();
+
+    perm_ = sellPermutation(A, chunk_, sigma_);
+
+    const auto chunks = perm_.size() / chunk_;
+    start_.resize(chunks + 1);
+
+    Size stored = 0;
+    start_[0]   = 0;
+    for (Size c = 0; c < chunks; ++c) {
+        Size len = 0;
+        for (Size r = 0; r < chunk_; ++r) {
+            len = std::max(len, rowLength(A, perm_[c * chunk_ + r]));
+        }
+        stored += len * chunk_;
+        start_[c + 1] = checkedIndex(stored);
+    }
+
+    length_.assign(perm_.size(), 0);
+    inner_.assign(stored, 0);
+    data_.assign(stored, 0);
+
+    for (Size c = 0; c < chunks; ++c) {
+        const auto len = Size(start_[c + 1] - start_[c]) / chunk_;
+
+        for (Size r = 0; r < chunk_; ++r) {
+            const auto row = perm_[c * chunk_ + r];
+            if (row < 0) {
+                continue;
+            }
+
+            const auto n = rowLength(A, row);
+            auto col     = n > 0 ? ja[ia[row + 1] - 1] : 0;  // padding reuses a column of the row
+
+            length_[c * chunk_ + r] = Index(n);
+
+            for (Size j = 0; j < len; ++j) {
+                const auto e = Size(start_[c]) + j * chunk_ + r;
+                if (j < n) {
+                    inner_[e] = ja[ia[row] + Index(j)];
+                    data_[e]  = a[ia[row] + Index(j)];
+                }
+                else {
+                    inner_[e] = col;
+                }
+            }
+        }
+    }
+}
+
+
+SELL::SELL(const std::vector<Size>& p) :
+    SparseFormat(p.at(0), p.at(1)), chunk_(p.at(2)), sigma_(p.at(3)) {
+    ASSERT(p.size() == 6);
+    ASSERT(chunk_ == 4 || chunk_ == 8 || chunk_ == 16);
+    ASSERT(p[4] % chunk_ == 0 && p[4] >= rows_);
+
+    perm_.resize(p[4]);
+    length_.resize(p[4]);
+    start_.resize(p[4] / chunk_ + 1);
+    inner_.resize(p[5]);
+    data_.resize(p[5]);
+}
+
+
+std::vector<Size> SELL::parameters() const {
+    return {rows_, cols_, chunk_, sigma_, perm_.size(), data_.size()};
+}
+
+
+std::vector<SparseFormat::Array> SELL::arrays() const {
+    return {{const_cast<Index*>(perm_.data()), perm_.size() * sizeof(Index)},
+            {const_cast<Index*>(length_.data()), length_.size() * sizeof(Index)},
+            {const_cast<Index*>(start_.data()), start_.size() * sizeof(Index)},
+            {const_cast<Index*>(inner_.data()), inner_.size() * sizeof(Index)},
+            {const_cast<Scalar*>(data_.data()), data_.size() * sizeof(Scalar)}};
+}
+
+
+Size SELL::storedSize(const SparseMatrixT<Scalar>& A, Size chunk, Size sigma) {
+    const auto perm = sellPermutation(A, chunk, sigma);
+
+    Size stored = 0;
+    for (Size c = 0; c < perm.size(); c += chunk) {
+        stored += rowLength(A, perm[c]) * chunk;  // longest row of each chunk is first
+    }
+    return stored;
+}
+
+
+void SELL::spmv(const Scalar* x, Scalar* y) const {
+    multiply(x, y, 1);
+}
+
+
+void SELL::spmm(const Scalar* B, Scalar* C, Size Nk) const {
+    multiply(B, C, Nk);
+}
+
+
+void SELL::multiply(const Scalar* x, Scalar* y, Size Nk) const {
+    const auto chunks = perm_.size() / chunk_;
+    if (finite(x, cols_ * Nk)) {
+        return sellDispatch<false>(chunk_, rows_, cols_, chunks, perm_.data(), start_.data(), length_.data(),
+                                   inner_.data(), data_.data(), x, y, Nk);
+    }
+    sellDispatch<true>(chunk_, rows_, cols_, chunks, perm_.data(), start_.data(), length_.data(), inner_.data(),
+                       data_.data(), x, y, Nk);
+}
+
+
+void SELL::print(std::ostream& out) const {
+    out << "SELL[C=" << chunk_ << ",sigma=" << sigma_ << ",stored=" << data_.size() << "," << Bytes(footprint())
+        << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BCSR::BCSR(const SparseMatrixT<Scalar>& A, Size blockRows, Size blockCols) :
+    SparseFormat(A.rows(), A.cols()), blockRows_(blockRows), blockCols_(blockCols) {
+    static_assert(maxBlockSize * maxBlockSize <= 16, "BCSR: block mask is 16 bits");
+    ASSERT(0 < blockRows_ && blockRows_ <= maxBlockSize);
+    ASSERT(0 < blockCols_ && blockCols_ <= maxBlockSize);
+
+    const auto* ia = A.outer();
+    const auto* ja = A.inner();
+    const auto* a  = A.data();
+
+    const auto R   = blockRows_;
+    const auto C   = blockCols_;
+    const auto Nbr = (rows_ + R - 1) / R;
+
+    // block row structure, block columns sorted within each block row
+    outer_.resize(Nbr + 1);
+    outer_[0] = 0;
+
+    bcsrBlocks(A, R, C, [this](Size br, std::vector<Index>& blocks) {
+        std::sort(blocks.begin(), blocks.end());
+        inner_.insert(inner_.end(), blocks.begin(), blocks.end());
+        outer_[br + 1] = checkedIndex(inner_.size());
+    });
+
+    mask_.assign(inner_.size(), 0);
+    data_.assign(inner_.size() * R * C, 0);
+
+    // block entries
+    std::vector<Index> block((cols_ + C - 1) / C, -1);
+
+    for (Size br = 0; br < Nbr; ++br) {
+        for (auto b = outer_[br]; b < outer_[br + 1]; ++b) {
+            block[inner_[b]] = b;
+        }
+
+        for (Size i = br * R; i < std::min(rows_, (br + 1) * R); ++i) {
+            for (auto k = ia[i]; k < ia[i + 1]; ++k) {
+                const auto j = Size(ja[k]);
+                const auto b = Size(block[j / C]);
+                const auto e = (i - br * R) * C + j % C;
+                mask_[b] |= std::uint16_t(1U << e);
+                data_[b * R * C + e] = a[k];
+            }
+        }
+    }
+}
+
+
+BCSR::BCSR(const std::vector<Size>& p) :
+    SparseFormat(p.at(0), p.at(1)), blockRows_(p.at(2)), blockCols_(p.at(3)) {
+    ASSERT(p.size() == 6);
+    ASSERT(0 < blockRows_ && blockRows_ <= maxBlockSize);
+    ASSERT(0 < blockCols_ && blockCols_ <= maxBlockSize);
+    ASSERT(p[4] == (rows_ + blockRows_ - 1) / blockRows_ + 1);
+    ASSERT(p[5] % (blockRows_ * blockCols_) == 0);
+
+    outer_.resize(p[4]);
+    inner_.resize(p[5] / (blockRows_ * blockCols_));
+    mask_.resize(inner_.size());
+    data_.resize(p[5]);
+}
+
+
+std::vector<Size> BCSR::parameters() const {
+    return {rows_, cols_, blockRows_, blockCols_, outer_.size(), data_.size()};
+}
+
+
+std::vector<SparseFormat::Array> BCSR::arrays() const {
+    return {{const_cast<Index*>(outer_.data()), outer_.size() * sizeof(Index)},
+            {const_cast<Index*>(inner_.data()), inner_.size() * sizeof(Index)},
+            {const_cast<std::uint16_t*>(mask_.data()), mask_.size() * sizeof(std::uint16_t)},
+            {const_cast<Scalar*>(data_.data()), data_.size() * sizeof(Scalar)}};
+}
+
+
+Size BCSR::storedSize(const SparseMatrixT<Scalar>& A, Size blockRows, Size blockCols) {
+    Size blocks = 0;
+    bcsrBlocks(A, blockRows, blockCols, [&blocks](Size, std::vector<Index>& b) { blocks += b.size(); });
+    return blocks * blockRows * blockCols;
+}
+
+
+void BCSR::spmv(const Scalar* x, Scalar* y) const {
+    multiply(x, y, 1);
+}
+
+
+void BCSR::spmm(const Scalar* B, Scalar* C, Size Nk) const {
+    multiply(B, C, Nk);
+}
+
+
+void BCSR::multiply(const Scalar* x, Scalar* y, Size Nk) const {
+    const auto Nbr = outer_.size() - 1;
+    if (finite(x, cols_ * Nk)) {
+        return bcsrDispatch<false>(blockRows_, blockCols_, rows_, cols_, Nbr, outer_.data(), inner_.data(),
+                                   mask_.data(), data_.data(), x, y, Nk);
+    }
+    bcsrDispatch<true>(blockRows_, blockCols_, rows_, cols_, Nbr, outer_.data(), inner_.data(), mask_.data(),
+                       data_.data(), x, y, Nk);
+}
+
+
+void BCSR::print(std::ostream& out) const {
+    out << "BCSR[R=" << blockRows_ << ",C=" << blockCols_ << ",stored=" << data_.size() << "," << Bytes(footprint())
+        << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::linalg::detail
@@ -0,0 +1,227 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
+#include "eckit/linalg/SparseMatrix.h"
+#include "eckit/linalg/types.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace eckit {
+class MemoryHandle;
+class Stream;
+}  // namespace eckit
+
+namespace eckit::linalg::detail {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Storage of a SparseMatrix in a format other than CSR, built from (and kept alongside) the CSR arrays
+///
+/// Padding and block fill entries are zeros that do not contribute to the products, also for non-finite x: if x (or B)
+/// contains NaN or Inf these entries are skipped, so results match CSR (at the cost of a scan of x and guarded loops)
+class SparseFormat : private NonCopyable {
+public:  // types
+    using Format = SparseMatrix::Format;
+
+    /// Statistics used to choose a storage format
+    struct Statistics {
+        Size rows_;
+        Size nnz_;
+        Size maxRowLength_;
+        double meanRowLength_;
+        double sellFill_;  ///< SELL-C-sigma stored entries over nnz
+        double bcsrFill_;  ///< BCSR stored entries over nnz, for the best block size
+        Size bcsrRows_;    ///< best BCSR block size
+        Size bcsrCols_;
+
+        void print(std::ostream&) const;
+
+        friend std::ostream& operator<<(std::ostream& os, const Statistics& s) {
+            s.print(os);
+            return os;
+        }
+    };
+
+public:  // methods
+    virtual ~SparseFormat();
+
+    virtual Format format() const = 0;
+
+    /// y = A x, with x sized cols() and y sized rows()
+    virtual void spmv(const Scalar* x, Scalar* y) const = 0;
+
+    /// C = A B, with B (column-major) sized cols() x Nk and C (column-major) sized rows() x Nk
+    virtual void spmm(const Scalar* B, Scalar* C, Size Nk) const = 0;
+
+    Size rows() const { return rows_; }
+    Size cols() const { return cols_; }
+
+    /// @returns number of stored entries, including explicit zeros introduced by padding
+    virtual Size storedSize() const = 0;
+
+    /// @returns memory used by the stored arrays, which is also the size written by dump()
+    size_t footprint() const;
+
+    // -- I/O
+
+    void encode(Stream&) const;
+    void dump(MemoryHandle&) const;
+
+    virtual void print(std::ostream&) const = 0;
+
+    friend std::ostream& operator<<(std::ostream& os, const SparseFormat& f) {
+        f.print(os);
+        return os;
+    }
+
+    // -- Class methods
+
+    /// Convert a CSR matrix to the given format (CSR itself is not a valid argument)
+    static SparseFormat* build(const SparseMatrixT<Scalar>&, Format);
+
+    static Statistics statistics(const SparseMatrixT<Scalar>&);
+
+    /// Format expected to give the best spmv/spmm performance, based on row-length statistics and block fill
+    static Format choose(const SparseMatrixT<Scalar>&);
+
+    static SparseFormat* decode(Stream&);
+
+    /// @returns nullptr if the buffer does not contain a dumped format
+    static SparseFormat* load(const void* buffer, size_t size);
+
+protected:  // types
+    using Array = std::pair<void*, size_t>;  ///< address and size in bytes
+
+protected:  // methods
+    SparseFormat(Size rows, Size cols) :
+        rows_(rows), cols_(cols) {}
+
+    /// Sizes describing the storage, sufficient to allocate it (see create())
+    virtual std::vector<Size> parameters() const = 0;
+
+    /// Allocated arrays, in serialisation order
+    virtual std::vector<Array> arrays() const = 0;
+
+private:  // methods
+    static SparseFormat* create(Format, const std::vector<Size>& parameters);
+
+protected:  // members
+    Size rows_;
+    Size cols_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Sliced ELLPACK (SELL-C-sigma)
+///
+/// Rows are sorted by decreasing length within windows of sigma rows, then grouped in chunks of C rows. Each chunk is
+/// padded to its longest row and stored column-major, so that the C rows of a chunk are processed together by
+/// contiguous, vectorisable loads. Padding entries are explicit zeros pointing to a column already used by the row, and
+/// are skipped using the row lengths if x is not finite.
+class SELL final : public SparseFormat {
+public:  // methods
+    SELL(const SparseMatrixT<Scalar>&, Size chunk, Size sigma);
+
+    Format format() const override { return Format::SELL; }
+
+    void spmv(const Scalar* x, Scalar* y) const override;
+    void spmm(const Scalar* B, Scalar* C, Size Nk) const override;
+
+    Size storedSize() const override { return data_.size(); }
+
+    void print(std::ostream&) const override;
+
+    Size chunk() const { return chunk_; }
+    Size sigma() const { return sigma_; }
+
+    /// Number of entries stored for a SELL-C-sigma conversion of the given matrix (without converting)
+    static Size storedSize(const SparseMatrixT<Scalar>&, Size chunk, Size sigma);
+
+private:  // methods
+    SELL(const std::vector<Size>& parameters);
+
+    std::vector<Size> parameters() const override;
+    std::vector<Array> arrays() const override;
+
+    void multiply(const Scalar* x, Scalar* y, Size Nk) const;
+
+private:  // members
+    Size chunk_;
+    Size sigma_;
+
+    std::vector<Index> perm_;    ///< original row of each sorted row, -1 for padding rows, sized chunks * C
+    std::vector<Index> length_;  ///< length of each sorted row, sized chunks * C
+    std::vector<Index> start_;   ///< start of each chunk, sized chunks + 1
+    std::vector<Index> inner_;   ///< column indices, sized stored entries
+    std::vector<Scalar> data_;   ///< matrix entries, sized stored entries
+
+    friend class SparseFormat;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Blocked compressed sparse row (BCSR)
+///
+/// The matrix is tiled in dense R x C blocks, and the non-empty blocks are stored in CSR fashion (by block row), each
+/// block row-major. Suited to matrices with a dense sub-structure (e.g. coupled vector components), where blocking
+/// amortises index loads over R x C entries. Each block has a mask of its stored entries, used to skip the fill if x is
+/// not finite.
+class BCSR final : public SparseFormat {
+public:  // methods
+    BCSR(const SparseMatrixT<Scalar>&, Size blockRows, Size blockCols);
+
+    Format format() const override { return Format::BCSR; }
+
+    void spmv(const Scalar* x, Scalar* y) const override;
+    void spmm(const Scalar* B, Scalar* C, Size Nk) const override;
+
+    Size storedSize() const override { return data_.size(); }
+
+    void print(std::ostream&) const override;
+
+    Size blockRows() const { return blockRows_; }
+    Size blockCols() const { return blockCols_; }
+
+    /// Number of entries stored for a BCSR conversion of the given matrix (without converting)
+    static Size storedSize(const SparseMatrixT<Scalar>&, Size blockRows, Size blockCols);
+
+    /// Largest supported block size (in each direction)
+    static constexpr Size maxBlockSize = 4;
+
+private:  // methods
+    BCSR(const std::vector<Size>& parameters);
+
+    std::vector<Size> parameters() const override;
+    std::vector<Array> arrays() const override;
+
+    void multiply(const Scalar* x, Scalar* y, Size Nk) const;
+
+private:  // members
+    Size blockRows_;
+    Size blockCols_;
+
+    std::vector<Index> outer_;         ///< start of block rows, sized block rows + 1
+    std::vector<Index> inner_;         ///< block column indices, sized number of blocks
+    std::vector<std::uint16_t> mask_;  ///< stored entries of each block (bit r * C + c), sized number of blocks
+    std::vector<Scalar> data_;         ///< block entries, sized number of blocks * R * C
+
+    friend class SparseFormat;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::linalg::detail
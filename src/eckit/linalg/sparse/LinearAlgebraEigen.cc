@@ -17,6 +17,7 @@
 #include "eckit/linalg/Matrix.h"
 #include "eckit/linalg/SparseMatrix.h"
 #include "eckit/linalg/Vector.h"
+#include "eckit/linalg/detail/SparseFormat.h"
 #include "eckit/linalg/sparse/LinearAlgebraGeneric.h"
 #include "eckit/maths/Eigen.h"
 
@@ -38,6 +39,11 @@ void LinearAlgebraEigen::spmv(const SparseMatrix& A, const Vector& x, Vector& y)
     ASSERT(x.size() == A.cols());
     ASSERT(y.size() == A.rows());
 
+    if (const auto* format = A.formatted(); format != nullptr) {
+        format->spmv(x.data(), y.data());
+        return;
+    }
+
     // We expect indices to be 0-based
     ASSERT(A.outer()[0] == 0);
 
@@ -55,6 +61,11 @@ void LinearAlgebraEigen::spmm(const SparseMatrix& A, const Matrix& B, Matrix& C)
     ASSERT(A.rows() == C.rows());
     ASSERT(B.cols() == C.cols());
 
+    if (const auto* format = A.formatted(); format != nullptr) {
+        format->spmm(B.data(), C.data(), B.cols());
+        return;
+    }
+
     // We expect indices to be 0-based
     ASSERT(A.outer()[0] == 0);
 
@@ -20,6 +20,10 @@ struct LinearAlgebraEigen final : public LinearAlgebraSparse {
     LinearAlgebraEigen(const std::string& name) :
         LinearAlgebraSparse(name) {}
 
+    // single precision products by the base class
+    using LinearAlgebraSparse::spmm;
+    using LinearAlgebraSparse::spmv;
+
     void spmv(const SparseMatrix&, const Vector&, Vector&) const override;
     void spmm(const SparseMatrix&, const Matrix&, Matrix&) const override;
     void dsptd(const Vector&, const SparseMatrix&, const Vector&, SparseMatrix&) const override;
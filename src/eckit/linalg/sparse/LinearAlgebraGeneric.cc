@@ -19,6 +19,7 @@
 #include "eckit/linalg/Matrix.h"
 #include "eckit/linalg/SparseMatrix.h"
 #include "eckit/linalg/Vector.h"
+#include "eckit/linalg/detail/SparseFormat.h"
 
 namespace eckit::linalg::sparse {
 
@@ -33,7 +34,12 @@ void LinearAlgebraGeneric::print(std::ostream& out) const {
 }
 
 
-void LinearAlgebraGeneric::spmv(const SparseMatrix& A, const Vector& x, Vector& y) const {
+namespace {
+
+
+/// Products are accumulated in type Acc (Scalar, or float for single precision matrices)
+template <typename Acc, typename SpMatrix>
+void spmv(const SpMatrix& A, const Vector& x, Vector& y) {
     const auto Ni = A.rows();
     const auto Nj = A.cols();
 
@@ -54,10 +60,10 @@ void LinearAlgebraGeneric::spmv(const SparseMatrix& A, const Vector& x, Vector&
 #pragma omp parallel for
 #endif
     for (Size i = 0; i < Ni; ++i) {
-        Scalar sum = 0.;
+        Acc sum = 0.;
 
         for (auto c = outer[i]; c < outer[i + 1]; ++c) {
-            sum += val[c] * x[static_cast<Size>(inner[c])];
+            sum += Acc(val[c]) * Acc(x[static_cast<Size>(inner[c])]);
         }
 
         y[i] = sum;
@@ -65,7 +71,8 @@ void LinearAlgebraGeneric::spmv(const SparseMatrix& A, const Vector& x, Vector&
 }
 
 
-void LinearAlgebraGeneric::spmm(const SparseMatrix& A, const Matrix& B, Matrix& C) const {
+template <typename Acc, typename SpMatrix>
+void spmm(const SpMatrix& A, const Matrix& B, Matrix& C) {
     const auto Ni = A.rows();
     const auto Nj = A.cols();
     const auto Nk = B.cols();
@@ -84,13 +91,11 @@ void LinearAlgebraGeneric::spmm(const SparseMatrix& A, const Matrix& B, Matrix&
 
     ASSERT(outer[0] == 0);  // expect indices to be 0-based
 
-    std::vector<Scalar> sum;
-
 #if eckit_HAVE_OMP
 #pragma omp parallel
 #endif
     {
-        std::vector<Scalar> sum(Nk);
+        std::vector<Acc> sum(Nk);
 
 #if eckit_HAVE_OMP
 #pragma omp for
@@ -100,9 +105,9 @@ void LinearAlgebraGeneric::spmm(const SparseMatrix& A, const Matrix& B, Matrix&
 
             for (auto c = outer[i]; c < outer[i + 1]; ++c) {
                 const auto j = static_cast<Size>(inner[c]);
-                const auto v = val[c];
+                const auto v = Acc(val[c]);
                 for (Size k = 0; k < Nk; ++k) {
-                    sum[k] += v * B(j, k);
+                    sum[k] += v * Acc(B(j, k));
                 }
             }
 
@@ -114,6 +119,52 @@ void LinearAlgebraGeneric::spmm(const SparseMatrix& A, const Matrix& B, Matrix&
 }
 
 
+}  // namespace
+
+
+void LinearAlgebraGeneric::spmv(const SparseMatrix& A, const Vector& x, Vector& y) const {
+    if (const auto* format = A.formatted(); format != nullptr) {
+        ASSERT(y.rows() == A.rows());
+        ASSERT(x.rows() == A.cols());
+        format->spmv(x.data(), y.data());
+        return;
+    }
+
+    sparse::spmv<Scalar>(A, x, y);
+}
+
+
+void LinearAlgebraGeneric::spmm(const SparseMatrix& A, const Matrix& B, Matrix& C) const {
+    if (const auto* format = A.formatted(); format != nullptr) {
+        ASSERT(C.rows() == A.rows());
+        ASSERT(B.rows() == A.cols());
+        ASSERT(C.cols() == B.cols());
+        format->spmm(B.data(), C.data(), B.cols());
+        return;
+    }
+
+    sparse::spmm<Scalar>(A, B, C);
+}
+
+
+void LinearAlgebraGeneric::spmv(const SparseMatrixFloat& A, const Vector& x, Vector& y) const {
+    if (A.accumulation() == SparseMatrixFloat::Accumulation::Float) {
+        sparse::spmv<float>(A, x, y);
+        return;
+    }
+    sparse::spmv<Scalar>(A, x, y);
+}
+
+
+void LinearAlgebraGeneric::spmm(const SparseMatrixFloat& A, const Matrix& B, Matrix& C) const {
+    if (A.accumulation() == SparseMatrixFloat::Accumulation::Float) {
+        sparse::spmm<float>(A, B, C);
+        return;
+    }
+    sparse::spmm<Scalar>(A, B, C);
+}
+
+
 void LinearAlgebraGeneric::dsptd(const Vector& x, const SparseMatrix& A, const Vector& y, SparseMatrix& B) const {
     const auto Ni = A.rows();
     const auto Nj = A.cols();
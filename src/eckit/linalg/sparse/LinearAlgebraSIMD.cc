@@ -0,0 +1,499 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+
+#include "eckit/linalg/sparse/LinearAlgebraSIMD.h"
+
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/eckit.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/linalg/Matrix.h"
+#include "eckit/linalg/SparseMatrix.h"
+#include "eckit/linalg/Vector.h"
+#include "eckit/linalg/detail/SparseFormat.h"
+
+#if eckit_HAVE_OMP
+#include <omp.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__NVCOMPILER)
+#define ECKIT_LINALG_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ECKIT_LINALG_SIMD_X86 0
+#endif
+
+namespace eckit::linalg::sparse {
+
+static const LinearAlgebraSIMD __la_simd("simd");
+
+
+namespace {
+
+
+/// Number of dense columns processed together by spmm: one cache line of Scalar
+constexpr Size KB = 8;
+
+
+/// Non-zeros in a block of rows of spmm, whose entries and indices (48 KiB in double precision) stay in cache while
+/// the panels of B are swept
+constexpr Size blockNonZeros = 4096;
+
+
+/// Largest repacked copy of B (number of Scalar), beyond which spmm packs and sweeps its panels a group at a time
+constexpr Size maxPacked = (Size(64) << 20) / sizeof(Scalar);
+
+
+/// Matrix entries are of type V (double or float), products are accumulated in double precision unless the kernel says
+/// otherwise
+template <typename V>
+using spmv_kernel_t = void (*)(const Index* outer, const Index* inner, const V* val, const Scalar* x, Scalar* y,
+                               Size begin, Size end);
+
+/// Computes rows [begin, end) of columns [k0, k0 + kn) of C, with B packed row-major in panels of KB columns
+template <typename V>
+using spmm_kernel_t = void (*)(const Index* outer, const Index* inner, const V* val, const Scalar* panel, Scalar* C,
+                               Size Ni, Size k0, Size kn, Size begin, Size end);
+
+
+template <typename V>
+struct Kernels {
+    std::string name;
+    spmv_kernel_t<V> spmv;
+    spmm_kernel_t<V> spmm;
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+/// Products are accumulated in type Acc (Scalar, or float for single precision matrices)
+template <typename V, typename Acc = Scalar>
+void spmv_scalar(const Index* outer, const Index* inner, const V* val, const Scalar* x, Scalar* y, Size begin,
+                 Size end) {
+    for (Size i = begin; i < end; ++i) {
+        Acc sum = 0.;
+        for (auto c = outer[i]; c < outer[i + 1]; ++c) {
+            sum += Acc(val[c]) * Acc(x[static_cast<Size>(inner[c])]);
+        }
+        y[i] = sum;
+    }
+}
+
+
+template <typename V, typename Acc = Scalar>
+void spmm_scalar(const Index* outer, const Index* inner, const V* val, const Scalar* panel, Scalar* C, Size Ni,
+                 Size k0, Size kn, Size begin, Size end) {
+    for (Size i = begin; i < end; ++i) {
+        Acc sum[KB] = {};
+        for (auto c = outer[i]; c < outer[i + 1]; ++c) {
+            const auto v  = Acc(val[c]);
+            const auto* b = panel + static_cast<Size>(inner[c]) * KB;
+            for (Size k = 0; k < KB; ++k) {
+                sum[k] += v * Acc(b[k]);
+            }
+        }
+        for (Size k = 0; k < kn; ++k) {
+            C[(k0 + k) * Ni + i] = sum[k];
+        }
+    }
+}
+
+
+#if ECKIT_LINALG_SIMD_X86
+
+static_assert(sizeof(Index) == sizeof(int), "gathered loads expect 32-bit indices");
+static_assert(sizeof(Scalar) == sizeof(double), "vectorised kernels expect double precision");
+
+
+/// Load 4 (AVX2) or 8 (AVX-512) matrix entries, widened to double precision
+__attribute__((target("avx2,fma"))) inline __m256d load4(const double* v) {
+    return _mm256_loadu_pd(v);
+}
+
+
+__attribute__((target("avx2,fma"))) inline __m256d load4(const float* v) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(v));
+}
+
+
+__attribute__((target("avx512f"))) inline __m512d load8(const double* v) {
+    return _mm512_loadu_pd(v);
+}
+
+
+__attribute__((target("avx512f"))) inline __m512d load8(const float* v) {
+    return _mm512_cvtps_pd(_mm256_loadu_ps(v));
+}
+
+
+template <typename V>
+__attribute__((target("avx2,fma"))) void spmv_avx2(const Index* outer, const Index* inner, const V* val,
+                                                   const Scalar* x, Scalar* y, Size begin, Size end) {
+    for (Size i = begin; i < end; ++i) {
+        auto c        = outer[i];
+        const auto ce = outer[i + 1];
+        __m256d acc0  = _mm256_setzero_pd();
+        __m256d acc1  = _mm256_setzero_pd();
+
+        for (; c + 8 <= ce; c += 8) {
+            const __m128i j0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner + c));
+            const __m128i j1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner + c + 4));
+            acc0             = _mm256_fmadd_pd(load4(val + c), _mm256_i32gather_pd(x, j0, 8), acc0);
+            acc1             = _mm256_fmadd_pd(load4(val + c + 4), _mm256_i32gather_pd(x, j1, 8), acc1);
+        }
+
+        if (c + 4 <= ce) {
+            const __m128i j0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner + c));
+            acc0             = _mm256_fmadd_pd(load4(val + c), _mm256_i32gather_pd(x, j0, 8), acc0);
+            c += 4;
+        }
+
+        acc0      = _mm256_add_pd(acc0, acc1);
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+        s         = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+
+        Scalar sum = _mm_cvtsd_f64(s);
+        for (; c < ce; ++c) {
+            sum += Scalar(val[c]) * x[static_cast<Size>(inner[c])];
+        }
+
+        y[i] = sum;
+    }
+}
+
+
+template <typename V>
+__attribute__((target("avx2,fma"))) void spmm_avx2(const Index* outer, const Index* inner, const V* val,
+                                                   const Scalar* panel, Scalar* C, Size Ni, Size k0, Size kn,
+                                                   Size begin, Size end) {
+    for (Size i = begin; i < end; ++i) {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+
+        for (auto c = outer[i]; c < outer[i + 1]; ++c) {
+            const __m256d v = _mm256_set1_pd(Scalar(val[c]));
+            const auto* b   = panel + static_cast<Size>(inner[c]) * KB;
+            acc0            = _mm256_fmadd_pd(v, _mm256_loadu_pd(b), acc0);
+            acc1            = _mm256_fmadd_pd(v, _mm256_loadu_pd(b + 4), acc1);
+        }
+
+        alignas(32) Scalar sum[KB];
+        _mm256_store_pd(sum, acc0);
+        _mm256_store_pd(sum + 4, acc1);
+        for (Size k = 0; k < kn; ++k) {
+            C[(k0 + k) * Ni + i] = sum[k];
+        }
+    }
+}
+
+
+template <typename V>
+__attribute__((target("avx512f"))) void spmv_avx512(const Index* outer, const Index* inner, const V* val,
+                                                    const Scalar* x, Scalar* y, Size begin, Size end) {
+    for (Size i = begin; i < end; ++i) {
+        auto c        = outer[i];
+        const auto ce = outer[i + 1];
+        __m512d acc0  = _mm512_setzero_pd();
+        __m512d acc1  = _mm512_setzero_pd();
+
+        for (; c + 16 <= ce; c += 16) {
+            const __m256i j0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inner + c));
+            const __m256i j1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inner + c + 8));
+            acc0             = _mm512_fmadd_pd(load8(val + c), _mm512_i32gather_pd(j0, x, 8), acc0);
+            acc1             = _mm512_fmadd_pd(load8(val + c + 8), _mm512_i32gather_pd(j1, x, 8), acc1);
+        }
+
+        if (c + 8 <= ce) {
+            const __m256i j0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inner + c));
+            acc0             = _mm512_fmadd_pd(load8(val + c), _mm512_i32gather_pd(j0, x, 8), acc0);
+            c += 8;
+        }
+
+        Scalar sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        for (; c < ce; ++c) {
+            sum += Scalar(val[c]) * x[static_cast<Size>(inner[c])];
+        }
+
+        y[i] = sum;
+    }
+}
+
+
+template <typename V>
+__attribute__((target("avx512f"))) void spmm_avx512(const Index* outer, const Index* inner, const V* val,
+                                                    const Scalar* panel, Scalar* C, Size Ni, Size k0, Size kn,
+                                                    Size begin, Size end) {
+    for (Size i = begin; i < end; ++i) {
+        __m512d acc = _mm512_setzero_pd();
+
+        for (auto c = outer[i]; c < outer[i + 1]; ++c) {
+            const auto* b = panel + static_cast<Size>(inner[c]) * KB;
+            acc           = _mm512_fmadd_pd(_mm512_set1_pd(Scalar(val[c])), _mm512_loadu_pd(b), acc);
+        }
+
+        alignas(64) Scalar sum[KB];
+        _mm512_store_pd(sum, acc);
+        for (Size k = 0; k < kn; ++k) {
+            C[(k0 + k) * Ni + i] = sum[k];
+        }
+    }
+}
+
+#endif  // ECKIT_LINALG_SIMD_X86
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+template <typename V>
+Kernels<V> select() {
+    const std::string isa = Resource<std::string>("linearAlgebraSIMD;$ECKIT_LINEAR_ALGEBRA_SIMD_ISA", "auto");
+
+    const Kernels<V> scalar{"scalar", spmv_scalar<V>, spmm_scalar<V>};
+
+#if ECKIT_LINALG_SIMD_X86
+    const Kernels<V> avx2{"avx2", spmv_avx2<V>, spmm_avx2<V>};
+    const Kernels<V> avx512{"avx512", spmv_avx512<V>, spmm_avx512<V>};
+
+    __builtin_cpu_init();
+    const bool has_avx512 = __builtin_cpu_supports("avx512f");
+    const bool has_avx2   = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+    if (isa == "auto") {
+        return has_avx512 ? avx512 : has_avx2 ? avx2 : scalar;
+    }
+    if (isa == "avx512" && has_avx512) {
+        return avx512;
+    }
+    if (isa == "avx2" && has_avx2) {
+        return avx2;
+    }
+#endif
+
+    if (isa != "auto" && isa != "scalar") {
+        throw UserError("LinearAlgebraSIMD: instruction set '" + isa + "' not supported on this CPU");
+    }
+    return scalar;
+}
+
+
+template <typename V>
+const Kernels<V>& kernels() {
+    static const Kernels<V> k = select<V>();
+    return k;
+}
+
+
+Size threads() {
+#if eckit_HAVE_OMP
+    return static_cast<Size>(omp_get_max_threads());
+#else
+    return 1;
+#endif
+}
+
+
+/// Split rows into contiguous ranges with (approximately) the same number of non-zeros
+std::vector<Size> partition(const Index* outer, Size Ni, Size parts) {
+    parts = std::max<Size>(1, std::min(parts, Ni));
+
+    const auto nnz = static_cast<Size>(outer[Ni]);
+
+    std::vector<Size> p(parts + 1, Ni);
+    p[0] = 0;
+    for (Size t = 1; t < parts; ++t) {
+        const auto target = static_cast<Index>((nnz * t) / parts);
+        const auto row    = static_cast<Size>(std::lower_bound(outer, outer + Ni + 1, target) - outer);
+        p[t]              = std::max(p[t - 1], std::min(row, Ni));
+    }
+
+    return p;
+}
+
+
+/// @returns end of the block of rows starting at begin (and ending at most at end), of about blockNonZeros non-zeros
+Size blockEnd(const Index* outer, Size begin, Size end) {
+    const auto target = static_cast<Index>(std::min(static_cast<Size>(outer[begin]) + blockNonZeros,
+                                                    static_cast<Size>(outer[end])));
+    const auto row    = static_cast<Size>(std::upper_bound(outer + begin + 1, outer + end + 1, target) - outer) - 1;
+    return std::max(begin + 1, row);
+}
+
+
+/// Type of the matrix entries (SparseMatrix or SparseMatrixFloat)
+template <typename SpMatrix>
+using value_t = std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<const SpMatrix&>().data())>>;
+
+
+template <typename SpMatrix>
+void spmv(const SpMatrix& A, const Vector& x, Vector& y, spmv_kernel_t<value_t<SpMatrix>> kernel) {
+    const auto Ni = A.rows();
+    const auto Nj = A.cols();
+
+    ASSERT(y.rows() == Ni);
+    ASSERT(x.rows() == Nj);
+
+    if (A.empty()) {
+        return;
+    }
+
+    const auto* const outer = A.outer();
+    const auto* const inner = A.inner();
+    const auto* const val   = A.data();
+
+    ASSERT(outer[0] == 0);  // expect indices to be 0-based
+
+    const auto parts = partition(outer, Ni, threads());
+    const auto Np    = parts.size() - 1;
+
+#if eckit_HAVE_OMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+    for (Size p = 0; p < Np; ++p) {
+        kernel(outer, inner, val, x.data(), y.data(), parts[p], parts[p + 1]);
+    }
+}
+
+
+template <typename SpMatrix>
+void spmm(const SpMatrix& A, const Matrix& B, Matrix& C, spmm_kernel_t<value_t<SpMatrix>> kernel) {
+    const auto Ni = A.rows();
+    const auto Nj = A.cols();
+    const auto Nk = B.cols();
+
+    ASSERT(C.rows() == Ni);
+    ASSERT(B.rows() == Nj);
+    ASSERT(C.cols() == Nk);
+
+    if (A.empty()) {
+        return;
+    }
+
+    const auto* const outer = A.outer();
+    const auto* const inner = A.inner();
+    const auto* const val   = A.data();
+
+    ASSERT(outer[0] == 0);  // expect indices to be 0-based
+
+    const auto parts = partition(outer, Ni, threads());
+    const auto Np    = parts.size() - 1;
+
+    // B (column-major) is repacked into row-major panels of KB columns, so every non-zero reads one contiguous cache
+    // line of B instead of KB strided values; the last panel is zero-padded (also when Nk < KB, as the kernels load
+    // whole lines). All panels are packed at once, or a group at a time if B is too large, and each block of rows of A
+    // sweeps the packed panels, so the entries of A are read from memory once per group instead of once per panel
+    const Size panels = (Nk + KB - 1) / KB;
+    const Size group  = std::max<Size>(1, std::min(panels, maxPacked / std::max<Size>(1, Nj * KB)));
+
+    std::vector<Scalar> packed(Nj * KB * group);
+
+    for (Size g0 = 0; g0 < panels; g0 += group) {
+        const auto gn = std::min(group, panels - g0);
+
+#if eckit_HAVE_OMP
+#pragma omp parallel
+#endif
+        {
+#if eckit_HAVE_OMP
+#pragma omp for
+#endif
+            for (Size j = 0; j < Nj; ++j) {
+                for (Size q = 0; q < gn; ++q) {
+                    const auto k0 = (g0 + q) * KB;
+                    const auto kn = std::min(KB, Nk - k0);
+                    auto* row     = packed.data() + (q * Nj + j) * KB;
+                    for (Size k = 0; k < KB; ++k) {
+                        row[k] = k < kn ? B(j, k0 + k) : 0.;
+                    }
+                }
+            }
+
+#if eckit_HAVE_OMP
+#pragma omp for schedule(static, 1)
+#endif
+            for (Size p = 0; p < Np; ++p) {
+                for (Size begin = parts[p], end = 0; begin < parts[p + 1]; begin = end) {
+                    end = blockEnd(outer, begin, parts[p + 1]);
+                    for (Size q = 0; q < gn; ++q) {
+                        const auto k0 = (g0 + q) * KB;
+                        const auto kn = std::min(KB, Nk - k0);
+                        kernel(outer, inner, val, packed.data() + q * Nj * KB, C.data(), Ni, k0, kn, begin, end);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+}  // namespace
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+
+void LinearAlgebraSIMD::print(std::ostream& out) const {
+    out << "LinearAlgebraSIMD[isa=" << kernels<Scalar>().name << "]";
+}
+
+
+void LinearAlgebraSIMD::spmv(const SparseMatrix& A, const Vector& x, Vector& y) const {
+    if (const auto* format = A.formatted(); format != nullptr) {
+        ASSERT(y.rows() == A.rows());
+        ASSERT(x.rows() == A.cols());
+        format->spmv(x.data(), y.data());
+        return;
+    }
+
+    sparse::spmv(A, x, y, kernels<Scalar>().spmv);
+}
+
+
+void LinearAlgebraSIMD::spmm(const SparseMatrix& A, const Matrix& B, Matrix& C) const {
+    if (const auto* format = A.formatted(); format != nullptr) {
+        ASSERT(C.rows() == A.rows());
+        ASSERT(B.rows() == A.cols());
+        ASSERT(C.cols() == B.cols());
+        format->spmm(B.data(), C.data(), B.cols());
+        return;
+    }
+
+    sparse::spmm(A, B, C, kernels<Scalar>().spmm);
+}
+
+
+// single precision accumulation is not vectorised: the operands are double precision, and converting them would cost
+// more than it saves
+void LinearAlgebraSIMD::spmv(const SparseMatrixFloat& A, const Vector& x, Vector& y) const {
+    const bool single = A.accumulation() == SparseMatrixFloat::Accumulation::Float;
+    sparse::spmv(A, x, y, single ? spmv_scalar<float, float> : kernels<float>().spmv);
+}
+
+
+void LinearAlgebraSIMD::spmm(const SparseMatrixFloat& A, const Matrix& B, Matrix& C) const {
+    const bool single = A.accumulation() == SparseMatrixFloat::Accumulation::Float;
+    sparse::spmm(A, B, C, single ? spmm_scalar<float, float> : kernels<float>().spmm);
+}
+
+
+void LinearAlgebraSIMD::dsptd(const Vector& x, const SparseMatrix& A, const Vector& y, SparseMatrix& B) const {
+    // memory bound and not on the critical path, no benefit from explicit vectorisation
+    LinearAlgebraSparse::getBackend("generic").dsptd(x, A, y, B);
+}
+
+
+}  // namespace eckit::linalg::sparse
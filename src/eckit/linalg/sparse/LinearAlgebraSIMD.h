@@ -0,0 +1,36 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation
+ * nor does it submit to any jurisdiction.
+ */
+
+
+#pragma once
+
+#include "eckit/linalg/LinearAlgebraSparse.h"
+
+namespace eckit::linalg::sparse {
+
+/// Sparse backend with explicitly vectorised CSR kernels
+///
+/// Rows are distributed over threads in contiguous ranges holding (approximately) the same number of non-zeros, which
+/// keeps the load balanced for matrices with skewed row lengths. Inner loops use gathered AVX2/AVX-512 loads selected at
+/// runtime according to the CPU capabilities (override with ECKIT_LINEAR_ALGEBRA_SIMD_ISA=scalar|avx2|avx512).
+struct LinearAlgebraSIMD final : public LinearAlgebraSparse {
+    LinearAlgebraSIMD() {}
+    LinearAlgebraSIMD(const std::string& name) :
+        LinearAlgebraSparse(name) {}
+
+    void spmv(const SparseMatrix&, const Vector&, Vector&) const override;
+    void spmm(const SparseMatrix&, const Matrix&, Matrix&) const override;
+    void dsptd(const Vector&, const SparseMatrix&, const Vector&, SparseMatrix&) const override;
+    void spmv(const SparseMatrixFloat&, const Vector&, Vector&) const override;
+    void spmm(const SparseMatrixFloat&, const Matrix&, Matrix&) const override;
+    void print(std::ostream&) const override;
+};
+
+}  // namespace eckit::linalg::sparse
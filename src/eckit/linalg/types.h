@@ -25,6 +25,10 @@ using Size   = size_t;
 
 class Vector;
 class Matrix;
+
+template <typename S>
+class SparseMatrixT;
 class SparseMatrix;
+class SparseMatrixFloat;
 
 }  // namespace eckit::linalg
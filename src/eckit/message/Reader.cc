@@ -10,6 +10,8 @@
 
 #include "eckit/message/Reader.h"
 
+#include <utility>
+
 #include "eckit/config/Resource.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/io/BufferedHandle.h"
@@ -22,23 +24,44 @@ static size_t readerBufferSize() {
     static size_t readerBuffer = eckit::Resource<size_t>("readerBuffer;$READER_BUFFER", 4 * 1024 * 1024);
     return readerBuffer;
 }
+
+/// Buffers read ahead, so that the messages are decoded while the next ones are read. The handle is then read by
+/// another thread: off by default for the handles of the caller, for which it may not be safe (see
+/// BufferedHandle::readAhead())
+static size_t readerReadAhead() {
+    static size_t readerReadAhead = eckit::Resource<size_t>("readerReadAhead;$READER_READ_AHEAD", 0);
+    return readerReadAhead;
+}
+
+/// Buffers read ahead of the files opened by the reader itself
+static size_t readerFileReadAhead() {
+    static size_t readerFileReadAhead = eckit::Resource<size_t>("readerFileReadAhead;$READER_FILE_READ_AHEAD", 2);
+    return readerFileReadAhead;
+}
+
+template <typename H>
+eckit::DataHandle* buffered(H&& h, bool opened, size_t readAhead) {
+    auto* handle = new eckit::BufferedHandle(std::forward<H>(h), readerBufferSize(), opened);
+    handle->readAhead(readAhead);
+    return handle;
+}
 }  // namespace
 
 namespace eckit::message {
 
 Reader::Reader(eckit::DataHandle* h, bool opened) :  //    handle_(h), opened_(opened) {
-    handle_(new BufferedHandle(h, readerBufferSize(), opened)) {
+    handle_(buffered(h, opened, readerReadAhead())) {
     init();
 }
 
 Reader::Reader(eckit::DataHandle& h, bool opened) :
     //    handle_(h), opened_(opened) {
-    handle_(new BufferedHandle(h, readerBufferSize(), opened)) {
+    handle_(buffered(h, opened, readerReadAhead())) {
     init();
 }
 
 Reader::Reader(const eckit::PathName& path) :
-    handle_(new BufferedHandle(path.fileHandle(), readerBufferSize())) {
+    handle_(buffered(path.fileHandle(), false, readerFileReadAhead())) {
     init();
 }
 
@@ -0,0 +1,149 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/sql/ColumnStoreTable.h"
+
+#include <cstring>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/sql/SQLColumn.h"
+
+namespace eckit::sql {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+const char* typeName(ColumnStore::Type type) {
+    switch (type) {
+        case ColumnStore::INTEGER:
+            return "integer";
+        case ColumnStore::REAL:
+            return "real";
+        case ColumnStore::DOUBLE:
+            return "double";
+        case ColumnStore::STRING:
+            return "string";
+    }
+    NOTIMP;
+}
+
+class ColumnStoreTableIterator : public SQLTableIterator {
+public:
+    ColumnStoreTableIterator(const ColumnStore& store,
+                             const std::vector<std::reference_wrapper<const SQLColumn>>& columns) :
+        store_(store), block_(0), row_(0), rows_(0), buffers_(columns.size()), blocks_(columns.size()) {
+
+        size_t offset = 0;
+        for (const auto& col : columns) {
+            const size_t c                    = col.get().index();
+            const ColumnStore::Column& column = store_.column(c);
+
+            columns_.push_back(c);
+            offsets_.push_back(offset);
+            sizes_.push_back(column.width_);
+            hasMissing_.push_back(column.hasMissing_);
+            missingValues_.push_back(column.missingValue_);
+
+            offset += column.width_;
+        }
+
+        data_.resize(offset);
+    }
+
+private:
+    void rewind() override {
+        block_ = 0;
+        row_   = 0;
+        rows_  = 0;
+    }
+
+    bool next() override {
+        if (row_ == rows_ && !loadBlock()) {
+            return false;
+        }
+
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            const size_t width = sizes_[i];
+            std::memcpy(&data_[offsets_[i]], blocks_[i] + row_ * width, width * sizeof(double));
+        }
+
+        row_++;
+        return true;
+    }
+
+    bool loadBlock() {
+        if (block_ >= store_.blocks()) {
+            return false;
+        }
+
+        // the selected columns only
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            blocks_[i] = store_.read(columns_[i], block_, buffers_[i]);
+        }
+
+        rows_ = store_.block(0, block_).rows_;
+        row_  = 0;
+        block_++;
+        return true;
+    }
+
+    std::vector<size_t> columnOffsets() const override { return offsets_; }
+    std::vector<size_t> doublesDataSizes() const override { return sizes_; }
+    std::vector<char> columnsHaveMissing() const override { return hasMissing_; }
+    std::vector<double> missingValues() const override { return missingValues_; }
+    const double* data() const override { return data_.data(); }
+
+    const ColumnStore& store_;
+
+    size_t block_;  ///< next block to load
+    size_t row_;    ///< in the current block
+    size_t rows_;   ///< of the current block
+
+    std::vector<size_t> columns_;
+    std::vector<size_t> offsets_;
+    std::vector<size_t> sizes_;
+    std::vector<char> hasMissing_;
+    std::vector<double> missingValues_;
+
+    std::vector<Buffer> buffers_;        ///< for compressed columns
+    std::vector<const double*> blocks_;  ///< values of the current block, per column
+    std::vector<double> data_;
+};
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ColumnStoreTable::ColumnStoreTable(SQLDatabase& db, const PathName& directory, const std::string& name) :
+    SQLTable(db, directory, name), store_(new ColumnStore(directory)) {
+
+    for (size_t c = 0; c < store_->columns(); ++c) {
+        const ColumnStore::Column& column = store_->column(c);
+        addColumn(column.name_, int(c), type::SQLType::lookup(typeName(column.type_), column.width_),
+                  column.hasMissing_, column.missingValue_);
+    }
+}
+
+ColumnStoreTable::~ColumnStoreTable() {}
+
+SQLTableIterator* ColumnStoreTable::iterator(const std::vector<std::reference_wrapper<const SQLColumn>>& columns,
+                                             std::function<void(SQLTableIterator&)>) const {
+    return new ColumnStoreTableIterator(*store_, columns);
+}
+
+void ColumnStoreTable::print(std::ostream& s) const {
+    s << "ColumnStoreTable[name=" << name_ << ",store=" << *store_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::sql
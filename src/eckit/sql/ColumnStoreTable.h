@@ -0,0 +1,45 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#ifndef eckit_sql_ColumnStoreTable_H
+#define eckit_sql_ColumnStoreTable_H
+
+#include <memory>
+
+#include "eckit/container/ColumnStore.h"
+#include "eckit/sql/SQLTable.h"
+
+namespace eckit::sql {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// SQL table over a ColumnStore: a scan reads (and maps) only the columns of the query, block by block
+
+class ColumnStoreTable : public SQLTable {
+public:
+    ColumnStoreTable(SQLDatabase&, const PathName& directory, const std::string& name);
+    ~ColumnStoreTable() override;
+
+    const ColumnStore& store() const { return *store_; }
+
+    SQLTableIterator* iterator(const std::vector<std::reference_wrapper<const SQLColumn>>&,
+                               std::function<void(SQLTableIterator&)> metadataUpdateCallback) const override;
+
+    void print(std::ostream& s) const override;
+
+private:
+    std::unique_ptr<ColumnStore> store_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::sql
+
+#endif
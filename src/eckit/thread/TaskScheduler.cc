@@ -0,0 +1,274 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/thread/TaskScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+#include "eckit/runtime/Monitor.h"
+#include "eckit/thread/Thread.h"
+#include "eckit/thread/ThreadControler.h"
+
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Scheduler and worker index of the calling thread
+thread_local const TaskScheduler* currentScheduler = nullptr;
+thread_local size_t currentWorker                  = 0;
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class TaskScheduler::WorkerThread : public Thread {
+public:
+    WorkerThread(TaskScheduler& owner, size_t index) :
+        owner_(owner), index_(index) {}
+
+private:
+    void run() override {
+        Monitor::instance().name(owner_.name());
+        owner_.work(index_);
+    }
+
+    TaskScheduler& owner_;
+    size_t index_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TaskScheduler::Task::~Task() = default;
+
+TaskScheduler::TaskScheduler(const std::string& name, size_t count, size_t stack) :
+    name_(name), queued_(0), active_(0), sleeping_(0), next_(0), stop_(false) {
+    if (count == 0) {
+        count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    // all deques exist before any worker starts stealing
+    for (size_t i = 0; i < count; ++i) {
+        workers_.emplace_back(new Worker);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        workers_[i]->thread_ = std::make_unique<ThreadControler>(new WorkerThread(*this, i), false, stack);
+        workers_[i]->thread_->start();
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_);
+        stop_ = true;
+        wake_.notify_all();
+    }
+
+    for (auto& w : workers_) {
+        w->thread_->wait();
+    }
+}
+
+size_t TaskScheduler::current() const {
+    return currentScheduler == this ? currentWorker : size();
+}
+
+void TaskScheduler::spawn(Task* task) {
+    ASSERT(task);
+    ASSERT(!stop_);
+
+    size_t index   = current();
+    const bool own = index < size();
+    if (!own) {
+        index = next_++ % size();
+    }
+
+    active_++;
+    queued_++;
+
+    {
+        // the owner pops from the back: its own tasks last-in first-out, submissions from outside first-in first-out
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex_);
+        if (own) {
+            workers_[index]->tasks_.push_back(task);
+        }
+        else {
+            workers_[index]->tasks_.push_front(task);
+        }
+    }
+
+    if (sleeping_ > 0) {
+        std::lock_guard<std::mutex> lock(sleep_);
+        wake_.notify_one();
+    }
+}
+
+void TaskScheduler::wait() {
+    // a task waiting for all tasks would wait for itself, use a TaskGroup instead
+    ASSERT(current() == size());
+
+    std::unique_lock<std::mutex> lock(sleep_);
+    done_.wait(lock, [this] { return active_ == 0; });
+}
+
+bool TaskScheduler::runOne() {
+    Task* task = take(current());
+    if (task == nullptr) {
+        return false;
+    }
+
+    execute(task);
+    return true;
+}
+
+TaskScheduler::Task* TaskScheduler::pop(size_t index) {
+    auto& w = *workers_[index];
+    std::lock_guard<std::mutex> lock(w.mutex_);
+    if (w.tasks_.empty()) {
+        return nullptr;
+    }
+
+    // most recently spawned, likely to share data with the task that spawned it
+    Task* task = w.tasks_.back();
+    w.tasks_.pop_back();
+    return task;
+}
+
+TaskScheduler::Task* TaskScheduler::steal(size_t index) {
+    auto& w = *workers_[index];
+    std::unique_lock<std::mutex> lock(w.mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || w.tasks_.empty()) {
+        return nullptr;
+    }
+
+    // oldest, likely to spawn more work
+    Task* task = w.tasks_.front();
+    w.tasks_.pop_front();
+    return task;
+}
+
+TaskScheduler::Task* TaskScheduler::take(size_t index) {
+    const size_t N = size();
+
+    Task* task = index < N ? pop(index) : nullptr;
+    for (size_t i = 1; task == nullptr && i <= N && queued_ > 0; ++i) {
+        task = steal((index + i) % N);
+    }
+
+    if (task != nullptr) {
+        queued_--;
+    }
+    return task;
+}
+
+void TaskScheduler::execute(Task* task) {
+    try {
+        task->execute();
+    }
+    catch (std::exception& e) {
+        Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+        Log::error() << "** Exception is ignored" << std::endl;
+    }
+
+    delete task;
+
+    if (--active_ == 0) {
+        std::lock_guard<std::mutex> lock(sleep_);
+        done_.notify_all();
+    }
+}
+
+void TaskScheduler::work(size_t index) {
+    currentScheduler = this;
+    currentWorker    = index;
+
+    for (;;) {
+        if (runOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_);
+        sleeping_++;
+        wake_.wait(lock, [this] { return queued_ > 0 || stop_; });
+        sleeping_--;
+
+        if (stop_ && queued_ == 0) {
+            break;
+        }
+    }
+
+    currentScheduler = nullptr;
+}
+
+void TaskScheduler::idle() const {
+    std::this_thread::yield();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler) :
+    scheduler_(scheduler), pending_(0), cancelled_(false) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    }
+    catch (std::exception& e) {
+        Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+        Log::error() << "** Exception is ignored" << std::endl;
+    }
+}
+
+void TaskGroup::wait() {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+
+    if (scheduler_.current() < scheduler_.size()) {
+        scheduler_.helpWhile([this] { return pending_ > 0; });
+        lock.lock();  // synchronise with the last finished()
+    }
+    else {
+        lock.lock();
+        done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    cancelled_ = false;
+    if (error_) {
+        std::exception_ptr e;
+        std::swap(e, error_);
+        std::rethrow_exception(e);
+    }
+}
+
+void TaskGroup::error(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+        error_ = e;
+    }
+    cancelled_ = true;
+}
+
+void TaskGroup::finished() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) {
+        done_.notify_all();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -0,0 +1,225 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "eckit/memory/NonCopyable.h"
+
+
+namespace eckit {
+
+class ThreadControler;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Work-stealing task scheduler
+///
+/// Each worker owns a deque of tasks: tasks spawned from a worker are pushed to (and popped from) the back of its own
+/// deque, idle workers steal from the front of the others. Tasks submitted from outside the scheduler are distributed
+/// round-robin over the workers. There is no central queue, so that short tasks do not contend on a single lock.
+///
+/// Waiting from within a task (TaskGroup::wait(), TaskScheduler::get()) executes other tasks until the awaited work
+/// completes, so nested parallelism does not deadlock irrespective of the number of workers.
+class TaskScheduler : private NonCopyable {
+public:  // types
+    /// Type-erased unit of work
+    class Task {
+    public:
+        virtual ~Task();
+        virtual void execute() = 0;
+    };
+
+public:  // methods
+    /// @param count number of worker threads (0 means the number of hardware threads)
+    /// @param stack worker thread stack size (0 means the system default)
+    explicit TaskScheduler(const std::string& name, size_t count = 0, size_t stack = 0);
+
+    /// Completes all pending tasks, then stops the workers
+    ~TaskScheduler();
+
+    /// Schedule a callable, returning a future for its result (exceptions are stored in the future)
+    template <typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& f) {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        std::packaged_task<R()> task(std::forward<F>(f));
+        auto future = task.get_future();
+        spawn(new CallableTask<std::packaged_task<R()>>(std::move(task)));
+        return future;
+    }
+
+    /// Get the result of a future, executing other tasks while it is not ready if called from a worker
+    template <typename T>
+    T get(std::future<T>& future) {
+        if (current() < size()) {
+            helpWhile([&future] { return future.wait_for(std::chrono::seconds(0)) != std::future_status::ready; });
+        }
+        return future.get();
+    }
+
+    /// Schedule a task, taking ownership
+    void spawn(Task*);
+
+    /// Block until all tasks scheduled so far (and those they spawn) have completed
+    void wait();
+
+    const std::string& name() const { return name_; }
+
+    size_t size() const { return workers_.size(); }
+
+    /// @returns number of tasks scheduled but not yet started
+    size_t pending() const { return queued_.load(); }
+
+    /// @returns this scheduler's worker index of the calling thread, or size() if not a worker
+    size_t current() const;
+
+    /// Execute one pending task on the calling thread, if any
+    /// @returns false if there was no task to execute
+    bool runOne();
+
+    /// Execute pending tasks on the calling thread while the predicate holds (yielding if there is no task)
+    template <typename P>
+    void helpWhile(P&& predicate) {
+        while (predicate()) {
+            if (!runOne()) {
+                idle();
+            }
+        }
+    }
+
+private:  // types
+    template <typename F>
+    class CallableTask : public Task {
+    public:
+        explicit CallableTask(F&& f) :
+            f_(std::move(f)) {}
+        void execute() override { f_(); }
+
+    private:
+        F f_;
+    };
+
+    struct Worker {
+        std::mutex mutex_;
+        std::deque<Task*> tasks_;
+        std::unique_ptr<ThreadControler> thread_;
+    };
+
+    class WorkerThread;
+
+private:  // methods
+    Task* pop(size_t index);
+    Task* steal(size_t index);
+    Task* take(size_t index);
+
+    void execute(Task*);
+    void work(size_t index);
+    void idle() const;
+
+private:  // members
+    std::string name_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::atomic<size_t> queued_;   ///< tasks in the deques
+    std::atomic<size_t> active_;   ///< tasks spawned but not completed
+    std::atomic<size_t> sleeping_;
+    std::atomic<size_t> next_;     ///< round-robin target for external submissions
+    std::atomic<bool> stop_;
+
+    std::mutex sleep_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Set of tasks that can be waited for, or cancelled, together
+///
+/// The first exception thrown by a task of the group cancels the group, and is rethrown by wait(). Cancelled tasks
+/// that have not started are not executed; tasks already running are not interrupted.
+class TaskGroup : private NonCopyable {
+public:  // methods
+    explicit TaskGroup(TaskScheduler&);
+
+    /// Waits for the tasks of the group (exceptions are not rethrown)
+    ~TaskGroup();
+
+    template <typename F>
+    void run(F&& f) {
+        pending_++;
+        scheduler_.spawn(new GroupTask<std::decay_t<F>>(*this, std::forward<F>(f)));
+    }
+
+    /// Block until all tasks of the group have completed (executing other tasks if called from a worker), then
+    /// rethrow the first exception thrown by a task, if any. The group can be reused afterwards
+    void wait();
+
+    /// Prevent tasks of the group that have not started from executing
+    void cancel() { cancelled_ = true; }
+
+    bool cancelled() const { return cancelled_; }
+
+private:  // types
+    template <typename F>
+    class GroupTask : public TaskScheduler::Task {
+    public:
+        template <typename G>
+        GroupTask(TaskGroup& group, G&& f) :
+            group_(group), f_(std::forward<G>(f)) {}
+
+        void execute() override {
+            if (!group_.cancelled()) {
+                try {
+                    f_();
+                }
+                catch (...) {
+                    group_.error(std::current_exception());
+                }
+            }
+            group_.finished();
+        }
+
+    private:
+        TaskGroup& group_;
+        F f_;
+    };
+
+private:  // methods
+    void error(std::exception_ptr);
+    void finished();
+
+private:  // members
+    TaskScheduler& scheduler_;
+
+    std::atomic<size_t> pending_;
+    std::atomic<bool> cancelled_;
+
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::exception_ptr error_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
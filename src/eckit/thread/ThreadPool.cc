@@ -12,10 +12,11 @@
 // Baudouin Raoult - (c) ECMWF Feb 12
 
 #include "eckit/thread/ThreadPool.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
 #include "eckit/runtime/Monitor.h"
 #include "eckit/thread/AutoLock.h"
-#include "eckit/thread/Thread.h"
-#include "eckit/thread/ThreadControler.h"
+#include "eckit/thread/TaskScheduler.h"
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -23,37 +24,25 @@ namespace eckit {
 
 //----------------------------------------------------------------------------------------------------------------------
 
-class ThreadPoolThread : public Thread {
+namespace {
+
+class PoolTask : public TaskScheduler::Task {
     ThreadPool& owner_;
-    void run();
+    ThreadPoolTask* task_;
+    bool monitor_;
 
 public:
-    ThreadPoolThread(ThreadPool& owner) :
-        owner_(owner) {}
-};
-
-void ThreadPoolThread::run() {
-    owner_.notifyStart();
-
-    Monitor::instance().name(owner_.name());
+    /// @param monitor show the status of the thread while the task executes, as a thread of the pool
+    PoolTask(ThreadPool& owner, ThreadPoolTask* task, bool monitor = true) :
+        owner_(owner), task_(task), monitor_(monitor) {}
 
-    // Log::info() << "Start of ThreadPoolThread " << std::endl;
-
-
-    for (;;) {
-        Monitor::instance().show(false);
-        Log::status() << "-" << std::endl;
-        ThreadPoolTask* r = owner_.next();
-        if (!r) {
-            break;
+    void execute() override {
+        if (monitor_) {
+            Monitor::instance().show(true);
         }
-        Monitor::instance().show(true);
-
-        r->pool_ = &owner_;
-
 
         try {
-            r->execute();
+            task_->execute();
         }
         catch (std::exception& e) {
             Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
@@ -62,7 +51,7 @@ void ThreadPoolThread::run() {
         }
 
         try {
-            delete r;
+            delete task_;
         }
         catch (std::exception& e) {
             Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
@@ -70,24 +59,23 @@ void ThreadPoolThread::run() {
             owner_.error(e.what());
         }
 
-        owner_.endTask();
+        if (monitor_) {
+            Monitor::instance().show(false);
+            Log::status() << "-" << std::endl;
+        }
     }
+};
 
+}  // namespace
 
-    // Log::info() << "End of ThreadPoolThread " << std::endl;
-
-    owner_.notifyEnd();
-}
+//----------------------------------------------------------------------------------------------------------------------
 
 ThreadPool::ThreadPool(const std::string& name, size_t count, size_t stack) :
-    count_(0), stack_(stack), running_(0), tasks_(0), name_(name), error_(false) {
-    // Log::info() << "ThreadPool::ThreadPool " << nme_ << " " << count << std::endl;
+    stack_(stack), stopping_(0), name_(name), error_(false) {
     resize(count);
 }
 
 ThreadPool::~ThreadPool() {
-    // Log::info() << "ThreadPool::~ThreadPool " << name_ << std::endl;
-
     try {
         waitForThreads();
     }
@@ -98,56 +86,19 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::waitForThreads() {
+    wait();
 
-    for (size_t i = 0; i < count_; i++) {
-        push(0);
-    }
-
-
-    AutoLock<MutexCond> lock(done_);
-    // Log::info() << "ThreadPool::waitForThreads " << name_ << " running: " << running_ << std::endl;
-    while (running_) {
-        // Log::info() << "ThreadPool::waitForThreads " << name_ << " running: " << running_ << std::endl;
-        done_.wait();
-    }
-
+    AutoLock<Mutex> lock(mutex_);
     if (error_) {
         error_ = false;
-        throw SeriousBug(std::string("ThreadPool::waitForThreads: ") + errorMessage_);
+        std::string msg;
+        std::swap(msg, errorMessage_);
+        throw SeriousBug(std::string("ThreadPool::waitForThreads: ") + msg);
     }
 }
 
-void ThreadPool::notifyStart() {
-    AutoLock<MutexCond> lock(done_);
-    running_++;
-    done_.signal();
-    // Log::info() << "ThreadPool::notifyStart " << name_ << " running: " << running_ << std::endl;
-}
-
-void ThreadPool::notifyEnd() {
-    AutoLock<MutexCond> lock(done_);
-    running_--;
-    done_.signal();
-    // Log::info() << "ThreadPool::notifyEnd " << name_ << " running: " << running_ << std::endl;
-}
-
-
-void ThreadPool::startTask() {
-    AutoLock<MutexCond> lock(active_);
-    tasks_++;
-    active_.signal();
-    // Log::info() << "ThreadPool::notifyStart " << name_ << " running: " << running_ << std::endl;
-}
-
-void ThreadPool::endTask() {
-    AutoLock<MutexCond> lock(active_);
-    tasks_--;
-    active_.signal();
-    // Log::info() << "ThreadPool::notifyStart " << name_ << " running: " << running_ << std::endl;
-}
-
 void ThreadPool::error(const std::string& msg) {
-    AutoLock<MutexCond> lock(done_);
+    AutoLock<Mutex> lock(mutex_);
     if (error_) {
         errorMessage_ += " | ";
     }
@@ -156,64 +107,116 @@ void ThreadPool::error(const std::string& msg) {
 }
 
 void ThreadPool::push(ThreadPoolTask* r) {
-    if (r) {
-        startTask();
+    if (!r) {
+        AutoLock<Mutex> lock(mutex_);
+        stopping_++;
+        return;
+    }
+
+    r->pool_ = this;
+
+    // spawned outside the lock. A task spawned while resize() replaces the scheduler still completes on the current
+    // threads, when the last reference to their scheduler is released
+    if (std::shared_ptr<TaskScheduler> scheduler = current()) {
+        scheduler->spawn(new PoolTask(*this, r));
+        return;
+    }
+
+    AutoLock<Mutex> lock(mutex_);
+    if (scheduler_) {
+        scheduler_->spawn(new PoolTask(*this, r));  // threads were created meanwhile
+        return;
     }
 
-    AutoLock<MutexCond> lock(ready_);
     queue_.push_back(r);
-    ready_.signal();
 }
 
 void ThreadPool::push(std::list<ThreadPoolTask*>& l) {
-    AutoLock<MutexCond> lock(ready_);
-
-    for (std::list<ThreadPoolTask*>::iterator j = l.begin(); j != l.end(); ++j) {
-        queue_.push_back((*j));
+    for (auto* r : l) {
+        push(r);
     }
-
     l.clear();
-    ready_.signal();
 }
 
-ThreadPoolTask* ThreadPool::next() {
-    AutoLock<MutexCond> lock(ready_);
-    while (queue_.empty()) {
-        ready_.wait();
+void ThreadPool::wait() {
+    if (std::shared_ptr<TaskScheduler> scheduler = current()) {
+        scheduler->wait();
     }
 
-    ThreadPoolTask* r = queue_.front();
-    queue_.pop_front();
-
-    if (!queue_.empty()) {
-        ready_.signal();
+    // tasks pushed while there are no threads, and the tasks they push
+    for (;;) {
+        ThreadPoolTask* r = nullptr;
+        {
+            AutoLock<Mutex> lock(mutex_);
+            if (queue_.empty()) {
+                break;
+            }
+            r = queue_.front();
+            queue_.pop_front();
+        }
+        PoolTask(*this, r, false).execute();
     }
 
-    return r;
-}
-
-void ThreadPool::wait() {
-    AutoLock<MutexCond> lock(active_);
+    size_t stopping = 0;
+    {
+        AutoLock<Mutex> lock(mutex_);
+        std::swap(stopping, stopping_);
+    }
 
-    while (tasks_) {
-        active_.wait();
+    if (stopping > 0) {
+        resize(size() > stopping ? size() - stopping : 0);
     }
 }
 
 void ThreadPool::resize(size_t size) {
+    std::shared_ptr<TaskScheduler> scheduler;
+    {
+        AutoLock<Mutex> lock(mutex_);
+
+        // destroying the scheduler would wait for the calling task
+        if (scheduler_ && scheduler_->current() < scheduler_->size()) {
+            throw SeriousBug("ThreadPool::resize() called from a task of " + name_);
+        }
+
+        if ((scheduler_ ? scheduler_->size() : 0) == size) {
+            return;
+        }
+
+        // tasks pushed from now on are queued for the new threads
+        scheduler = std::atomic_exchange(&scheduler_, std::shared_ptr<TaskScheduler>());
+    }
 
-    while (count_ > size) {
-        push(0);
-        count_--;
+    // pending tasks complete on the current threads (destroying the scheduler completes those spawned meanwhile)
+    if (scheduler) {
+        scheduler->wait();
+        scheduler.reset();
     }
 
-    while (count_ < size) {
-        ThreadControler c(new ThreadPoolThread(*this), true, stack_);
-        c.start();
-        count_++;
+    if (size > 0) {
+        AutoLock<Mutex> lock(mutex_);
+        std::atomic_store(&scheduler_, std::make_shared<TaskScheduler>(name_, size, stack_));
+
+        std::list<ThreadPoolTask*> queued;
+        std::swap(queued, queue_);
+        push(queued);
     }
 }
 
+size_t ThreadPool::size() const {
+    std::shared_ptr<TaskScheduler> scheduler = current();
+    return scheduler ? scheduler->size() : 0;
+}
+
+std::shared_ptr<TaskScheduler> ThreadPool::current() const {
+    return std::atomic_load(&scheduler_);
+}
+
+TaskScheduler& ThreadPool::scheduler() {
+    AutoLock<Mutex> lock(mutex_);
+    ASSERT(scheduler_);
+    return *scheduler_;
+}
+
 ThreadPoolTask::~ThreadPoolTask() {}
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -12,9 +12,10 @@
 #define eckit_ThreadPool_h
 
 #include <list>
+#include <memory>
 #include <string>
 
-#include "eckit/thread/MutexCond.h"
+#include "eckit/thread/Mutex.h"
 
 
 namespace eckit {
@@ -29,7 +30,7 @@ public:
     virtual ~ThreadPoolTask();
     virtual void execute() = 0;
 
-    friend class ThreadPoolThread;
+    friend class ThreadPool;
 
 protected:
     ThreadPool& pool() { return *pool_; }
@@ -40,6 +41,14 @@ private:
 
 //-----------------------------------------------------------------------------
 
+class TaskScheduler;
+
+/// Pool of threads executing ThreadPoolTasks, scheduled by a (work-stealing) TaskScheduler
+///
+/// Tasks are owned by the pool once pushed, and deleted after execution. Exceptions thrown by tasks are collected and
+/// reported by waitForThreads(). For results, task groups and nested parallelism, use scheduler() directly.
+///
+/// A pool of zero threads queues the tasks, executed by the thread calling wait().
 class ThreadPool : private NonCopyable {
 
 public:  // methods
@@ -47,34 +56,44 @@ public:  // methods
 
     ~ThreadPool();
 
+    /// Push a task, or a null task which stops one of the threads once the tasks pushed so far are executed
     void push(ThreadPoolTask*);
     void push(std::list<ThreadPoolTask*>&);
-    ThreadPoolTask* next();
-    void notifyStart();
-    void notifyEnd();
+
+    /// Wait for all tasks to complete, and throw if any task failed
     void waitForThreads();
+
     const std::string& name() const { return name_; }
     void error(const std::string&);
 
+    /// Wait for all tasks to complete
     void wait();
+
+    /// Change the number of threads, after waiting for all tasks to complete
+    /// @note throws if called from a task of this pool
     void resize(size_t);
 
-    void startTask();
-    void endTask();
+    /// Number of threads
+    size_t size() const;
+
+    /// @pre size() > 0
+    TaskScheduler& scheduler();
+
+private:  // methods
+    std::shared_ptr<TaskScheduler> current() const;
 
 private:  // members
-    MutexCond ready_;
-    MutexCond done_;
-    MutexCond active_;
+    mutable Mutex mutex_;
 
-    size_t count_;
     size_t stack_;
-    size_t running_;
-    size_t tasks_;
+    size_t stopping_;  ///< threads to stop, requested by null tasks
 
     std::string errorMessage_;
     std::string name_;
-    std::list<ThreadPoolTask*> queue_;
+
+    std::list<ThreadPoolTask*> queue_;  ///< tasks pushed while the pool has no threads
+
+    std::shared_ptr<TaskScheduler> scheduler_;  ///< replaced by resize() under mutex_, read with std::atomic_load
 
     bool error_;
 };
@@ -48,10 +48,10 @@ public:
 
     FixedString();
     FixedString(const std::string&);
-    FixedString(const FixedString&);
+    FixedString(const FixedString&) = default;
     FixedString(const char*);
 
-    FixedString& operator=(const FixedString&);
+    FixedString& operator=(const FixedString&) = default;
     FixedString& operator=(const std::string&);
 
     bool operator<(const FixedString& other) const { return ::memcmp(data_, other.data_, SIZE) < 0; }
@@ -109,11 +109,6 @@ FixedString<SIZE>::FixedString(const std::string& s) {
     std::copy(s.begin(), s.end(), data_);
 }
 
-template <int SIZE>
-FixedString<SIZE>::FixedString(const FixedString& other) {
-    ::memcpy(data_, other.data_, SIZE);
-}
-
 template <int SIZE>
 FixedString<SIZE>::FixedString(const char* s) {
     ASSERT(sizeof(char) == 1 && s && strlen(s) <= SIZE);
@@ -121,14 +116,6 @@ FixedString<SIZE>::FixedString(const char* s) {
     ::memcpy(data_, s, strlen(s));
 }
 
-template <int SIZE>
-FixedString<SIZE>& FixedString<SIZE>::operator=(const FixedString& s) {
-    if (this != &s) {
-        ::memcpy(data_, s.data_, SIZE);
-    }
-    return *this;
-}
-
 template <int SIZE>
 FixedString<SIZE>& FixedString<SIZE>::operator=(const std::string& s) {
     ASSERT(s.length() <= SIZE && sizeof(s[0]) == 1);
@@ -97,6 +97,9 @@ public:
     bool has(const std::string& name);
     void list(std::ostream&);
 
+    /// @returns name of the default compressor (resource defaultCompression, or none if not available)
+    std::string defaultCompression();
+
     /// @returns default compressor
     Compressor* build();
 
@@ -0,0 +1,64 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/utils/ZstdCompressor.h"
+
+#include "zstd.h"  // header includes extern c linkage
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+
+namespace eckit {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ZstdCompressor::ZstdCompressor() {}
+
+ZstdCompressor::~ZstdCompressor() {}
+
+size_t ZstdCompressor::compress(const void* in, size_t len, Buffer& out) const {
+    static const int level = Resource<int>("zstdCompressionLevel;$ECKIT_ZSTD_COMPRESSION_LEVEL", ZSTD_CLEVEL_DEFAULT);
+
+    const size_t maxcompressed = ZSTD_compressBound(len);
+
+    if (out.size() < maxcompressed) {
+        out.resize(maxcompressed);
+    }
+
+    const size_t compressed = ZSTD_compress(out, maxcompressed, in, len, level);
+
+    if (ZSTD_isError(compressed)) {
+        throw FailedLibraryCall("ZSTD", "ZSTD_compress", ZSTD_getErrorName(compressed), Here());
+    }
+
+    return compressed;
+}
+
+void ZstdCompressor::uncompress(const void* in, size_t len, Buffer& out, size_t outlen) const {
+
+    if (out.size() < outlen) {
+        out.resize(outlen);
+    }
+
+    const size_t uncompressed = ZSTD_decompress(out, out.size(), in, len);
+
+    if (ZSTD_isError(uncompressed)) {
+        throw FailedLibraryCall("ZSTD", "ZSTD_decompress", ZSTD_getErrorName(uncompressed), Here());
+    }
+
+    ASSERT(uncompressed == outlen);
+}
+
+CompressorBuilder<ZstdCompressor> zstd("zstd");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit
@@ -13,6 +13,7 @@
 #include <map>
 
 #include "eckit/container/DenseMap.h"
+#include "eckit/container/FlatHashMap.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/log/Timer.h"
 #include "eckit/types/FixedString.h"
@@ -102,6 +103,34 @@ void benchmark_stdmap_int_string(const std::string& tname) {
     }
 }
 
+/// Incremental build, with a lookup after each insertion (e.g. an index of metadata)
+template <typename MAP>
+void benchmark_interleaved(const std::string& tname, int size) {
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << tname << " interleaved, " << size << " items" << std::endl;
+
+    MAP m;
+    size_t found = 0;
+
+    {
+        Timer timer("insert+find");
+        for (int i = 0; i < size; ++i) {
+            m.insert(i, i);
+            m.sort();
+            found += m.find(rand() % (i + 1)) != m.cend() ? 1 : 0;
+        }
+    }
+
+    ASSERT(found == size_t(size));
+}
+
+template <typename K, typename V>
+struct StdMap : std::map<K, V> {
+    using std::map<K, V>::insert;
+    void insert(const K& k, const V& v) { this->emplace(k, v); }
+    void sort() {}
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 
 CASE("benchmark_densemap") {
@@ -115,6 +144,21 @@ CASE("benchmark_densemap") {
     benchmark_stdmap_int_string<std::map<int, FixedString<256> > >("std::map<int,FixedString>");
 }
 
+CASE("benchmark_flathashmap") {
+
+    benchmark_densemap_int_string<FlatHashMap<int, std::string> >("FlatHashMap<int,string>");
+    benchmark_densemap_int_string<FlatHashMap<int, FixedString<256> > >("FlatHashMap<int,FixedString>");
+}
+
+CASE("benchmark_interleaved") {
+
+    const int size = 5000;
+
+    benchmark_interleaved<DenseMap<int, int> >("DenseMap<int,int>", size);
+    benchmark_interleaved<StdMap<int, int> >("std::map<int,int>", size);
+    benchmark_interleaved<FlatHashMap<int, int> >("FlatHashMap<int,int>", size);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit::test
@@ -0,0 +1,97 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "eckit/container/Queue.h"
+#include "eckit/container/RingQueue.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Timer.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#define QSIZE 1024
+#define NITEMS 200000
+
+template <typename QUEUE>
+void benchmark_queue(const std::string& tname, size_t nprod, size_t ncons, size_t batch) {
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << tname << " producers=" << nprod << " consumers=" << ncons << " batch=" << batch << std::endl;
+
+    QUEUE q(QSIZE);
+    size_t total = 0;
+
+    {
+        Timer timer("transfer");
+
+        std::vector<std::thread> producers;
+        for (size_t id = 0; id < nprod; ++id) {
+            producers.emplace_back([&q, nprod] {
+                for (size_t j = 0; j < NITEMS / nprod; ++j) {
+                    q.push(j);
+                }
+            });
+        }
+
+        std::vector<size_t> counts(ncons, 0);
+        std::vector<std::thread> consumers;
+        for (size_t id = 0; id < ncons; ++id) {
+            consumers.emplace_back([&q, &counts, id, batch] {
+                std::vector<size_t> elems(batch);
+                long n;
+                while ((n = q.pop(elems)) > 0) {
+                    counts[id] += n;
+                }
+            });
+        }
+
+        for (auto& p : producers) {
+            p.join();
+        }
+        q.close();
+        for (auto& c : consumers) {
+            c.join();
+        }
+
+        for (auto c : counts) {
+            total += c;
+        }
+    }
+
+    ASSERT(total == (NITEMS / nprod) * nprod);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("benchmark_queue") {
+    for (size_t threads : {1, 4}) {
+        for (size_t batch : {1, 64}) {
+            benchmark_queue<Queue<size_t> >("Queue<size_t>", threads, threads, batch);
+            benchmark_queue<RingQueue<size_t> >("RingQueue<size_t>", threads, threads, batch);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
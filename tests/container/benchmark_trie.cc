@@ -0,0 +1,106 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/container/RadixTree.h"
+#include "eckit/container/Trie.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Timer.h"
+#include "eckit/system/MemoryInfo.h"
+#include "eckit/system/SystemInfo.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#define NKEYS 100000
+
+/// Request-like keys, e.g. class=od,expver=0001,stream=oper,date=20170101,time=1200,...
+std::vector<std::string> requests() {
+    std::mt19937 rng(42);
+    std::vector<std::string> keys;
+    keys.reserve(NKEYS);
+    for (int i = 0; i < NKEYS; ++i) {
+        std::ostringstream s;
+        s << "class=od,expver=000" << (rng() % 4) << ",stream=" << (rng() % 2 ? "oper" : "enfo")
+          << ",type=fc,levtype=pl,date=2017" << (1000 + rng() % 1231) << ",time=" << (rng() % 4) * 6
+          << "00,step=" << (rng() % 240) << ",levelist=" << (rng() % 1000) << ",param=" << (rng() % 300);
+        keys.push_back(s.str());
+    }
+    return keys;
+}
+
+size_t allocated() {
+    return system::SystemInfo::instance().memoryUsage().uordblks_;
+}
+
+template <typename TREE>
+void benchmark(const std::string& tname, const std::vector<std::string>& keys) {
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << tname << std::endl;
+
+    const size_t before = allocated();
+    {
+        auto t = std::make_unique<TREE>();
+
+        {
+            Timer timer("insert");
+            for (size_t i = 0; i < keys.size(); ++i) {
+                t->insert(keys[i], int(i));
+            }
+        }
+
+        std::cout << "heap: " << (allocated() - before) / 1024 << " KiB" << std::endl;
+
+        {
+            Timer timer("find");
+            for (size_t i = 0; i < keys.size(); ++i) {
+                ASSERT(t->contains(keys[(i * 7919) % keys.size()]));
+            }
+        }
+
+        {
+            Timer timer("remove");
+            for (const auto& key : keys) {
+                t->remove(key);
+            }
+        }
+
+        ASSERT(t->empty());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("benchmark_trie") {
+    const std::vector<std::string> keys = requests();
+
+    benchmark<Trie<int> >("Trie<int>", keys);
+    benchmark<RadixTree<int> >("RadixTree<int>", keys);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
@@ -8,7 +8,20 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "eckit/container/BlockedBloomFilter.h"
 #include "eckit/container/BloomFilter.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/log/Log.h"
+#include "eckit/serialisation/FileStream.h"
 #include "eckit/testing/Test.h"
 
 using namespace std;
@@ -35,6 +48,150 @@ CASE("test_eckit_container_bloomfilter_insert") {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+CASE("test_eckit_container_blockedbloomfilter") {
+
+    const size_t N = 10000;
+
+    BlockedBloomFilter f(N, 0.01);
+    EXPECT(f.empty());
+    EXPECT(f.hashes() == 7);
+    EXPECT(f.bits() >= N * 9);
+
+    EXPECT(!f.contains("hello there"));
+
+    f.insert("hello there");
+    f.insert(std::string("hello again"));
+    f.insert(42L);
+
+    EXPECT(f.contains("hello there"));
+    EXPECT(f.contains(std::string("hello there")));
+    EXPECT(f.contains("hello again"));
+    EXPECT(f.contains(42L));
+    EXPECT(!f.contains(43L));
+    EXPECT(f.insertions() == 3);
+
+    SECTION("false positive rate") {
+        std::vector<long> keys(N);
+        for (size_t i = 0; i < N; ++i) {
+            keys[i] = long(i);
+        }
+        f.insert(keys.begin(), keys.end());
+
+        std::vector<bool> found;
+        EXPECT(f.contains(keys.begin(), keys.end(), std::back_inserter(found)) == N);
+        EXPECT(std::all_of(found.begin(), found.end(), [](bool b) { return b; }));
+
+        size_t positives = 0;
+        for (size_t i = N; i < 11 * N; ++i) {
+            positives += f.contains(long(i)) ? 1 : 0;
+        }
+
+        // blocked filters are slightly worse than the target rate
+        double rate = double(positives) / double(10 * N);
+        Log::info() << f << " false positive rate " << rate << std::endl;
+        EXPECT(rate < 0.02);
+    }
+
+    SECTION("string views") {
+        // views are hashed by their characters, not by their pointer
+        const std::string key("a key held by a view");
+        f.insert(std::string_view(key));
+
+        const std::string copy(key);
+        EXPECT(f.contains(copy));
+        EXPECT(f.contains(std::string_view(copy)));
+        EXPECT(f.contains(copy.c_str()));
+
+        std::vector<std::string_view> views{std::string_view(copy).substr(0, 5), "another key"};
+        f.insert(views.begin(), views.end());
+        EXPECT(f.contains(std::string("a key")));
+        EXPECT(f.contains("another key"));
+    }
+
+    SECTION("union/intersection") {
+        BlockedBloomFilter a(N, 0.01);
+        BlockedBloomFilter b(N, 0.01);
+        a.insert("a");
+        a.insert("ab");
+        b.insert("b");
+        b.insert("ab");
+
+        BlockedBloomFilter u(N, 0.01);
+        u |= a;
+        u |= b;
+        EXPECT(u.contains("a") && u.contains("b") && u.contains("ab"));
+
+        a &= b;
+        EXPECT(a.contains("ab"));
+        EXPECT(!a.contains("a") && !a.contains("b"));
+
+        BlockedBloomFilter other(10 * N, 0.01);
+        EXPECT_THROWS_AS(other |= b, AssertionFailed);
+    }
+
+    SECTION("serialisation") {
+        PathName path = PathName::unique("bloom");
+
+        {
+            FileStream s(path, "w");
+            f.encode(s);
+            s.close();
+        }
+
+        {
+            FileStream s(path, "r");
+            BlockedBloomFilter g(s);
+            s.close();
+            EXPECT(g.bits() == f.bits() && g.hashes() == f.hashes() && g.insertions() == f.insertions());
+            EXPECT(g.contains("hello there") && g.contains(42L) && !g.contains(43L));
+        }
+
+        f.save(path);
+
+        BlockedBloomFilter g(path);
+        EXPECT(g.readOnly());
+        EXPECT(g.bits() == f.bits() && g.insertions() == f.insertions());
+        EXPECT(g.contains("hello there") && g.contains(42L) && !g.contains(43L));
+        EXPECT_THROWS_AS(g.insert("read-only"), AssertionFailed);
+
+        path.unlink();
+    }
+
+    SECTION("invalid files") {
+        PathName path = PathName::unique("bloom");
+        f.save(path);
+
+        std::string content;
+        {
+            std::ifstream in(path.localPath(), std::ios::binary);
+            content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        auto rewrite = [&](const std::string& data) {
+            std::ofstream out(path.localPath(), std::ios::binary | std::ios::trunc);
+            out.write(data.data(), std::streamsize(data.size()));
+        };
+
+        // header only, of no blocks
+        std::string header   = content.substr(0, 64);
+        std::uint64_t blocks = 0;
+        std::memcpy(&header[16], &blocks, sizeof(blocks));
+        rewrite(header);
+        EXPECT_THROWS_AS(BlockedBloomFilter{path}, BadValue);
+
+        // more hashes than bits in a block pattern
+        std::string data     = content;
+        std::uint64_t hashes = 17;
+        std::memcpy(&data[24], &hashes, sizeof(hashes));
+        rewrite(data);
+        EXPECT_THROWS_AS(BlockedBloomFilter{path}, BadValue);
+
+        path.unlink();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 }  // namespace eckit::test
 
 int main(int argc, char** argv) {
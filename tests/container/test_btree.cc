@@ -8,7 +8,17 @@
  * does it submit to any jurisdiction.
  */
 
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <random>
+#include <thread>
+#include <vector>
 
 #include "eckit/container/BTree.h"
 #include "eckit/os/Semaphore.h"
@@ -344,6 +354,413 @@ CASE("test_eckit_container_fixedsttring_fixedsttring") {
     //  btree.dump();
 }
 
+CASE("test_eckit_container_btree_page_cache") {
+    const int N = 20000;
+
+    unlink("cache");
+
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    {
+        BTree<int, int, 256> btree("cache");
+        btree.cacheSize(8);
+        EXPECT(btree.cacheSize() == 8);
+
+        for (int k : keys) {
+            btree.set(k, -k);
+        }
+
+        // the cache is bounded, dirty pages have been written back on eviction
+        EXPECT(btree.statistics().evictions_ > 0);
+        EXPECT(btree.statistics().writeBacks_ > 0);
+
+        for (int k : keys) {
+            int v;
+            EXPECT(btree.get(k, v) && v == -k);
+        }
+        EXPECT(btree.count() == N);
+    }
+
+    auto expected = [](int key1, int key2) {
+        std::vector<std::pair<int, int> > result;
+        for (int k = std::max(0, key1 + key1 % 2); k <= key2 && k < 2 * N; k += 2) {
+            result.emplace_back(k, -k);
+        }
+        return result;
+    };
+
+    SECTION("range with read-ahead") {
+        BTree<int, int, 256> btree("cache", true);
+        btree.cacheSize(16);
+
+        std::vector<std::pair<int, int> > result;
+        btree.range(-1, 2 * N, result);
+        EXPECT(result == expected(-1, 2 * N));
+        EXPECT(btree.statistics().readAheads_ > 0);
+
+        // ranges starting beyond the last key of a leaf continue in the next leaf
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> dist(-10, 2 * N + 10);
+        for (int i = 0; i < 200; ++i) {
+            int a = dist(gen);
+            int b = a + dist(gen) % 500;
+            btree.range(a, b, result);
+            EXPECT(result == expected(a, b));
+        }
+
+        btree.readAhead(0);
+        btree.resetStatistics();
+        btree.range(0, 2 * N, result);
+        EXPECT(result.size() == N);
+        EXPECT(btree.statistics().readAheads_ == 0);
+    }
+
+    SECTION("cache smaller than the shards") {
+        BTree<int, int, 256> btree("cache", true);
+        btree.cacheSize(4);
+
+        // each shard keeps a page: a key read again is found in the cache, unless pages of its path share a shard
+        size_t cached = 0;
+        for (int i = 0; i < 100; ++i) {
+            int v;
+            EXPECT(btree.get(keys[i], v) && v == -keys[i]);
+            const size_t misses = btree.statistics().misses_;
+            EXPECT(btree.get(keys[i], v) && v == -keys[i]);
+            cached += btree.statistics().misses_ == misses ? 1 : 0;
+        }
+        EXPECT(cached >= 25);
+    }
+
+    SECTION("memory mapped") {
+        BTree<int, int, 256> btree("cache", true);
+        btree.mmap();
+
+        for (int k : keys) {
+            int v;
+            EXPECT(btree.get(k, v) && v == -k);
+        }
+
+        std::vector<std::pair<int, int> > result;
+        btree.range(100, 300, result);
+        EXPECT(result == expected(100, 300));
+
+        EXPECT(btree.statistics().mapped_ > 0);
+        EXPECT(btree.statistics().misses_ == 0);
+    }
+}
+
+CASE("test_eckit_container_btree_bulk") {
+    const int N = 20000;
+
+    std::vector<std::pair<int, int> > entries;
+    for (int i = 0; i < N; ++i) {
+        entries.emplace_back(3 * i, i);
+    }
+
+    for (double fill : {1., 0.5}) {
+        unlink("bulk");
+
+        BTree<int, int, 256> btree("bulk");
+        btree.build(entries.begin(), entries.end(), fill);
+
+        EXPECT(btree.count() == N);
+
+        std::vector<std::pair<int, int> > result;
+        btree.range(0, 3 * N, result);
+        EXPECT(result == entries);
+
+        btree.range(301, 599, result);
+        EXPECT(result.size() == 99);
+        EXPECT(result.front().first == 303 && result.back().first == 597);
+
+        for (const auto& e : entries) {
+            int v;
+            EXPECT(btree.get(e.first, v) && v == e.second);
+        }
+
+        // the tree is still updatable
+        EXPECT(!btree.set(1, 1));
+        EXPECT(btree.count() == N + 1);
+
+        EXPECT_THROWS_AS(btree.build(entries.begin(), entries.end()), AssertionFailed);
+    }
+
+    SECTION("not sorted") {
+        unlink("bulk");
+        BTree<int, int, 256> btree("bulk");
+        std::vector<std::pair<int, int> > unsorted{{1, 1}, {3, 3}, {2, 2}};
+        EXPECT_THROWS_AS(btree.build(unsorted.begin(), unsorted.end()), AssertionFailed);
+    }
+
+    SECTION("single leaf") {
+        unlink("bulk");
+        BTree<int, int, 256> btree("bulk");
+        btree.build(entries.begin(), entries.begin() + 5);
+        EXPECT(btree.count() == 5);
+
+        int v;
+        EXPECT(btree.get(12, v) && v == 4);
+    }
+
+    SECTION("batched get and set") {
+        unlink("bulk");
+        BTree<int, int, 256> btree("bulk");
+        btree.build(entries.begin(), entries.end(), 0.7);
+
+        std::mt19937 gen(3);
+        std::uniform_int_distribution<int> dist(-10, 3 * N + 10);
+
+        std::vector<int> keys(5000);
+        for (auto& k : keys) {
+            k = dist(gen);
+        }
+
+        std::vector<int> values;
+        std::vector<bool> found;
+        size_t count = btree.get(keys, values, found);
+
+        size_t expected = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const bool exists = keys[i] >= 0 && keys[i] < 3 * N && keys[i] % 3 == 0;
+            EXPECT(found[i] == exists);
+            if (exists) {
+                EXPECT(values[i] == keys[i] / 3);
+                expected++;
+            }
+        }
+        EXPECT(count == expected);
+
+        // new keys, replacements, and duplicates (the last one wins)
+        std::vector<std::pair<int, int> > updates;
+        for (int k : keys) {
+            updates.emplace_back(k, -k);
+        }
+        updates.emplace_back(keys[0], 42);
+        btree.set(updates);
+
+        count = btree.get(keys, values, found);
+        EXPECT(count == keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            EXPECT(found[i]);
+            EXPECT(values[i] == (keys[i] == keys[0] ? 42 : -keys[i]));
+        }
+
+        std::vector<std::pair<int, int> > result;
+        btree.range(-10, 3 * N + 10, result);
+        EXPECT(result.size() == btree.count());
+        EXPECT(std::is_sorted(result.begin(), result.end()));
+    }
+}
+
+template <class L>
+void concurrentReaders(const char* path) {
+    const int N = 20000;
+
+    unlink(path);
+
+    std::vector<std::pair<int, int> > entries;
+    for (int i = 0; i < N; ++i) {
+        entries.emplace_back(2 * i, i);
+    }
+
+    BTree<int, int, 256, L> btree(path);
+    btree.cacheSize(64);
+    btree.build(entries.begin(), entries.end());
+
+    // the writer inserts the odd keys (splitting pages), while readers look up and scan the even ones
+    std::atomic<bool> done{false};
+    std::atomic<size_t> errors{0};
+
+    std::thread writer([&] {
+        std::vector<int> keys;
+        for (int i = 0; i < N; ++i) {
+            keys.push_back(2 * i + 1);
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+        for (int k : keys) {
+            btree.set(k, -k);
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937 gen(r);
+            std::uniform_int_distribution<int> dist(0, N - 1);
+            std::vector<std::pair<int, int> > result;
+
+            do {
+                const int i = dist(gen);
+                int v;
+                if (!btree.get(2 * i, v) || v != i) {
+                    errors++;
+                }
+
+                btree.range(2 * i, 2 * i + 200, result);
+                size_t even = 0;
+                for (size_t j = 0; j < result.size(); ++j) {
+                    if (j > 0 && !(result[j - 1].first < result[j].first)) {
+                        errors++;
+                    }
+                    even += (result[j].first % 2 == 0) ? 1 : 0;
+                }
+                if (even != size_t(std::min(101, N - i))) {
+                    errors++;
+                }
+            } while (!done);
+        });
+    }
+
+    writer.join();
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    EXPECT(errors == 0);
+    EXPECT(btree.count() == size_t(2 * N));
+
+    for (int k = 0; k < 2 * N; ++k) {
+        int v;
+        EXPECT(btree.get(k, v) && v == (k % 2 ? -k : k / 2));
+    }
+}
+
+CASE("test_eckit_container_btree_concurrent_readers") {
+    SECTION("no locking") {
+        concurrentReaders<BTreeNoLock>("concurrent");
+    }
+
+    SECTION("file locking") {
+        concurrentReaders<BTreeLock>("concurrent");
+    }
+}
+
+template <class L>
+void reentrantLocks(const char* path) {
+    unlink(path);
+
+    BTree<int, int, 256, L> btree(path);
+
+    {
+        AutoLock<BTree<int, int, 256, L> > lock(btree);
+        for (int i = 0; i < 1000; ++i) {
+            EXPECT(!btree.set(i, i));
+        }
+        EXPECT(btree.count() == 1000);
+
+        int v;
+        EXPECT(btree.get(10, v) && v == 10);
+    }
+
+    // upgrades a shared lock
+    {
+        AutoSharedLock<BTree<int, int, 256, L> > shared(btree);
+        AutoLock<BTree<int, int, 256, L> > lock(btree);
+        EXPECT(btree.set(10, -10));
+
+        int v;
+        EXPECT(btree.get(10, v) && v == -10);
+    }
+
+    // then updates from another thread
+    {
+        std::thread writer([&] {
+            AutoLock<BTree<int, int, 256, L> > lock(btree);
+            EXPECT(btree.set(20, -20));
+        });
+        writer.join();
+
+        int v;
+        EXPECT(btree.get(20, v) && v == -20);
+        EXPECT(btree.count() == 1000);
+    }
+}
+
+CASE("test_eckit_container_btree_reentrant_locks") {
+    SECTION("no locking") {
+        reentrantLocks<BTreeNoLock>("reentrant");
+    }
+
+    SECTION("file locking") {
+        reentrantLocks<BTreeLock>("reentrant");
+    }
+}
+
+CASE("test_eckit_container_btree_file_lock_of_another_process") {
+    const char* path = "locked";
+    unlink(path);
+
+    BTree<int, int, 256, BTreeLock> btree(path);
+    btree.set(1, 1);
+
+    // another process holds a read lock on the file until told to release it
+    int ready[2];
+    int release[2];
+    EXPECT(::pipe(ready) == 0 && ::pipe(release) == 0);
+
+    pid_t pid = ::fork();
+    EXPECT(pid >= 0);
+
+    if (pid == 0) {
+        int fd = ::open(path, O_RDONLY);
+
+        struct flock lock;
+        lock.l_type   = F_RDLCK;
+        lock.l_whence = SEEK_SET;
+        lock.l_start  = 0;
+        lock.l_len    = 0;
+
+        char c = (fd >= 0 && ::fcntl(fd, F_SETLKW, &lock) == 0) ? 'y' : 'n';
+        if (::write(ready[1], &c, 1) != 1 || ::read(release[0], &c, 1) != 1) {
+            ::_exit(1);
+        }
+        ::_exit(0);
+    }
+
+    char c = 0;
+    EXPECT(::read(ready[0], &c, 1) == 1 && c == 'y');
+
+    // a reader of this process holds a shared lock, and releases it while a writer waits for the other process
+    std::promise<void> held;
+    std::promise<void> go;
+    std::promise<void> unlocked;
+
+    std::thread reader([&] {
+        {
+            AutoSharedLock<BTree<int, int, 256, BTreeLock> > lock(btree);
+            held.set_value();
+            go.get_future().wait();
+        }
+        unlocked.set_value();
+    });
+    held.get_future().wait();
+
+    std::thread writer([&] { btree.set(2, 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    go.set_value();
+    EXPECT(unlocked.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+
+    EXPECT(::write(release[1], &c, 1) == 1);
+    writer.join();
+    reader.join();
+
+    int status = 0;
+    EXPECT(::waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    int v;
+    EXPECT(btree.get(2, v) && v == 2);
+
+    for (int fd : {ready[0], ready[1], release[0], release[1]}) {
+        ::close(fd);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit::test
@@ -8,9 +8,13 @@
  * does it submit to any jurisdiction.
  */
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "eckit/container/CacheLRU.h"
+#include "eckit/container/ConcurrentCacheLRU.h"
 #include "eckit/exception/Exceptions.h"
 
 #include "eckit/testing/Test.h"
@@ -178,6 +182,164 @@ CASE("test_cache_lru_purge") {
     EXPECT(purgeCalls == 3);
 }
 
+CASE("test_concurrent_cache_lru_basic") {
+    // single shard, for a deterministic order of eviction
+    ConcurrentCacheLRU<std::string, std::string> cache(3, nullptr, 1);
+
+    EXPECT(cache.size() == 0);
+    EXPECT(cache.capacity() == 3);
+    EXPECT(cache.shards() == 1);
+
+    EXPECT(!cache.find("a"));
+
+    cache.insert("a", "1");
+    cache.insert("b", "2");
+    cache.insert("c", "3");
+    EXPECT(cache.size() == 3);
+
+    // a is the most recent, b is evicted
+    auto a = cache.find("a");
+    EXPECT(a && *a == "1");
+    cache.insert("d", "4");
+    EXPECT(cache.size() == 3);
+    EXPECT(!cache.exists("b"));
+    EXPECT(cache.exists("a"));
+
+    // handles outlive eviction
+    cache.capacity(0);
+    EXPECT(cache.size() == 0);
+    EXPECT(*a == "1");
+
+    cache.capacity(3);
+    cache.insert("a", "1");
+    cache.insert("a", "one");
+    EXPECT(cache.size() == 1);
+    EXPECT(*cache.find("a") == "one");
+    EXPECT(cache.remove("a"));
+    EXPECT(!cache.remove("a"));
+
+    auto stats = cache.statistics();
+    EXPECT(stats.hits_ == 2);
+    EXPECT(stats.misses_ == 1);
+    EXPECT(stats.inserts_ == 6);
+    EXPECT(stats.evictions_ == 4);
+
+    cache.resetStatistics();
+    EXPECT(cache.statistics().hits_ == 0);
+}
+
+CASE("test_concurrent_cache_lru_cost") {
+    // capacity in bytes
+    ConcurrentCacheLRU<int, std::vector<char>> cache(
+        100, [](const int&, const std::vector<char>& v) { return v.size(); }, 1);
+
+    cache.insert(1, std::vector<char>(40));
+    cache.insert(2, std::vector<char>(40));
+    EXPECT(cache.cost() == 80);
+
+    cache.insert(3, std::vector<char>(40));
+    EXPECT(cache.cost() == 80);
+    EXPECT(!cache.exists(1));
+
+    // larger than the capacity, returned but not cached
+    auto big = cache.insert(4, std::vector<char>(101));
+    EXPECT(big->size() == 101);
+    EXPECT(!cache.exists(4));
+    EXPECT(cache.cost() == 80);
+
+    cache.clear();
+    EXPECT(cache.cost() == 0);
+    EXPECT(cache.size() == 0);
+}
+
+CASE("test_concurrent_cache_lru_get_or_compute") {
+    ConcurrentCacheLRU<int, int> cache(1000);
+
+    std::atomic<size_t> computed{0};
+    std::atomic<bool> release{false};
+
+    // concurrent misses on the same key compute it once
+    std::vector<std::thread> threads;
+    std::vector<int> results(8, 0);
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t] {
+            results[t] = *cache.getOrCompute(42, [&] {
+                computed++;
+                while (!release) {
+                    std::this_thread::yield();
+                }
+                return 4200;
+            });
+        });
+    }
+
+    while (cache.statistics().misses_ < results.size()) {
+        std::this_thread::yield();
+    }
+    release = true;
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT(computed == 1);
+    for (int r : results) {
+        EXPECT(r == 4200);
+    }
+    EXPECT(cache.statistics().coalesced_ == results.size() - 1);
+    EXPECT(*cache.getOrCompute(42, [] { return 0; }) == 4200);
+
+    SECTION("exceptions are not cached") {
+        EXPECT_THROWS_AS(cache.getOrCompute(7, []() -> int { throw BadValue("no value"); }), BadValue);
+        EXPECT(!cache.exists(7));
+        EXPECT(*cache.getOrCompute(7, [] { return 700; }) == 700);
+    }
+
+    SECTION("the cost function throws") {
+        ConcurrentCacheLRU<int, int> costly(1000, [](const int&, const int& v) -> size_t {
+            if (v < 0) {
+                throw BadValue("no cost");
+            }
+            return 1;
+        });
+
+        EXPECT_THROWS_AS(costly.getOrCompute(7, [] { return -1; }), BadValue);
+        EXPECT(!costly.exists(7));
+
+        // not left pending
+        EXPECT(*costly.getOrCompute(7, [] { return 700; }) == 700);
+        EXPECT(costly.size() == 1);
+    }
+
+    SECTION("many threads, many keys") {
+        ConcurrentCacheLRU<int, int> small(64);
+
+        threads.clear();
+        std::atomic<size_t> wrong{0};
+        for (size_t t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 20000; ++i) {
+                    int key = int((i * 7 + t * 13) % 200);
+                    if (*small.getOrCompute(key, [key] { return key * 2; }) != key * 2) {
+                        wrong++;
+                    }
+                    if (i % 100 == 0) {
+                        small.remove(key);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        EXPECT(wrong == 0);
+        EXPECT(small.size() <= 64);
+        auto stats = small.statistics();
+        EXPECT(stats.hits_ + stats.misses_ == 8 * 20000);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit::test
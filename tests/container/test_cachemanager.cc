@@ -8,7 +8,12 @@
  * does it submit to any jurisdiction.
  */
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "eckit/container/CacheManager.h"
 #include "eckit/exception/Exceptions.h"
@@ -69,6 +74,23 @@ private:
 };
 
 
+/// Counts creations, made slow so that they overlap
+struct CountingCacheCreator : Manager::CacheContentCreator {
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> done{0};
+
+private:
+    void create(const eckit::PathName& path, CacheTraits::value_type& value, bool& saved) final {
+        count++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        path.touch();
+        saved = true;
+        value = "cached";
+        done++;
+    }
+};
+
+
 struct ManagerCantMiss : eckit::CacheManager<CacheTraits> {
     ManagerCantMiss() :
         eckit::CacheManager<CacheTraits>("loader", ".", /*throwOnCacheMiss*/ true, /*maxCacheSize*/ 0) {}
@@ -159,6 +181,101 @@ CASE("test_cachemanager") {
     EXPECT(!missingPath.exists());
 }
 
+CASE("test_cachemanager_statistics") {
+    static caching::Manager cache;
+    caching::CacheCreator creator;
+
+    caching::Manager::key_t key = "statistics";
+    caching::CacheTraits::value_type value;
+
+    cache.getOrCreate(key, creator, value);
+    cache.getOrCreate(key, creator, value);
+    cache.getOrCreate(key, creator, value);
+
+    auto s = cache.statistics();
+    Log::info() << s << std::endl;
+
+    EXPECT(s.misses_ == 1);
+    EXPECT(s.hits_ == 2);
+    EXPECT(s.creations_ == 1);
+    EXPECT(s.coalesced_ == 0);
+
+    cache.resetStatistics();
+    EXPECT(cache.statistics().hits_ == 0);
+}
+
+CASE("test_cachemanager_concurrent_creation") {
+    static caching::Manager cache;
+    caching::CountingCacheCreator creator;
+
+    caching::Manager::key_t key = "concurrent";
+
+    const size_t nthreads = 8;
+
+    std::vector<caching::CacheTraits::value_type> values(nthreads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nthreads; ++i) {
+        threads.emplace_back([&, i] { cache.getOrCreate(key, creator, values[i]); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // created once, the other threads waited for it (or found it)
+    EXPECT(creator.count == 1);
+    for (const auto& v : values) {
+        EXPECT(v == "cached");
+    }
+
+    auto s = cache.statistics();
+    Log::info() << s << std::endl;
+
+    EXPECT(s.creations_ == 1);
+    EXPECT(s.coalesced_ + s.hits_ == nthreads - 1);
+}
+
+CASE("test_cachemanager_async_creation") {
+    static caching::Manager cache;
+    auto creator = std::make_shared<caching::CountingCacheCreator>();
+
+    caching::Manager::key_t key = "async";
+
+    SECTION("thread") {
+        auto future = cache.getOrCreateAsync(key, creator);
+
+        // waits for the creation in progress
+        caching::CacheTraits::value_type value;
+        PathName path = cache.getOrCreate(key, *creator, value);
+
+        EXPECT(future.get() == path);
+        EXPECT(value == "cached");
+        EXPECT(creator->count == 1);
+    }
+
+    SECTION("scheduler") {
+        TaskScheduler scheduler("cache", 2);
+
+        auto future   = cache.getOrCreateAsync(key + "-scheduler", creator, &scheduler);
+        PathName path = future.get();
+        EXPECT(path.exists());
+
+        caching::CacheTraits::value_type value;
+        EXPECT(cache.getOrCreate(key + "-scheduler", *creator, value) == path);
+        EXPECT(creator->count == 1);  // one per section
+    }
+
+    SECTION("future dropped") {
+        {
+            caching::Manager manager;
+            manager.getOrCreateAsync(key + "-dropped", creator);
+            EXPECT(creator->done == 0);  // not waited for by the future
+        }
+
+        // the manager waited for the creation
+        EXPECT(creator->done == 1);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit::test
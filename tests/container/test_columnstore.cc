@@ -0,0 +1,215 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "eckit/container/ColumnStore.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/utils/Compressor.h"
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// Reverses the bytes, so that reading a compressed column without uncompressing it fails
+class ReverseCompressor : public Compressor {
+public:
+    size_t compress(const void* in, size_t len, Buffer& out) const override {
+        out.resize(len);
+        std::reverse_copy(static_cast<const char*>(in), static_cast<const char*>(in) + len,
+                          static_cast<char*>(out.data()));
+        return len;
+    }
+
+    void uncompress(const void* in, size_t len, Buffer& out, size_t outlen) const override {
+        EXPECT(len == outlen);
+        out.resize(len);
+        std::reverse_copy(static_cast<const char*>(in), static_cast<const char*>(in) + len,
+                          static_cast<char*>(out.data()));
+    }
+};
+
+CompressorBuilder<ReverseCompressor> reverse("test-reverse");
+
+const double MISSING = -2147483647.;
+
+std::vector<ColumnStore::Column> schema() {
+    return {{"seqno", ColumnStore::INTEGER},
+            {"obsvalue", ColumnStore::REAL, 1, "none", true, MISSING},
+            {"statid", ColumnStore::STRING, 2},
+            {"lat", ColumnStore::DOUBLE, 1, "test-reverse"}};
+}
+
+std::vector<double> row(size_t i) {
+    std::vector<double> r(5, 0.);
+    r[0]               = double(i);
+    r[1]               = i % 10 == 0 ? MISSING : double(i) / 2;
+    std::string statid = "station" + std::to_string(i % 7);
+    std::strncpy(reinterpret_cast<char*>(&r[2]), statid.c_str(), 2 * sizeof(double));
+    r[4] = -90. + double(i % 180);
+    return r;
+}
+
+void deldir(const PathName& dir) {
+    if (!dir.exists()) {
+        return;
+    }
+    std::vector<PathName> files;
+    std::vector<PathName> dirs;
+    dir.children(files, dirs);
+    for (auto& f : files) {
+        f.unlink();
+    }
+    dir.rmdir();
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("test_columnstore") {
+    const PathName dir("test_columnstore.dir");
+    deldir(dir);
+
+    const size_t N = 1000;
+
+    {
+        ColumnStore store(dir, schema(), 64);
+        EXPECT(store.rowWidth() == 5);
+        for (size_t i = 0; i < N; ++i) {
+            store.append(row(i));
+        }
+        EXPECT_THROWS_AS(store.append(std::vector<double>(4)), AssertionFailed);
+
+        // not readable until closed
+        EXPECT_THROWS_AS(ColumnStore{dir}, BadValue);
+    }
+
+    ColumnStore store(dir);
+    EXPECT(store.rows() == N);
+    EXPECT(store.columns() == 4);
+    EXPECT(store.blocks() == 16);  // the last one partial
+    EXPECT(store.block(0, 15).rows_ == N - 15 * 64);
+    EXPECT(store.column(2).width_ == 2);
+    EXPECT(store.columnIndex("lat") == 3);
+    EXPECT_THROWS_AS(store.columnIndex("unknown"), BadValue);
+
+    SECTION("read columns") {
+        std::vector<double> values;
+        for (size_t c = 0; c < store.columns(); ++c) {
+            store.read(c, values);
+            const size_t width = store.column(c).width_;
+            EXPECT(values.size() == N * width);
+
+            size_t offset = 0;
+            for (size_t k = 0; k < c; ++k) {
+                offset += store.column(k).width_;
+            }
+            for (size_t i = 0; i < N; ++i) {
+                EXPECT(std::memcmp(&values[i * width], &row(i)[offset], width * sizeof(double)) == 0);
+            }
+        }
+    }
+
+    SECTION("read blocks") {
+        Buffer buffer;
+
+        // in place, uncompressed
+        const double* seqno = store.read(0, 3, buffer);
+        EXPECT(seqno[0] == 3 * 64);
+        EXPECT(buffer.size() == 0);
+
+        const double* lat = store.read(3, 3, buffer);
+        EXPECT(lat[1] == row(3 * 64 + 1)[4]);
+        EXPECT(buffer.size() == 64 * sizeof(double));
+    }
+
+    SECTION("zone maps") {
+        const ColumnStore::Block& block = store.block(1, 1);
+        EXPECT(block.missing_ == 6);  // 70, 80, ..., 120
+        EXPECT(block.min_ == 64 / 2);
+        EXPECT(block.max_ == 127 / 2.);
+
+        EXPECT(store.select(0, 100, 200) == std::vector<size_t>({1, 2, 3}));
+        EXPECT(store.select(0, 2000, 3000).empty());
+        EXPECT(store.select(1, 499.5, 1000) == std::vector<size_t>({15}));
+        EXPECT_THROWS_AS(store.select(2, 0, 1), AssertionFailed);
+    }
+}
+
+CASE("test_columnstore_nan") {
+    const PathName dir("test_columnstore_nan.dir");
+    deldir(dir);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    {
+        ColumnStore store(dir, {{"value", ColumnStore::DOUBLE}}, 4);
+        for (size_t i = 0; i < 12; ++i) {
+            // NaN first in the first block, only NaNs in the last block
+            store.append({(i == 0 || i >= 8) ? nan : double(i)});
+        }
+    }
+
+    ColumnStore store(dir);
+
+    // NaNs are counted as missing values, and do not hide the others from the zone maps
+    const ColumnStore::Block& block = store.block(0, 0);
+    EXPECT(block.missing_ == 1);
+    EXPECT(block.min_ == 1 && block.max_ == 3);
+
+    EXPECT(store.select(0, 2, 2) == std::vector<size_t>({0}));
+    EXPECT(store.select(0, 0, 100) == std::vector<size_t>({0, 1}));
+    EXPECT(store.block(0, 2).missing_ == 4);
+
+    deldir(dir);
+}
+
+CASE("test_columnstore_schema") {
+    const PathName dir("test_columnstore_schema.dir");
+    deldir(dir);
+
+    using C = ColumnStore::Column;
+    EXPECT_THROWS_AS(ColumnStore(dir, {C("a", ColumnStore::REAL), C("a", ColumnStore::REAL)}), BadValue);
+    EXPECT_THROWS_AS(ColumnStore(dir, {C("a", ColumnStore::REAL, 2)}), BadValue);
+    EXPECT_THROWS_AS(ColumnStore(dir, {C("a", ColumnStore::REAL, 1, "unknown")}), BadValue);
+
+    {
+        ColumnStore store(dir, {C("a", ColumnStore::REAL)});
+    }
+
+    ColumnStore empty(dir);
+    EXPECT(empty.rows() == 0);
+    EXPECT(empty.blocks() == 0);
+
+    std::vector<double> values(3);
+    empty.read(0, values);
+    EXPECT(values.empty());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
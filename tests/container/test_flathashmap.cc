@@ -0,0 +1,265 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "eckit/container/FlatHashMap.h"
+#include "eckit/container/FlatHashSet.h"
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+};
+
+struct StringEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+/// All keys with the same hash
+struct BadHash {
+    size_t operator()(int) const { return 42; }
+};
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("test_flathashmap_string_int") {
+    FlatHashMap<std::string, int> m;
+
+    EXPECT(m.empty());
+    EXPECT(m.find("two") == m.end());
+    EXPECT(!m.contains("two"));
+
+    EXPECT(m.insert("two", 2));
+    EXPECT(m.insert("four", 4));
+    EXPECT(m.insert("nine", 9));
+    EXPECT(!m.insert("four", 5));  // no overwrite
+
+    EXPECT(m.size() == 3);
+    EXPECT(m.get("two") == 2);
+    EXPECT(m.get("four") == 4);
+    EXPECT(m.get("nine") == 9);
+    EXPECT(!m.contains("one"));
+    EXPECT_THROWS(m.get("one"));
+
+    m.replace("four", 44);
+    m.replace("one", 1);
+    EXPECT(m.size() == 4);
+    EXPECT(m.get("four") == 44);
+    EXPECT(m.get("one") == 1);
+
+    m["ten"] = 10;
+    m["one"]++;
+    EXPECT(m.get("ten") == 10);
+    EXPECT(m.get("one") == 2);
+
+    EXPECT(m.erase("two") == 1);
+    EXPECT(m.erase("two") == 0);
+    EXPECT(!m.contains("two"));
+    EXPECT(m.size() == 4);
+
+    std::set<std::string> keys;
+    int sum = 0;
+    for (const auto& item : m) {
+        keys.insert(item.first);
+        sum += item.second;
+    }
+    EXPECT(keys == std::set<std::string>({"four", "nine", "one", "ten"}));
+    EXPECT(sum == 44 + 9 + 2 + 10);
+
+    for (auto& item : m) {
+        item.second = 0;
+    }
+    EXPECT(m.get("nine") == 0);
+
+    m.clear();
+    EXPECT(m.empty());
+    EXPECT(m.begin() == m.end());
+    EXPECT(!m.contains("nine"));
+}
+
+CASE("test_flathashmap_grow_and_erase") {
+    FlatHashMap<int, std::unique_ptr<int>> m;
+
+    const int N = 10000;
+    for (int i = 0; i < N; ++i) {
+        EXPECT(m.emplace(i, new int(i)).second);
+    }
+    EXPECT(m.size() == size_t(N));
+    EXPECT(m.loadFactor() <= 0.875);
+
+    for (int i = 0; i < N; ++i) {
+        EXPECT(*m.get(i) == i);
+    }
+
+    // erase by iterator, every other item
+    for (auto it = m.begin(); it != m.end();) {
+        it = (it->first % 2) ? m.erase(it) : std::next(it);
+    }
+    EXPECT(m.size() == size_t(N / 2));
+
+    // tombstones are reused or purged, the table does not grow
+    const size_t capacity = m.capacity();
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 1; i < N; i += 2) {
+            m.emplace(i, new int(i));
+        }
+        for (int i = 1; i < N; i += 2) {
+            EXPECT(m.erase(i) == 1);
+        }
+    }
+    EXPECT(m.capacity() == capacity);
+
+    for (int i = 0; i < N; ++i) {
+        EXPECT(m.contains(i) == (i % 2 == 0));
+    }
+
+    // copy and move
+    FlatHashMap<int, int> a;
+    for (int i = 0; i < 100; ++i) {
+        a.insert(i, -i);
+    }
+    FlatHashMap<int, int> b(a);
+    FlatHashMap<int, int> c(std::move(a));
+    EXPECT(b.size() == 100);
+    EXPECT(c.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT(b.get(i) == -i);
+        EXPECT(c.get(i) == -i);
+    }
+}
+
+CASE("test_flathashmap_reserve") {
+    FlatHashMap<int, int> m;
+    m.reserve(1000);
+
+    const size_t capacity = m.capacity();
+    EXPECT(capacity >= 1000);
+
+    for (int i = 0; i < 1000; ++i) {
+        m.insert(i, i);
+    }
+    EXPECT(m.capacity() == capacity);
+}
+
+CASE("test_flathashmap_collisions") {
+    FlatHashMap<int, int, BadHash> m;
+    for (int i = 0; i < 200; ++i) {
+        m.insert(i, i * i);
+    }
+    for (int i = 0; i < 200; i += 3) {
+        m.erase(i);
+    }
+    for (int i = 0; i < 200; ++i) {
+        EXPECT(m.contains(i) == (i % 3 != 0));
+        if (i % 3 != 0) {
+            EXPECT(m.get(i) == i * i);
+        }
+    }
+}
+
+CASE("test_flathashmap_heterogeneous_lookup") {
+    FlatHashMap<std::string, int, StringHash, StringEqual> m;
+    m.insert("alpha", 1);
+    m.insert("beta", 2);
+
+    std::string_view key("beta");
+    EXPECT(m.contains(key));
+    EXPECT(m.get(key) == 2);
+    EXPECT(m.contains("alpha"));  // const char*, without a temporary std::string
+    EXPECT(m.find(std::string_view("gamma")) == m.end());
+
+    EXPECT(m.erase(std::string_view("alpha")) == 1);
+    EXPECT(!m.contains("alpha"));
+}
+
+CASE("test_flathashset") {
+    FlatHashSet<std::string, StringHash, StringEqual> s;
+
+    EXPECT(s.insert("a"));
+    EXPECT(s.insert("b"));
+    EXPECT(!s.insert("a"));
+    EXPECT(s.size() == 2);
+    EXPECT(s.contains(std::string_view("b")));
+    EXPECT(*s.find("a") == "a");
+
+    std::set<std::string> values(s.begin(), s.end());
+    EXPECT(values == std::set<std::string>({"a", "b"}));
+
+    EXPECT(s.erase("a") == 1);
+    EXPECT(!s.contains("a"));
+    EXPECT(s.size() == 1);
+}
+
+CASE("test_flathashmap_random_operations") {
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> key(0, 2000);
+    std::uniform_int_distribution<int> op(0, 3);
+
+    FlatHashMap<int, int> m;
+    std::unordered_map<int, int> ref;
+
+    for (int i = 0; i < 100000; ++i) {
+        const int k = key(rng);
+        switch (op(rng)) {
+            case 0:
+                EXPECT(m.insert(k, i) == ref.emplace(k, i).second);
+                break;
+            case 1:
+                m.replace(k, i);
+                ref[k] = i;
+                break;
+            case 2:
+                EXPECT(m.erase(k) == ref.erase(k));
+                break;
+            default: {
+                auto it = ref.find(k);
+                EXPECT(m.contains(k) == (it != ref.end()));
+                if (it != ref.end()) {
+                    EXPECT(m.get(k) == it->second);
+                }
+            }
+        }
+        EXPECT(m.size() == ref.size());
+    }
+
+    size_t n = 0;
+    for (const auto& item : m) {
+        EXPECT(ref.at(item.first) == item.second);
+        ++n;
+    }
+    EXPECT(n == ref.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
@@ -8,7 +8,15 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include "eckit/container/Queue.h"
+#include "eckit/container/RingQueue.h"
 #include "eckit/log/Log.h"
 #include "eckit/testing/Test.h"
 
@@ -82,6 +90,229 @@ CASE("Multi Producer Multi Consumer Queue access size = 1") {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+CASE("RingQueue push/pop") {
+    RingQueue<int> q(5);
+    EXPECT(q.maxSize() == 8);
+    EXPECT(q.empty());
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT(q.tryPush(i));
+    }
+    EXPECT(!q.tryPush(8));
+    EXPECT(q.size() == 8);
+
+    int e = -1;
+    EXPECT(q.tryPop(e) && e == 0);
+    EXPECT(q.pop(e) == 6 && e == 1);
+
+    // batches
+    EXPECT(q.push(std::vector<int>{8, 9}) == 8);
+
+    std::vector<int> elems(5);
+    EXPECT(q.pop(elems) == 5);
+    EXPECT(elems == std::vector<int>({2, 3, 4, 5, 6}));
+
+    elems.resize(10);
+    EXPECT(q.pop(elems) == 3);
+    EXPECT(elems[0] == 7 && elems[1] == 8 && elems[2] == 9);
+
+    EXPECT(!q.tryPop(e));
+    EXPECT(q.empty());
+}
+
+/// Element without default constructor, whose copies may throw
+struct Fragile {
+    static int live_;
+
+    explicit Fragile(int value) :
+        value_(value) {
+        live_++;
+    }
+    Fragile(const Fragile& other) :
+        value_(other.value_) {
+        if (value_ < 0) {
+            throw std::runtime_error("Fragile: copy");
+        }
+        live_++;
+    }
+    Fragile(Fragile&& other) noexcept :
+        value_(other.value_) {
+        live_++;
+    }
+    Fragile& operator=(Fragile&&) noexcept = default;
+    ~Fragile() { live_--; }
+
+    int value_;
+};
+
+int Fragile::live_ = 0;
+
+CASE("RingQueue elements") {
+    {
+        RingQueue<Fragile> q(2, 0);
+        q.push(Fragile(1));
+        q.emplace(2);
+
+        // a copy throwing before claiming a cell leaves the queue usable
+        Fragile bad(-1);
+        EXPECT_THROWS_AS(q.tryPush(bad), std::runtime_error);
+        EXPECT(q.size() == 2);
+
+        Fragile e(0);
+        EXPECT(q.pop(e) == 1 && e.value_ == 1);
+        EXPECT(q.tryPush(Fragile(3)));
+
+        EXPECT(q.pop(e) == 1 && e.value_ == 2);
+        EXPECT(Fragile::live_ == 3);  // bad, e and the queued element
+    }
+
+    // elements still queued are destroyed with the queue
+    EXPECT(Fragile::live_ == 0);
+}
+
+CASE("RingQueue close/interrupt") {
+    SECTION("close") {
+        RingQueue<int> q(4);
+        q.push(1);
+        q.push(2);
+        q.close();
+        EXPECT(q.closed());
+
+        EXPECT_THROWS_AS(q.push(3), AssertionFailed);
+
+        int e;
+        EXPECT(q.pop(e) >= 0 && e == 1);
+        EXPECT(q.pop(e) >= 0 && e == 2);
+        EXPECT(q.pop(e) == -1);
+    }
+
+    SECTION("close wakes up consumers") {
+        RingQueue<int> q(4, 0);
+        long result = 0;
+        std::thread consumer([&q, &result] {
+            int e;
+            result = q.pop(e);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        q.close();
+        consumer.join();
+        EXPECT(result == -1);
+    }
+
+    SECTION("close while pushing") {
+        // consumers of a closed queue receive the elements of the pushes started before close()
+        for (size_t spin : {0, 128}) {
+            RingQueue<int> q(8, spin);
+            std::atomic<size_t> pushed{0};
+            std::atomic<size_t> popped{0};
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < 4; ++i) {
+                threads.emplace_back([&q, &pushed] {
+                    try {
+                        for (;;) {
+                            q.push(1);
+                            pushed++;
+                        }
+                    }
+                    catch (const AssertionFailed&) {
+                        // closed
+                    }
+                });
+                threads.emplace_back([&q, &popped] {
+                    int e;
+                    while (q.pop(e) >= 0) {
+                        popped++;
+                    }
+                });
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            q.close();
+            for (auto& t : threads) {
+                t.join();
+            }
+
+            const size_t npushed = pushed;
+            const size_t npopped = popped;
+            EXPECT(npushed > 0);
+            EXPECT_EQUAL(npopped, npushed);
+            EXPECT(q.empty());
+        }
+    }
+
+    SECTION("interrupt") {
+        RingQueue<int> q(1, 0);
+        EXPECT(q.maxSize() == 2);
+        q.push(1);
+        q.push(1);
+
+        bool interrupted = false;
+        std::thread producer([&q, &interrupted] {
+            try {
+                q.push(2);
+            }
+            catch (const QueueInterruptedError&) {
+                interrupted = true;
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        q.interrupt(std::make_exception_ptr(QueueInterruptedError("test", Here())));
+        producer.join();
+
+        EXPECT(interrupted);
+        EXPECT(q.closed());
+
+        int e;
+        EXPECT_THROWS_AS(q.pop(e), QueueInterruptedError);
+    }
+}
+
+CASE("RingQueue multi producer multi consumer") {
+    const size_t nprod = 7;
+    const size_t ncons = 5;
+    const size_t N     = 20000;
+
+    for (size_t depth : {1, 64}) {
+        RingQueue<size_t> q(depth, depth == 1 ? 0 : 128);
+
+        std::vector<std::thread> producers;
+        for (size_t id = 0; id < nprod; ++id) {
+            producers.emplace_back([&q, id, N] {
+                for (size_t j = 0; j < N; ++j) {
+                    q.push(id * N + j);
+                }
+            });
+        }
+
+        std::vector<size_t> counts(nprod * N, 0);
+        std::vector<std::thread> consumers;
+        for (size_t id = 0; id < ncons; ++id) {
+            consumers.emplace_back([&q, &counts, id] {
+                std::vector<size_t> elems(1 + id);
+                long n;
+                while ((n = q.pop(elems)) > 0) {
+                    for (long i = 0; i < n; ++i) {
+                        counts[elems[i]]++;  // each element is popped by one consumer
+                    }
+                }
+            });
+        }
+
+        for (auto& p : producers) {
+            p.join();
+        }
+        q.close();
+        for (auto& c : consumers) {
+            c.join();
+        }
+
+        EXPECT(std::all_of(counts.begin(), counts.end(), [](size_t c) { return c == 1; }));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 }  // namespace eckit::test
 
 int main(int argc, char** argv) {
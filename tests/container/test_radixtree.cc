@@ -0,0 +1,233 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "eckit/container/RadixTree.h"
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+std::vector<std::string> keys(const RadixTree<int>& t) {
+    std::vector<std::string> result;
+    t.visit([&result](const std::string& key, int) { result.push_back(key); });
+    return result;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("test_radixtree_insertion") {
+    RadixTree<int> t;
+
+    EXPECT(t.empty());
+    EXPECT(t.find("a-test-string") == nullptr);
+
+    EXPECT(t.insert("a-test-string", 1234));
+    EXPECT(!t.empty());
+    EXPECT(*t.find("a-test-string") == 1234);
+
+    EXPECT(t.find("b-test-string") == nullptr);
+    EXPECT(t.find("a-test-strinh") == nullptr);
+    EXPECT(t.find("a-test-str") == nullptr);
+    EXPECT(t.find("a-test-stringy") == nullptr);
+
+    EXPECT(t.insert("a-different-string", 4321));
+    EXPECT(t.insert("a-x-string", 666));
+    EXPECT(t.insert("a-x", 999));                     // prefix of an existing key
+    EXPECT(t.insert("a-test-string-extended", 5678));  // existing key is a prefix
+    EXPECT(t.insert("a-#$@!%^&*", 9876));
+    EXPECT(t.insert("", 0));
+    EXPECT(t.insert(std::string("a\0b", 3), 3));
+
+    EXPECT(!t.insert("a-x", 1000));  // replaced
+
+    EXPECT(t.size() == 8);
+    EXPECT(*t.find("a-test-string") == 1234);
+    EXPECT(*t.find("a-different-string") == 4321);
+    EXPECT(*t.find("a-x-string") == 666);
+    EXPECT(*t.find("a-x") == 1000);
+    EXPECT(*t.find("a-test-string-extended") == 5678);
+    EXPECT(*t.find("a-#$@!%^&*") == 9876);
+    EXPECT(*t.find("") == 0);
+    EXPECT(*t.find(std::string("a\0b", 3)) == 3);
+    EXPECT(t.find("a") == nullptr);
+    EXPECT(t.find("a-") == nullptr);
+
+    *t.find("a-x") = 999;
+    EXPECT(*t.find("a-x") == 999);
+}
+
+CASE("test_radixtree_removal") {
+    RadixTree<int> t;
+
+    t.insert("a", 1111);
+    t.insert("a-string", 2222);
+    t.insert("a-strinh", 3333);
+    t.insert("a-string-extended", 4444);
+    t.insert("a-str", 555);
+
+    EXPECT(t.remove("a"));
+    EXPECT(!t.remove("a"));
+    EXPECT(!t.remove("a-s"));
+    EXPECT(!t.remove("a-string-ext"));
+    EXPECT(!t.contains("a"));
+    EXPECT(t.size() == 4);
+
+    EXPECT(t.remove("a-string"));
+    EXPECT(*t.find("a-string-extended") == 4444);
+    EXPECT(*t.find("a-strinh") == 3333);
+    EXPECT(*t.find("a-str") == 555);
+
+    EXPECT(t.remove("a-string-extended"));
+    EXPECT(t.remove("a-str"));
+    EXPECT(*t.find("a-strinh") == 3333);
+
+    EXPECT(t.remove("a-strinh"));
+    EXPECT(t.empty());
+    EXPECT(t.footprint() == 0);
+}
+
+CASE("test_radixtree_node_sizes") {
+    // fanouts of all node types, growing then shrinking
+    RadixTree<int> t;
+
+    for (int b = 0; b < 256; ++b) {
+        EXPECT(t.insert(std::string("key") + char(b) + "suffix", b));
+    }
+    EXPECT(t.size() == 256);
+    for (int b = 0; b < 256; ++b) {
+        EXPECT(*t.find(std::string("key") + char(b) + "suffix") == b);
+    }
+
+    // in order, as unsigned bytes
+    std::vector<std::string> k = keys(t);
+    EXPECT(k.size() == 256);
+    for (int b = 0; b < 256; ++b) {
+        EXPECT(k[b] == std::string("key") + char(b) + "suffix");
+    }
+
+    for (int b = 255; b >= 0; --b) {
+        EXPECT(t.remove(std::string("key") + char(b) + "suffix"));
+        for (int c = 0; c < b; c += 17) {
+            EXPECT(*t.find(std::string("key") + char(c) + "suffix") == c);
+        }
+    }
+    EXPECT(t.empty());
+}
+
+CASE("test_radixtree_prefix") {
+    RadixTree<int> t;
+
+    t.insert("class=od,expver=0001", 1);
+    t.insert("class=od,expver=0001,stream=oper", 2);
+    t.insert("class=od,expver=0001,stream=enfo", 3);
+    t.insert("class=od,expver=0002", 4);
+    t.insert("class=rd,expver=0001", 5);
+
+    std::vector<int> values;
+    t.visitPrefix("class=od,expver=0001", [&values](const std::string& key, int v) {
+        EXPECT(key.compare(0, 20, "class=od,expver=0001") == 0);
+        values.push_back(v);
+    });
+    EXPECT(values == std::vector<int>({1, 3, 2}));
+
+    values.clear();
+    t.visitPrefix("class=od,e", [&values](const std::string&, int v) { values.push_back(v); });
+    EXPECT(values == std::vector<int>({1, 3, 2, 4}));
+
+    values.clear();
+    t.visitPrefix("class=x", [&values](const std::string&, int v) { values.push_back(v); });
+    t.visitPrefix("class=od,expver=0001,stream=operational",
+                  [&values](const std::string&, int v) { values.push_back(v); });
+    EXPECT(values.empty());
+
+    t.visitPrefix("", [&values](const std::string&, int v) { values.push_back(v); });
+    EXPECT(values.size() == 5);
+
+    // longest prefix match
+    size_t length = 0;
+    EXPECT(*t.longestPrefix("class=od,expver=0001,stream=oper,type=an", &length) == 2);
+    EXPECT(length == 32);
+    EXPECT(*t.longestPrefix("class=od,expver=0001,stream=ope", &length) == 1);
+    EXPECT(length == 20);
+    EXPECT(*t.longestPrefix("class=od,expver=0002") == 4);
+    EXPECT(t.longestPrefix("class=od,expver=000") == nullptr);
+    EXPECT(t.longestPrefix("") == nullptr);
+}
+
+CASE("test_radixtree_random_operations") {
+    std::mt19937 rng(4321);
+
+    // keys sharing long prefixes, from a small alphabet
+    auto randomKey = [&rng]() {
+        static const std::string alphabet = "ab=,";
+        std::string key                   = "class=od,";
+        const size_t length               = rng() % 12;
+        for (size_t i = 0; i < length; ++i) {
+            key += alphabet[rng() % alphabet.size()];
+        }
+        return key;
+    };
+
+    RadixTree<int> t;
+    std::map<std::string, int> ref;
+
+    for (int i = 0; i < 50000; ++i) {
+        const std::string key = randomKey();
+        switch (rng() % 3) {
+            case 0:
+                EXPECT(t.insert(key, i) == (ref.find(key) == ref.end()));
+                ref[key] = i;
+                break;
+            case 1:
+                EXPECT(t.remove(key) == (ref.erase(key) == 1));
+                break;
+            default: {
+                auto it = ref.find(key);
+                EXPECT(t.contains(key) == (it != ref.end()));
+                if (it != ref.end()) {
+                    EXPECT(*t.find(key) == it->second);
+                }
+            }
+        }
+        EXPECT(t.size() == ref.size());
+    }
+
+    std::vector<std::string> expected;
+    for (const auto& item : ref) {
+        expected.push_back(item.first);
+    }
+    EXPECT(keys(t) == expected);
+
+    t.clear();
+    EXPECT(t.empty());
+    EXPECT(keys(t).empty());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
@@ -0,0 +1,242 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "eckit/container/SharedMemHashTable.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+#include "eckit/types/FixedString.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+using Key   = FixedString<32>;
+using Table = SharedMemHashTable<Key, size_t>;
+
+/// A fresh table, unlinked at the end of the test
+struct Fixture {
+    Fixture() :
+        name_("/eckit_test_shmht_" + std::to_string(::getpid())) {
+        Table::unlink(name_);
+    }
+    ~Fixture() { Table::unlink(name_); }
+
+    PathName path_{"test_sharedmemhashtable.lock"};
+    std::string name_;
+};
+
+Key key(size_t i) {
+    return Key("key-" + std::to_string(i));
+}
+
+/// Run f in n forked processes, and wait for them
+template <typename F>
+void workers(size_t n, F f) {
+    std::vector<pid_t> pids;
+    for (size_t i = 0; i < n; ++i) {
+        pid_t pid = ::fork();
+        ASSERT(pid >= 0);
+        if (pid == 0) {
+            f(i);
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+    for (pid_t pid : pids) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("test_sharedmemhashtable_basic") {
+    Fixture fixture;
+    Table t(fixture.path_, fixture.name_, 100);
+
+    EXPECT(t.empty());
+    EXPECT(t.capacity() >= 100);
+
+    size_t v = 0;
+    EXPECT(!t.find(key(1), v));
+
+    EXPECT(t.insert(key(1), 10));
+    EXPECT(t.insert(key(2), 20));
+    EXPECT(!t.insert(key(1), 11));  // replaced
+
+    EXPECT(t.size() == 2);
+    EXPECT(t.find(key(1), v) && v == 11);
+    EXPECT(t.find(key(2), v) && v == 20);
+    EXPECT(t.contains(key(2)));
+
+    EXPECT(t.update(key(2), [](size_t& x) { x++; }));
+    EXPECT(!t.update(key(3), [](size_t& x) { x++; }));
+    EXPECT(t.find(key(2), v) && v == 21);
+
+    // not modified halfway
+    EXPECT_THROWS_AS(t.update(key(2),
+                              [](size_t& x) {
+                                  x = 0;
+                                  throw BadValue("update");
+                              }),
+                     BadValue);
+    EXPECT(t.find(key(2), v) && v == 21);
+
+    EXPECT(t.remove(key(1)));
+    EXPECT(!t.remove(key(1)));
+    EXPECT(!t.contains(key(1)));
+    EXPECT(t.size() == 1);
+
+    // another handle on the same segment, in the same process
+    {
+        Table other(fixture.path_, fixture.name_, 100);
+        EXPECT(other.find(key(2), v) && v == 21);
+        EXPECT(other.insert(key(3), 30));
+    }
+    EXPECT(t.find(key(3), v) && v == 30);
+
+    // a different layout is rejected
+    EXPECT_THROWS_AS(Table(fixture.path_, fixture.name_, 10000), BadValue);
+
+    size_t n = 0;
+    t.forEach([&n](const Key&, size_t) { n++; });
+    EXPECT(n == 2);
+
+    t.clear();
+    EXPECT(t.empty());
+    EXPECT(!t.contains(key(2)));
+}
+
+CASE("test_sharedmemhashtable_full") {
+    Fixture fixture;
+    Table t(fixture.path_, fixture.name_, 10);
+
+    size_t i = 0;
+    while (i < t.capacity()) {
+        EXPECT(t.insert(key(i), i));
+        ++i;
+    }
+    EXPECT_THROWS(t.insert(key(i), i));
+
+    // the bucket of a removed key is reused by keys probing it
+    EXPECT(t.remove(key(0)));
+    EXPECT(t.size() == t.capacity() - 1);
+    EXPECT(t.insert(key(0), 0));
+    EXPECT(t.size() == t.capacity());
+
+    t.clear();
+    EXPECT(t.insert(key(i), i));
+}
+
+CASE("test_sharedmemhashtable_processes") {
+    Fixture fixture;
+    const size_t nkeys   = 500;
+    const size_t nworker = 4;
+    const size_t rounds  = 20;
+
+    Table t(fixture.path_, fixture.name_, 2 * nkeys * nworker);
+    for (size_t i = 0; i < nkeys; ++i) {
+        t.insert(key(i), 0);
+    }
+
+    workers(nworker, [&](size_t w) {
+        Table table(fixture.path_, fixture.name_, 2 * nkeys * nworker);
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < nkeys; ++i) {
+                ASSERT(table.update(key(i), [](size_t& x) { x++; }));
+            }
+        }
+        // keys of their own, inserted and some removed
+        for (size_t i = 0; i < nkeys; ++i) {
+            table.insert(key(nkeys * (w + 1) + i), w);
+        }
+        for (size_t i = 0; i < nkeys; i += 2) {
+            ASSERT(table.remove(key(nkeys * (w + 1) + i)));
+        }
+    });
+
+    size_t v = 0;
+    for (size_t i = 0; i < nkeys; ++i) {
+        EXPECT(t.find(key(i), v) && v == nworker * rounds);
+    }
+    for (size_t w = 0; w < nworker; ++w) {
+        for (size_t i = 0; i < nkeys; ++i) {
+            EXPECT(t.find(key(nkeys * (w + 1) + i), v) == (i % 2 == 1));
+        }
+    }
+    EXPECT(t.size() == nkeys + nworker * nkeys / 2);
+}
+
+CASE("test_sharedmemhashtable_crash_recovery") {
+    Fixture fixture;
+    Table t(fixture.path_, fixture.name_, 100);
+
+    for (size_t i = 0; i < 10; ++i) {
+        t.insert(key(i), i);
+    }
+
+    // a worker dies in the middle of an update, holding the locks
+    pid_t pid = ::fork();
+    ASSERT(pid >= 0);
+    if (pid == 0) {
+        Table table(fixture.path_, fixture.name_, 100);
+        table.update(key(3), [](size_t& x) {
+            x = 0xdead;
+            ::_exit(1);
+        });
+        ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+
+    SECTION("readers and writers take over") {
+        // the update modified a copy, the entry is unchanged
+        size_t v = 0;
+        EXPECT(t.find(key(3), v) && v == 3);
+        EXPECT(!t.insert(key(3), 33));
+        EXPECT(t.find(key(3), v) && v == 33);
+    }
+
+    SECTION("recover") {
+        EXPECT(t.recover() == 2);  // the stripe and the bucket
+        EXPECT(t.contains(key(3)));
+        EXPECT(t.size() == 10);
+        EXPECT(t.recover() == 0);
+    }
+
+    for (size_t i = 0; i < 10; ++i) {
+        size_t v = 0;
+        EXPECT(i == 3 || (t.find(key(i), v) && v == i));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
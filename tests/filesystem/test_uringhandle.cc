@@ -0,0 +1,249 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/AutoCloser.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/URingHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// size is prime number 89
+const char tbuf[] = "74e1feb8d0b1d328cbea63832c2dcfb2b4fa1adfeb8d0b1d328cb53d50e63a50fba73f0151028a695a238ff0";
+
+class TestURing {
+public:
+    TestURing() {
+        std::string base = Resource<std::string>("$TMPDIR", "/tmp");
+        path_            = PathName::unique(base + "/file") + ".dat";
+        reference_       = PathName::unique(base + "/reference") + ".dat";
+
+        std::unique_ptr<DataHandle> fh(reference_.fileHandle());
+        writeTo(*fh);
+    }
+
+    size_t writeTo(DataHandle& dh) {
+        long sz = sizeof(tbuf);
+
+        dh.openForWrite(0);
+        auto close = closer(dh);
+
+        size_t nblocks = 10 * 1024 * 1024 / sz;
+        size_t total   = 0;
+
+        for (size_t i = 0; i < nblocks; ++i) {
+            total += dh.write(tbuf, sz);
+        }
+
+        return total;
+    }
+
+    bool verify() {
+        std::unique_ptr<DataHandle> fh(path_.fileHandle());
+        std::unique_ptr<DataHandle> rh(reference_.fileHandle());
+        return rh->compare(*fh);
+    }
+
+    ~TestURing() {
+        if (path_.exists()) {
+            path_.unlink();
+        }
+        reference_.unlink();
+    }
+
+    PathName path_;
+    PathName reference_;
+};
+
+CASE("io_uring availability") {
+    Log::info() << "io_uring supported: " << URingHandle::supported() << std::endl;
+}
+
+CASE("Write to a new file") {
+
+    TestURing test;
+
+    SECTION("Single write") {
+        std::unique_ptr<DataHandle> rh(test.reference_.fileHandle());
+        URingHandle uh(test.path_);
+        rh->saveInto(uh);
+        EXPECT(test.verify());
+    }
+
+    SECTION("Multiple writes") {
+        URingHandle uh(test.path_);
+        test.writeTo(uh);
+        EXPECT(test.verify());
+    }
+
+    SECTION("Small buffers, deep queue") {
+        URingHandle uh(test.path_, 64, 4096);
+        test.writeTo(uh);
+        EXPECT(test.verify());
+    }
+
+    SECTION("O_DIRECT with fsync") {
+        URingHandle uh(test.path_, 8, 1024 * 1024, true, true);
+        test.writeTo(uh);
+        EXPECT(test.verify());
+    }
+}
+
+CASE("Append to a file") {
+
+    TestURing test;
+
+    {
+        FileHandle fh(test.path_);
+        fh.openForWrite(0);
+        auto close = closer(fh);
+        fh.write(tbuf, sizeof(tbuf));
+    }
+
+    URingHandle uh(test.path_, 4, 4096);
+    uh.openForAppend(0);
+    {
+        auto close = closer(uh);
+        EXPECT(uh.position() == Offset(sizeof(tbuf)));
+        uh.write(tbuf, sizeof(tbuf));
+    }
+
+    EXPECT(test.path_.size() == Length(2 * sizeof(tbuf)));
+}
+
+CASE("Read a file") {
+
+    TestURing test;
+
+    for (bool direct : {false, true}) {
+
+        URingHandle uh(test.reference_, 4, 64 * 1024, false, direct);
+        FileHandle fh(test.reference_);
+
+        SECTION("Compare") {
+            EXPECT(uh.compare(fh));
+        }
+
+        SECTION("Seek and skip") {
+            Length size = uh.openForRead();
+            auto close1 = closer(uh);
+            EXPECT(size == test.reference_.size());
+
+            fh.openForRead();
+            auto close2 = closer(fh);
+
+            Buffer b1(1000);
+            Buffer b2(1000);
+
+            for (Offset o : {Offset(0), Offset(12345), Offset(12000), Offset(1024 * 1024 + 17), Offset(0)}) {
+                EXPECT(uh.seek(o) == o);
+                fh.seek(o);
+                EXPECT(uh.read(b1, b1.size()) == 1000);
+                EXPECT(fh.read(b2, b2.size()) == 1000);
+                EXPECT(::memcmp(b1, b2, b1.size()) == 0);
+            }
+
+            uh.skip(100);
+            fh.skip(100);
+            EXPECT(uh.position() == fh.position());
+            EXPECT(uh.read(b1, b1.size()) == 1000);
+            EXPECT(fh.read(b2, b2.size()) == 1000);
+            EXPECT(::memcmp(b1, b2, b1.size()) == 0);
+
+            uh.seek(Offset(size));
+            EXPECT(uh.read(b1, b1.size()) == 0);
+        }
+    }
+}
+
+CASE("Fall back if the rings cannot be mapped") {
+
+    TestURing test;
+
+    // a child process, with an address space limit that a large ring does not fit in
+    pid_t pid = ::fork();
+    ASSERT(pid >= 0);
+
+    if (pid == 0) {
+        size_t pages = 0;
+        std::ifstream("/proc/self/statm") >> pages;
+
+        rlimit limit;
+        limit.rlim_cur = limit.rlim_max = (pages + 64) * ::sysconf(_SC_PAGESIZE);
+
+        int status = 1;
+        try {
+            char buffer[sizeof(tbuf)];
+
+            URingHandle uh(test.reference_, 4096, 4096);
+            if (::setrlimit(RLIMIT_AS, &limit) == 0) {
+                uh.openForRead();
+                auto close = closer(uh);
+                if (uh.read(buffer, sizeof(buffer)) == long(sizeof(buffer)) &&
+                    ::memcmp(buffer, tbuf, sizeof(buffer)) == 0) {
+                    status = 0;
+                }
+            }
+        }
+        catch (...) {
+            status = 2;
+        }
+        ::_exit(status);
+    }
+
+    int status = 0;
+    EXPECT(::waitpid(pid, &status, 0) == pid);
+    EXPECT(WIFEXITED(status));
+    EXPECT_EQUAL(WEXITSTATUS(status), 0);
+}
+
+CASE("Write errors with requests in flight") {
+
+    PathName full("/dev/full");
+    if (!full.exists()) {
+        return;
+    }
+
+    // the handle waits for the requests in flight before releasing their buffers
+    URingHandle uh(full, 8, 4096);
+    uh.openForWrite(0);
+
+    EXPECT_THROWS([&uh] {
+        for (size_t i = 0; i < 1024; ++i) {
+            uh.write(tbuf, sizeof(tbuf));
+        }
+        uh.flush();
+    }());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
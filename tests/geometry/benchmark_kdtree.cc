@@ -0,0 +1,234 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/container/KDTree.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/geometry/Point3.h"
+#include "eckit/log/Timer.h"
+#include "eckit/thread/TaskScheduler.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace std;
+using namespace eckit;
+using namespace eckit::testing;
+using namespace eckit::geometry;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Small enough for a smoke test by default. For timings, set e.g. ECKIT_KDTREE_BENCHMARK_POINTS=1000000 and
+/// ECKIT_KDTREE_BENCHMARK_QUERIES=200000
+size_t npoints() {
+    static const size_t n = Resource<size_t>("$ECKIT_KDTREE_BENCHMARK_POINTS", 100000);
+    return n;
+}
+
+size_t nqueries() {
+    static const size_t n = Resource<size_t>("$ECKIT_KDTREE_BENCHMARK_QUERIES", 10000);
+    return n;
+}
+
+struct TreeTrait {
+    typedef Point3 Point;
+    typedef size_t Payload;
+};
+
+using Tree = KDTreeMemory<TreeTrait>;
+
+/// Points on the unit sphere, as for a global grid
+std::vector<Point3> sphere(size_t n, unsigned int seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> dist;
+
+    std::vector<Point3> points;
+    points.reserve(n);
+    while (points.size() < n) {
+        double x = dist(gen);
+        double y = dist(gen);
+        double z = dist(gen);
+        double r = std::sqrt(x * x + y * y + z * z);
+        if (r > 0) {
+            points.emplace_back(x / r, y / r, z / r);
+        }
+    }
+    return points;
+}
+
+size_t query(Tree& tree, const std::vector<Point3>& queries, const std::string& name) {
+    Timer timer(name);
+
+    size_t sum = 0;
+    for (const auto& q : queries) {
+        sum += tree.nearestNeighbour(q).payload();
+        sum += tree.kNearestNeighbours(q, 4).size();
+    }
+    return sum;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("benchmark_kdtree_build") {
+    const auto points  = sphere(npoints(), 1);
+    const auto queries = sphere(nqueries(), 2);
+
+    std::vector<Tree::Value> values;
+    values.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        values.emplace_back(points[i], i);
+    }
+
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << "KDTree " << npoints() << " points, " << nqueries() << " queries" << std::endl;
+
+    Tree recursive;
+    {
+        std::vector<Tree::Value> v(values);
+        Timer timer("build (recursive, depth-first layout)");
+        recursive.build(v);
+    }
+
+    for (size_t threads : {1, 0}) {
+        TaskScheduler scheduler("kdtree", threads);
+
+        Tree parallel;
+        {
+            std::vector<Tree::Value> v(values);
+            Timer timer("build (parallel, " + std::to_string(scheduler.size()) + " threads, van Emde Boas layout)");
+            parallel.build(v, scheduler);
+        }
+
+        ASSERT(parallel.size() == recursive.size());
+    }
+
+    TaskScheduler scheduler("kdtree");
+
+    Tree parallel;
+    {
+        std::vector<Tree::Value> v(values);
+        parallel.build(v, scheduler);
+    }
+
+    size_t a = query(recursive, queries, "query (depth-first layout)");
+    size_t b = query(parallel, queries, "query (van Emde Boas layout)");
+
+    // same trees, same answers
+    EXPECT(a == b);
+}
+
+CASE("benchmark_kdtree_allocation") {
+    const size_t n        = npoints();
+    const size_t requests = 4;
+
+    const auto points = sphere(n, 3);
+
+    std::vector<Tree::Value> values;
+    values.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        values.emplace_back(points[i], i);
+    }
+
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << "KDTree " << n << " points built then deleted, " << requests << " times" << std::endl;
+
+    {
+        Timer timer("KDMemory");
+        for (size_t r = 0; r < requests; ++r) {
+            std::vector<Tree::Value> v(values);
+            Tree tree;
+            tree.build(v);
+        }
+    }
+
+    KDArena arena;
+    {
+        Timer timer("KDArena");
+        for (size_t r = 0; r < requests; ++r) {
+            std::vector<Tree::Value> v(values);
+            KDTreeArena<TreeTrait> tree(arena);
+            tree.build(v);
+        }
+    }
+
+    arena.statsPrint(std::cout, false);
+}
+
+CASE("benchmark_kdtree_batch_queries") {
+    const auto points  = sphere(npoints(), 1);
+    const auto queries = sphere(nqueries(), 2);
+    const size_t n     = queries.size();
+    const size_t k     = 4;
+
+    std::vector<Tree::Value> values;
+    values.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        values.emplace_back(points[i], i);
+    }
+
+    TaskScheduler scheduler("kdtree");
+
+    Tree tree;
+    tree.build(values, scheduler);
+
+    std::cout << "-------------------------------------------------------------" << std::endl;
+    std::cout << "KDTree " << npoints() << " points, " << nqueries() << " batched queries" << std::endl;
+
+    std::vector<size_t> reference(n);
+    {
+        Timer timer("nearest neighbour, one by one");
+        for (size_t i = 0; i < n; ++i) {
+            reference[i] = tree.nearestNeighbour(queries[i]).payload();
+        }
+    }
+
+    std::vector<size_t> payloads(n * k);
+    std::vector<double> distances(n * k);
+    {
+        Timer timer("nearest neighbour, batch (Hilbert order)");
+        tree.nearestNeighbours(queries.data(), n, payloads.data(), distances.data());
+    }
+    EXPECT(std::equal(reference.begin(), reference.end(), payloads.begin()));
+
+    {
+        Timer timer("nearest neighbour, batch (" + std::to_string(scheduler.size()) + " threads)");
+        tree.nearestNeighbours(queries.data(), n, payloads.data(), distances.data(), &scheduler);
+    }
+    EXPECT(std::equal(reference.begin(), reference.end(), payloads.begin()));
+
+    {
+        Timer timer("k nearest neighbours, one by one");
+        for (size_t i = 0; i < n; ++i) {
+            reference[i] = tree.kNearestNeighbours(queries[i], k).back().payload();
+        }
+    }
+
+    {
+        Timer timer("k nearest neighbours, batch (" + std::to_string(scheduler.size()) + " threads)");
+        tree.kNearestNeighbours(queries.data(), n, k, payloads.data(), distances.data(), &scheduler);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT(payloads[i * k + k - 1] == reference[i]);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
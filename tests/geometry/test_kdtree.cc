@@ -8,12 +8,20 @@
  * does it submit to any jurisdiction.
  */
 
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <random>
 
 #include "eckit/container/KDTree.h"
 #include "eckit/geometry/Point2.h"
 #include "eckit/os/Semaphore.h"
 #include "eckit/testing/Test.h"
+#include "eckit/thread/TaskScheduler.h"
 
 using namespace std;
 using namespace eckit;
@@ -354,6 +362,186 @@ CASE("test_kdtree_mapped") {
     }
 }
 
+CASE("test_kdtree_mapped_file") {
+    using Tree  = KDTreeMapped<TestTreeTrait>;
+    using Point = Tree::PointType;
+    using Node  = Tree::Node;
+
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-10., 10.);
+
+    std::vector<Tree::Value> points;
+    for (size_t i = 0; i < 1000; ++i) {
+        points.emplace_back(Point(dist(gen), dist(gen)), double(i));
+    }
+
+    // capacity larger than needed
+    eckit::PathName path("test_kdtree_mapped_file.kdtree");
+    {
+        Tree kd(path, points.size() + 10, 0);
+        kd.build(points);
+    }
+
+    auto bytes = [](const eckit::PathName& path) {
+        std::ifstream in(path.localPath(), std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+
+    auto write = [](const eckit::PathName& path, const std::string& content) {
+        std::ofstream out(path.localPath(), std::ios::binary | std::ios::trunc);
+        out.write(content.data(), content.size());
+    };
+
+    const std::string file = bytes(path);
+    eckit::PathName copy("test_kdtree_mapped_file.copy.kdtree");
+
+    SECTION("load") {
+        Tree kd(path, 0, 0);
+        EXPECT_EQUAL(kd.size(), points.size());
+        EXPECT(kd.verify());
+        kd.prefault();
+
+        Point min;
+        Point max;
+        EXPECT(kd.boundingBox(min, max));
+        for (size_t d = 0; d < Point::DIMS; ++d) {
+            double lo = points[0].point().x(d);
+            double hi = lo;
+            for (const auto& v : points) {
+                lo = std::min(lo, v.point().x(d));
+                hi = std::max(hi, v.point().x(d));
+            }
+            EXPECT_EQUAL(min.x(d), lo);
+            EXPECT_EQUAL(max.x(d), hi);
+        }
+
+        for (const auto& v : points) {
+            EXPECT(kd.nearestNeighbour(v.point()).payload() == v.payload());
+        }
+    }
+
+    SECTION("corrupted") {
+        std::string content = file;
+        content[content.size() - sizeof(Node) * 10 - 1] ^= 1;  // last stored node
+        write(copy, content);
+
+        Tree kd(copy, 0, 0);
+        EXPECT(!kd.verify());
+    }
+
+    SECTION("read while writing") {
+        Tree writer(copy, points.size() + 1, 0);
+        writer.build(points);
+
+        // finalised by the build, before the writer is destroyed
+        {
+            Tree kd(copy, 0, 0);
+            EXPECT_EQUAL(kd.size(), points.size());
+            EXPECT(kd.verify());
+
+            Point min;
+            Point max;
+            EXPECT(kd.boundingBox(min, max));
+        }
+
+        // modified, until finalised again
+        writer.insert(Tree::Value(Point(20., 20.), 1000.));
+        EXPECT_THROWS_AS(Tree(copy, 0, 0), eckit::BadValue);
+
+        writer.finalise();
+        Tree kd(copy, 0, 0);
+        EXPECT_EQUAL(kd.size(), points.size() + 1);
+        EXPECT(kd.verify());
+
+        Point min;
+        Point max;
+        EXPECT(kd.boundingBox(min, max));
+        EXPECT(max.x(0) == 20.);
+    }
+
+    SECTION("rebuild in place") {
+        write(copy, file);
+
+        std::vector<Tree::Value> fewer(points.begin(), points.begin() + 10);
+        {
+            Tree kd(copy, fewer.size(), 0);
+            kd.build(fewer);
+        }
+
+        // no stale tail of the larger tree
+        EXPECT(bytes(copy).size() < file.size());
+
+        Tree kd(copy, 0, 0);
+        EXPECT_EQUAL(kd.size(), fewer.size());
+        EXPECT(kd.verify());
+    }
+
+    SECTION("invalid") {
+        struct OtherTrait {
+            typedef Point2 Point;
+            typedef float Payload;
+        };
+
+        EXPECT_THROWS_AS(KDTreeMapped<OtherTrait>(path, 0, 0), eckit::BadValue);  // different traits
+
+        write(copy, file.substr(0, file.size() - 1));
+        EXPECT_THROWS_AS(Tree(copy, 0, 0), eckit::BadValue);  // truncated
+
+        write(copy, file.substr(0, 16));
+        EXPECT_THROWS_AS(Tree(copy, 0, 0), eckit::BadValue);  // too short
+
+        std::string content = file;
+        std::memset(&content[offsetof(KDMappedHeader, complete_)], 0, sizeof(std::uint64_t));
+        write(copy, content);
+        EXPECT_THROWS_AS(Tree(copy, 0, 0), eckit::BadValue);  // incomplete
+
+        content    = file;
+        content[0] = 'X';
+        write(copy, content);
+        EXPECT_THROWS_AS(Tree(copy, 0, 0), eckit::BadValue);  // not a tree
+    }
+
+    SECTION("unknown checksum algorithm") {
+        std::string content      = file;
+        const std::uint32_t hash = 99;
+        std::memcpy(&content[offsetof(KDMappedHeader, hash_)], &hash, sizeof(hash));
+        write(copy, content);
+
+        // the tree is usable, only its verification fails
+        Tree kd(copy, 0, 0);
+        EXPECT(kd.nearestNeighbour(points[0].point()).payload() == points[0].payload());
+        EXPECT_THROWS_AS(kd.verify(), eckit::BadValue);
+    }
+
+    SECTION("legacy") {
+        // header of 4 size_t (header size, item count, item size, metadata size), followed by the nodes
+        const size_t capacity  = points.size() + 10;
+        const size_t header[4] = {4 * sizeof(size_t), capacity, sizeof(Node), 0};
+
+        const size_t base   = ((sizeof(KDMappedHeader) + 4 * sizeof(double) + sizeof(Node) - 1) / sizeof(Node)) * sizeof(Node);
+        const size_t legacy = ((sizeof(header) + sizeof(Node) - 1) / sizeof(Node)) * sizeof(Node);
+
+        std::string content(legacy, 0);
+        std::memcpy(&content[0], header, sizeof(header));
+        content += file.substr(base);
+        write(copy, content);
+
+        Tree kd(copy, 0, 0);
+        EXPECT_EQUAL(kd.size(), capacity);  // count was not recorded
+        EXPECT(kd.verify());
+
+        Point min;
+        Point max;
+        EXPECT(!kd.boundingBox(min, max));
+        EXPECT(kd.nearestNeighbour(points[0].point()).payload() == points[0].payload());
+    }
+
+    if (copy.exists()) {
+        copy.unlink();
+    }
+    path.unlink();
+}
+
 CASE("test_kdtree_iterate_empty") {
     using Tree = KDTreeMemory<TestTreeTrait>;
 
@@ -365,6 +553,255 @@ CASE("test_kdtree_iterate_empty") {
     EXPECT_EQUAL(count, 0);
 }
 
+CASE("test_kdtree_parallel_build") {
+    using Tree  = KDTreeMemory<TestTreeTrait>;
+    using Point = Tree::PointType;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-100., 100.);
+
+    std::vector<Tree::Value> points;
+    for (size_t i = 0; i < 100000; ++i) {
+        points.emplace_back(Point(dist(gen), dist(gen)), double(i));
+    }
+
+    std::vector<Tree::Value> copy(points);
+
+    TaskScheduler scheduler("kdtree", 4);
+
+    Tree sequential;
+    sequential.build(points);
+
+    Tree parallel;
+    parallel.build(copy, scheduler);
+
+    EXPECT_EQUAL(parallel.size(), points.size());
+
+    // the same tree, with the nodes in a different order
+    size_t count = 0;
+    for (auto& item : parallel) {
+        (void)item;
+        count++;
+    }
+    EXPECT_EQUAL(count, points.size());
+
+    for (size_t i = 0; i < 1000; ++i) {
+        Point p(dist(gen), dist(gen));
+
+        EXPECT(parallel.nearestNeighbour(p).payload() == sequential.nearestNeighbour(p).payload());
+        EXPECT(parallel.nearestNeighbour(p).payload() == parallel.nearestNeighbourBruteForce(p).payload());
+
+        auto a = parallel.kNearestNeighbours(p, 8);
+        auto b = sequential.kNearestNeighbours(p, 8);
+        EXPECT_EQUAL(a.size(), b.size());
+        for (size_t j = 0; j < a.size(); ++j) {
+            EXPECT(a[j].payload() == b[j].payload());
+        }
+
+        auto c = parallel.findInSphere(p, 2.);
+        auto d = sequential.findInSphere(p, 2.);
+        EXPECT_EQUAL(c.size(), d.size());
+    }
+
+    SECTION("mapped") {
+        using Mapped = KDTreeMapped<TestTreeTrait>;
+
+        eckit::PathName path("test_kdtree_parallel_build.kdtree");
+        if (path.exists()) {
+            path.unlink();
+        }
+
+        {
+            Mapped kd(path, points.size(), 0);
+            kd.build(points.begin(), points.end(), scheduler);
+            EXPECT_EQUAL(kd.size(), points.size());
+        }
+
+        Mapped kd(path, 0, 0);
+        EXPECT_THROWS_AS(kd.build(points, scheduler), eckit::AssertionFailed);
+
+        for (size_t i = 0; i < 1000; ++i) {
+            Point p(dist(gen), dist(gen));
+            EXPECT(kd.nearestNeighbour(p).payload() == sequential.nearestNeighbour(p).payload());
+        }
+
+        path.unlink();
+    }
+
+    SECTION("small") {
+        for (size_t n : {0, 1, 2, 3, 7}) {
+            std::vector<Tree::Value> few(points.begin(), points.begin() + n);
+            Tree kd;
+            kd.build(few, scheduler);
+            EXPECT_EQUAL(kd.size(), n);
+            if (n > 0) {
+                EXPECT(kd.nearestNeighbour(points[0].point()).payload() == points[0].payload());
+            }
+        }
+    }
+}
+
+CASE("test_kdtree_arena") {
+    using Tree  = KDTreeMemory<TestTreeTrait>;
+    using Point = Tree::PointType;
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> dist(-100., 100.);
+
+    std::vector<Tree::Value> points;
+    for (size_t i = 0; i < 20000; ++i) {
+        points.emplace_back(Point(dist(gen), dist(gen)), double(i));
+    }
+
+    Tree reference;
+    reference.build(points);
+
+    KDArena arena(64 * 1024);
+    TaskScheduler scheduler("kdtree", 2);
+
+    using ArenaTree = KDTreeArena<TestTreeTrait>;
+
+    // trees of successive requests, reusing the arena
+    auto requests = [&](const std::function<void(ArenaTree&)>& build) {
+        size_t blocks = 0;
+        for (int request = 0; request < 3; ++request) {
+            {
+                ArenaTree kd(arena);
+                build(kd);
+
+                EXPECT_EQUAL(kd.size(), points.size());
+                EXPECT(arena.bytesUsed() >= points.size() * sizeof(ArenaTree::Node));
+                EXPECT(arena.bytesAllocated() >= arena.bytesUsed());
+                EXPECT(arena.fragmentation() < 0.1);
+
+                for (size_t i = 0; i < 200; ++i) {
+                    Point p(dist(gen), dist(gen));
+                    EXPECT(kd.nearestNeighbour(p).payload() == reference.nearestNeighbour(p).payload());
+                }
+            }
+
+            // all released, the blocks are kept for the next tree
+            EXPECT(arena.nbItems() == 0);
+            EXPECT(arena.bytesUsed() == 0);
+            if (request == 0) {
+                blocks = arena.blocks();
+                EXPECT(blocks > 0);
+            }
+            EXPECT(arena.blocks() == blocks);
+        }
+
+        arena.release();
+        EXPECT(arena.blocks() == 0);
+        EXPECT(arena.bytesAllocated() == 0);
+    };
+
+    SECTION("build") {
+        requests([&](ArenaTree& kd) { kd.build(points); });
+    }
+
+    SECTION("parallel build") {
+        requests([&](ArenaTree& kd) { kd.build(points, scheduler); });
+    }
+
+    SECTION("insert") {
+        requests([&](ArenaTree& kd) {
+            for (const auto& v : points) {
+                kd.insert(v);
+            }
+        });
+    }
+}
+
+CASE("test_kdtree_batch_queries") {
+    using Tree  = KDTreeMemory<TestTreeTrait>;
+    using Point = Tree::PointType;
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-100., 100.);
+
+    std::vector<Tree::Value> points;
+    for (size_t i = 0; i < 20000; ++i) {
+        points.emplace_back(Point(dist(gen), dist(gen)), double(i));
+    }
+
+    Tree kd;
+    kd.build(points);
+
+    // more queries than a task's worth, outside the tree's bounding box too
+    std::uniform_real_distribution<double> wide(-150., 150.);
+    std::vector<Point> queries;
+    for (size_t i = 0; i < 5000; ++i) {
+        queries.emplace_back(wide(gen), wide(gen));
+    }
+    const size_t n = queries.size();
+
+    TaskScheduler scheduler("kdtree", 4);
+
+    for (auto* s : {static_cast<TaskScheduler*>(nullptr), &scheduler}) {
+        SECTION(s ? "parallel" : "sequential") {
+            std::vector<double> payloads(n);
+            std::vector<double> distances(n);
+            kd.nearestNeighbours(queries.data(), n, payloads.data(), distances.data(), s);
+            for (size_t i = 0; i < n; ++i) {
+                auto nn = kd.nearestNeighbour(queries[i]);
+                EXPECT_EQUAL(payloads[i], nn.payload());
+                EXPECT_EQUAL(distances[i], nn.distance());
+            }
+
+            const size_t k = 5;
+            payloads.assign(n * k, -1.);
+            distances.assign(n * k, -1.);
+            kd.kNearestNeighbours(queries.data(), n, k, payloads.data(), distances.data(), s);
+            for (size_t i = 0; i < n; ++i) {
+                auto knn = kd.kNearestNeighbours(queries[i], k);
+                EXPECT_EQUAL(knn.size(), k);
+                for (size_t j = 0; j < k; ++j) {
+                    EXPECT_EQUAL(payloads[i * k + j], knn[j].payload());
+                    EXPECT_EQUAL(distances[i * k + j], knn[j].distance());
+                }
+            }
+
+            std::vector<size_t> offsets;
+            kd.findInSphere(queries.data(), n, 3., offsets, payloads, distances, s);
+            EXPECT_EQUAL(offsets.size(), n + 1);
+            EXPECT_EQUAL(offsets[n], payloads.size());
+            for (size_t i = 0; i < n; ++i) {
+                auto sphere = kd.findInSphere(queries[i], 3.);
+                EXPECT_EQUAL(offsets[i + 1] - offsets[i], sphere.size());
+                for (size_t j = 0; j < sphere.size(); ++j) {
+                    EXPECT_EQUAL(distances[offsets[i] + j], sphere[j].distance());
+                }
+            }
+        }
+    }
+
+    SECTION("more neighbours than points") {
+        std::vector<Tree::Value> few(points.begin(), points.begin() + 3);
+        Tree small;
+        small.build(few);
+
+        std::vector<double> payloads(n * 4, -1.);
+        std::vector<double> distances(n * 4);
+        small.kNearestNeighbours(queries.data(), n, 4, payloads.data(), distances.data(), &scheduler);
+        for (size_t i = 0; i < n; ++i) {
+            EXPECT(distances[i * 4 + 2] < std::numeric_limits<double>::infinity());
+            EXPECT(distances[i * 4 + 3] == std::numeric_limits<double>::infinity());
+            EXPECT_EQUAL(payloads[i * 4 + 3], -1.);
+        }
+    }
+
+    SECTION("statistics") {
+        kd.statsReset();
+        std::vector<double> payloads(n);
+        std::vector<double> distances(n);
+        kd.nearestNeighbours(queries.data(), n, payloads.data(), distances.data(), &scheduler);
+        const auto& stats = static_cast<Tree::KDTree&>(kd).alloc_;
+        EXPECT_EQUAL(stats.calls_, n);
+        EXPECT_EQUAL(stats.nodes_, 0);
+        EXPECT(stats.statsEnabled());
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace eckit::test
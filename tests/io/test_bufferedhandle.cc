@@ -0,0 +1,270 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/BufferedHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "util.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class Tester {
+public:
+    Tester() :
+        data_(testData(1024 * 1024 + 17)), path_("bufferedhandle") {}
+
+    void write() { path_.write(data_); }
+
+    std::string content() const { return path_.read(); }
+
+    const std::string& data() const { return data_; }
+    const PathName& path() const { return path_; }
+
+private:
+    const std::string data_;
+    const TestFile path_;
+};
+
+/// Fails to write after a few bytes
+class FailingHandle : public DataHandle {
+public:
+    void openForWrite(const Length&) override {}
+    long write(const void*, long length) override {
+        if (written_ > 100) {
+            throw WriteError("FailingHandle", Here());
+        }
+        written_ += length;
+        return length;
+    }
+    void close() override {}
+    void print(std::ostream& s) const override { s << "FailingHandle[]"; }
+
+private:
+    long written_ = 0;
+};
+
+/// Writes slowly in memory, at the position of the last seek
+class SlowHandle : public DataHandle {
+public:
+    void openForWrite(const Length&) override { position_ = 0; }
+    long write(const void* buffer, long length) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        data_.resize(std::max(data_.size(), position_ + length));
+        data_.replace(position_, length, static_cast<const char*>(buffer), length);
+        position_ += length;
+        return length;
+    }
+    Offset seek(const Offset& offset) override {
+        position_ = size_t(static_cast<long long>(offset));
+        return offset;
+    }
+    void rewind() override { position_ = 0; }
+    void close() override {}
+    void print(std::ostream& s) const override { s << "SlowHandle[]"; }
+
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+    size_t position_ = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Buffered handle read ahead") {
+    Tester tester;
+    tester.write();
+
+    const std::string& data = tester.data();
+
+    BufferedHandle h(new FileHandle(tester.path()), 4096);
+    h.readAhead(3);
+
+    EXPECT(h.openForRead() == Length(data.size()));
+    AutoClose closer(h);
+
+    std::string result;
+    char buffer[10000];
+    long len = 0;
+    for (size_t n = 1; (len = h.read(buffer, long(n % sizeof(buffer) + 1))) > 0; n = n * 3 + 1) {
+        result.append(buffer, len);
+    }
+
+    EXPECT(result == data);
+    EXPECT(h.position() == Offset(data.size()));
+
+    const BufferedHandleStatistics& stats = h.statistics();
+    EXPECT(stats.reads_ == (data.size() + 4095) / 4096);
+    EXPECT(stats.readAhead_ > 0);
+    EXPECT(stats.readAhead_ < stats.reads_);
+}
+
+CASE("Buffered handle read ahead, with seeks") {
+    Tester tester;
+    tester.write();
+
+    const std::string& data = tester.data();
+
+    BufferedHandle h(new FileHandle(tester.path()), 4096);
+    h.readAhead(4);
+    h.openForRead();
+    AutoClose closer(h);
+
+    char buffer[5000];
+    auto check = [&h, &data, &buffer](size_t offset) {
+        EXPECT(h.position() == Offset(offset));
+        EXPECT(h.read(buffer, sizeof(buffer)) == long(sizeof(buffer)));
+        EXPECT(std::string(buffer, sizeof(buffer)) == data.substr(offset, sizeof(buffer)));
+    };
+
+    check(0);
+    check(5000);
+    check(10000);
+
+    // within the buffers read ahead
+    h.skip(10000);
+    check(25000);
+
+    // beyond
+    h.skip(500000);
+    check(530000);
+    check(535000);
+    check(540000);
+
+    h.seek(100);
+    check(100);
+
+    h.rewind();
+    check(0);
+}
+
+CASE("Buffered handle read ahead, only of files") {
+    Tester tester;
+
+    const std::string& data = tester.data();
+
+    BufferedHandle h(new MemoryHandle(data.data(), data.size()), 4096);
+    h.readAhead(3);
+    h.openForRead();
+    AutoClose closer(h);
+
+    std::string result(data.size(), '\0');
+    EXPECT(h.read(&result[0], long(result.size())) == long(result.size()));
+    EXPECT(result == data);
+
+    EXPECT(h.statistics().reads_ == (data.size() + 4095) / 4096);
+    EXPECT(h.statistics().readAhead_ == 0);
+}
+
+CASE("Buffered handle write behind") {
+    Tester tester;
+
+    const std::string& data = tester.data();
+
+    BufferedHandle h(new FileHandle(tester.path()), 4096);
+    h.writeBehind(2);
+    h.openForWrite(0);
+
+    size_t done = 0;
+    for (size_t n = 1; done < data.size(); n = n * 3 + 1) {
+        const size_t len = std::min(n % 10000 + 1, data.size() - done);
+        EXPECT(h.write(&data[done], long(len)) == long(len));
+        done += len;
+
+        if (done > data.size() / 2 && done - len <= data.size() / 2) {
+            h.flush();
+            EXPECT(tester.path().size() == Length(done));
+        }
+    }
+
+    h.close();
+
+    EXPECT(tester.content() == data);
+
+    const BufferedHandleStatistics& stats = h.statistics();
+    EXPECT(stats.writes_ >= data.size() / 4096);
+    EXPECT(stats.writeBehind_ == stats.writes_);
+}
+
+CASE("Buffered handle write behind, with errors") {
+    BufferedHandle h(new FailingHandle(), 16);
+    h.writeBehind(2);
+
+    const std::string data(1000, 'x');
+    auto run = [&h, &data] {
+        h.openForWrite(0);
+        for (size_t i = 0; i < data.size(); i += 10) {
+            h.write(&data[i], 10);
+        }
+        h.close();
+    };
+
+    EXPECT_THROWS_AS(run(), WriteError);
+}
+
+CASE("Buffered handle write behind, with seeks") {
+    SlowHandle* slow = new SlowHandle();
+
+    BufferedHandle h(slow, 16);
+    h.writeBehind(4);
+    h.openForWrite(0);
+
+    // full buffers queued for the background thread are written before seeking
+    const std::string a(64, 'a');
+    EXPECT(h.write(a.data(), long(a.size())) == long(a.size()));
+    EXPECT(h.seek(16) == Offset(16));
+    EXPECT(slow->data() == a);
+
+    const std::string b(32, 'b');
+    EXPECT(h.write(b.data(), long(b.size())) == long(b.size()));
+    h.rewind();
+    EXPECT(slow->data() == std::string(16, 'a') + b + std::string(16, 'a'));
+
+    h.close();
+}
+
+CASE("Buffered handle write behind, with errors before seeking") {
+    BufferedHandle h(new FailingHandle(), 16);
+    h.writeBehind(2);
+    h.openForWrite(0);
+
+    const std::string data(160, 'x');
+    auto run = [&h, &data] {
+        for (size_t i = 0; i < data.size(); i += 10) {
+            h.write(&data[i], 10);
+        }
+        h.rewind();
+    };
+
+    EXPECT_THROWS_AS(run(), WriteError);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char* argv[]) {
+    return run_tests(argc, argv);
+}
@@ -0,0 +1,273 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/CompressedHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/testing/Test.h"
+#include "eckit/utils/Compressor.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Run-length encoding, so that the blocks are really transformed
+class RunLengthCompressor : public Compressor {
+public:
+    size_t compress(const void* in, size_t len, Buffer& out) const override {
+        const unsigned char* p = static_cast<const unsigned char*>(in);
+        if (out.size() < 2 * len) {
+            out.resize(2 * len);
+        }
+        unsigned char* q = static_cast<unsigned char*>(out.data());
+        size_t n         = 0;
+        for (size_t i = 0; i < len;) {
+            size_t run = 1;
+            while (i + run < len && run < 255 && p[i + run] == p[i]) {
+                run++;
+            }
+            q[n++] = static_cast<unsigned char>(run);
+            q[n++] = p[i];
+            i += run;
+        }
+        return n;
+    }
+
+    void uncompress(const void* in, size_t len, Buffer& out, size_t outlen) const override {
+        const unsigned char* p = static_cast<const unsigned char*>(in);
+        if (out.size() < outlen) {
+            out.resize(outlen);
+        }
+        unsigned char* q = static_cast<unsigned char*>(out.data());
+        size_t n         = 0;
+        for (size_t i = 0; i < len; i += 2) {
+            ASSERT(n + p[i] <= outlen);
+            std::memset(q + n, p[i + 1], p[i]);
+            n += p[i];
+        }
+        ASSERT(n == outlen);
+    }
+};
+
+CompressorBuilder<RunLengthCompressor> rle("test-rle");
+
+/// Hides the ability of a file to seek
+class SequentialHandle : public DataHandle {
+public:
+    explicit SequentialHandle(const PathName& path) : file_(path) {}
+
+    Length openForRead() override { return file_.openForRead(); }
+    bool canSeek() const override { return false; }
+    long read(void* buffer, long length) override { return file_.read(buffer, length); }
+    void close() override { file_.close(); }
+    void print(std::ostream& s) const override { s << "SequentialHandle[" << file_ << "]"; }
+
+private:
+    FileHandle file_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class Tester {
+public:
+    Tester() {
+        for (size_t i = 0; i < 100 * 1024 + 17; ++i) {
+            data_.push_back(char('a' + (i / 37) % 26));
+        }
+
+        std::string base = Resource<std::string>("$TMPDIR", "/tmp");
+        path_            = PathName::unique(base + "/compressedhandle");
+        path_ += ".dat";
+    }
+
+    ~Tester() { path_.unlink(false); }
+
+    /// Write the data in pieces of irregular size
+    void write(const std::string& compression, size_t blockSize) {
+        CompressedHandle h(new FileHandle(path_), compression, blockSize);
+        h.openForWrite(0);
+
+        size_t done = 0;
+        for (size_t n = 1; done < data_.size(); n = n * 3 + 1) {
+            const size_t len = std::min(n % 5000 + 1, data_.size() - done);
+            EXPECT(h.write(&data_[done], long(len)) == long(len));
+            done += len;
+        }
+
+        h.close();
+        blocks_ = h.blocks();
+    }
+
+    const std::string& data() const { return data_; }
+    const PathName& path() const { return path_; }
+    size_t blocks() const { return blocks_; }
+
+private:
+    std::string data_;
+    PathName path_;
+    size_t blocks_ = 0;
+};
+
+std::string readAll(DataHandle& h, long chunk) {
+    std::string result;
+    Buffer buffer(chunk);
+    long len = 0;
+    while ((len = h.read(buffer, chunk)) > 0) {
+        result.append(static_cast<const char*>(buffer), len);
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Compressed handle round trip") {
+    for (const std::string compression : {"none", "test-rle"}) {
+        Tester tester;
+        tester.write(compression, 1000);
+
+        EXPECT(tester.blocks() == (tester.data().size() + 999) / 1000);
+        EXPECT(tester.path().size() < Length(tester.data().size()) || compression == "none");
+
+        CompressedHandle h(new FileHandle(tester.path()));
+        Length estimate = h.openForRead();
+        AutoClose closer(h);
+
+        EXPECT(h.compression() == compression);
+        EXPECT(h.blocks() == tester.blocks());
+        EXPECT(estimate == Length(tester.data().size()));
+        EXPECT(readAll(h, 777) == tester.data());
+        EXPECT(h.position() == Offset(tester.data().size()));
+    }
+}
+
+CASE("Compressed handle seek") {
+    Tester tester;
+    tester.write("test-rle", 1024);
+
+    const std::string& data = tester.data();
+
+    CompressedHandle h(new FileHandle(tester.path()));
+    h.openForRead();
+    AutoClose closer(h);
+
+    EXPECT(h.canSeek());
+
+    char buffer[3000];
+    for (size_t offset : {size_t(50000), size_t(10), size_t(1023), size_t(1024), size_t(99000), size_t(50001),
+                          data.size() - 100}) {
+        EXPECT(h.seek(offset) == Offset(offset));
+
+        const long expected = long(std::min(sizeof(buffer), data.size() - offset));
+        EXPECT(h.read(buffer, sizeof(buffer)) == expected);
+        EXPECT(std::string(buffer, expected) == data.substr(offset, expected));
+        EXPECT(h.position() == Offset(offset + expected));
+    }
+
+    h.seek(100);
+    h.skip(5000);
+    EXPECT(h.read(buffer, 10) == 10);
+    EXPECT(std::string(buffer, 10) == data.substr(5100, 10));
+
+    h.rewind();
+    EXPECT(readAll(h, 4096) == data);
+
+    EXPECT(h.seek(data.size() + 10) == Offset(data.size()));
+    EXPECT(h.read(buffer, sizeof(buffer)) == 0);
+}
+
+CASE("Compressed handle without seeking") {
+    Tester tester;
+    tester.write("test-rle", 4096);
+
+    const std::string& data = tester.data();
+
+    CompressedHandle h(new SequentialHandle(tester.path()));
+    EXPECT(!h.canSeek());
+
+    EXPECT(h.openForRead() == Length(0));
+    AutoClose closer(h);
+
+    char buffer[100];
+    h.skip(20000);
+    EXPECT(h.read(buffer, sizeof(buffer)) == long(sizeof(buffer)));
+    EXPECT(std::string(buffer, sizeof(buffer)) == data.substr(20000, sizeof(buffer)));
+
+    EXPECT(readAll(h, 1000) == data.substr(20100));
+
+    auto back = [&h] { h.seek(0); };
+    EXPECT_THROWS_AS(back(), NotImplemented);
+}
+
+CASE("Compressed handle empty stream") {
+    Tester tester;
+    {
+        CompressedHandle h(new FileHandle(tester.path()), "none");
+        h.openForWrite(0);
+        h.close();
+    }
+
+    CompressedHandle h(new FileHandle(tester.path()));
+    EXPECT(h.openForRead() == Length(0));
+    AutoClose closer(h);
+
+    char buffer[10];
+    EXPECT(h.read(buffer, sizeof(buffer)) == 0);
+}
+
+CASE("Compressed handle not compressed") {
+    Tester tester;
+    {
+        FileHandle h(tester.path());
+        h.openForWrite(0);
+        AutoClose closer(h);
+        h.write(tester.data().c_str(), long(tester.data().size()));
+    }
+
+    CompressedHandle h(new FileHandle(tester.path()));
+    auto open = [&h] { h.openForRead(); };
+    EXPECT_THROWS_AS(open(), ReadError);
+}
+
+CASE("Compressed handle save into") {
+    Tester tester;
+    tester.write("test-rle", 1000);
+
+    PathName target = PathName::unique(tester.path());
+    {
+        CompressedHandle h(new FileHandle(tester.path()));
+        FileHandle out(target);
+        EXPECT(h.saveInto(out) == Length(tester.data().size()));
+    }
+
+    FileHandle in(target);
+    in.openForRead();
+    AutoClose closer(in);
+    EXPECT(readAll(in, 10000) == tester.data());
+
+    target.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char* argv[]) {
+    return run_tests(argc, argv);
+}
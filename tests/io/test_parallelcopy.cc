@@ -0,0 +1,242 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileDescHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MultiHandle.h"
+#include "eckit/io/ParallelCopy.h"
+#include "eckit/io/PartFileHandle.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/testing/Test.h"
+
+#include "util.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Several chunks per stream and an odd tail
+const size_t size = 3 * 1024 * 1024 + 17;
+
+/// Not seekable, of unknown size
+class StreamHandle : public DataHandle {
+public:
+    explicit StreamHandle(const std::string& data) :
+        data_(data) {}
+
+    void print(std::ostream& s) const override { s << "StreamHandle[]"; }
+
+    Length openForRead() override { return 0; }
+    void close() override {}
+    bool canSeek() const override { return false; }
+
+    long read(void* buffer, long length) override {
+        long n = std::min(length, long(data_.size() - position_));
+        std::memcpy(buffer, data_.data() + position_, size_t(n));
+        position_ += size_t(n);
+        return n;
+    }
+
+private:
+    std::string data_;
+    size_t position_ = 0;
+};
+
+/// Written sequentially, fails after limit bytes
+class SinkHandle : public DataHandle {
+public:
+    explicit SinkHandle(size_t limit = size_t(-1)) :
+        limit_(limit) {}
+
+    void print(std::ostream& s) const override { s << "SinkHandle[]"; }
+
+    void openForWrite(const Length&) override {}
+    void close() override {}
+
+    long write(const void* buffer, long length) override {
+        if (data_.size() + size_t(length) > limit_) {
+            throw WriteError("SinkHandle: full");
+        }
+        data_.append(static_cast<const char*>(buffer), size_t(length));
+        return length;
+    }
+
+    std::string data_;
+
+private:
+    size_t limit_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Parallel copy") {
+    CopyTester test("parallelcopy", size);
+
+    SECTION("file to file") {
+        Progress progress;
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        ParallelCopy copy(4, 64 * 1024, progress);
+        Length total = copy.copy(in, out);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT_EQUAL(progress.bytes_, (long long)test.data_.size());
+        EXPECT(test.target() == test.data_);
+
+        const ParallelCopyStatistics& stats = copy.statistics();
+        EXPECT(stats.parallel_);
+        EXPECT(stats.positional_);
+        EXPECT_EQUAL(stats.bytes_, total);
+        EXPECT(stats.streams_ >= 1 && stats.streams_ <= 4);
+        EXPECT(stats.chunks_ > 1);
+    }
+
+    SECTION("watcher sees the data in order") {
+        Checksum sum;
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        ParallelCopy copy(4, 64 * 1024, sum);
+        copy.copy(in, out);
+
+        EXPECT(copy.statistics().parallel_);
+        EXPECT(!copy.statistics().positional_);
+        EXPECT_EQUAL(sum.sum_, checksum(test.data_));
+        EXPECT(test.target() == test.data_);
+    }
+
+    SECTION("sequential target") {
+        FileHandle in(test.source_);
+        SinkHandle out;
+
+        ParallelCopy copy(3, 100 * 1000);
+        copy.copy(in, out);
+
+        EXPECT(copy.statistics().parallel_);
+        EXPECT(!copy.statistics().positional_);
+        EXPECT(out.data_ == test.data_);
+    }
+
+    SECTION("target opened for appending") {
+        Progress progress;
+        FileHandle in(test.source_);
+
+        int fd = ::open(test.target_.localPath(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        EXPECT(fd >= 0);
+        FileDescHandle out(fd, true);
+
+        ParallelCopy copy(4, 64 * 1024, progress);
+        copy.copy(in, out);
+
+        EXPECT(copy.statistics().parallel_);
+        EXPECT(!copy.statistics().positional_);
+        EXPECT(test.target() == test.data_);
+    }
+
+    // read through PooledHandles, in pools of the threads that open them
+    SECTION("part file source") {
+        const size_t offset = 1000;
+        const size_t length = 2 * 1024 * 1024;
+
+        PartFileHandle in(test.source_, offset, length);
+        FileHandle out(test.target_);
+
+        ParallelCopy copy(4, 64 * 1024);
+        Length total = copy.copy(in, out);
+
+        EXPECT_EQUAL(total, Length(length));
+        EXPECT(copy.statistics().parallel_);
+        EXPECT(test.target() == test.data_.substr(offset, length));
+    }
+
+    SECTION("multi handle source") {
+        const size_t half = test.data_.size() / 2;
+
+        MultiHandle in;
+        in += new PartFileHandle(test.source_, 0, half);
+        in += new PartFileHandle(test.source_, half, test.data_.size() - half);
+        FileHandle out(test.target_);
+
+        ParallelCopy copy(4, 64 * 1024);
+        Length total = copy.copy(in, out);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT(copy.statistics().parallel_);
+        EXPECT(test.target() == test.data_);
+    }
+
+    SECTION("one stream") {
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        ParallelCopy copy(1, 64 * 1024);
+        copy.copy(in, out);
+
+        EXPECT(!copy.statistics().parallel_);
+        EXPECT(test.target() == test.data_);
+    }
+}
+
+CASE("Sequential source") {
+    CopyTester test("parallelcopy", size);
+
+    Checksum sum;
+    StreamHandle in(test.data_);
+    FileHandle out(test.target_);
+
+    ParallelCopy copy(4, 64 * 1024, sum);
+    Length total = copy.copy(in, out);
+
+    EXPECT_EQUAL(total, Length(test.data_.size()));
+    EXPECT(!copy.statistics().parallel_);
+    EXPECT(copy.statistics().streams_ == 1);
+    EXPECT_EQUAL(sum.sum_, checksum(test.data_));
+    EXPECT(test.target() == test.data_);
+}
+
+CASE("Errors are rethrown") {
+    CopyTester test("parallelcopy", size);
+
+    SECTION("parallel") {
+        FileHandle in(test.source_);
+        SinkHandle out(1000000);
+
+        auto run = [&in, &out] { ParallelCopy(4, 64 * 1024).copy(in, out); };
+        EXPECT_THROWS_AS(run(), WriteError);
+    }
+
+    SECTION("sequential") {
+        StreamHandle in(test.data_);
+        SinkHandle out(1000000);
+
+        auto run = [&in, &out] { ParallelCopy(4, 64 * 1024).copy(in, out); };
+        EXPECT_THROWS_AS(run(), WriteError);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
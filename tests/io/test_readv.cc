@@ -0,0 +1,195 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/io/MultiHandle.h"
+#include "eckit/io/PartFileHandle.h"
+#include "eckit/io/ReadRange.h"
+#include "eckit/testing/Test.h"
+#include "eckit/types/Types.h"
+
+#include "util.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class Tester {
+public:
+    Tester() :
+        data_(testData(256 * 1024)), path_("readv") {
+        path_.write(data_);
+    }
+
+    /// Read ranges (offset, length) of a handle, and check them against the data
+    void check(DataHandle& handle, const std::vector<std::pair<long long, long long>>& ranges,
+               const std::string& data) const {
+        std::vector<std::string> buffers;
+        for (const auto& r : ranges) {
+            buffers.emplace_back(size_t(r.second), '\0');
+        }
+
+        ReadRanges rr;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            rr.emplace_back(ranges[i].first, ranges[i].second, &buffers[i][0]);
+        }
+
+        handle.readv(rr);
+
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            EXPECT(buffers[i] == data.substr(size_t(ranges[i].first), size_t(ranges[i].second)));
+        }
+    }
+
+    const std::string data_;
+    const TestFile path_;
+};
+
+const std::vector<std::pair<long long, long long>> ranges = {
+    {1000, 100}, {0, 10}, {1050, 200}, {200000, 5000}, {100000, 1}, {1100, 20}, {262000, 144}, {5, 0},
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("ReadSpans merges close ranges") {
+    char b[1];
+    ReadRanges rr = {
+        ReadRange(100, 10, b), ReadRange(0, 10, b), ReadRange(20, 10, b), ReadRange(1000, 10, b),
+        ReadRange(115, 10, b), ReadRange(50, 0, b),
+    };
+
+    SECTION("gap") {
+        ReadSpans spans(rr, 10, 1024);
+        EXPECT_EQUAL(spans.size(), 3);
+
+        EXPECT_EQUAL(spans[0].offset_, Offset(0));
+        EXPECT_EQUAL(spans[0].length_, Length(30));
+        EXPECT(spans[0].ranges_ == std::vector<size_t>({1, 2}));
+        EXPECT(spans.direct(0) == nullptr);
+
+        EXPECT_EQUAL(spans[1].offset_, Offset(100));
+        EXPECT_EQUAL(spans[1].length_, Length(25));
+
+        EXPECT_EQUAL(spans[2].offset_, Offset(1000));
+        EXPECT(spans.direct(2) == b);
+    }
+
+    SECTION("no gap") {
+        ReadSpans spans(rr, 0, 1024);
+        EXPECT_EQUAL(spans.size(), 5);
+    }
+
+    SECTION("max span") {
+        ReadSpans spans(rr, 1000, 30);
+        EXPECT_EQUAL(spans.size(), 3);
+        EXPECT_EQUAL(spans[0].length_, Length(30));
+        EXPECT_EQUAL(spans[1].length_, Length(25));
+    }
+}
+
+CASE("FileHandle::readv") {
+    Tester test;
+
+    FileHandle h(test.path_);
+    h.openForRead();
+    AutoClose closer(h);
+
+    test.check(h, ranges, test.data_);
+
+    // the position of the handle is not changed
+    char c;
+    long n = h.read(&c, 1);
+    EXPECT_EQUAL(n, 1);
+    EXPECT_EQUAL(c, test.data_[0]);
+
+    SECTION("past the end") {
+        char b[10];
+        EXPECT_THROWS_AS(h.readv({ReadRange(test.data_.size() - 5, 10, b)}), ReadError);
+    }
+}
+
+CASE("DataHandle::readv") {
+    Tester test;
+
+    MemoryHandle h(test.data_.data(), test.data_.size());
+    h.openForRead();
+    AutoClose closer(h);
+
+    test.check(h, ranges, test.data_);
+}
+
+CASE("PartFileHandle::readv") {
+    Tester test;
+
+    OffsetList offsets = {200000, 0, 1000, 100000, 1000};
+    LengthList lengths = {60000, 300, 50000, 0, 20};
+
+    std::string data;
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        data += test.data_.substr(size_t((long long)offsets[i]), size_t((long long)lengths[i]));
+    }
+
+    PartFileHandle h(test.path_, offsets, lengths);
+    h.openForRead();
+    AutoClose closer(h);
+
+    SECTION("ranges") {
+        test.check(h, {{59990, 320}, {0, 60000}, {70000, 40320}, {60300, 1}, {5, 0}}, data);
+    }
+
+    SECTION("read over parts") {
+        std::string buffer(data.size() + 10, '\0');
+        long n = h.read(&buffer[0], 59000);
+        EXPECT_EQUAL(n, 59000);
+
+        n = h.read(&buffer[59000], long(buffer.size()) - 59000);
+        EXPECT_EQUAL(n, long(data.size()) - 59000);
+
+        n = h.read(&buffer[0], 10);
+        EXPECT_EQUAL(n, 0);
+        EXPECT(buffer.substr(0, data.size()) == data);
+    }
+
+    SECTION("past the end") {
+        char b[10];
+        EXPECT_THROWS_AS(h.readv({ReadRange(data.size() - 5, 10, b)}), ReadError);
+    }
+}
+
+CASE("MultiHandle::readv") {
+    Tester test;
+
+    MultiHandle h;
+    h += new PartFileHandle(test.path_, 100000, 150000);
+    h += new FileHandle(test.path_);
+
+    std::string data = test.data_.substr(100000, 150000) + test.data_;
+
+    h.openForRead();
+    AutoClose closer(h);
+
+    test.check(h, {{149990, 20}, {0, 10}, {300000, 100000}, {5, 1}}, data);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
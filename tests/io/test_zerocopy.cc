@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileDescHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/io/PartFileHandle.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/io/ZeroCopyTransfer.h"
+#include "eckit/testing/Test.h"
+#include "eckit/types/Types.h"
+
+#include "util.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Several transfer chunks and an odd tail
+const size_t size = 3 * 1024 * 1024 + 17;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("File to file") {
+    CopyTester test("zerocopy", size);
+
+    SECTION("copyTo") {
+        Progress progress;
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        Length total = in.copyTo(out, -1, -1, progress);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT(progress.zeroCopy_);
+        EXPECT_EQUAL(progress.bytes_, (long long)test.data_.size());
+        EXPECT(test.target() == test.data_);
+    }
+
+    SECTION("copyTo, maxsize") {
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        Length total = in.copyTo(out, -1, 1000000);
+
+        EXPECT_EQUAL(total, Length(1000000));
+        EXPECT(test.target() == test.data_.substr(0, 1000000));
+    }
+
+    SECTION("saveInto") {
+        Progress progress;
+        FileHandle in(test.source_);
+
+        Length total = in.saveInto(test.target_, progress);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT(progress.zeroCopy_);
+        EXPECT(test.target() == test.data_);
+    }
+
+    SECTION("watcher needs the data") {
+        Checksum sum;
+        FileHandle in(test.source_);
+        FileHandle out(test.target_);
+
+        Length total = in.copyTo(out, 1024 * 1024, -1, sum);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT_EQUAL(sum.sum_, checksum(test.data_));
+        EXPECT(test.target() == test.data_);
+    }
+}
+
+CASE("Parts of a file") {
+    CopyTester test("zerocopy", size);
+
+    OffsetList offsets = {2000000, 0, 1000, 3000000};
+    LengthList lengths = {1000000, 300, 0, 100000};
+
+    std::string expected;
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        expected += test.data_.substr(size_t((long long)offsets[i]), size_t((long long)lengths[i]));
+    }
+
+    Progress progress;
+    PartFileHandle in(test.source_, offsets, lengths);
+    FileHandle out(test.target_);
+
+    Length total = in.copyTo(out, -1, -1, progress);
+
+    EXPECT_EQUAL(total, Length(expected.size()));
+    EXPECT(progress.zeroCopy_);
+    EXPECT(test.target() == expected);
+}
+
+CASE("File to socket") {
+    CopyTester test("zerocopy", size);
+
+    int fds[2];
+    EXPECT(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    std::string received;
+    std::thread reader([&received, fd = fds[1]] {
+        char buffer[64 * 1024];
+        ssize_t n;
+        while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+            received.append(buffer, size_t(n));
+        }
+        ::close(fd);
+    });
+
+    {
+        Progress progress;
+        FileHandle in(test.source_);
+        FileDescHandle out(fds[0], true);
+
+        Length total = in.copyTo(out, -1, -1, progress);
+
+        EXPECT_EQUAL(total, Length(test.data_.size()));
+        EXPECT(progress.zeroCopy_);
+    }
+
+    reader.join();
+    EXPECT(received == test.data_);
+}
+
+CASE("Not from a file") {
+    CopyTester test("zerocopy", size);
+
+    Progress progress;
+    MemoryHandle in(test.data_.data(), test.data_.size());
+    FileHandle out(test.target_);
+
+    Length total = in.copyTo(out, -1, -1, progress);
+
+    EXPECT_EQUAL(total, Length(test.data_.size()));
+    EXPECT(!progress.zeroCopy_);
+    EXPECT(test.target() == test.data_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
@@ -0,0 +1,115 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Test files and transfer watchers shared by the DataHandle tests
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "eckit/config/Resource.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/testing/Test.h"
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Letters with a period (26 * 251) that is not a multiple of any buffer size, so misplaced blocks are detected
+inline std::string testData(size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = char('a' + (i * 7 + i / 251) % 26);
+    }
+    return data;
+}
+
+/// Unique file under $TMPDIR (name, a unique suffix then extension), removed with its last copy (EXPECT_EQUAL copies)
+class TestFile : public PathName {
+public:
+    explicit TestFile(const std::string& name, const std::string& extension = ".dat") :
+        PathName(PathName::unique(std::string(Resource<std::string>("$TMPDIR", "/tmp")) + "/" + name) + extension),
+        remove_(nullptr, [path = PathName(*this)](void*) { path.unlink(false); }) {}
+
+    void write(const std::string& data) const {
+        FileHandle f(*this);
+        f.openForWrite(0);
+        AutoClose closer(f);
+        EXPECT(f.write(data.data(), long(data.size())) == long(data.size()));
+    }
+
+    std::string read() const {
+        std::string result(size_t(size()), '\0');
+        FileHandle f(*this);
+        f.openForRead();
+        AutoClose closer(f);
+        EXPECT(f.read(&result[0], long(result.size())) == long(result.size()));
+        return result;
+    }
+
+private:
+    std::shared_ptr<void> remove_;  ///< deleter called (with nullptr) by the last copy
+};
+
+/// Source file holding data, and a target file to copy it into
+class CopyTester {
+public:
+    CopyTester(const std::string& name, size_t size) :
+        data_(testData(size)), source_(name), target_(name, ".out") {
+        source_.write(data_);
+    }
+
+    std::string target() const { return target_.read(); }
+
+    const std::string data_;
+    const TestFile source_;
+    const TestFile target_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Progress only, allows zero-copy transfers
+struct Progress : public TransferWatcher {
+    void watch(const void* data, long length) override {
+        calls_++;
+        zeroCopy_ = zeroCopy_ || (data == nullptr && length > 0);
+        bytes_ += length;
+    }
+    bool needsData() const override { return false; }
+
+    size_t calls_    = 0;
+    long long bytes_ = 0;
+    bool zeroCopy_   = false;
+};
+
+/// Looks at the data, in order
+struct Checksum : public TransferWatcher {
+    void watch(const void* data, long length) override {
+        EXPECT(data != nullptr || length == 0);
+        for (long i = 0; i < length; ++i) {
+            sum_ = sum_ * 31 + static_cast<const unsigned char*>(data)[i];
+        }
+    }
+
+    unsigned long long sum_ = 0;
+};
+
+inline unsigned long long checksum(const std::string& data) {
+    Checksum c;
+    c.watch(data.data(), long(data.size()));
+    return c.sum_;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
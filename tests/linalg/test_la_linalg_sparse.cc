@@ -8,8 +8,11 @@
  * nor does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+
 #include "eckit/config/Resource.h"
 #include "eckit/linalg/LinearAlgebraSparse.h"
+#include "eckit/linalg/SparseMatrix.h"
 #include "util.h"
 
 namespace eckit::test {
@@ -151,6 +154,241 @@ CASE("test backend") {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Test sparse linear algebra backend against generic, on a matrix with skewed row lengths
+
+CASE("test backend against generic") {
+    using linalg::Matrix;
+    using linalg::Scalar;
+    using linalg::Size;
+    using linalg::SparseMatrix;
+    using linalg::Triplet;
+    using linalg::Vector;
+
+    const Size Ni = 1000;
+    const Size Nj = 800;
+    const Size Nk = 13;
+
+    std::vector<Triplet> triplets;
+    for (Size i = 0; i < Ni; ++i) {
+        const Size n = i % 97 == 0 ? 300 : i % 7;
+        for (Size c = 0; c < n; ++c) {
+            triplets.emplace_back(i, (i * 31 + c * 17) % Nj, Scalar(1 + (i + c) % 5) / 8.);
+        }
+    }
+    SparseMatrix A(Ni, Nj, triplets);
+
+    const auto& linalg  = linalg::LinearAlgebraSparse::backend();
+    const auto& generic = linalg::LinearAlgebraSparse::getBackend("generic");
+
+    SECTION("spmv") {
+        Vector x(Nj);
+        for (Size j = 0; j < Nj; ++j) {
+            x[j] = Scalar(j % 11) - 5.;
+        }
+
+        Vector y(Ni);
+        Vector z(Ni);
+        linalg.spmv(A, x, y);
+        generic.spmv(A, x, z);
+        EXPECT(equal_dense_matrix(y, z, Ni));
+    }
+
+    SECTION("spmm") {
+        Matrix B(Nj, Nk);
+        for (Size j = 0; j < Nj; ++j) {
+            for (Size k = 0; k < Nk; ++k) {
+                B(j, k) = Scalar((j + 3 * k) % 13) - 6.;
+            }
+        }
+
+        Matrix C(Ni, Nk);
+        Matrix D(Ni, Nk);
+        linalg.spmm(A, B, C);
+        generic.spmm(A, B, D);
+        EXPECT(equal_dense_matrix(C, D, Ni * Nk));
+    }
+}
+
+CASE("test single precision against double precision") {
+    using linalg::Matrix;
+    using linalg::Scalar;
+    using linalg::Size;
+    using linalg::SparseMatrix;
+    using linalg::SparseMatrixFloat;
+    using linalg::Triplet;
+    using linalg::Vector;
+
+    const Size Ni = 517;
+    const Size Nj = 433;
+    const Size Nk = 11;
+
+    std::vector<Triplet> triplets;
+    for (Size i = 0; i < Ni; ++i) {
+        for (Size c = 0; c < 1 + i % 19; ++c) {
+            triplets.emplace_back(i, (i * 7 + c * 23) % Nj, Scalar(1 + (i + c) % 9) / 9.);
+        }
+    }
+    std::sort(triplets.begin(), triplets.end());
+    triplets.erase(std::unique(triplets.begin(), triplets.end(),
+                               [](const Triplet& a, const Triplet& b) {
+                                   return a.row() == b.row() && a.col() == b.col();
+                               }),
+                   triplets.end());
+
+    // entries exactly representable in single precision are not required, products are compared with tolerance
+    const SparseMatrix A(Ni, Nj, triplets);
+    const SparseMatrixFloat F(A);
+
+    const auto& linalg  = linalg::LinearAlgebraSparse::backend();
+    const auto& generic = linalg::LinearAlgebraSparse::getBackend("generic");
+
+    SECTION("spmv") {
+        Vector x(Nj);
+        for (Size j = 0; j < Nj; ++j) {
+            x[j] = Scalar(j % 11) - 5.;
+        }
+
+        Vector y(Ni);
+        Vector z(Ni);
+        linalg.spmv(F, x, y);
+        generic.spmv(A, x, z);
+        EXPECT(equal_dense_matrix(y, z, Ni));
+    }
+
+    SECTION("spmm") {
+        Matrix B(Nj, Nk);
+        for (Size j = 0; j < Nj; ++j) {
+            for (Size k = 0; k < Nk; ++k) {
+                B(j, k) = Scalar((j + 3 * k) % 13) - 6.;
+            }
+        }
+
+        Matrix C(Ni, Nk);
+        Matrix D(Ni, Nk);
+        linalg.spmm(F, B, C);
+        generic.spmm(A, B, D);
+        EXPECT(equal_dense_matrix(C, D, Ni * Nk));
+    }
+
+    SECTION("single precision accumulation") {
+        SparseMatrixFloat G(F);
+        EXPECT(G.accumulation() == SparseMatrixFloat::Accumulation::Double);
+        G.accumulation(SparseMatrixFloat::Accumulation::Float);
+        EXPECT(SparseMatrixFloat(G).accumulation() == SparseMatrixFloat::Accumulation::Float);
+
+        Vector x(Nj);
+        for (Size j = 0; j < Nj; ++j) {
+            x[j] = Scalar(j % 11) - 5.;
+        }
+
+        Vector y(Ni);
+        Vector z(Ni);
+        linalg.spmv(G, x, y);
+        generic.spmv(A, x, z);
+        EXPECT(equal_dense_matrix(y, z, Ni));
+
+        Matrix B(Nj, Nk);
+        for (Size j = 0; j < Nj; ++j) {
+            for (Size k = 0; k < Nk; ++k) {
+                B(j, k) = Scalar((j + 3 * k) % 13) - 6.;
+            }
+        }
+
+        Matrix C(Ni, Nk);
+        Matrix D(Ni, Nk);
+        linalg.spmm(G, B, C);
+        generic.spmm(A, B, D);
+        EXPECT(equal_dense_matrix(C, D, Ni * Nk));
+    }
+}
+
+CASE("test storage formats against CSR") {
+    using linalg::Matrix;
+    using linalg::Scalar;
+    using linalg::Size;
+    using linalg::SparseMatrix;
+    using linalg::Triplet;
+    using linalg::Vector;
+
+    using Format = SparseMatrix::Format;
+
+    const Size Ni = 1003;
+    const Size Nj = 802;
+    const Size Nk = 5;
+
+    // near-constant row length (interpolation-like), 3x3 dense blocks (coupled components), skewed row length
+    std::vector<Triplet> interpolation;
+    std::vector<Triplet> blocked;
+    std::vector<Triplet> skewed;
+    for (Size i = 0; i < Ni; ++i) {
+        for (Size c = 0; c < (i % 13 == 0 ? 3 : 4); ++c) {
+            interpolation.emplace_back(i, (i * 4 / 5 + c * 3) % Nj, Scalar(1 + (i + c) % 4) / 10.);
+        }
+        for (Size b = 0; b < 2; ++b) {
+            const auto j0 = ((i / 3 + b * 50) % (Nj / 3)) * 3;
+            for (Size c = 0; c < 3; ++c) {
+                blocked.emplace_back(i, j0 + c, Scalar(1 + (i + b + c) % 7));
+            }
+        }
+        const Size n = i % 97 == 0 ? 300 : i % 7;
+        for (Size c = 0; c < n; ++c) {
+            skewed.emplace_back(i, (i * 31 + c * 17) % Nj, Scalar(1 + (i + c) % 5) / 8.);
+        }
+    }
+
+    for (auto* triplets : {&interpolation, &blocked, &skewed}) {
+        std::sort(triplets->begin(), triplets->end());
+        triplets->erase(std::unique(triplets->begin(), triplets->end(),
+                                    [](const Triplet& a, const Triplet& b) {
+                                        return a.row() == b.row() && a.col() == b.col();
+                                    }),
+                        triplets->end());
+    }
+
+    SparseMatrix I(Ni, Nj, interpolation);
+    SparseMatrix B(Ni, Nj, blocked);
+    SparseMatrix K(Ni, Nj, skewed);
+
+    EXPECT(I.bestFormat() == Format::SELL);
+    EXPECT(B.bestFormat() == Format::BCSR);
+    EXPECT(K.bestFormat() == Format::CSR);
+
+    const auto& linalg  = linalg::LinearAlgebraSparse::backend();
+    const auto& generic = linalg::LinearAlgebraSparse::getBackend("generic");
+
+    Vector x(Nj);
+    Matrix X(Nj, Nk);
+    for (Size j = 0; j < Nj; ++j) {
+        x[j] = Scalar(j % 11) - 5.;
+        for (Size k = 0; k < Nk; ++k) {
+            X(j, k) = Scalar((j + 3 * k) % 13) - 6.;
+        }
+    }
+
+    for (const auto* A : {&I, &B, &K}) {
+        for (auto format : {Format::SELL, Format::BCSR}) {
+            SparseMatrix F(*A);
+            F.format(format);
+            EXPECT(F.format() == format);
+            Log::info() << F << std::endl;
+
+            Vector y(Ni);
+            Vector z(Ni);
+            linalg.spmv(F, x, y);
+            generic.spmv(*A, x, z);
+            EXPECT(equal_dense_matrix(y, z, Ni));
+
+            Matrix Y(Ni, Nk);
+            Matrix Z(Ni, Nk);
+            linalg.spmm(F, X, Y);
+            generic.spmm(*A, X, Z);
+            EXPECT(equal_dense_matrix(Y, Z, Ni * Nk));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 }  // namespace eckit::test
 
 int main(int argc, char** argv) {
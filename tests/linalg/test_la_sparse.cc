@@ -8,7 +8,14 @@
  * nor does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "eckit/config/Resource.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/linalg/SparseMatrix.h"
+#include "eckit/linalg/detail/SparseFormat.h"
 #include "util.h"
 
 using namespace eckit::linalg;
@@ -242,6 +249,224 @@ CASE("creation with unassigned triplets ( ECKIT-361 )") {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+CASE("storage formats") {
+    using Format = SparseMatrix::Format;
+
+    const Size Ni = 37;
+    const Size Nj = 29;
+
+    std::vector<Triplet> triplets;
+    for (Size i = 0; i < Ni; ++i) {
+        for (Size c = 0; c < 1 + i % 3; ++c) {
+            triplets.emplace_back(i, (i + 5 * c) % Nj, Scalar(1 + i + c));
+        }
+    }
+    std::sort(triplets.begin(), triplets.end());
+
+    const SparseMatrix A(Ni, Nj, triplets);
+    EXPECT(A.format() == Format::CSR);
+    EXPECT(A.formatted() == nullptr);
+
+    std::vector<Scalar> x(Nj);
+    std::vector<Scalar> ref(Ni, 0.);
+    for (Size j = 0; j < Nj; ++j) {
+        x[j] = Scalar(j % 7) - 3.;
+    }
+    for (auto it = A.begin(); it != A.end(); ++it) {
+        ref[it.row()] += *it * x[it.col()];
+    }
+
+    auto spmv = [&x](const SparseMatrix& M) {
+        std::vector<Scalar> y(M.rows(), -42.);
+        EXPECT(M.formatted() != nullptr);
+        M.formatted()->spmv(x.data(), y.data());
+        return y;
+    };
+
+    for (auto format : {Format::SELL, Format::BCSR}) {
+        SparseMatrix B(A);
+        B.format(format);
+        EXPECT(B.format() == format);
+        EXPECT(B.footprint() > A.footprint());
+        EXPECT(spmv(B) == ref);
+
+        SECTION("copies are CSR") {
+            SparseMatrix C(B);
+            EXPECT(C.format() == Format::CSR);
+            EXPECT(B.format(Format::CSR).format() == Format::CSR);
+        }
+
+        SECTION("transpose resets format") {
+            EXPECT(B.transpose().format() == Format::CSR);
+        }
+
+        SECTION("save/load") {
+            PathName path = PathName::unique("matrix");
+            B.save(path);
+
+            SparseMatrix C;
+            C.load(path);
+            EXPECT(C.format() == format);
+            EXPECT(spmv(C) == ref);
+
+            A.save(path);
+            C.load(path);
+            EXPECT(C.format() == Format::CSR);
+
+            path.unlink();
+        }
+
+        SECTION("dump/load") {
+            MemoryBuffer buffer(B.footprint());
+            B.dump(buffer);
+
+            SparseMatrix C(buffer);
+            EXPECT(C.format() == format);
+            EXPECT(spmv(C) == ref);
+            EXPECT(equal_sparse_matrix(C, A.outer(), A.inner(), A.data()));
+        }
+
+        SECTION("non-const access resets format") {
+            auto it = B.begin();
+            *it     = 42.;
+            EXPECT(B.format() == Format::CSR);
+            EXPECT(B.formatted() == nullptr);
+        }
+    }
+}
+
+
+CASE("storage formats with non-finite x") {
+    using Format = SparseMatrix::Format;
+
+    const Size Ni = 37;
+    const Size Nj = 29;
+
+    // rows of different lengths (SELL padding), an empty row and an explicit zero (as in CSR, 0 * NaN is NaN)
+    std::vector<Triplet> triplets;
+    for (Size i = 0; i < Ni; ++i) {
+        for (Size c = 0; i != 11 && c < 1 + i % 3; ++c) {
+            triplets.emplace_back(i, (i + 5 * c) % Nj, i == 20 ? 0. : Scalar(1 + i + c));
+        }
+    }
+    std::sort(triplets.begin(), triplets.end());
+
+    const SparseMatrix A(Ni, Nj, triplets);
+
+    std::vector<Scalar> x(Nj, 1.);
+    x[0]  = std::numeric_limits<Scalar>::quiet_NaN();
+    x[5]  = std::numeric_limits<Scalar>::infinity();
+    x[13] = -std::numeric_limits<Scalar>::infinity();
+
+    std::vector<Scalar> ref(Ni, 0.);
+    for (Size i = 0; i < Ni; ++i) {
+        for (auto k = A.outer()[i]; k < A.outer()[i + 1]; ++k) {
+            ref[i] += A.data()[k] * x[Size(A.inner()[k])];
+        }
+    }
+    EXPECT(std::any_of(ref.begin(), ref.end(), [](Scalar v) { return std::isnan(v); }));
+    EXPECT(std::any_of(ref.begin(), ref.end(), [](Scalar v) { return std::isinf(v); }));
+
+    auto same = [](Scalar a, Scalar b) { return (std::isnan(a) && std::isnan(b)) || a == b; };
+
+    for (auto format : {Format::SELL, Format::BCSR}) {
+        SparseMatrix B(A);
+        B.format(format);
+        EXPECT(B.format() == format);
+
+        std::vector<Scalar> y(Ni, -42.);
+        B.formatted()->spmv(x.data(), y.data());
+        EXPECT(std::equal(y.begin(), y.end(), ref.begin(), same));
+
+        // spmm, with a finite column
+        std::vector<Scalar> X(x);
+        X.insert(X.end(), Nj, 2.);
+
+        std::vector<Scalar> Y(2 * Ni, -42.);
+        B.formatted()->spmm(X.data(), Y.data(), 2);
+        EXPECT(std::equal(Y.begin(), Y.begin() + Ni, ref.begin(), same));
+        for (Size i = 0; i < Ni; ++i) {
+            EXPECT(std::isfinite(Y[Ni + i]));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("single precision") {
+    // A =  2  . -3
+    //      .  2  .
+    //      .  .  0.1
+    const SparseMatrix A(S(3, 3, 4, 0, 0, 2., 0, 2, -3., 1, 1, 2., 2, 2, 0.1));
+
+    auto equal = [](const SparseMatrixFloat& F, const SparseMatrix& A) {
+        const std::vector<float> data(A.data(), A.data() + A.nonZeros());
+        return F.rows() == A.rows() && F.cols() == A.cols() && F.nonZeros() == A.nonZeros() &&
+               equal_array(F.outer(), A.outer(), A.rows() + 1) && equal_array(F.inner(), A.inner(), A.nonZeros()) &&
+               equal_array(F.data(), data.data(), A.nonZeros());
+    };
+
+    SECTION("conversion") {
+        SparseMatrixFloat F(A);
+        EXPECT(equal(F, A));
+        EXPECT(F.footprint() < A.footprint());
+
+        SparseMatrixFloat G(F);
+        EXPECT(equal(G, A));
+
+        SparseMatrixFloat H(std::move(G));
+        EXPECT(equal(H, A));
+        EXPECT(G.empty());
+    }
+
+    SECTION("save/load") {
+        PathName path = PathName::unique("matrix");
+
+        SparseMatrixFloat F(A);
+        F.save(path);
+
+        SparseMatrixFloat G;
+        G.load(path);
+        EXPECT(equal(G, A));
+
+        // single precision entries are widened by SparseMatrix
+        SparseMatrix B;
+        B.load(path);
+        EXPECT(B.nonZeros() == A.nonZeros());
+        EXPECT(B.data()[3] == double(0.1f));
+
+        // double precision entries are rounded by SparseMatrixFloat
+        A.save(path);
+        G.load(path);
+        EXPECT(equal(G, A));
+
+        path.unlink();
+    }
+
+    SECTION("dump/load") {
+        SparseMatrixFloat F(A);
+
+        MemoryBuffer buffer(F.footprint());
+        F.dump(buffer);
+
+        SparseMatrixFloat G(buffer);
+        EXPECT(equal(G, A));
+
+        MemoryBuffer other(A.footprint());
+        A.dump(other);
+        EXPECT_THROWS_AS(SparseMatrixFloat{other}, AssertionFailed);
+    }
+
+    SECTION("storage formats") {
+        SparseMatrixFloat F(A);
+        EXPECT(F.format(SparseMatrix::Format::CSR).format() == SparseMatrix::Format::CSR);
+        EXPECT(F.bestFormat() == SparseMatrix::Format::CSR);
+        EXPECT_THROWS_AS(F.format(SparseMatrix::Format::SELL), UserError);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 }  // namespace eckit::test
 
 int main(int argc, char** argv) {
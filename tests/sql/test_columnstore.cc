@@ -0,0 +1,84 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstring>
+#include <memory>
+
+#include "eckit/container/ColumnStore.h"
+#include "eckit/sql/ColumnStoreTable.h"
+#include "eckit/sql/SQLColumn.h"
+#include "eckit/sql/SQLDatabase.h"
+#include "eckit/testing/Test.h"
+
+using namespace eckit::testing;
+
+namespace {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Scan a column store") {
+
+    const eckit::PathName dir("test_sql_columnstore.dir");
+
+    using eckit::ColumnStore;
+
+    {
+        ColumnStore store(dir,
+                          {{"icol", ColumnStore::INTEGER},
+                           {"scol", ColumnStore::STRING, 2},
+                           {"rcol", ColumnStore::REAL, 1, "none", true, -1.}},
+                          3);
+
+        for (size_t i = 0; i < 10; ++i) {
+            std::vector<double> row(4, 0.);
+            row[0] = double(i);
+            ::strncpy(reinterpret_cast<char*>(&row[1]), "a-string", 16);
+            row[3] = i == 5 ? -1. : i * 1.5;
+            store.append(row);
+        }
+    }
+
+    eckit::sql::SQLDatabase db;
+    auto* table = new eckit::sql::ColumnStoreTable(db, dir, "table1");
+    db.addTable(table);
+
+    EXPECT(table->columnNames() == std::vector<std::string>({"icol", "scol", "rcol"}));
+    EXPECT(table->column("scol").type().size() == 16);
+    EXPECT(table->column("rcol").hasMissingValue());
+
+    // a subset of the columns, in another order
+    std::vector<std::reference_wrapper<const eckit::sql::SQLColumn>> columns{table->column("rcol"),
+                                                                             table->column("scol")};
+    std::unique_ptr<eckit::sql::SQLTableIterator> it(table->iterator(columns, nullptr));
+
+    EXPECT(it->columnOffsets() == std::vector<size_t>({0, 1}));
+    EXPECT(it->doublesDataSizes() == std::vector<size_t>({1, 2}));
+    EXPECT(it->columnsHaveMissing() == std::vector<char>({1, 0}));
+
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t i = 0;
+        while (it->next()) {
+            const double* data = it->data();
+            EXPECT(data[0] == (i == 5 ? -1. : i * 1.5));
+            EXPECT(std::string(reinterpret_cast<const char*>(&data[1])) == "a-string");
+            ++i;
+        }
+        EXPECT(i == 10);
+        it->rewind();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}
@@ -0,0 +1,283 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <thread>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/thread/TaskScheduler.h"
+#include "eckit/thread/ThreadPool.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+
+namespace eckit::test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+long fibonacci(TaskScheduler& scheduler, long n) {
+    if (n < 2) {
+        return n;
+    }
+
+    long a = 0;
+    long b = 0;
+
+    TaskGroup group(scheduler);
+    group.run([&] { a = fibonacci(scheduler, n - 1); });
+    b = fibonacci(scheduler, n - 2);
+    group.wait();
+
+    return a + b;
+}
+
+CASE("futures") {
+    TaskScheduler scheduler("futures", 4);
+    EXPECT(scheduler.size() == 4);
+
+    std::vector<std::future<size_t>> results;
+    for (size_t i = 0; i < 1000; ++i) {
+        results.emplace_back(scheduler.submit([i] { return i * i; }));
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT(results[i].get() == i * i);
+    }
+
+    auto failed = scheduler.submit([]() -> int { throw BadValue("expected"); });
+    EXPECT_THROWS_AS(failed.get(), BadValue);
+}
+
+CASE("nested parallelism") {
+    // more blocked waits than workers, which would deadlock if waiting did not execute other tasks
+    for (size_t workers : {1, 2, 3}) {
+        TaskScheduler scheduler("nested", workers);
+        auto result = scheduler.submit([&scheduler] { return fibonacci(scheduler, 18); });
+        EXPECT(result.get() == 2584);
+    }
+
+    SECTION("futures within tasks") {
+        TaskScheduler scheduler("nested", 1);
+        auto outer = scheduler.submit([&scheduler] {
+            auto inner = scheduler.submit([] { return 42; });
+            return scheduler.get(inner) + 1;
+        });
+        EXPECT(outer.get() == 43);
+    }
+}
+
+CASE("task groups") {
+    TaskScheduler scheduler("groups", 4);
+
+    SECTION("wait") {
+        std::atomic<size_t> count(0);
+
+        TaskGroup group(scheduler);
+        for (size_t i = 0; i < 10000; ++i) {
+            group.run([&count] { count++; });
+        }
+        group.wait();
+
+        EXPECT(count == 10000);
+    }
+
+    SECTION("cancel") {
+        TaskScheduler scheduler("cancel", 1);
+
+        // occupy the only worker, so that the group's tasks are still pending when cancelled
+        std::promise<void> gate;
+        auto busy = scheduler.submit([future = gate.get_future()]() mutable { future.wait(); });
+
+        std::atomic<size_t> count(0);
+
+        TaskGroup group(scheduler);
+        for (size_t i = 0; i < 100; ++i) {
+            group.run([&count] { count++; });
+        }
+        group.cancel();
+        EXPECT(group.cancelled());
+
+        gate.set_value();
+        group.wait();
+        EXPECT(count == 0);
+
+        // a group can be reused after wait()
+        EXPECT(!group.cancelled());
+        group.run([&count] { count++; });
+        group.wait();
+        EXPECT(count == 1);
+    }
+
+    SECTION("exception cancels the group") {
+        TaskScheduler scheduler("exception", 1);
+
+        std::promise<void> gate;
+        std::atomic<size_t> count(0);
+
+        // tasks submitted from outside the scheduler start in submission order
+        TaskGroup group(scheduler);
+        group.run([future = gate.get_future().share()] {
+            future.wait();
+            throw BadValue("expected");
+        });
+        for (size_t i = 0; i < 100; ++i) {
+            group.run([&count] { count++; });
+        }
+
+        gate.set_value();
+        EXPECT_THROWS_AS(group.wait(), BadValue);
+        EXPECT(count == 0);
+    }
+}
+
+CASE("ThreadPool") {
+    class Counter : public ThreadPoolTask {
+        std::atomic<size_t>& count_;
+        bool fail_;
+        void execute() override {
+            count_++;
+            if (fail_) {
+                throw BadValue("expected");
+            }
+        }
+
+    public:
+        Counter(std::atomic<size_t>& count, bool fail = false) :
+            count_(count), fail_(fail) {}
+    };
+
+    std::atomic<size_t> count(0);
+
+    ThreadPool pool("pool", 4);
+    for (size_t i = 0; i < 1000; ++i) {
+        pool.push(new Counter(count));
+    }
+    pool.wait();
+    EXPECT(count == 1000);
+
+    pool.resize(2);
+    EXPECT(pool.scheduler().size() == 2);
+
+    std::list<ThreadPoolTask*> tasks;
+    for (size_t i = 0; i < 10; ++i) {
+        tasks.push_back(new Counter(count, i == 5));
+    }
+    pool.push(tasks);
+    EXPECT(tasks.empty());
+
+    EXPECT_THROWS_AS(pool.waitForThreads(), SeriousBug);
+    EXPECT(count == 1010);
+
+    // errors are reported once
+    EXPECT_NO_THROW(pool.waitForThreads());
+
+    // a null task stops a thread
+    pool.push(nullptr);
+    pool.wait();
+    EXPECT(pool.size() == 1);
+}
+
+CASE("ThreadPool without threads") {
+    class Pusher : public ThreadPoolTask {
+        std::atomic<size_t>& count_;
+        std::thread::id& thread_;
+        void execute() override {
+            thread_ = std::this_thread::get_id();
+            if (count_++ < 10) {
+                pool().push(new Pusher(count_, thread_));
+            }
+        }
+
+    public:
+        Pusher(std::atomic<size_t>& count, std::thread::id& thread) :
+            count_(count), thread_(thread) {}
+    };
+
+    std::atomic<size_t> count(0);
+    std::thread::id thread;
+
+    ThreadPool pool("pool", 0);
+    EXPECT(pool.size() == 0);
+
+    pool.push(new Pusher(count, thread));
+    EXPECT(count == 0);
+
+    pool.wait();
+    EXPECT(count == 11);
+    EXPECT(thread == std::this_thread::get_id());
+
+    // queued tasks move to the threads
+    pool.push(new Pusher(count, thread));
+    pool.resize(2);
+    pool.wait();
+    EXPECT(count == 12);
+    EXPECT(thread != std::this_thread::get_id());
+}
+
+CASE("ThreadPool resized from a task") {
+    class Resizer : public ThreadPoolTask {
+        void execute() override { pool().resize(1); }
+    };
+
+    ThreadPool pool("pool", 2);
+    pool.push(new Resizer);
+
+    EXPECT_THROWS_AS(pool.waitForThreads(), SeriousBug);
+    EXPECT(pool.size() == 2);
+}
+
+CASE("ThreadPool pushed to while resized") {
+    class Counter : public ThreadPoolTask {
+        std::atomic<size_t>& count_;
+        void execute() override { count_++; }
+
+    public:
+        Counter(std::atomic<size_t>& count) :
+            count_(count) {}
+    };
+
+    std::atomic<size_t> count(0);
+
+    ThreadPool pool("pool", 2);
+
+    std::vector<std::thread> pushers;
+    for (size_t t = 0; t < 4; ++t) {
+        pushers.emplace_back([&] {
+            for (size_t i = 0; i < 2000; ++i) {
+                pool.push(new Counter(count));
+                EXPECT(pool.size() <= 4);
+            }
+        });
+    }
+
+    for (size_t i = 0; i < 20; ++i) {
+        pool.resize(i % 4 + 1);
+    }
+
+    for (auto& t : pushers) {
+        t.join();
+    }
+
+    pool.wait();
+    EXPECT(count == 8000);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace eckit::test
+
+int main(int argc, char** argv) {
+    return run_tests(argc, argv);
+}